@@ -0,0 +1,609 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of merchantability or fitness for a particular purpose, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+
+/*!
+
+    bfd_bench - Synthetic BFD file generator and microbenchmark.
+
+    This builds a synthetic BFD file (configurable record count, polygon density, polygon size,
+    image density, image size, and byte order) and then times the common library calls against
+    it.  Every timed call is recorded so that latency percentiles can be reported along with
+    throughput.  The results are written to stdout (or the -j file) as JSON so that runs can be
+    compared by a script.
+
+    Build (POSIX systems only since it uses clock_gettime) with "make bench" from the top level directory.  That
+    links it against libBFD.a and leaves it in bench/bfd_bench.
+
+    Run "bfd_bench -h" for the options.
+
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <getopt.h>
+
+#include "binaryFeatureData.h"
+
+
+/*  Timings for one benchmarked operation.  */
+
+typedef struct
+{
+  const char    *name;
+  uint32_t      count;
+  uint32_t      alloc;
+  uint64_t      *ns;
+  uint64_t      total_ns;
+  uint64_t      bytes;
+} BENCH_TIMER;
+
+
+/*  Generator and benchmark settings.  */
+
+typedef struct
+{
+  char          path[1024];
+  uint32_t      records;
+  double        poly_density;
+  uint32_t      poly_points;
+  double        image_density;
+  uint32_t      image_size;
+  int32_t       endian;                     /*  -1 = native, 0 = little, 1 = big  */
+  uint32_t      random_reads;
+  uint32_t      updates;
+  uint32_t      opens;
+  uint64_t      seed;
+  uint8_t       keep;
+} BENCH_CONFIG;
+
+
+#define BENCH_TIMERS 11
+
+static BENCH_TIMER timer[BENCH_TIMERS] =
+  {{"write_append", 0, 0, NULL, 0, 0}, {"close_create", 0, 0, NULL, 0, 0}, {"open", 0, 0, NULL, 0, 0}, {"close", 0, 0, NULL, 0, 0},
+   {"read_record_sequential", 0, 0, NULL, 0, 0}, {"read_record_random", 0, 0, NULL, 0, 0},
+   {"read_all_short_features", 0, 0, NULL, 0, 0}, {"read_polygon", 0, 0, NULL, 0, 0}, {"read_image", 0, 0, NULL, 0, 0},
+   {"write_update", 0, 0, NULL, 0, 0}, {"close_update", 0, 0, NULL, 0, 0}};
+
+enum {T_APPEND, T_CLOSE_CREATE, T_OPEN, T_CLOSE, T_SEQ, T_RANDOM, T_SHORT, T_POLY, T_IMAGE, T_UPDATE, T_CLOSE_UPDATE};
+
+
+static uint64_t rng_state;
+
+
+
+/*  xorshift64*, so the generated file only depends on the seed.  */
+
+static uint64_t rng ()
+{
+  rng_state ^= rng_state >> 12;
+  rng_state ^= rng_state << 25;
+  rng_state ^= rng_state >> 27;
+  return (rng_state * 2685821657736338717ULL);
+}
+
+
+
+static double rng_uniform ()
+{
+  return ((rng () >> 11) * (1.0 / 9007199254740992.0));
+}
+
+
+
+static uint64_t now_ns ()
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+
+  return ((uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec);
+}
+
+
+
+static void timer_add (BENCH_TIMER *t, uint64_t ns, uint64_t bytes)
+{
+  if (t->count == t->alloc)
+    {
+      t->alloc = t->alloc ? t->alloc * 2 : 1024;
+      if ((t->ns = (uint64_t *) realloc (t->ns, t->alloc * sizeof (uint64_t))) == NULL)
+        {
+          perror ("Allocating timer samples");
+          exit (-1);
+        }
+    }
+
+  t->ns[t->count++] = ns;
+  t->total_ns += ns;
+  t->bytes += bytes;
+}
+
+
+
+static int compare_ns (const void *a, const void *b)
+{
+  uint64_t x = *((const uint64_t *) a), y = *((const uint64_t *) b);
+
+  return ((x > y) - (x < y));
+}
+
+
+
+/*  Nearest rank percentile of the (sorted) samples.  */
+
+static uint64_t percentile (BENCH_TIMER *t, double p)
+{
+  uint32_t rank;
+
+  if (!t->count) return (0);
+
+  rank = (uint32_t) ceil (p / 100.0 * t->count);
+  if (rank < 1) rank = 1;
+  if (rank > t->count) rank = t->count;
+
+  return (t->ns[rank - 1]);
+}
+
+
+
+static void check (int32_t status, const char *what)
+{
+  if (status < 0)
+    {
+      fprintf (stderr, "%s failed\n", what);
+      binaryFeatureData_perror ();
+      exit (-1);
+    }
+}
+
+
+
+/*  Fill in record i of the synthetic file.  The polygon and image (if any) are generated into poly and image and
+    *has_poly and *has_image are set to match.  Everything is derived from the PRNG so that a record can be rebuilt
+    later for verification by reseeding.  */
+
+static void make_record (BENCH_CONFIG *config, uint32_t i, BFDATA_RECORD *bfd_record, BFDATA_POLYGON *poly, uint8_t *image,
+                         uint8_t *has_poly, uint8_t *has_image)
+{
+  uint32_t j;
+  double radius;
+
+
+  memset (bfd_record, 0, sizeof (BFDATA_RECORD));
+
+  sprintf (bfd_record->contact_id, "C%08u", i);
+  bfd_record->event_tv_sec = 1600000000 + i;
+  bfd_record->event_tv_nsec = (long) (rng () % 1000000000);
+  bfd_record->latitude = 30.0 + rng_uniform ();
+  bfd_record->longitude = -89.0 + rng_uniform ();
+  bfd_record->length = (float) (rng_uniform () * 10.0);
+  bfd_record->width = (float) (rng_uniform () * 10.0);
+  bfd_record->height = (float) (rng_uniform () * 2.0);
+  bfd_record->depth = (float) (rng_uniform () * 100.0);
+  bfd_record->horizontal_orientation = (float) (rng_uniform () * 360.0);
+  bfd_record->heading = (float) (rng_uniform () * 360.0);
+  bfd_record->confidence_level = (uint8_t) (rng () % 6);
+  bfd_record->feature_type = (uint8_t) (rng () % BFDATA_FEATURE_TYPES);
+  sprintf (bfd_record->description, "Synthetic feature %u", i);
+  strcpy (bfd_record->analyst_activity, "bfd_bench");
+
+
+  *has_poly = (rng_uniform () < config->poly_density && config->poly_points);
+  if (*has_poly)
+    {
+      radius = 0.0001 + rng_uniform () * 0.001;
+      bfd_record->poly_count = config->poly_points;
+      bfd_record->poly_type = 1;
+
+      for (j = 0 ; j < config->poly_points ; j++)
+        {
+          poly->latitude[j] = bfd_record->latitude + radius * cos (2.0 * M_PI * j / config->poly_points);
+          poly->longitude[j] = bfd_record->longitude + radius * sin (2.0 * M_PI * j / config->poly_points);
+        }
+    }
+
+
+  *has_image = (rng_uniform () < config->image_density && config->image_size);
+  if (*has_image)
+    {
+      bfd_record->image_size = config->image_size;
+      sprintf (bfd_record->image_name, "image_%08u.jpg", i);
+      for (j = 0 ; j < config->image_size ; j++) image[j] = (uint8_t) (i + j);
+    }
+}
+
+
+
+static void usage ()
+{
+  fprintf (stderr, "\nUsage: bfd_bench [OPTIONS]\n\n");
+  fprintf (stderr, "  -f PATH     BFD file to generate (default /tmp/bfd_bench.bfd)\n");
+  fprintf (stderr, "  -n COUNT    Number of records (default 100000)\n");
+  fprintf (stderr, "  -p DENSITY  Fraction of records with a polygon (default 0.3)\n");
+  fprintf (stderr, "  -v COUNT    Points per polygon (default 32, max %d)\n", BFDATA_POLY_ARRAY_SIZE);
+  fprintf (stderr, "  -i DENSITY  Fraction of records with an image (default 0.1)\n");
+  fprintf (stderr, "  -s BYTES    Image size in bytes (default 16384)\n");
+  fprintf (stderr, "  -e ENDIAN   native, little, or big (default native)\n");
+  fprintf (stderr, "  -r COUNT    Number of random record reads (default 100000)\n");
+  fprintf (stderr, "  -u COUNT    Number of record updates (default 10000)\n");
+  fprintf (stderr, "  -o COUNT    Number of open/close cycles (default 20)\n");
+  fprintf (stderr, "  -S SEED     PRNG seed (default 1)\n");
+  fprintf (stderr, "  -j PATH     Write the JSON results to PATH instead of stdout\n");
+  fprintf (stderr, "  -k          Keep the generated file\n\n");
+  exit (-1);
+}
+
+
+
+static void write_json (FILE *fp, BENCH_CONFIG *config)
+{
+  int32_t i;
+  BENCH_TIMER *t;
+  double seconds;
+
+
+  fprintf (fp, "{\n");
+  fprintf (fp, "  \"version\": \"%s\",\n", binaryFeatureData_get_version ());
+  fprintf (fp, "  \"config\": {\"records\": %u, \"poly_density\": %g, \"poly_points\": %u, \"image_density\": %g, ",
+           config->records, config->poly_density, config->poly_points, config->image_density);
+  fprintf (fp, "\"image_size\": %u, \"endian\": \"%s\", \"random_reads\": %u, \"updates\": %u, \"opens\": %u, \"seed\": %llu},\n",
+           config->image_size, config->endian < 0 ? "native" : config->endian ? "big" : "little", config->random_reads,
+           config->updates, config->opens, (unsigned long long) config->seed);
+  fprintf (fp, "  \"results\": [\n");
+
+  for (i = 0 ; i < BENCH_TIMERS ; i++)
+    {
+      t = &timer[i];
+      qsort (t->ns, t->count, sizeof (uint64_t), compare_ns);
+      seconds = t->total_ns * 1.0e-9;
+
+      fprintf (fp, "    {\"name\": \"%s\", \"count\": %u, \"seconds\": %.9f, \"ops_per_sec\": %.1f, \"mb_per_sec\": %.3f, ",
+               t->name, t->count, seconds, seconds > 0.0 ? t->count / seconds : 0.0,
+               seconds > 0.0 ? t->bytes / seconds / 1048576.0 : 0.0);
+      fprintf (fp, "\"latency_ns\": {\"min\": %llu, \"p50\": %llu, \"p90\": %llu, \"p99\": %llu, \"p999\": %llu, \"max\": %llu, \"mean\": %.1f}}%s\n",
+               (unsigned long long) percentile (t, 0.0), (unsigned long long) percentile (t, 50.0),
+               (unsigned long long) percentile (t, 90.0), (unsigned long long) percentile (t, 99.0),
+               (unsigned long long) percentile (t, 99.9), (unsigned long long) percentile (t, 100.0),
+               t->count ? (double) t->total_ns / t->count : 0.0, i < BENCH_TIMERS - 1 ? "," : "");
+    }
+
+  fprintf (fp, "  ]\n}\n");
+}
+
+
+
+int main (int argc, char **argv)
+{
+  BENCH_CONFIG config;
+  BFDATA_HEADER bfd_header;
+  BFDATA_RECORD bfd_record, copy, expected;
+  BFDATA_SHORT_FEATURE *short_feature;
+  static BFDATA_POLYGON poly;
+  uint8_t *image, *check_image, has_poly, has_image, *with_poly, *with_image;
+  uint32_t i, j, recnum, poly_bytes, record_bytes;
+  int32_t hnd, option;
+  uint64_t start;
+  char json_path[1024] = "", a_path[1024];
+  FILE *fp;
+
+
+  strcpy (config.path, "/tmp/bfd_bench.bfd");
+  config.records = 100000;
+  config.poly_density = 0.3;
+  config.poly_points = 32;
+  config.image_density = 0.1;
+  config.image_size = 16384;
+  config.endian = -1;
+  config.random_reads = 100000;
+  config.updates = 10000;
+  config.opens = 20;
+  config.seed = 1;
+  config.keep = 0;
+
+
+  while ((option = getopt (argc, argv, "f:n:p:v:i:s:e:r:u:o:S:j:kh")) != EOF)
+    {
+      switch (option)
+        {
+        case 'f':
+          strcpy (config.path, optarg);
+          break;
+
+        case 'n':
+          config.records = (uint32_t) strtoul (optarg, NULL, 10);
+          break;
+
+        case 'p':
+          config.poly_density = atof (optarg);
+          break;
+
+        case 'v':
+          config.poly_points = (uint32_t) strtoul (optarg, NULL, 10);
+          if (config.poly_points > BFDATA_POLY_ARRAY_SIZE) usage ();
+          break;
+
+        case 'i':
+          config.image_density = atof (optarg);
+          break;
+
+        case 's':
+          config.image_size = (uint32_t) strtoul (optarg, NULL, 10);
+          break;
+
+        case 'e':
+          if (!strcmp (optarg, "native"))
+            {
+              config.endian = -1;
+            }
+          else if (!strcmp (optarg, "little"))
+            {
+              config.endian = 0;
+            }
+          else if (!strcmp (optarg, "big"))
+            {
+              config.endian = 1;
+            }
+          else
+            {
+              usage ();
+            }
+          break;
+
+        case 'r':
+          config.random_reads = (uint32_t) strtoul (optarg, NULL, 10);
+          break;
+
+        case 'u':
+          config.updates = (uint32_t) strtoul (optarg, NULL, 10);
+          break;
+
+        case 'o':
+          config.opens = (uint32_t) strtoul (optarg, NULL, 10);
+          break;
+
+        case 'S':
+          config.seed = strtoull (optarg, NULL, 10);
+          break;
+
+        case 'j':
+          strcpy (json_path, optarg);
+          break;
+
+        case 'k':
+          config.keep = 1;
+          break;
+
+        default:
+          usage ();
+        }
+    }
+
+  if (!config.records || strlen (config.path) < 5 || strcmp (&config.path[strlen (config.path) - 4], ".bfd")) usage ();
+
+
+  image = (uint8_t *) malloc (config.image_size + 1);
+  check_image = (uint8_t *) malloc (config.image_size + 1);
+  with_poly = (uint8_t *) calloc (config.records, 1);
+  with_image = (uint8_t *) calloc (config.records, 1);
+  if (image == NULL || check_image == NULL || with_poly == NULL || with_image == NULL)
+    {
+      perror ("Allocating memory");
+      exit (-1);
+    }
+
+
+  /*  Generate the file.  Each record is timed on its own so the append numbers include polygon and image writes.  */
+
+  memset (&bfd_header, 0, sizeof (BFDATA_HEADER));
+  strcpy (bfd_header.creation_software, "bfd_bench");
+  strcpy (bfd_header.comments, "Synthetic file generated by bfd_bench");
+
+  check (hnd = binaryFeatureData_create_file (config.path, bfd_header), "binaryFeatureData_create_file");
+  if (config.endian >= 0) check (binaryFeatureData_set_file_endian (hnd, config.endian), "binaryFeatureData_set_file_endian");
+
+  rng_state = config.seed ? config.seed : 1;
+  record_bytes = sizeof (BFDATA_RECORD);
+  poly_bytes = config.poly_points * 2 * sizeof (double);
+
+  for (i = 0 ; i < config.records ; i++)
+    {
+      make_record (&config, i, &bfd_record, &poly, image, &has_poly, &has_image);
+      with_poly[i] = has_poly;
+      with_image[i] = has_image;
+
+      copy = bfd_record;
+      start = now_ns ();
+      check (binaryFeatureData_write_record (hnd, BFDATA_NEXT_RECORD, &copy, has_poly ? &poly : NULL, has_image ? image : NULL),
+             "binaryFeatureData_write_record");
+      timer_add (&timer[T_APPEND], now_ns () - start, record_bytes + (has_poly ? poly_bytes : 0) + (has_image ? config.image_size : 0));
+    }
+
+  start = now_ns ();
+  check (binaryFeatureData_close_file (hnd), "binaryFeatureData_close_file");
+  timer_add (&timer[T_CLOSE_CREATE], now_ns () - start, 0);
+
+
+  /*  Open/close cycles.  */
+
+  for (i = 0 ; i < config.opens ; i++)
+    {
+      start = now_ns ();
+      check (hnd = binaryFeatureData_open_file (config.path, &bfd_header, BFDATA_READONLY), "binaryFeatureData_open_file");
+      timer_add (&timer[T_OPEN], now_ns () - start, 0);
+
+      start = now_ns ();
+      check (binaryFeatureData_close_file (hnd), "binaryFeatureData_close_file");
+      timer_add (&timer[T_CLOSE], now_ns () - start, 0);
+    }
+
+
+  check (hnd = binaryFeatureData_open_file (config.path, &bfd_header, BFDATA_READONLY), "binaryFeatureData_open_file");
+  if (bfd_header.number_of_records != config.records)
+    {
+      fprintf (stderr, "Expected %u records, found %u\n", config.records, bfd_header.number_of_records);
+      exit (-1);
+    }
+
+
+  /*  Sequential reads.  These double as a check that the file reads back the way it was generated (which is
+      mostly interesting for files written in the other byte order).  */
+
+  rng_state = config.seed ? config.seed : 1;
+
+  for (i = 0 ; i < config.records ; i++)
+    {
+      start = now_ns ();
+      check (binaryFeatureData_read_record (hnd, i, &bfd_record), "binaryFeatureData_read_record");
+      timer_add (&timer[T_SEQ], now_ns () - start, record_bytes);
+
+      make_record (&config, i, &expected, &poly, image, &has_poly, &has_image);
+      if (bfd_record.latitude != expected.latitude || bfd_record.longitude != expected.longitude ||
+          bfd_record.depth != expected.depth || bfd_record.event_tv_nsec != expected.event_tv_nsec ||
+          bfd_record.poly_count != expected.poly_count || bfd_record.image_size != expected.image_size ||
+          strcmp (bfd_record.description, expected.description))
+        {
+          fprintf (stderr, "Record %u doesn't match what was written\n", i);
+          exit (-1);
+        }
+    }
+
+
+  /*  Random reads.  */
+
+  for (i = 0 ; i < config.random_reads ; i++)
+    {
+      recnum = (uint32_t) (rng () % config.records);
+
+      start = now_ns ();
+      check (binaryFeatureData_read_record (hnd, recnum, &bfd_record), "binaryFeatureData_read_record");
+      timer_add (&timer[T_RANDOM], now_ns () - start, record_bytes);
+    }
+
+
+  /*  Short features.  The first call allocates the array, later calls reuse it.  */
+
+  for (i = 0 ; i < 5 ; i++)
+    {
+      start = now_ns ();
+      check (binaryFeatureData_read_all_short_features (hnd, &short_feature), "binaryFeatureData_read_all_short_features");
+      timer_add (&timer[T_SHORT], now_ns () - start, (uint64_t) config.records * sizeof (BFDATA_SHORT_FEATURE));
+    }
+
+
+  /*  Polygons and images in random order.  */
+
+  for (i = 0 ; i < config.records ; i++)
+    {
+      recnum = (uint32_t) (rng () % config.records);
+
+      if (with_poly[recnum])
+        {
+          start = now_ns ();
+          check (binaryFeatureData_read_polygon (hnd, recnum, &poly), "binaryFeatureData_read_polygon");
+          timer_add (&timer[T_POLY], now_ns () - start, poly_bytes);
+        }
+
+      if (with_image[recnum])
+        {
+          start = now_ns ();
+          check (binaryFeatureData_read_image (hnd, recnum, check_image), "binaryFeatureData_read_image");
+          timer_add (&timer[T_IMAGE], now_ns () - start, config.image_size);
+
+          for (j = 0 ; j < config.image_size ; j++)
+            {
+              if (check_image[j] != (uint8_t) (recnum + j))
+                {
+                  fprintf (stderr, "Image for record %u doesn't match what was written\n", recnum);
+                  exit (-1);
+                }
+            }
+        }
+    }
+
+  check (binaryFeatureData_close_file (hnd), "binaryFeatureData_close_file");
+
+
+  /*  In place updates of random records (record only, the polygon and image are left alone).  */
+
+  if (config.updates)
+    {
+      check (hnd = binaryFeatureData_open_file (config.path, &bfd_header, BFDATA_UPDATE), "binaryFeatureData_open_file");
+
+      for (i = 0 ; i < config.updates ; i++)
+        {
+          recnum = (uint32_t) (rng () % config.records);
+          check (binaryFeatureData_read_record (hnd, recnum, &bfd_record), "binaryFeatureData_read_record");
+          bfd_record.confidence_level = (uint8_t) ((bfd_record.confidence_level + 1) % 6);
+
+          start = now_ns ();
+          check (binaryFeatureData_write_record (hnd, recnum, &bfd_record, NULL, NULL), "binaryFeatureData_write_record");
+          timer_add (&timer[T_UPDATE], now_ns () - start, record_bytes);
+        }
+
+      start = now_ns ();
+      check (binaryFeatureData_close_file (hnd), "binaryFeatureData_close_file");
+      timer_add (&timer[T_CLOSE_UPDATE], now_ns () - start, 0);
+    }
+
+
+  if (json_path[0])
+    {
+      if ((fp = fopen (json_path, "w")) == NULL)
+        {
+          perror (json_path);
+          exit (-1);
+        }
+
+      write_json (fp, &config);
+      fclose (fp);
+    }
+  else
+    {
+      write_json (stdout, &config);
+    }
+
+
+  if (!config.keep)
+    {
+      strcpy (a_path, config.path);
+      strcpy (&a_path[strlen (a_path) - 3], "bfa");
+      remove (config.path);
+      remove (a_path);
+      strcpy (&a_path[strlen (a_path) - 3], "bfb");
+      remove (a_path);
+    }
+
+  for (i = 0 ; i < BENCH_TIMERS ; i++) free (timer[i].ns);
+  free (image);
+  free (check_image);
+  free (with_poly);
+  free (with_image);
+
+  return (0);
+}
@@ -36,7 +36,24 @@
 
 
 
+#ifdef __linux__
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#endif
+
 #include <errno.h>
+#include <float.h>
+
+#ifdef NVWIN3X
+#include <io.h>
+#else
+#include <fcntl.h>
+#endif
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
 
 #include "binaryFeatureData.h"
 #include "binaryFeatureData_internals.h"
@@ -53,7 +70,33 @@ static INTERNAL_BFDATA_STRUCT bfdh[BFDATA_MAX_FILES];
 static uint8_t first = 1;
 
 
-static BFDATA_ERROR_STRUCT bfd_error;
+/*  Set if the public operations should be timed (see binaryFeatureData_set_latency_stats).  */
+
+static uint8_t latency_stats = 0;
+
+
+/*  Tracing hooks (see binaryFeatureData_set_trace_hooks).  */
+
+static BFDATA_TRACE_CALLBACK trace_begin = NULL;
+static BFDATA_TRACE_CALLBACK trace_end = NULL;
+static void *trace_data = NULL;
+
+
+/*  Set if either latency_stats or a tracing hook is set.  This is the only thing the public operations check when
+    nobody is watching.  */
+
+static uint8_t instrumented = 0;
+
+
+/*  Error state (per thread, see BFDATA_THREAD_LOCAL).  A handle should only be used by one thread at a time and opening
+    and closing files is not thread safe.  */
+
+static BFDATA_THREAD_LOCAL BFDATA_ERROR_STRUCT bfd_error;
+
+
+/*  Bytes read and written by a handle just before binaryFeatureData_close_file cleared it (for the close trace event).  */
+
+static BFDATA_THREAD_LOCAL uint64_t closed_io;
 
 
 /*  Some static functions that don't need to be in this file.  */
@@ -61,6 +104,198 @@ static BFDATA_ERROR_STRUCT bfd_error;
 #include "binaryFeatureData_functions.h"
 
 
+/*  The public operations that are timed and traced (see binaryFeatureData_get_stats and binaryFeatureData_set_trace_hooks)
+    are thin wrappers around these.  Calls from inside the library go straight to these so that only the application's
+    calls are seen.  */
+
+static int32_t binaryFeatureData_do_create_file (const char *path, BFDATA_HEADER bfd_header);
+static int32_t binaryFeatureData_do_open_file (const char *path, BFDATA_HEADER *bfd_header, int32_t mode);
+static int32_t binaryFeatureData_do_close_file (int32_t hnd);
+static int32_t binaryFeatureData_do_read_record (int32_t hnd, int32_t recnum, BFDATA_RECORD *bfd_record);
+static int32_t binaryFeatureData_do_read_record_fields (int32_t hnd, int32_t recnum, uint32_t mask, BFDATA_RECORD *bfd_record);
+static int32_t binaryFeatureData_do_read_record_range (int32_t hnd, uint32_t start, uint32_t count, uint32_t mask, BFDATA_RECORD *bfd_record);
+static int32_t binaryFeatureData_do_write_record (int32_t hnd, int32_t recnum, BFDATA_RECORD *bfd_record, const BFDATA_POLYGON *poly,
+                                                  const uint8_t *image);
+static int32_t binaryFeatureData_do_write_record_image_file (int32_t hnd, int32_t recnum, BFDATA_RECORD *bfd_record, const BFDATA_POLYGON *poly,
+                                                             const char *image_file);
+static int32_t binaryFeatureData_do_read_polygon (int32_t hnd, int32_t recnum, BFDATA_POLYGON *poly);
+static int32_t binaryFeatureData_do_read_polygon_lod (int32_t hnd, int32_t recnum, double tolerance, BFDATA_POLYGON *poly, uint32_t *count);
+static int32_t binaryFeatureData_do_read_image (int32_t hnd, int32_t recnum, uint8_t *image);
+static int32_t binaryFeatureData_do_read_image_chunk (int32_t hnd, int32_t recnum, uint32_t offset, uint32_t length, uint8_t *buffer,
+                                                      uint32_t *bytes_read);
+static int32_t binaryFeatureData_do_read_image_stream (int32_t hnd, int32_t recnum, uint32_t chunk_size, BFDATA_IMAGE_CALLBACK callback,
+                                                       void *user_data);
+static int32_t binaryFeatureData_do_read_all_short_features (int32_t hnd, BFDATA_SHORT_FEATURE **bfd_feature);
+static int32_t binaryFeatureData_do_scan_fields (int32_t hnd, uint32_t *recnum, int32_t count, const BFDATA_PREDICATE *predicate,
+                                                 uint32_t mask, BFDATA_RECORD *bfd_record);
+static int32_t binaryFeatureData_do_sync (int32_t hnd);
+static int32_t binaryFeatureData_do_commit_transaction (int32_t hnd);
+
+
+
+/*!  Total bytes read and written on the handle's files.  */
+
+static uint64_t binaryFeatureData_io_bytes (int32_t hnd)
+{
+  return (bfdh[hnd].stats.bfd_bytes_read + bfdh[hnd].stats.bfd_bytes_written + bfdh[hnd].stats.bfa_bytes_read +
+          bfdh[hnd].stats.bfa_bytes_written);
+}
+
+
+
+/*!  Start an instrumented public operation.  "hnd" is -1 for binaryFeatureData_open_file and
+     binaryFeatureData_create_file and "recnum" is -1 for operations that aren't about one record.  */
+
+static void binaryFeatureData_begin_operation (INTERNAL_BFDATA_OPERATION *operation, int32_t id, int32_t hnd, int32_t recnum)
+{
+  BFDATA_TRACE_EVENT event;
+
+
+  operation->id = id;
+  operation->hnd = hnd;
+  operation->recnum = recnum;
+  operation->io = hnd >= 0 ? binaryFeatureData_io_bytes (hnd) : 0;
+  closed_io = operation->io;
+
+
+  if (trace_begin != NULL)
+    {
+      event.operation = id;
+      event.hnd = hnd;
+      event.recnum = recnum;
+      event.status = 0;
+      event.bytes = 0;
+
+      (*trace_begin) (&event, trace_data);
+    }
+
+
+  operation->begin = latency_stats ? binaryFeatureData_nsecs () : 0;
+}
+
+
+
+/*!  Finish an instrumented public operation.  Adds the time to the handle's latency histogram (see
+     binaryFeatureData_get_stats) and calls the end tracing hook.  */
+
+static void binaryFeatureData_end_operation (INTERNAL_BFDATA_OPERATION *operation, int32_t status)
+{
+  BFDATA_TRACE_EVENT event;
+  BFDATA_LATENCY *latency;
+  uint64_t ns, io;
+  int32_t hnd, bucket;
+
+
+  hnd = operation->hnd;
+  if (operation->id == BFDATA_OPERATION_OPEN && status >= 0) hnd = status;
+
+
+  /*  The handle is gone after a successful close so the latency can't be kept.  */
+
+  if (hnd >= 0 && bfdh[hnd].fp != NULL)
+    {
+      io = binaryFeatureData_io_bytes (hnd);
+
+      if (latency_stats && operation->begin)
+        {
+          ns = (uint64_t) (binaryFeatureData_nsecs () - operation->begin);
+
+          latency = &bfdh[hnd].stats.latency[operation->id];
+
+          latency->count++;
+          latency->total_ns += ns;
+          if (ns > latency->max_ns) latency->max_ns = ns;
+
+          bucket = binaryFeatureData_ilog2 (ns);
+          if (bucket >= BFDATA_LATENCY_BUCKETS) bucket = BFDATA_LATENCY_BUCKETS - 1;
+
+          latency->bucket[bucket]++;
+        }
+    }
+  else
+    {
+      io = closed_io;
+    }
+
+
+  if (trace_end != NULL)
+    {
+      event.operation = operation->id;
+      event.hnd = hnd;
+      event.recnum = operation->recnum;
+      event.status = status;
+      event.bytes = io - operation->io;
+
+
+      /*  Let the tracer know which record a BFDATA_NEXT_RECORD read got.  Every successful record read (whole record,
+          fields, or range) leaves recnum one past the last record it read.  last_rec is only set by whole record
+          reads so we can't use that.  */
+
+      if (operation->id == BFDATA_OPERATION_READ_RECORD && event.recnum == BFDATA_NEXT_RECORD && status >= 0)
+        event.recnum = (int32_t) bfdh[hnd].recnum - 1;
+
+      (*trace_end) (&event, trace_data);
+    }
+}
+
+
+
+/*!  Counted seek, read, and write on the handle's .bfd or .bfa file (see binaryFeatureData_get_stats).  */
+
+static int32_t binaryFeatureData_seek (int32_t hnd, FILE *fp, int64_t offset, int32_t whence)
+{
+  bfdh[hnd].stats.seeks++;
+
+  return (fseeko64 (fp, offset, whence));
+}
+
+
+
+static size_t binaryFeatureData_read (int32_t hnd, void *ptr, size_t size, size_t count, FILE *fp)
+{
+  size_t n;
+
+
+  n = fread (ptr, size, count, fp);
+
+  bfdh[hnd].stats.read_calls++;
+
+  if (fp == bfdh[hnd].fp)
+    {
+      bfdh[hnd].stats.bfd_bytes_read += n * size;
+    }
+  else
+    {
+      bfdh[hnd].stats.bfa_bytes_read += n * size;
+    }
+
+  return (n);
+}
+
+
+
+static size_t binaryFeatureData_write (int32_t hnd, const void *ptr, size_t size, size_t count, FILE *fp)
+{
+  size_t n;
+
+
+  n = fwrite (ptr, size, count, fp);
+
+  bfdh[hnd].stats.write_calls++;
+
+  if (fp == bfdh[hnd].fp)
+    {
+      bfdh[hnd].stats.bfd_bytes_written += n * size;
+    }
+  else
+    {
+      bfdh[hnd].stats.bfa_bytes_written += n * size;
+    }
+
+  return (n);
+}
+
+
 /*!  Compute the actual size of the BFDATA_RECORD as it will be stored on disk.  */
 
 static int32_t binaryFeatureData_compute_record_size (int32_t hnd)
@@ -127,35 +362,88 @@ static int32_t binaryFeatureData_compute_record_size (int32_t hnd)
 
 
 
-static void binaryFeatureData_swap_record (BFDATA_RECORD *bfd_record, int32_t hnd)
+/*!  Work out where each field (BFDATA_FIELD_*) starts in the on-disk record so that we can decode single fields (see
+     binaryFeatureData_decode_field).  The order is the one used by binaryFeatureData_decode_record.  Fields that aren't
+     stored in this version of the file get -1.  */
+
+static void binaryFeatureData_compute_field_offsets (int32_t hnd)
 {
+  int16_t offset = 0;
+
+
+  bfdh[hnd].field_offset[BFDATA_FIELD_CONTACT_ID] = offset;
+  offset += 15;
+
+
   /*  Pre 2.00 screwup.  I used the structure size even though I wasn't writing structures.  DOH!  */
 
-  if (bfdh[hnd].major_version < 2)
-    {
-      binaryFeatureData_swap_int ((int32_t *) &bfd_record->event_tv_sec);
-      binaryFeatureData_swap_int ((int32_t *) &bfd_record->event_tv_nsec);
-    }
+  bfdh[hnd].field_offset[BFDATA_FIELD_EVENT_TV_SEC] = offset;
+  offset += bfdh[hnd].major_version < 2 ? sizeof (time_t) : sizeof (int64_t);
+  bfdh[hnd].field_offset[BFDATA_FIELD_EVENT_TV_NSEC] = offset;
+  offset += bfdh[hnd].major_version < 2 ? sizeof (long) : sizeof (int32_t);
+
+  bfdh[hnd].field_offset[BFDATA_FIELD_LATITUDE] = offset;
+  offset += sizeof (double);
+  bfdh[hnd].field_offset[BFDATA_FIELD_LONGITUDE] = offset;
+  offset += sizeof (double);
+  bfdh[hnd].field_offset[BFDATA_FIELD_LENGTH] = offset;
+  offset += sizeof (float);
+  bfdh[hnd].field_offset[BFDATA_FIELD_WIDTH] = offset;
+  offset += sizeof (float);
+  bfdh[hnd].field_offset[BFDATA_FIELD_HEIGHT] = offset;
+  offset += sizeof (float);
+  bfdh[hnd].field_offset[BFDATA_FIELD_DEPTH] = offset;
+  offset += sizeof (float);
+  bfdh[hnd].field_offset[BFDATA_FIELD_DATUM] = offset;
+  offset += sizeof (float);
+  bfdh[hnd].field_offset[BFDATA_FIELD_HORIZONTAL_ORIENTATION] = offset;
+  offset += sizeof (float);
+  bfdh[hnd].field_offset[BFDATA_FIELD_VERTICAL_ORIENTATION] = offset;
+  offset += sizeof (float);
+  bfdh[hnd].field_offset[BFDATA_FIELD_DESCRIPTION] = offset;
+  offset += 128;
+  bfdh[hnd].field_offset[BFDATA_FIELD_REMARKS] = offset;
+  offset += 128;
+  bfdh[hnd].field_offset[BFDATA_FIELD_SONAR_TYPE] = offset;
+  offset += sizeof (uint8_t);
+  bfdh[hnd].field_offset[BFDATA_FIELD_EQUIP_TYPE] = offset;
+  offset += sizeof (uint8_t);
+  bfdh[hnd].field_offset[BFDATA_FIELD_PLATFORM_TYPE] = offset;
+  offset += sizeof (uint8_t);
+  bfdh[hnd].field_offset[BFDATA_FIELD_NAV_SYSTEM] = offset;
+  offset += sizeof (uint8_t);
+  bfdh[hnd].field_offset[BFDATA_FIELD_HEADING] = offset;
+  offset += sizeof (float);
+  bfdh[hnd].field_offset[BFDATA_FIELD_CONFIDENCE_LEVEL] = offset;
+  offset += sizeof (uint8_t);
+  bfdh[hnd].field_offset[BFDATA_FIELD_ANALYST_ACTIVITY] = offset;
+  offset += 40;
+  bfdh[hnd].field_offset[BFDATA_FIELD_POLY_ADDRESS] = offset;
+  offset += sizeof (int64_t);
+  bfdh[hnd].field_offset[BFDATA_FIELD_POLY_COUNT] = offset;
+  offset += sizeof (uint32_t);
+  bfdh[hnd].field_offset[BFDATA_FIELD_POLY_TYPE] = offset;
+  offset += sizeof (uint8_t);
+  bfdh[hnd].field_offset[BFDATA_FIELD_IMAGE_ADDRESS] = offset;
+  offset += sizeof (int64_t);
+  bfdh[hnd].field_offset[BFDATA_FIELD_IMAGE_SIZE] = offset;
+  offset += sizeof (uint32_t);
+  bfdh[hnd].field_offset[BFDATA_FIELD_IMAGE_NAME] = offset;
+  offset += 128;
+  bfdh[hnd].field_offset[BFDATA_FIELD_PARENT_RECORD] = offset;
+  offset += sizeof (uint32_t);
+  bfdh[hnd].field_offset[BFDATA_FIELD_CHILD_RECORD] = offset;
+  offset += sizeof (uint32_t);
+
+
+  /*  Version 3.0 dependency.  */
 
-  binaryFeatureData_swap_double (&bfd_record->latitude);
-  binaryFeatureData_swap_double (&bfd_record->longitude);
-  binaryFeatureData_swap_float (&bfd_record->length);
-  binaryFeatureData_swap_float (&bfd_record->width);
-  binaryFeatureData_swap_float (&bfd_record->height);
-  binaryFeatureData_swap_float (&bfd_record->depth);
-  binaryFeatureData_swap_float (&bfd_record->horizontal_orientation);
-  binaryFeatureData_swap_float (&bfd_record->vertical_orientation);
-  binaryFeatureData_swap_float (&bfd_record->heading);
-  binaryFeatureData_swap_double ((double *) &bfd_record->poly_address);
-  binaryFeatureData_swap_int ((int32_t *) &bfd_record->poly_count);
-  binaryFeatureData_swap_double ((double *) &bfd_record->image_address);
-  binaryFeatureData_swap_int ((int32_t *) &bfd_record->image_size);
-  binaryFeatureData_swap_int ((int32_t *) &bfd_record->parent_record);
-  binaryFeatureData_swap_int ((int32_t *) &bfd_record->child_record);
+  bfdh[hnd].field_offset[BFDATA_FIELD_FEATURE_TYPE] = bfdh[hnd].major_version >= 3 ? offset : -1;
 }
 
 
 
+
 static void binaryFeatureData_swap_polygon (int32_t count, BFDATA_POLYGON *bfd_polygon)
 {
   int32_t     i;
@@ -170,78 +458,86 @@ static void binaryFeatureData_swap_polygon (int32_t count, BFDATA_POLYGON *bfd_p
 
 
 
-static uint8_t binaryFeatureData_get_record (int32_t hnd, BFDATA_RECORD *bfd_record)
+/*!  Unpack a BFDATA_RECORD from "buffer", which holds a record exactly as it was stored on disk by a version "version"
+     library (only < 2, 2, and >= 3 matter) with byte order "swap".  This is only called with constant version and swap
+     (see BFDATA_RECORD_CODEC) so each instance is straight line code for one layout.  The inverse of
+     binaryFeatureData_encode_layout.  */
+
+BFDATA_FORCE_INLINE void binaryFeatureData_decode_layout (const uint8_t *buffer, BFDATA_RECORD *bfd_record, const int32_t version,
+                                                          const int32_t swap)
 {
+  const uint8_t *ptr = buffer;
   int64_t tmp_d;
   int32_t tmp_s;
 
 
-  if (!fread (&bfd_record->contact_id, 15, 1, bfdh[hnd].fp)) return (0);
+  binaryFeatureData_unpack (&ptr, &bfd_record->contact_id, 15);
 
 
   /*  Pre 2.00 screwup.  I used the structure size even though I wasn't writing structures.  DOH!  */
 
-  if (bfdh[hnd].major_version < 2)
+  if (version < 2)
     {
-      if (!fread (&bfd_record->event_tv_sec, sizeof (time_t), 1, bfdh[hnd].fp)) return (0);
-      if (!fread (&bfd_record->event_tv_nsec, sizeof (long), 1, bfdh[hnd].fp)) return (0);
+      binaryFeatureData_unpack (&ptr, &bfd_record->event_tv_sec, sizeof (time_t));
+      binaryFeatureData_unpack (&ptr, &bfd_record->event_tv_nsec, sizeof (long));
+
+      if (swap)
+        {
+          binaryFeatureData_swap_int ((int32_t *) &bfd_record->event_tv_sec);
+          binaryFeatureData_swap_int ((int32_t *) &bfd_record->event_tv_nsec);
+        }
     }
   else
     {
-      /*  We swap here because we're storing tv_sec in 64 bits but we stuff it into a time_t which is 32 bits on 32 bit systems.  */
+      /*  We're storing tv_sec in 64 bits but we stuff it into a time_t which is 32 bits on 32 bit systems.  */
 
-      if (!fread (&tmp_d, sizeof (int64_t), 1, bfdh[hnd].fp)) return (0);
-      if (bfdh[hnd].swap) binaryFeatureData_swap_double ((double *) &tmp_d);
+      binaryFeatureData_unpack_swap (&ptr, &tmp_d, sizeof (int64_t), swap);
       bfd_record->event_tv_sec = tmp_d;
 
 
-      /*  We swap here because we're storing tv_nsec in 32 bits but we stuff it into a long which is 64 bits on 64 bit systems.  */
+      /*  We're storing tv_nsec in 32 bits but we stuff it into a long which is 64 bits on 64 bit systems.  */
 
-      if (!fread (&tmp_s, sizeof (int32_t), 1, bfdh[hnd].fp)) return (0);
-      if (bfdh[hnd].swap) binaryFeatureData_swap_int ((int32_t *) &tmp_s);
+      binaryFeatureData_unpack_swap (&ptr, &tmp_s, sizeof (int32_t), swap);
       bfd_record->event_tv_nsec = (long) tmp_s;
     }
 
-  if (!fread (&bfd_record->latitude, sizeof (double), 1, bfdh[hnd].fp)) return (0);
-  if (!fread (&bfd_record->longitude, sizeof (double), 1, bfdh[hnd].fp)) return (0);
-  if (!fread (&bfd_record->length, sizeof (float), 1, bfdh[hnd].fp)) return (0);
-  if (!fread (&bfd_record->width, sizeof (float), 1, bfdh[hnd].fp)) return (0);
-  if (!fread (&bfd_record->height, sizeof (float), 1, bfdh[hnd].fp)) return (0);
-  if (!fread (&bfd_record->depth, sizeof (float), 1, bfdh[hnd].fp)) return (0);
-  if (!fread (&bfd_record->datum, sizeof (float), 1, bfdh[hnd].fp)) return (0);
-
-
-  /*  Applying the datum shift (or 0.0).  */
-
-  bfd_record->depth -= bfd_record->datum;
-
-
-  if (!fread (&bfd_record->horizontal_orientation, sizeof (float), 1, bfdh[hnd].fp)) return (0);
-  if (!fread (&bfd_record->vertical_orientation, sizeof (float), 1, bfdh[hnd].fp)) return (0);
-  if (!fread (&bfd_record->description, 128, 1, bfdh[hnd].fp)) return (0);
-  if (!fread (&bfd_record->remarks, 128, 1, bfdh[hnd].fp)) return (0);
-  if (!fread (&bfd_record->sonar_type, sizeof (uint8_t), 1, bfdh[hnd].fp)) return (0);
-  if (!fread (&bfd_record->equip_type, sizeof (uint8_t), 1, bfdh[hnd].fp)) return (0);
-  if (!fread (&bfd_record->platform_type, sizeof (uint8_t), 1, bfdh[hnd].fp)) return (0);
-  if (!fread (&bfd_record->nav_system, sizeof (uint8_t), 1, bfdh[hnd].fp)) return (0);
-  if (!fread (&bfd_record->heading, sizeof (float), 1, bfdh[hnd].fp)) return (0);
-  if (!fread (&bfd_record->confidence_level, sizeof (uint8_t), 1, bfdh[hnd].fp)) return (0);
-  if (!fread (&bfd_record->analyst_activity, 40, 1, bfdh[hnd].fp)) return (0);
-  if (!fread (&bfd_record->poly_address, sizeof (int64_t), 1, bfdh[hnd].fp)) return (0);
-  if (!fread (&bfd_record->poly_count, sizeof (uint32_t), 1, bfdh[hnd].fp)) return (0);
-  if (!fread (&bfd_record->poly_type, sizeof (uint8_t), 1, bfdh[hnd].fp)) return (0);
-  if (!fread (&bfd_record->image_address, sizeof (int64_t), 1, bfdh[hnd].fp)) return (0);
-  if (!fread (&bfd_record->image_size, sizeof (uint32_t), 1, bfdh[hnd].fp)) return (0);
-  if (!fread (&bfd_record->image_name, 128, 1, bfdh[hnd].fp)) return (0);
-  if (!fread (&bfd_record->parent_record, sizeof (uint32_t), 1, bfdh[hnd].fp)) return (0);
-  if (!fread (&bfd_record->child_record, sizeof (uint32_t), 1, bfdh[hnd].fp)) return (0);
+  binaryFeatureData_unpack_swap (&ptr, &bfd_record->latitude, sizeof (double), swap);
+  binaryFeatureData_unpack_swap (&ptr, &bfd_record->longitude, sizeof (double), swap);
+  binaryFeatureData_unpack_swap (&ptr, &bfd_record->length, sizeof (float), swap);
+  binaryFeatureData_unpack_swap (&ptr, &bfd_record->width, sizeof (float), swap);
+  binaryFeatureData_unpack_swap (&ptr, &bfd_record->height, sizeof (float), swap);
+  binaryFeatureData_unpack_swap (&ptr, &bfd_record->depth, sizeof (float), swap);
+
+
+  /*  The datum has never been swapped.  */
+
+  binaryFeatureData_unpack (&ptr, &bfd_record->datum, sizeof (float));
+  binaryFeatureData_unpack_swap (&ptr, &bfd_record->horizontal_orientation, sizeof (float), swap);
+  binaryFeatureData_unpack_swap (&ptr, &bfd_record->vertical_orientation, sizeof (float), swap);
+  binaryFeatureData_unpack (&ptr, &bfd_record->description, 128);
+  binaryFeatureData_unpack (&ptr, &bfd_record->remarks, 128);
+  binaryFeatureData_unpack (&ptr, &bfd_record->sonar_type, sizeof (uint8_t));
+  binaryFeatureData_unpack (&ptr, &bfd_record->equip_type, sizeof (uint8_t));
+  binaryFeatureData_unpack (&ptr, &bfd_record->platform_type, sizeof (uint8_t));
+  binaryFeatureData_unpack (&ptr, &bfd_record->nav_system, sizeof (uint8_t));
+  binaryFeatureData_unpack_swap (&ptr, &bfd_record->heading, sizeof (float), swap);
+  binaryFeatureData_unpack (&ptr, &bfd_record->confidence_level, sizeof (uint8_t));
+  binaryFeatureData_unpack (&ptr, &bfd_record->analyst_activity, 40);
+  binaryFeatureData_unpack_swap (&ptr, &bfd_record->poly_address, sizeof (int64_t), swap);
+  binaryFeatureData_unpack_swap (&ptr, &bfd_record->poly_count, sizeof (uint32_t), swap);
+  binaryFeatureData_unpack (&ptr, &bfd_record->poly_type, sizeof (uint8_t));
+  binaryFeatureData_unpack_swap (&ptr, &bfd_record->image_address, sizeof (int64_t), swap);
+  binaryFeatureData_unpack_swap (&ptr, &bfd_record->image_size, sizeof (uint32_t), swap);
+  binaryFeatureData_unpack (&ptr, &bfd_record->image_name, 128);
+  binaryFeatureData_unpack_swap (&ptr, &bfd_record->parent_record, sizeof (uint32_t), swap);
+  binaryFeatureData_unpack_swap (&ptr, &bfd_record->child_record, sizeof (uint32_t), swap);
 
 
   /*  Version 3.0 dependency.  */
 
-  if (bfdh[hnd].major_version >= 3)
+  if (version >= 3)
     {
-      if (!fread (&bfd_record->feature_type, sizeof (uint8_t), 1, bfdh[hnd].fp)) return (0);
+      binaryFeatureData_unpack (&ptr, &bfd_record->feature_type, sizeof (uint8_t));
     }
   else
     {
@@ -249,497 +545,576 @@ static uint8_t binaryFeatureData_get_record (int32_t hnd, BFDATA_RECORD *bfd_rec
     }
 
 
-  if (bfdh[hnd].swap) binaryFeatureData_swap_record (bfd_record, hnd);
+  /*  Applying the datum shift (or 0.0).  */
 
-  return (1);
+  bfd_record->depth -= bfd_record->datum;
 }
 
 
 
 
-static uint8_t binaryFeatureData_put_record (int32_t hnd, BFDATA_RECORD *bfd_record)
+/*!  Pack a BFDATA_RECORD into "buffer" exactly as a version "version" library with byte order "swap" stores it on disk
+     (see binaryFeatureData_decode_layout).  Only called with constant version and swap.  The record isn't modified.  */
+
+BFDATA_FORCE_INLINE void binaryFeatureData_encode_layout (const BFDATA_RECORD *bfd_record, uint8_t *buffer, const int32_t version,
+                                                          const int32_t swap)
 {
+  uint8_t *ptr = buffer;
   int64_t tmp_d = (int64_t) bfd_record->event_tv_sec;
-  int32_t tmp_s = (int64_t) bfd_record->event_tv_nsec;
+  int32_t tmp_s = (int32_t) bfd_record->event_tv_nsec;
+  time_t tmp_t;
+  long tmp_l;
 
 
-  /*  Pre 2.00 screwup.  I used the structure size even though I wasn't writing structures.  DOH!  */
+  /*  Pre 2.00 screwup.  I used the structure size even though I wasn't writing structures.  DOH!  The record is
+      sizeof (BFDATA_RECORD) bytes so we have to clear the unused part (before we pack anything into it).  */
 
-  if (bfdh[hnd].major_version < 2)
-    {
-      if (!fwrite (&bfd_record->event_tv_sec, sizeof (time_t), 1, bfdh[hnd].fp)) return (0);
-      if (!fwrite (&bfd_record->event_tv_nsec, sizeof (long), 1, bfdh[hnd].fp)) return (0);
-    }
-  else
-    {
-      if (bfdh[hnd].swap)
-        {
-          binaryFeatureData_swap_record (bfd_record, hnd);
-          binaryFeatureData_swap_double ((double *) &tmp_d);
-          binaryFeatureData_swap_int ((int32_t *) &tmp_s);
-        }
-    }
-
-
-  if (!fwrite (&bfd_record->contact_id, 15, 1, bfdh[hnd].fp)) return (0);
-  if (!fwrite (&tmp_d, sizeof (int64_t), 1, bfdh[hnd].fp)) return (0);
-  if (!fwrite (&tmp_s, sizeof (int32_t), 1, bfdh[hnd].fp)) return (0);
-  if (!fwrite (&bfd_record->latitude, sizeof (double), 1, bfdh[hnd].fp)) return (0);
-  if (!fwrite (&bfd_record->longitude, sizeof (double), 1, bfdh[hnd].fp)) return (0);
-  if (!fwrite (&bfd_record->length, sizeof (float), 1, bfdh[hnd].fp)) return (0);
-  if (!fwrite (&bfd_record->width, sizeof (float), 1, bfdh[hnd].fp)) return (0);
-  if (!fwrite (&bfd_record->height, sizeof (float), 1, bfdh[hnd].fp)) return (0);
-  if (!fwrite (&bfd_record->depth, sizeof (float), 1, bfdh[hnd].fp)) return (0);
-  if (!fwrite (&bfd_record->datum, sizeof (float), 1, bfdh[hnd].fp)) return (0);
-  if (!fwrite (&bfd_record->horizontal_orientation, sizeof (float), 1, bfdh[hnd].fp)) return (0);
-  if (!fwrite (&bfd_record->vertical_orientation, sizeof (float), 1, bfdh[hnd].fp)) return (0);
-  if (!fwrite (&bfd_record->description, 128, 1, bfdh[hnd].fp)) return (0);
-  if (!fwrite (&bfd_record->remarks, 128, 1, bfdh[hnd].fp)) return (0);
-  if (!fwrite (&bfd_record->sonar_type, sizeof (uint8_t), 1, bfdh[hnd].fp)) return (0);
-  if (!fwrite (&bfd_record->equip_type, sizeof (uint8_t), 1, bfdh[hnd].fp)) return (0);
-  if (!fwrite (&bfd_record->platform_type, sizeof (uint8_t), 1, bfdh[hnd].fp)) return (0);
-  if (!fwrite (&bfd_record->nav_system, sizeof (uint8_t), 1, bfdh[hnd].fp)) return (0);
-  if (!fwrite (&bfd_record->heading, sizeof (float), 1, bfdh[hnd].fp)) return (0);
-  if (!fwrite (&bfd_record->confidence_level, sizeof (uint8_t), 1, bfdh[hnd].fp)) return (0);
-  if (!fwrite (&bfd_record->analyst_activity, 40, 1, bfdh[hnd].fp)) return (0);
-  if (!fwrite (&bfd_record->poly_address, sizeof (int64_t), 1, bfdh[hnd].fp)) return (0);
-  if (!fwrite (&bfd_record->poly_count, sizeof (uint32_t), 1, bfdh[hnd].fp)) return (0);
-  if (!fwrite (&bfd_record->poly_type, sizeof (uint8_t), 1, bfdh[hnd].fp)) return (0);
-  if (!fwrite (&bfd_record->image_address, sizeof (int64_t), 1, bfdh[hnd].fp)) return (0);
-  if (!fwrite (&bfd_record->image_size, sizeof (uint32_t), 1, bfdh[hnd].fp)) return (0);
-  if (!fwrite (&bfd_record->image_name, 128, 1, bfdh[hnd].fp)) return (0);
-  if (!fwrite (&bfd_record->parent_record, sizeof (uint32_t), 1, bfdh[hnd].fp)) return (0);
-  if (!fwrite (&bfd_record->child_record, sizeof (uint32_t), 1, bfdh[hnd].fp)) return (0);
+  if (version < 2) memset (buffer, 0, sizeof (BFDATA_RECORD));
 
 
-  /*  Version 3.0 dependency.  */
+  binaryFeatureData_pack (&ptr, &bfd_record->contact_id, 15);
 
-  if (bfdh[hnd].major_version >= 3)
-    {
-      /*  Make sure that any application that is unaware of the 3.0 addition of feature_type will set it to BFDATA_HYDROGRAPHIC.  */
 
-      if (bfd_record->feature_type >= BFDATA_FEATURE_TYPES) bfd_record->feature_type = BFDATA_HYDROGRAPHIC;
+  if (version < 2)
+    {
+      tmp_t = bfd_record->event_tv_sec;
+      tmp_l = bfd_record->event_tv_nsec;
 
+      if (swap)
+        {
+          binaryFeatureData_swap_int ((int32_t *) &tmp_t);
+          binaryFeatureData_swap_int ((int32_t *) &tmp_l);
+        }
 
-      if (!fwrite (&bfd_record->feature_type, sizeof (uint8_t), 1, bfdh[hnd].fp)) return (0);
+      binaryFeatureData_pack (&ptr, &tmp_t, sizeof (time_t));
+      binaryFeatureData_pack (&ptr, &tmp_l, sizeof (long));
+    }
+  else
+    {
+      binaryFeatureData_pack_swap (&ptr, &tmp_d, sizeof (int64_t), swap);
+      binaryFeatureData_pack_swap (&ptr, &tmp_s, sizeof (int32_t), swap);
     }
 
+  binaryFeatureData_pack_swap (&ptr, &bfd_record->latitude, sizeof (double), swap);
+  binaryFeatureData_pack_swap (&ptr, &bfd_record->longitude, sizeof (double), swap);
+  binaryFeatureData_pack_swap (&ptr, &bfd_record->length, sizeof (float), swap);
+  binaryFeatureData_pack_swap (&ptr, &bfd_record->width, sizeof (float), swap);
+  binaryFeatureData_pack_swap (&ptr, &bfd_record->height, sizeof (float), swap);
+  binaryFeatureData_pack_swap (&ptr, &bfd_record->depth, sizeof (float), swap);
+  binaryFeatureData_pack (&ptr, &bfd_record->datum, sizeof (float));
+  binaryFeatureData_pack_swap (&ptr, &bfd_record->horizontal_orientation, sizeof (float), swap);
+  binaryFeatureData_pack_swap (&ptr, &bfd_record->vertical_orientation, sizeof (float), swap);
+  binaryFeatureData_pack (&ptr, &bfd_record->description, 128);
+  binaryFeatureData_pack (&ptr, &bfd_record->remarks, 128);
+  binaryFeatureData_pack (&ptr, &bfd_record->sonar_type, sizeof (uint8_t));
+  binaryFeatureData_pack (&ptr, &bfd_record->equip_type, sizeof (uint8_t));
+  binaryFeatureData_pack (&ptr, &bfd_record->platform_type, sizeof (uint8_t));
+  binaryFeatureData_pack (&ptr, &bfd_record->nav_system, sizeof (uint8_t));
+  binaryFeatureData_pack_swap (&ptr, &bfd_record->heading, sizeof (float), swap);
+  binaryFeatureData_pack (&ptr, &bfd_record->confidence_level, sizeof (uint8_t));
+  binaryFeatureData_pack (&ptr, &bfd_record->analyst_activity, 40);
+  binaryFeatureData_pack_swap (&ptr, &bfd_record->poly_address, sizeof (int64_t), swap);
+  binaryFeatureData_pack_swap (&ptr, &bfd_record->poly_count, sizeof (uint32_t), swap);
+  binaryFeatureData_pack (&ptr, &bfd_record->poly_type, sizeof (uint8_t));
+  binaryFeatureData_pack_swap (&ptr, &bfd_record->image_address, sizeof (int64_t), swap);
+  binaryFeatureData_pack_swap (&ptr, &bfd_record->image_size, sizeof (uint32_t), swap);
+  binaryFeatureData_pack (&ptr, &bfd_record->image_name, 128);
+  binaryFeatureData_pack_swap (&ptr, &bfd_record->parent_record, sizeof (uint32_t), swap);
+  binaryFeatureData_pack_swap (&ptr, &bfd_record->child_record, sizeof (uint32_t), swap);
 
-  return (1);
-}
 
+  /*  Version 3.0 dependency.  */
 
+  if (version >= 3) binaryFeatureData_pack (&ptr, &bfd_record->feature_type, sizeof (uint8_t));
+}
 
 
-static uint8_t binaryFeatureData_get_polygon (int32_t hnd, int32_t count, BFDATA_POLYGON *poly)
-{
-  int32_t i;
 
 
-  for (i = 0 ; i < count ; i++)
-    {
-      if (!fread (&poly->latitude[i], sizeof (double), 1, bfdh[hnd].afp)) return (0);
-      if (!fread (&poly->longitude[i], sizeof (double), 1, bfdh[hnd].afp)) return (0);
-    }
+/*!  One decoder/encoder pair per layout and byte order.  Pre 2.00 files are "1".  */
 
-  if (bfdh[hnd].swap) binaryFeatureData_swap_polygon (count, poly);
+#define BFDATA_RECORD_CODEC(version, swap) \
+  static void binaryFeatureData_decode_v##version##_##swap (const uint8_t *buffer, BFDATA_RECORD *bfd_record) \
+  { \
+    binaryFeatureData_decode_layout (buffer, bfd_record, version, swap); \
+  } \
+  static void binaryFeatureData_encode_v##version##_##swap (const BFDATA_RECORD *bfd_record, uint8_t *buffer) \
+  { \
+    binaryFeatureData_encode_layout (bfd_record, buffer, version, swap); \
+  }
 
-  return (1);
-}
+BFDATA_RECORD_CODEC (1, 0)
+BFDATA_RECORD_CODEC (1, 1)
+BFDATA_RECORD_CODEC (2, 0)
+BFDATA_RECORD_CODEC (2, 1)
+BFDATA_RECORD_CODEC (3, 0)
+BFDATA_RECORD_CODEC (3, 1)
 
 
 
 
-static uint8_t binaryFeatureData_put_polygon (int32_t hnd, int32_t count, BFDATA_POLYGON *poly)
-{
-  int32_t i;
+/*!  Pick the record codec for the file's major version and byte order.  This has to be called whenever either of them
+     is set (create, open, and binaryFeatureData_set_file_endian) so that nothing on the record path has to look at
+     them again.  */
 
+static void binaryFeatureData_select_codec (int32_t hnd)
+{
+  static const INTERNAL_BFDATA_DECODER decoder[3][2] =
+    {{binaryFeatureData_decode_v1_0, binaryFeatureData_decode_v1_1},
+     {binaryFeatureData_decode_v2_0, binaryFeatureData_decode_v2_1},
+     {binaryFeatureData_decode_v3_0, binaryFeatureData_decode_v3_1}};
+  static const INTERNAL_BFDATA_ENCODER encoder[3][2] =
+    {{binaryFeatureData_encode_v1_0, binaryFeatureData_encode_v1_1},
+     {binaryFeatureData_encode_v2_0, binaryFeatureData_encode_v2_1},
+     {binaryFeatureData_encode_v3_0, binaryFeatureData_encode_v3_1}};
+  int32_t layout, swap = bfdh[hnd].swap ? 1 : 0;
 
-  if (bfdh[hnd].swap) binaryFeatureData_swap_polygon (count, poly);
 
-  for (i = 0 ; i < count ; i++)
+  if (bfdh[hnd].major_version < 2)
+    {
+      layout = 0;
+    }
+  else if (bfdh[hnd].major_version < 3)
+    {
+      layout = 1;
+    }
+  else
     {
-      if (!fwrite (&poly->latitude[i], sizeof (double), 1, bfdh[hnd].afp)) return (0);
-      if (!fwrite (&poly->longitude[i], sizeof (double), 1, bfdh[hnd].afp)) return (0);
+      layout = 2;
     }
 
-  return (1);
+  bfdh[hnd].decode = decoder[layout][swap];
+  bfdh[hnd].encode = encoder[layout][swap];
 }
 
 
 
 
-/********************************************************************************************/
-/*!
-
- - Function:    binaryFeatureData_write_record
+/*!  Unpack a BFDATA_RECORD from "buffer", which holds bfdh[hnd].record_size bytes exactly as they were stored on
+     disk.  The inverse of binaryFeatureData_encode_record.  */
 
- - Purpose:     Swaps the bytes (if needed) and writes the record and (optionally) the 
-                polygon/polyline.
+static void binaryFeatureData_decode_record (int32_t hnd, const uint8_t *buffer, BFDATA_RECORD *bfd_record)
+{
+  bfdh[hnd].stats.records_decoded++;
 
- - Author:      Jan C. Depner (area.based.editor@gmail.com)
+  bfdh[hnd].decode (buffer, bfd_record);
+}
 
- - Date:        03/27/09
 
- - Arguments:
-                - hnd            =    The BFD file handle
-                - recnum         =    The record number to write or BFDATA_NEXT_RECORD to append
-                - bfd_record     =    The BFD point record to receive the data
-                - poly           =    The polygon/polyline structure or NULL if you haven't
-                                       modified or created the polygon/polyline 
-                - image          =    The image or NULL if you haven't modified or created an image 
 
- - Returns:
-                - BFDATA_SUCCESS
-                - BFDATA_INVALID_RECORD_NUMBER
-                - BFDATA_POLYGON_TOO_LARGE_ERROR
-                - BFDATA_POLY_WRITE_FSEEK_ERROR
-                - BFDATA_POLY_WRITE_ERROR
-                - BFDATA_RECORD_WRITE_FSEEK_ERROR
-                - BFDATA_RECORD_WRITE_ERROR
 
-*********************************************************************************************/
+/*!  Unpack a single field (BFDATA_FIELD_*) of the on-disk record in "buffer" into "bfd_record" (swapped, and for the
+     depth datum corrected, just as binaryFeatureData_decode_record would).  The rest of bfd_record is left alone.  */
 
-BFDATA_DLL int32_t binaryFeatureData_write_record (int32_t hnd, int32_t recnum, BFDATA_RECORD *bfd_record, BFDATA_POLYGON *poly, uint8_t *image)
+static void binaryFeatureData_decode_field (int32_t hnd, const uint8_t *buffer, int32_t field, BFDATA_RECORD *bfd_record)
 {
-  int32_t i, pos;
+  const uint8_t *ptr;
+  int64_t tmp_d;
+  int32_t tmp_s;
+  float datum;
 
 
-  if (recnum < BFDATA_NEXT_RECORD)
+  /*  The feature type isn't stored in pre-3.0 files.  */
+
+  if (bfdh[hnd].field_offset[field] < 0)
     {
-      bfd_error.recnum = recnum;
-      strcpy (bfd_error.file, bfdh[hnd].path);
-      return (bfd_error.bfd = BFDATA_INVALID_RECORD_NUMBER);
+      if (field == BFDATA_FIELD_FEATURE_TYPE) bfd_record->feature_type = 0;
+      return;
     }
 
+  ptr = buffer + bfdh[hnd].field_offset[field];
 
-  if (bfd_record->poly_count && poly != NULL)
-    {
-      if (bfd_record->poly_count > BFDATA_POLY_ARRAY_SIZE)
-        {
-          bfd_error.recnum = recnum;
-          strcpy (bfd_error.file, bfdh[hnd].a_path);
-          return (bfd_error.bfd = BFDATA_POLYGON_TOO_LARGE_ERROR);
-        }
 
+  switch (field)
+    {
+    case BFDATA_FIELD_CONTACT_ID:
+      binaryFeatureData_unpack (&ptr, &bfd_record->contact_id, 15);
+      break;
 
-      /*  We always want to tack the polygon data on to the end of the file.  If there was a pre-existing address
-          we're just going to change it and let the data stay there.  We're not going to try to pack the file or 
-          save space since this should be a temporary file anyway.  After all, this is a working format and, at the
-          end of the processing cycle should be converted to the NAVO standard MIW XML format.  */
+    case BFDATA_FIELD_FEATURE_TYPE:
+      bfd_record->feature_type = *ptr;
+      break;
 
-      if (fseeko64 (bfdh[hnd].afp, 0LL, SEEK_END) < 0)
+    case BFDATA_FIELD_EVENT_TV_SEC:
+      if (bfdh[hnd].major_version < 2)
         {
-          bfd_error.system = errno;
-          bfd_error.recnum = recnum;
-          strcpy (bfd_error.file, bfdh[hnd].a_path);
-          return (bfd_error.bfd = BFDATA_POLY_WRITE_FSEEK_ERROR);
+          binaryFeatureData_unpack (&ptr, &bfd_record->event_tv_sec, sizeof (time_t));
+          if (bfdh[hnd].swap) binaryFeatureData_swap_int ((int32_t *) &bfd_record->event_tv_sec);
         }
-
-
-      bfd_record->poly_address = ftello64 (bfdh[hnd].afp);
-
-
-      for (i = 0 ; i < bfd_record->poly_count ; i++)
+      else
         {
-          if (!binaryFeatureData_put_polygon (hnd, bfd_record->poly_count, poly))
-            {
-              bfd_error.system = errno;
-              bfd_error.recnum = recnum;
-              strcpy (bfd_error.file, bfdh[hnd].a_path);
-              return (bfd_error.bfd = BFDATA_POLY_WRITE_ERROR);
-            }
+          binaryFeatureData_unpack (&ptr, &tmp_d, sizeof (int64_t));
+          if (bfdh[hnd].swap) binaryFeatureData_swap_double ((double *) &tmp_d);
+          bfd_record->event_tv_sec = tmp_d;
         }
-    }
-
-
-  if (bfd_record->image_size && image != NULL)
-    {
-      /*  We always want to tack the image data on to the end of the file.  If there was a pre-existing address
-          we're just going to change it and let the data stay there.  We're not going to try to pack the file or 
-          save space since this should be a temporary file anyway.  After all, this is a working format and, at the
-          end of the processing cycle should be converted to the NAVO standard MIW XML format.  */
+      break;
 
-      if (fseeko64 (bfdh[hnd].afp, 0LL, SEEK_END) < 0)
+    case BFDATA_FIELD_EVENT_TV_NSEC:
+      if (bfdh[hnd].major_version < 2)
         {
-          bfd_error.system = errno;
-          bfd_error.recnum = recnum;
-          strcpy (bfd_error.file, bfdh[hnd].a_path);
-          return (bfd_error.bfd = BFDATA_IMAGE_WRITE_FSEEK_ERROR);
+          binaryFeatureData_unpack (&ptr, &bfd_record->event_tv_nsec, sizeof (long));
+          if (bfdh[hnd].swap) binaryFeatureData_swap_int ((int32_t *) &bfd_record->event_tv_nsec);
+        }
+      else
+        {
+          binaryFeatureData_unpack (&ptr, &tmp_s, sizeof (int32_t));
+          if (bfdh[hnd].swap) binaryFeatureData_swap_int ((int32_t *) &tmp_s);
+          bfd_record->event_tv_nsec = (long) tmp_s;
         }
+      break;
 
+    case BFDATA_FIELD_LATITUDE:
+      binaryFeatureData_unpack (&ptr, &bfd_record->latitude, sizeof (double));
+      if (bfdh[hnd].swap) binaryFeatureData_swap_double (&bfd_record->latitude);
+      break;
 
-      bfd_record->image_address = ftello64 (bfdh[hnd].afp);
+    case BFDATA_FIELD_LONGITUDE:
+      binaryFeatureData_unpack (&ptr, &bfd_record->longitude, sizeof (double));
+      if (bfdh[hnd].swap) binaryFeatureData_swap_double (&bfd_record->longitude);
+      break;
 
+    case BFDATA_FIELD_LENGTH:
+      binaryFeatureData_unpack (&ptr, &bfd_record->length, sizeof (float));
+      if (bfdh[hnd].swap) binaryFeatureData_swap_float (&bfd_record->length);
+      break;
 
-      if (!fwrite (image, bfd_record->image_size, 1, bfdh[hnd].afp))
-        {
-          bfd_error.system = errno;
-          bfd_error.recnum = recnum;
-          strcpy (bfd_error.file, bfdh[hnd].a_path);
-          return (bfd_error.bfd = BFDATA_IMAGE_WRITE_ERROR);
-        }
-    }
+    case BFDATA_FIELD_WIDTH:
+      binaryFeatureData_unpack (&ptr, &bfd_record->width, sizeof (float));
+      if (bfdh[hnd].swap) binaryFeatureData_swap_float (&bfd_record->width);
+      break;
 
+    case BFDATA_FIELD_HEIGHT:
+      binaryFeatureData_unpack (&ptr, &bfd_record->height, sizeof (float));
+      if (bfdh[hnd].swap) binaryFeatureData_swap_float (&bfd_record->height);
+      break;
 
-  if (recnum == BFDATA_NEXT_RECORD)
-    {
-      bfdh[hnd].recnum = bfdh[hnd].header.number_of_records;
-      pos = bfdh[hnd].recnum * bfdh[hnd].record_size + bfdh[hnd].header_size;
-    }
-  else
-    {
-      pos = recnum * bfdh[hnd].record_size + bfdh[hnd].header_size;
-      bfdh[hnd].recnum = recnum;
-    }
 
+      /*  The datum is never swapped (see binaryFeatureData_decode_layout) so neither is the correction.  */
 
-  if (fseek (bfdh[hnd].fp, pos, SEEK_SET) < 0)
-    {
-      bfd_error.system = errno;
-      bfd_error.recnum = recnum;
-      strcpy (bfd_error.file, bfdh[hnd].path);
-      return (bfd_error.bfd = BFDATA_RECORD_WRITE_FSEEK_ERROR);
-    }
+    case BFDATA_FIELD_DEPTH:
+      binaryFeatureData_unpack (&ptr, &bfd_record->depth, sizeof (float));
+      if (bfdh[hnd].swap) binaryFeatureData_swap_float (&bfd_record->depth);
+      ptr = buffer + bfdh[hnd].field_offset[BFDATA_FIELD_DATUM];
+      binaryFeatureData_unpack (&ptr, &datum, sizeof (float));
+      bfd_record->depth -= datum;
+      break;
 
+    case BFDATA_FIELD_DATUM:
+      binaryFeatureData_unpack (&ptr, &bfd_record->datum, sizeof (float));
+      break;
 
-  if (!binaryFeatureData_put_record (hnd, bfd_record))
-    {
-      bfd_error.system = errno;
-      bfd_error.recnum = recnum;
-      strcpy (bfd_error.file, bfdh[hnd].path);
-      return (bfd_error.bfd = BFDATA_RECORD_WRITE_ERROR);
-    }
+    case BFDATA_FIELD_HORIZONTAL_ORIENTATION:
+      binaryFeatureData_unpack (&ptr, &bfd_record->horizontal_orientation, sizeof (float));
+      if (bfdh[hnd].swap) binaryFeatureData_swap_float (&bfd_record->horizontal_orientation);
+      break;
 
+    case BFDATA_FIELD_VERTICAL_ORIENTATION:
+      binaryFeatureData_unpack (&ptr, &bfd_record->vertical_orientation, sizeof (float));
+      if (bfdh[hnd].swap) binaryFeatureData_swap_float (&bfd_record->vertical_orientation);
+      break;
 
-  bfdh[hnd].modified = 1;
-  bfdh[hnd].write = 1;
-  bfdh[hnd].last_rec = -1;
+    case BFDATA_FIELD_DESCRIPTION:
+      binaryFeatureData_unpack (&ptr, &bfd_record->description, 128);
+      break;
 
+    case BFDATA_FIELD_REMARKS:
+      binaryFeatureData_unpack (&ptr, &bfd_record->remarks, 128);
+      break;
 
-  bfdh[hnd].recnum++;
+    case BFDATA_FIELD_SONAR_TYPE:
+      bfd_record->sonar_type = *ptr;
+      break;
 
+    case BFDATA_FIELD_EQUIP_TYPE:
+      bfd_record->equip_type = *ptr;
+      break;
 
-  if (recnum == BFDATA_NEXT_RECORD) bfdh[hnd].header.number_of_records++;
+    case BFDATA_FIELD_PLATFORM_TYPE:
+      bfd_record->platform_type = *ptr;
+      break;
 
+    case BFDATA_FIELD_NAV_SYSTEM:
+      bfd_record->nav_system = *ptr;
+      break;
 
-  bfd_error.system = 0;
-  return (bfd_error.bfd = BFDATA_SUCCESS);
-}
+    case BFDATA_FIELD_HEADING:
+      binaryFeatureData_unpack (&ptr, &bfd_record->heading, sizeof (float));
+      if (bfdh[hnd].swap) binaryFeatureData_swap_float (&bfd_record->heading);
+      break;
 
+    case BFDATA_FIELD_CONFIDENCE_LEVEL:
+      bfd_record->confidence_level = *ptr;
+      break;
 
+    case BFDATA_FIELD_ANALYST_ACTIVITY:
+      binaryFeatureData_unpack (&ptr, &bfd_record->analyst_activity, 40);
+      break;
 
-/********************************************************************************************/
-/*!
+    case BFDATA_FIELD_POLY_ADDRESS:
+      binaryFeatureData_unpack (&ptr, &bfd_record->poly_address, sizeof (int64_t));
+      if (bfdh[hnd].swap) binaryFeatureData_swap_double ((double *) &bfd_record->poly_address);
+      break;
 
- - Function:    binaryFeatureData_write_record_image_file
+    case BFDATA_FIELD_POLY_COUNT:
+      binaryFeatureData_unpack (&ptr, &bfd_record->poly_count, sizeof (uint32_t));
+      if (bfdh[hnd].swap) binaryFeatureData_swap_int ((int32_t *) &bfd_record->poly_count);
+      break;
 
- - Purpose:     This function reads the specified image file instead of a binary image.  It
-                stores the size and basename of the image in the bfd_record and then calls
-                binaryFeatureData_write_record to write the record, polygon, and image.
+    case BFDATA_FIELD_POLY_TYPE:
+      bfd_record->poly_type = *ptr;
+      break;
 
- - Author:      Jan C. Depner (area.based.editor@gmail.com)
+    case BFDATA_FIELD_IMAGE_ADDRESS:
+      binaryFeatureData_unpack (&ptr, &bfd_record->image_address, sizeof (int64_t));
+      if (bfdh[hnd].swap) binaryFeatureData_swap_double ((double *) &bfd_record->image_address);
+      break;
 
- - Date:        03/27/09
+    case BFDATA_FIELD_IMAGE_SIZE:
+      binaryFeatureData_unpack (&ptr, &bfd_record->image_size, sizeof (uint32_t));
+      if (bfdh[hnd].swap) binaryFeatureData_swap_int ((int32_t *) &bfd_record->image_size);
+      break;
 
- - Arguments:
-                - hnd            =    The BFD file handle
-                - recnum         =    The record number to write or BFDATA_NEXT_RECORD to append
-                - bfd_record     =    The BFD point record to receive the data
-                - poly           =    The polygon/polyline structure or NULL if you haven't
-                                      modified or created the polygon/polyline 
-                - image_file     =    The image file path or "" if no file available
+    case BFDATA_FIELD_IMAGE_NAME:
+      binaryFeatureData_unpack (&ptr, &bfd_record->image_name, 128);
+      break;
 
- - Returns:
-                - BFDATA_SUCCESS
-                - BFDATA_INVALID_RECORD_NUMBER
-                - BFDATA_POLYGON_TOO_LARGE_ERROR
-                - BFDATA_POLY_WRITE_FSEEK_ERROR
-                - BFDATA_POLY_WRITE_ERROR
-                - BFDATA_RECORD_WRITE_FSEEK_ERROR
-                - BFDATA_RECORD_WRITE_ERROR
-                - BFDATA_IMAGE_FILE_OPEN_ERROR
-                - BFDATA_IMAGE_FILE_READ_ERROR
+    case BFDATA_FIELD_PARENT_RECORD:
+      binaryFeatureData_unpack (&ptr, &bfd_record->parent_record, sizeof (uint32_t));
+      if (bfdh[hnd].swap) binaryFeatureData_swap_int ((int32_t *) &bfd_record->parent_record);
+      break;
 
-*********************************************************************************************/
+    case BFDATA_FIELD_CHILD_RECORD:
+      binaryFeatureData_unpack (&ptr, &bfd_record->child_record, sizeof (uint32_t));
+      if (bfdh[hnd].swap) binaryFeatureData_swap_int ((int32_t *) &bfd_record->child_record);
+      break;
+    }
+}
 
-BFDATA_DLL int32_t binaryFeatureData_write_record_image_file (int32_t hnd, int32_t recnum, BFDATA_RECORD *bfd_record, BFDATA_POLYGON *poly,
-                                                              const char *image_file)
+
+
+
+/*!  Unpack the fields in "mask" (see BFDATA_FIELD_MASK) of the on-disk record in "buffer".  The rest of bfd_record is
+     left alone.  */
+
+static void binaryFeatureData_decode_fields (int32_t hnd, const uint8_t *buffer, uint32_t mask, BFDATA_RECORD *bfd_record)
 {
-  FILE *ifp;
-  uint8_t *image = NULL;
-  int32_t ret;
+  int32_t field;
 
 
-  if (strlen (image_file) >= 2)
+  mask &= BFDATA_ALL_FIELDS;
+
+  if (mask == BFDATA_ALL_FIELDS)
     {
-      if ((ifp = fopen (image_file, "rb")) == NULL)
-        {
-          bfd_error.system = errno;
-          bfd_error.recnum = recnum;
-          strcpy (bfd_error.file, image_file);
-          return (bfd_error.bfd = BFDATA_IMAGE_FILE_OPEN_ERROR);
-        }
+      binaryFeatureData_decode_record (hnd, buffer, bfd_record);
+      return;
+    }
 
+  bfdh[hnd].stats.records_decoded++;
 
-      strcpy (bfd_record->image_name, binaryFeatureData_gen_basename (image_file));
+  for (field = 0 ; mask ; field++, mask >>= 1)
+    {
+      if (mask & 1) binaryFeatureData_decode_field (hnd, buffer, field, bfd_record);
+    }
+}
 
 
-      fseek (ifp, 0, SEEK_END);
-      bfd_record->image_size = ftell (ifp);
-      fseek (ifp, 0, SEEK_SET);
 
 
-      image = (uint8_t *) malloc (bfd_record->image_size);
+/*!  Fill the read-ahead buffer starting at record "recnum".  Returns 0 with bfd_error set on failure.  */
 
-      if (image == NULL)
-        {
-          perror ("Allocating image memory");
-	  fflush (stderr);
-          exit (-1);
-        }
+static uint8_t binaryFeatureData_read_ahead (int32_t hnd, uint32_t recnum)
+{
+  uint32_t count;
+  int64_t pos;
 
 
-      if (!fread (image, bfd_record->image_size, 1, ifp))
-        {
-          bfd_error.system = errno;
-          bfd_error.recnum = recnum;
-          strcpy (bfd_error.file, image_file);
-          free (image);
-          fclose (ifp);
-          return (bfd_error.bfd = BFDATA_IMAGE_FILE_READ_ERROR);
-        }
+  count = BFDATA_READ_AHEAD_SIZE / bfdh[hnd].record_size;
+  if (count > bfdh[hnd].header.number_of_records - recnum) count = bfdh[hnd].header.number_of_records - recnum;
 
-      fclose (ifp);
-    }
+  pos = (int64_t) recnum * bfdh[hnd].record_size + bfdh[hnd].header_size;
 
+  bfdh[hnd].ra_count = 0;
 
-  ret = binaryFeatureData_write_record (hnd, recnum, bfd_record, poly, image);
+  if (binaryFeatureData_seek (hnd, bfdh[hnd].fp, pos, SEEK_SET) < 0)
+    {
+      bfd_error.system = errno;
+      bfd_error.recnum = recnum;
+      strcpy (bfd_error.file, bfdh[hnd].path);
+      bfd_error.bfd = BFDATA_RECORD_READ_FSEEK_ERROR;
+      return (0);
+    }
 
+  if (!(count = binaryFeatureData_read (hnd, bfdh[hnd].ra_buffer, bfdh[hnd].record_size, count, bfdh[hnd].fp)))
+    {
+      bfd_error.system = errno;
+      bfd_error.recnum = recnum;
+      strcpy (bfd_error.file, bfdh[hnd].path);
+      bfd_error.bfd = BFDATA_RECORD_READ_ERROR;
+      return (0);
+    }
 
-  free (image);
+  bfdh[hnd].ra_start = recnum;
+  bfdh[hnd].ra_count = count;
 
-  return (ret);
-}
 
+#ifndef NVWIN3X
 
+  /*  Let the kernel know what we're up to so it can have the next chunk ready when we ask for it.  */
 
-/********************************************************************************************/
-/*!
+  if (!bfdh[hnd].ra_advised)
+    {
+      posix_fadvise (fileno (bfdh[hnd].fp), 0, 0, POSIX_FADV_SEQUENTIAL);
+      bfdh[hnd].ra_advised = 1;
+    }
 
- - Function:    binaryFeatureData_write_header
+  posix_fadvise (fileno (bfdh[hnd].fp), pos + (int64_t) count * bfdh[hnd].record_size, BFDATA_READ_AHEAD_SIZE, POSIX_FADV_WILLNEED);
 
- - Purpose:     Write the bfd_header to the BFD file.
+#endif
 
- - Author:      Jan C. Depner (area.based.editor@gmail.com)
 
- - Date:        03/27/09
+  return (1);
+}
 
- - Arguments:   hnd            =    The BFD file handle
 
- - Returns:
-                - BFDATA_SUCCESS
-                - BFDATA_HEADER_WRITE_FSEEK_ERROR
-                - BFDATA_HEADER_WRITE_ERROR
 
-*********************************************************************************************/
 
-static int32_t binaryFeatureData_write_header (int32_t hnd)
+/*!  Get a pointer to the on-disk bytes of record "rec".  If the record is already in the read-ahead buffer we're done.
+     If we're reading sequentially (or the caller says it will be, e.g. for a scan) we refill the buffer starting at this
+     record.  Otherwise we just read the one record into "buffer" (which must be at least bfdh[hnd].record_size bytes).
+     If we can't get memory for the read-ahead buffer we just don't read ahead.  Returns NULL with bfd_error set on
+     failure.  */
+
+static const uint8_t *binaryFeatureData_fetch_record (int32_t hnd, uint32_t rec, uint8_t *buffer, uint8_t sequential)
 {
-  char space = ' ';
-  int32_t i, size, year, jday, hour, minute, month, day;
-  float second;
+  int64_t pos;
+
 
+  /*  Keep track of how many records in a row have been read in order.  */
 
-  if (fseek (bfdh[hnd].fp, 0, SEEK_SET) < 0)
+  if (rec == bfdh[hnd].ra_next)
     {
-      bfd_error.system = errno;
-      strcpy (bfd_error.file, bfdh[hnd].path);
-      return (bfd_error.bfd = BFDATA_HEADER_WRITE_FSEEK_ERROR);
+      bfdh[hnd].ra_streak++;
+    }
+  else
+    {
+      bfdh[hnd].ra_streak = 0;
     }
 
+  bfdh[hnd].ra_next = rec + 1;
 
-  fprintf (bfdh[hnd].fp, "[VERSION] = %s\n", BFDATA_VERSION);
 
-  if (binaryFeatureData_big_endian ())
+  if (bfdh[hnd].ra_count && rec >= bfdh[hnd].ra_start && rec < bfdh[hnd].ra_start + bfdh[hnd].ra_count)
     {
-      fprintf (bfdh[hnd].fp, "[ENDIAN] = BIG\n");
+      bfdh[hnd].stats.read_ahead_hits++;
     }
   else
     {
-      fprintf (bfdh[hnd].fp, "[ENDIAN] = LITTLE\n");
+      if ((sequential || bfdh[hnd].ra_streak >= BFDATA_READ_AHEAD_TRIGGER) &&
+          (bfdh[hnd].ra_buffer != NULL || (bfdh[hnd].ra_buffer = (uint8_t *) malloc (BFDATA_READ_AHEAD_SIZE)) != NULL))
+        {
+          if (!binaryFeatureData_read_ahead (hnd, rec)) return (NULL);
+        }
+      else
+        {
+          pos = (int64_t) rec * bfdh[hnd].record_size + bfdh[hnd].header_size;
+
+          if (binaryFeatureData_seek (hnd, bfdh[hnd].fp, pos, SEEK_SET) < 0)
+            {
+              bfd_error.system = errno;
+              bfd_error.recnum = rec;
+              strcpy (bfd_error.file, bfdh[hnd].path);
+              bfd_error.bfd = BFDATA_RECORD_READ_FSEEK_ERROR;
+              return (NULL);
+            }
+
+          if (!binaryFeatureData_read (hnd, buffer, bfdh[hnd].record_size, 1, bfdh[hnd].fp))
+            {
+              bfd_error.system = errno;
+              bfd_error.recnum = rec;
+              strcpy (bfd_error.file, bfdh[hnd].path);
+              bfd_error.bfd = BFDATA_RECORD_READ_ERROR;
+              return (NULL);
+            }
+
+          return (buffer);
+        }
     }
 
 
-  binaryFeatureData_cvtime (bfdh[hnd].header.creation_tv_sec, bfdh[hnd].header.creation_tv_nsec, &year, &jday, &hour, &minute, &second);
-  binaryFeatureData_jday2mday (year, jday, &month, &day);
-  month++;
+  return (&bfdh[hnd].ra_buffer[(rec - bfdh[hnd].ra_start) * bfdh[hnd].record_size]);
+}
 
-  fprintf (bfdh[hnd].fp, "[CREATION YEAR] = %d\n", year + 1900);
-  fprintf (bfdh[hnd].fp, "[CREATION MONTH] = %02d\n", month);
-  fprintf (bfdh[hnd].fp, "[CREATION DAY] = %02d\n", day);
-  fprintf (bfdh[hnd].fp, "[CREATION DAY OF YEAR] = %03d\n", jday);
-  fprintf (bfdh[hnd].fp, "[CREATION HOUR] = %02d\n", hour);
-  fprintf (bfdh[hnd].fp, "[CREATION MINUTE] = %02d\n", minute);
-  fprintf (bfdh[hnd].fp, "[CREATION SECOND] = %5.2f\n", second);
-  if (strlen (bfdh[hnd].header.creation_software) > 2) fprintf (bfdh[hnd].fp, "[CREATION SOFTWARE] = %s\n", bfdh[hnd].header.creation_software);
 
 
-  binaryFeatureData_cvtime (bfdh[hnd].header.modification_tv_sec, bfdh[hnd].header.modification_tv_nsec, &year, &jday, &hour, &minute, &second);
-  binaryFeatureData_jday2mday (year, jday, &month, &day);
-  month++;
 
-  fprintf (bfdh[hnd].fp, "[MODIFICATION YEAR] = %d\n", year + 1900);
-  fprintf (bfdh[hnd].fp, "[MODIFICATION MONTH] = %02d\n", month);
-  fprintf (bfdh[hnd].fp, "[MODIFICATION DAY] = %02d\n", day);
-  fprintf (bfdh[hnd].fp, "[MODIFICATION DAY OF YEAR] = %03d\n", jday);
-  fprintf (bfdh[hnd].fp, "[MODIFICATION HOUR] = %02d\n", hour);
-  fprintf (bfdh[hnd].fp, "[MODIFICATION MINUTE] = %02d\n", minute);
-  fprintf (bfdh[hnd].fp, "[MODIFICATION SECOND] = %5.2f\n", second);
-  if (strlen (bfdh[hnd].header.modification_software) > 2) fprintf (bfdh[hnd].fp, "[MODIFICATION SOFTWARE] = %s\n", bfdh[hnd].header.modification_software);
+/*!  Pack the BFDATA_RECORD into "buffer" exactly as it will be stored on disk.  The buffer must be at least
+     bfdh[hnd].record_size bytes.  Packing into a buffer lets us write the record with a single fwrite and gives
+     us a copy of the on-disk bytes for the journal.  */
 
-  if (strlen (bfdh[hnd].header.security_classification) > 2) fprintf (bfdh[hnd].fp, "[SECURITY CLASSIFICATION] = %s\n",
-                                                                      bfdh[hnd].header.security_classification);
-  if (strlen (bfdh[hnd].header.distribution) > 2) fprintf (bfdh[hnd].fp, "{DISTRIBUTION = \n%s\n}\n", bfdh[hnd].header.distribution);
-  if (strlen (bfdh[hnd].header.declassification) > 2) fprintf (bfdh[hnd].fp, "{DECLASSIFICATION = \n%s\n}\n", bfdh[hnd].header.declassification);
-  if (strlen (bfdh[hnd].header.class_just) > 2) fprintf (bfdh[hnd].fp, "{SECURITY CLASSIFICATION JUSTIFICATION = \n%s\n}\n", bfdh[hnd].header.class_just);
-  if (strlen (bfdh[hnd].header.downgrade) > 2) fprintf (bfdh[hnd].fp, "{DOWNGRADE = \n%s\n}\n", bfdh[hnd].header.downgrade);
+static void binaryFeatureData_encode_record (int32_t hnd, const BFDATA_RECORD *bfd_record, uint8_t *buffer)
+{
+  bfdh[hnd].stats.records_encoded++;
 
-  fprintf (bfdh[hnd].fp, "[NUMBER OF RECORDS] = %d\n", bfdh[hnd].header.number_of_records);
-  bfdh[hnd].header_size = BFDATA_HEADER_SIZE;
-  fprintf (bfdh[hnd].fp, "[HEADER SIZE] = %d\n", bfdh[hnd].header_size);
+  bfdh[hnd].encode (bfd_record, buffer);
+}
 
 
-  /*  Major version 2 or greater.  */
 
-  if (bfdh[hnd].major_version >= 2) fprintf (bfdh[hnd].fp, "[RECORD SIZE] = %d\n", bfdh[hnd].record_size);
 
+static uint8_t binaryFeatureData_put_record (int32_t hnd, const BFDATA_RECORD *bfd_record, uint8_t *buffer)
+{
+  binaryFeatureData_encode_record (hnd, bfd_record, buffer);
 
-  if (strlen (bfdh[hnd].header.comments) > 2) fprintf (bfdh[hnd].fp, "{COMMENTS = \n%s\n}\n", bfdh[hnd].header.comments);
+  if (!binaryFeatureData_write (hnd, buffer, bfdh[hnd].record_size, 1, bfdh[hnd].fp)) return (0);
+
+  return (1);
+}
 
 
-  /*  Space fill the rest.  */
 
-  size = bfdh[hnd].header_size - ftell (bfdh[hnd].fp);
 
+/*!  Pack count polygon points into "buffer" in the raw .bfa form (interleaved latitude and longitude, swapped if
+     needed).  This doesn't touch the caller's polygon.  */
 
-  for (i = 0 ; i < size ; i++)
+static void binaryFeatureData_encode_polygon (int32_t hnd, int32_t count, const BFDATA_POLYGON *poly, uint8_t *buffer)
+{
+  int32_t i;
+  double lat, lon;
+
+
+  for (i = 0 ; i < count ; i++)
     {
-      if (!fwrite (&space, 1, 1, bfdh[hnd].fp))
+      lat = poly->latitude[i];
+      lon = poly->longitude[i];
+
+      if (bfdh[hnd].swap)
         {
-          bfd_error.system = errno;
-          strcpy (bfd_error.file, bfdh[hnd].path);
-          return (bfd_error.bfd = BFDATA_HEADER_WRITE_ERROR);
+          binaryFeatureData_swap_double (&lat);
+          binaryFeatureData_swap_double (&lon);
         }
+
+      binaryFeatureData_pack (&buffer, &lat, sizeof (double));
+      binaryFeatureData_pack (&buffer, &lon, sizeof (double));
     }
+}
 
 
-  bfdh[hnd].modified = 1;
-  bfdh[hnd].write = 1;
 
+/*!  Make sure the handle's polygon scratch buffer can hold "size" bytes.  Returns 0 on allocation failure.  */
 
-  bfd_error.system = 0;
-  return (bfd_error.bfd = BFDATA_SUCCESS);
+static uint8_t binaryFeatureData_poly_space (int32_t hnd, int64_t size)
+{
+  uint8_t *data;
+
+
+  if (size <= bfdh[hnd].poly_buffer_alloc) return (1);
+
+  if ((data = (uint8_t *) realloc (bfdh[hnd].poly_buffer, size)) == NULL) return (0);
+
+  bfdh[hnd].poly_buffer = data;
+  bfdh[hnd].poly_buffer_alloc = size;
+
+  return (1);
 }
 
 
@@ -747,574 +1122,7947 @@ static int32_t binaryFeatureData_write_header (int32_t hnd)
 /********************************************************************************************/
 /*!
 
- - Function:    binaryFeatureData_create_file
+ - Function:    binaryFeatureData_encode_block
 
- - Purpose:     Create a BFD file.
+ - Purpose:     Store count polygon points in "out" the way they'll be stored in the .bfa
+                file.  Normally this is just the raw interleaved latitude and longitude
+                doubles.  If delta encoding has been requested (see
+                binaryFeatureData_set_polygon_encoding) the points are scaled to integers and
+                stored as zigzag varint differences from the previous point:
 
- - Author:      Jan C. Depner (area.based.editor@gmail.com)
+                <pre>
+                BFDATA_POLY_DELTA_MAGIC           8 bytes
+                size of the varint data           uint32 (little endian)
+                reserved                          uint32 (0)
+                scale                             double (little endian)
+                lat0, lon0, lat1-lat0, ...        zigzag varints
+                </pre>
 
- - Date:        03/27/09
+                The magic, read as a double, is nowhere near a valid latitude so it can't be
+                mistaken for the start of a raw polygon.  If the encoded polygon isn't smaller
+                than the raw one (or a scaled point is 4.0e18 or more, so that the differences
+                might not fit in 64 bit integers) we store it raw.
+
+ - Date:        10/19/26
 
  - Arguments:
-                - path           =    The BFD file path
-                - bfd_header     =    BFDATA_HEADER structure to be written to the file
+                - hnd            =    The file handle
+                - count          =    Number of points
+                - poly           =    The polygon
+                - out            =    Output buffer, at least BFDATA_POLY_DELTA_HEADER_SIZE +
+                                      count * 20 bytes
 
  - Returns:
-                - The file handle (0 or positive)
-                - BFDATA_TOO_MANY_OPEN_FILES
-                - BFDATA_CREATE_ERROR
-                - BFDATA_CREATE_POLY_ERROR
-                - BFDATA_HEADER_WRITE_FSEEK_ERROR
-                - BFDATA_HEADER_WRITE_ERROR
+                - Number of bytes stored in out
 
 *********************************************************************************************/
 
-BFDATA_DLL int32_t binaryFeatureData_create_file (const char *path, BFDATA_HEADER bfd_header)
+static int64_t binaryFeatureData_encode_block (int32_t hnd, int32_t count, const BFDATA_POLYGON *poly, uint8_t *out)
 {
-  char space = ' ', info[128];
-  int32_t i, hnd, size;
-  float tmpf;
-
+  uint8_t *ptr, *end;
+  const double limit = 4.0e18;
+  double scale = bfdh[hnd].poly_scale, lat, lon;
+  int64_t ilat, ilon, prev_lat = 0, prev_lon = 0, size, raw_size = (int64_t) count * 2 * sizeof (double);
+  uint64_t bits;
+  int32_t i;
 
-  /*  The first time through we want to initialize (zero) the BFD handle array.  */
 
-  if (first)
+  if (bfdh[hnd].poly_encoding == BFDATA_POLYGON_DELTA)
     {
-      for (i = 0 ; i < BFDATA_MAX_FILES ; i++) 
+      ptr = out + BFDATA_POLY_DELTA_HEADER_SIZE;
+      end = out + raw_size;
+
+      for (i = 0 ; i < count && ptr < end ; i++)
         {
-          memset (&bfdh[i], 0, sizeof (INTERNAL_BFDATA_STRUCT));
-          bfdh[i].fp = NULL;
-          bfdh[i].afp = NULL;
-          bfdh[i].short_feature = NULL;
-        }
+          lat = poly->latitude[i] * scale;
+          lon = poly->longitude[i] * scale;
 
-      first = 0;
-    }
+          /*  Both points have to be under 2^62 (about 4.6e18) in magnitude or the difference can overflow 64 bits.  */
 
+          if (!(fabs (lat) < limit && fabs (lon) < limit)) break;
 
-  /*  Find the next available handle and make sure we haven't opened too many.  */
+          ilat = llround (lat);
+          ilon = llround (lon);
 
-  hnd = BFDATA_MAX_FILES;
-  for (i = 0 ; i < BFDATA_MAX_FILES ; i++)
-    {
-      if (bfdh[i].fp == NULL)
+          binaryFeatureData_put_varint (&ptr, ilat - prev_lat);
+          binaryFeatureData_put_varint (&ptr, ilon - prev_lon);
+
+          prev_lat = ilat;
+          prev_lon = ilon;
+        }
+
+
+      if (i == count && ptr < end)
         {
-          hnd = i;
-          bfdh[hnd].last_rec = -1;
-          break;
+          size = ptr - out;
+
+          ptr = out;
+          binaryFeatureData_pack (&ptr, BFDATA_POLY_DELTA_MAGIC, 8);
+          binaryFeatureData_put_le32 (&ptr, (uint32_t) (size - BFDATA_POLY_DELTA_HEADER_SIZE));
+          binaryFeatureData_put_le32 (&ptr, 0);
+          memcpy (&bits, &scale, sizeof (double));
+          binaryFeatureData_put_le64 (&ptr, bits);
+
+          return (size);
         }
     }
 
 
-  if (hnd == BFDATA_MAX_FILES) return (bfd_error.bfd = BFDATA_TOO_MANY_OPEN_FILES);
+  binaryFeatureData_encode_polygon (hnd, count, poly, out);
 
+  return (raw_size);
+}
 
-  /*  Set the major version.  */
 
-  strcpy (info, strstr (BFDATA_VERSION, "library V"));
-  sscanf (info, "library V%f", &tmpf);
-  bfdh[hnd].major_version = (int32_t) tmpf;
 
+/********************************************************************************************/
+/*!
 
-  /*  Make sure we know the BFDATA_RECORD size as stored on disk.  */
+ - Function:    binaryFeatureData_build_trailer
 
-  bfdh[hnd].record_size = binaryFeatureData_compute_record_size (hnd);
+ - Purpose:     Build the polygon trailer in the handle's lod_buffer.  The trailer is stored
+                immediately in front of the polygon in the .bfa file so that anything that
+                only knows about poly_address (including older versions of the library)
+                still finds the full polygon right where it expects it.  The layout is:
 
+                <pre>
+                level of detail polygon blocks    (see binaryFeatureData_encode_block)
+                meta data sections                (tag uint32, length uint32, data)
+                meta data size                    uint32
+                meta data checksum (FNV-1a)       uint32
+                BFDATA_POLY_TRAILER_MAGIC         8 bytes
+                </pre>
 
-  /*  Save the file name for error messages.  */
+                The BFDATA_POLY_SECTION_LOD section holds the number of levels followed by
+                the tolerance (double), point count, block size, and distance back from
+                poly_address (uint64) of each level.  The BFDATA_POLY_SECTION_BOUNDS
+                section holds the minimum latitude, minimum longitude, maximum latitude,
+                and maximum longitude (doubles).  Everything is little endian.
 
-  strcpy (bfdh[hnd].path, path);
+ - Date:        10/19/26
 
+ - Arguments:
+                - hnd            =    The file handle
+                - count          =    Number of points
+                - poly_type      =    0 - polyline, 1 - polygon
+                - poly           =    The polygon
 
-  /*  Open the file and write the header.  */
+ - Returns:
+                - Size of the trailer in bytes (0 if there is nothing to put in it)
+                - -1 on allocation failure
 
-  if ((bfdh[hnd].fp = fopen (path, "wb+")) == NULL)
+*********************************************************************************************/
+
+static int64_t binaryFeatureData_build_trailer (int32_t hnd, int32_t count, uint8_t poly_type, const BFDATA_POLYGON *poly)
+{
+  uint8_t *ptr, *meta, *data;
+  double *sig = NULL;
+  int32_t *stack = NULL, i, j, level, levels = 0, min_count, lod_count[BFDATA_MAX_LOD_LEVELS], prev_count;
+  int64_t alloc, lod_start[BFDATA_MAX_LOD_LEVELS], lod_size[BFDATA_MAX_LOD_LEVELS], size;
+  double lod_tolerance[BFDATA_MAX_LOD_LEVELS];
+  uint64_t bits;
+  uint8_t have_bounds;
+  BFDATA_POLYGON_BOUNDS bounds;
+
+
+  if (count < 1) return (0);
+
+
+  /*  Each stored level has at most half the points of the one before so all of the levels together can't have more
+      points than the full polygon.  */
+
+  alloc = BFDATA_MAX_LOD_LEVELS * BFDATA_POLY_DELTA_HEADER_SIZE + (int64_t) count * 20 + 256 + BFDATA_MAX_LOD_LEVELS * 24 + 40;
+
+  if (alloc > bfdh[hnd].lod_buffer_alloc)
     {
-      bfd_error.system = errno;
-      strcpy (bfd_error.file, bfdh[hnd].path);
-      return (bfd_error.bfd = BFDATA_CREATE_ERROR);
+      if ((data = (uint8_t *) realloc (bfdh[hnd].lod_buffer, alloc)) == NULL) return (-1);
+
+      bfdh[hnd].lod_buffer = data;
+      bfdh[hnd].lod_buffer_alloc = alloc;
     }
 
+  ptr = bfdh[hnd].lod_buffer;
 
-  /*  Open the associated polygon file and write the version string.  */
 
-  if (hnd >= 0)
+  if (bfdh[hnd].lod_levels && count >= 3)
     {
-      strcpy (bfdh[hnd].a_path, path);
-      sprintf (&bfdh[hnd].a_path[strlen (bfdh[hnd].a_path) - 3], "bfa");
+      if (bfdh[hnd].lod_poly == NULL && (bfdh[hnd].lod_poly = (BFDATA_POLYGON *) malloc (sizeof (BFDATA_POLYGON))) == NULL)
+        return (-1);
 
-      if ((bfdh[hnd].afp = fopen64 (bfdh[hnd].a_path, "wb+")) == NULL)
+      sig = (double *) malloc (count * sizeof (double));
+      stack = (int32_t *) malloc (count * 2 * sizeof (int32_t));
+
+      if (sig == NULL || stack == NULL)
         {
-          bfd_error.system = errno;
-          strcpy (bfd_error.file, bfdh[hnd].a_path);
-          return (bfd_error.bfd = BFDATA_CREATE_POLY_ERROR);
+          free (sig);
+          free (stack);
+          return (-1);
         }
 
-      fprintf (bfdh[hnd].afp, "%s\n", BFDATA_VERSION);
 
+      binaryFeatureData_polygon_significance (count, poly->latitude, poly->longitude, sig, stack);
+    }
 
-      /*  Space fill the rest.  */
 
-      size = BFDATA_POLY_VERSION_SIZE - ftello64 (bfdh[hnd].afp);
+  /*  Only store a level if it's worth it (no more than half the points of the previous level).  */
 
+  min_count = poly_type ? 3 : 2;
+  prev_count = count;
 
-      for (i = 0 ; i < size ; i++)
+  for (level = 0 ; sig != NULL && level < bfdh[hnd].lod_levels ; level++)
+    {
+      for (i = 0, j = 0 ; i < count ; i++)
         {
-          if (!fwrite (&space, 1, 1, bfdh[hnd].afp))
+          if (sig[i] > bfdh[hnd].lod_tolerance[level])
             {
-              bfd_error.system = errno;
-              strcpy (bfd_error.file, bfdh[hnd].a_path);
-              return (bfd_error.bfd = BFDATA_HEADER_WRITE_ERROR);
+              bfdh[hnd].lod_poly->latitude[j] = poly->latitude[i];
+              bfdh[hnd].lod_poly->longitude[j] = poly->longitude[i];
+              j++;
             }
         }
+
+      if (j < min_count || j > prev_count / 2) continue;
+
+      lod_count[levels] = j;
+      lod_start[levels] = ptr - bfdh[hnd].lod_buffer;
+      lod_size[levels] = binaryFeatureData_encode_block (hnd, j, bfdh[hnd].lod_poly, ptr);
+      ptr += lod_size[levels];
+
+      lod_tolerance[levels] = bfdh[hnd].lod_tolerance[level];
+      prev_count = j;
+      levels++;
     }
 
+  free (sig);
+  free (stack);
 
-  bfdh[hnd].header = bfd_header;
 
+  have_bounds = binaryFeatureData_polygon_bounds (count, poly->latitude, poly->longitude, &bounds);
 
-  bfdh[hnd].header.number_of_records = 0;
+  if (!levels && !have_bounds) return (0);
 
 
-  /*  Write the header.  */
+  /*  The meta data.  */
 
-  if (binaryFeatureData_write_header (hnd) < 0) return (bfd_error.bfd = BFDATA_HEADER_WRITE_ERROR);
+  meta = ptr;
 
+  if (levels)
+    {
+      binaryFeatureData_put_le32 (&ptr, BFDATA_POLY_SECTION_LOD);
+      binaryFeatureData_put_le32 (&ptr, 8 + levels * 24);
+      binaryFeatureData_put_le32 (&ptr, levels);
+      binaryFeatureData_put_le32 (&ptr, 0);
 
-  bfdh[hnd].modified = 1;
-  bfdh[hnd].created = 1;
-  bfdh[hnd].write = 1;
 
+      /*  The distance back from poly_address is from the start of the level to the end of the trailer.  */
 
-  bfd_error.system = 0;
-  return (hnd);
+      size = (meta - bfdh[hnd].lod_buffer) + (8 + 8 + levels * 24) + (have_bounds ? 8 + 32 : 0) + 16;
+
+      for (i = 0 ; i < levels ; i++)
+        {
+          memcpy (&bits, &lod_tolerance[i], sizeof (double));
+          binaryFeatureData_put_le64 (&ptr, bits);
+          binaryFeatureData_put_le32 (&ptr, lod_count[i]);
+          binaryFeatureData_put_le32 (&ptr, (uint32_t) lod_size[i]);
+          binaryFeatureData_put_le64 (&ptr, size - lod_start[i]);
+        }
+    }
+
+  if (have_bounds)
+    {
+      binaryFeatureData_put_le32 (&ptr, BFDATA_POLY_SECTION_BOUNDS);
+      binaryFeatureData_put_le32 (&ptr, 32);
+
+      memcpy (&bits, &bounds.min_latitude, sizeof (double));
+      binaryFeatureData_put_le64 (&ptr, bits);
+      memcpy (&bits, &bounds.min_longitude, sizeof (double));
+      binaryFeatureData_put_le64 (&ptr, bits);
+      memcpy (&bits, &bounds.max_latitude, sizeof (double));
+      binaryFeatureData_put_le64 (&ptr, bits);
+      memcpy (&bits, &bounds.max_longitude, sizeof (double));
+      binaryFeatureData_put_le64 (&ptr, bits);
+    }
+
+
+  binaryFeatureData_put_le32 (&ptr, (uint32_t) (ptr - meta));
+  binaryFeatureData_put_le32 (&ptr, binaryFeatureData_fnv1a (BFDATA_FNV1A_SEED, meta, ptr - 4 - meta));
+  binaryFeatureData_pack (&ptr, BFDATA_POLY_TRAILER_MAGIC, 8);
+
+
+  return (ptr - bfdh[hnd].lod_buffer);
 }
 
 
+
 /********************************************************************************************/
 /*!
 
- - Function:    binaryFeatureData_open_file
-
- - Purpose:     Open a BFD file.
+ - Function:    binaryFeatureData_build_polygon
 
- - Author:      Jan C. Depner (area.based.editor@gmail.com)
+ - Purpose:     Build the block of bytes that will be stored in the .bfa file for a polygon
+                in the handle's scratch buffer.  This is the trailer (if any, see
+                binaryFeatureData_build_trailer) followed by the polygon itself (see
+                binaryFeatureData_encode_block).
 
- - Date:        03/25/09
+ - Date:        10/19/26
 
  - Arguments:
-                - path           =    The BFD file path
-                - bfd_header     =    BFDATA_HEADER structure to be populated
-                - mode           =    BFDATA_UPDATE or BFDATA_READ_ONLY
+                - hnd            =    The file handle
+                - bfd_record     =    The record (for poly_count and poly_type)
+                - poly           =    The polygon
+                - size           =    Returned size of the block in bytes
+                - offset         =    Returned offset of the polygon in the block.  This is
+                                      what poly_address has to point to.
 
  - Returns:
-                - The file handle (0 or positive) or
-                - BFDATA_TOO_MANY_OPEN_FILES
-                - BFDATA_OPEN_UPDATE_ERROR
-                - BFDATA_OPEN_POLY_UPDATE_ERROR
-                - BFDATA_OPEN_READONLY_ERROR
-                - BFDATA_OPEN_POLY_READONLY_ERROR
-                - BFDATA_NOT_BFD_FILE_ERROR
+                - Pointer to the block (in the handle's scratch buffer) or NULL if we
+                  couldn't allocate memory
 
 *********************************************************************************************/
 
-BFDATA_DLL int32_t binaryFeatureData_open_file (const char *path, BFDATA_HEADER *bfd_header, int32_t mode)
+static uint8_t *binaryFeatureData_build_polygon (int32_t hnd, const BFDATA_RECORD *bfd_record, const BFDATA_POLYGON *poly, int64_t *size,
+                                                 int64_t *offset)
 {
-  int32_t i, hnd, year[4], jday[4], hour[4], minute[4], eof;
-  float second[4], tmpf;
-  char varin[8192], info[8192];
+  int32_t count = bfd_record->poly_count;
 
 
-  /*  The first time through we want to initialize (zero) the bfd handle array.  */
+  if ((*offset = binaryFeatureData_build_trailer (hnd, count, bfd_record->poly_type, poly)) < 0) return (NULL);
 
-  if (first)
-    {
-      for (i = 0 ; i < BFDATA_MAX_FILES ; i++) 
-        {
-          memset (&bfdh[i], 0, sizeof (INTERNAL_BFDATA_STRUCT));
-          bfdh[i].fp = NULL;
-          bfdh[i].afp = NULL;
-          bfdh[i].short_feature = NULL;
-        }
+  if (!binaryFeatureData_poly_space (hnd, *offset + BFDATA_POLY_DELTA_HEADER_SIZE + (int64_t) count * 20)) return (NULL);
 
-      first = 0;
-    }
+  if (*offset) memcpy (bfdh[hnd].poly_buffer, bfdh[hnd].lod_buffer, *offset);
 
+  *size = *offset + binaryFeatureData_encode_block (hnd, count, poly, bfdh[hnd].poly_buffer + *offset);
 
-  /*  Find the next available handle and make sure we haven't opened too many.  */
+  return (bfdh[hnd].poly_buffer);
+}
 
-  hnd = BFDATA_MAX_FILES;
-  for (i = 0 ; i < BFDATA_MAX_FILES ; i++)
+
+
+/*!  Read and check the trailer meta data in front of the polygon at "address" into the handle's poly_meta buffer.
+     Returns the size of the meta data or 0 if there is no (valid) trailer, which is the case for every polygon written
+     before version 3.10 of the library.  */
+
+static uint32_t binaryFeatureData_read_poly_meta (int32_t hnd, int64_t address)
+{
+  uint8_t tail[16], *data;
+  const uint8_t *ptr;
+  uint32_t size, checksum;
+
+
+  if (address < BFDATA_POLY_VERSION_SIZE + 16) return (0);
+
+  if (binaryFeatureData_seek (hnd, bfdh[hnd].afp, address - 16, SEEK_SET) < 0 || !binaryFeatureData_read (hnd, tail, 16, 1, bfdh[hnd].afp)) return (0);
+
+  if (memcmp (&tail[8], BFDATA_POLY_TRAILER_MAGIC, 8)) return (0);
+
+  ptr = tail;
+  size = binaryFeatureData_get_le32 (&ptr);
+  checksum = binaryFeatureData_get_le32 (&ptr);
+
+  if (size < 8 || size > 65536 || address - 16 - size < BFDATA_POLY_VERSION_SIZE) return (0);
+
+
+  if (size > bfdh[hnd].poly_meta_alloc)
     {
-      if (bfdh[i].fp == NULL)
-        {
-          hnd = i;
-          bfdh[hnd].last_rec = -1;
-          break;
-        }
+      if ((data = (uint8_t *) realloc (bfdh[hnd].poly_meta, size)) == NULL) return (0);
+
+      bfdh[hnd].poly_meta = data;
+      bfdh[hnd].poly_meta_alloc = size;
     }
 
+  if (binaryFeatureData_seek (hnd, bfdh[hnd].afp, address - 16 - size, SEEK_SET) < 0 || !binaryFeatureData_read (hnd, bfdh[hnd].poly_meta, size, 1, bfdh[hnd].afp)) return (0);
 
-  if (hnd == BFDATA_MAX_FILES) return (bfd_error.bfd = BFDATA_TOO_MANY_OPEN_FILES);
+  if (binaryFeatureData_fnv1a (BFDATA_FNV1A_SEED, bfdh[hnd].poly_meta, size) != checksum) return (0);
 
 
-  /*  Internal structs are zeroed above and on close of file so we don't have to do it here.  */
+  return (size);
+}
 
 
-  /*  Save the file name for error messages.  */
 
-  strcpy (bfdh[hnd].path, path);
+/*!  Find the section with "tag" in the meta data read by binaryFeatureData_read_poly_meta.  Returns a pointer to the
+     section data (and its length) or NULL if it isn't there.  */
 
+static const uint8_t *binaryFeatureData_find_poly_section (int32_t hnd, uint32_t meta_size, uint32_t tag, uint32_t *length)
+{
+  const uint8_t *ptr = bfdh[hnd].poly_meta, *end = bfdh[hnd].poly_meta + meta_size;
+  uint32_t section;
 
-  /*  Open the file and read the header.  */
 
-  switch (mode)
+  while (end - ptr >= 8)
     {
-    case BFDATA_UPDATE:
-      if ((bfdh[hnd].fp = fopen (path, "rb+")) == NULL)
-        {
-          bfd_error.system = errno;
-          strcpy (bfd_error.file, bfdh[hnd].path);
-          return (bfd_error.bfd = BFDATA_OPEN_UPDATE_ERROR);
-        }
+      section = binaryFeatureData_get_le32 (&ptr);
+      *length = binaryFeatureData_get_le32 (&ptr);
 
+      if (*length > (uint32_t) (end - ptr)) return (NULL);
 
-      strcpy (bfdh[hnd].a_path, path);
-      sprintf (&bfdh[hnd].a_path[strlen (bfdh[hnd].a_path) - 3], "bfa");
+      if (section == tag) return (ptr);
 
-      if ((bfdh[hnd].afp = fopen64 (bfdh[hnd].a_path, "rb+")) == NULL)
+      ptr += *length;
+    }
+
+  return (NULL);
+}
+
+
+
+/*!  Compute the bounding box of a record from the .bfa file.  This uses the BFDATA_POLY_SECTION_BOUNDS trailer section if
+     there is one, otherwise (polygons written before version 3.11) it reads the polygon.  Records without a polygon (or
+     with no valid points) get a box around the feature position.  */
+
+static int32_t binaryFeatureData_record_bounds (int32_t hnd, int32_t recnum, BFDATA_RECORD *bfd_record, BFDATA_POLYGON_BOUNDS *bounds)
+{
+  const uint8_t *ptr;
+  uint32_t meta_size, length;
+  uint64_t bits;
+
+
+  if (bfd_record->poly_address && bfd_record->poly_count)
+    {
+      if ((meta_size = binaryFeatureData_read_poly_meta (hnd, bfd_record->poly_address)) &&
+          (ptr = binaryFeatureData_find_poly_section (hnd, meta_size, BFDATA_POLY_SECTION_BOUNDS, &length)) != NULL && length >= 32)
         {
-          bfd_error.system = errno;
-          strcpy (bfd_error.file, bfdh[hnd].a_path);
-          return (bfd_error.bfd = BFDATA_OPEN_POLY_UPDATE_ERROR);
+          bits = binaryFeatureData_get_le64 (&ptr);
+          memcpy (&bounds->min_latitude, &bits, sizeof (double));
+          bits = binaryFeatureData_get_le64 (&ptr);
+          memcpy (&bounds->min_longitude, &bits, sizeof (double));
+          bits = binaryFeatureData_get_le64 (&ptr);
+          memcpy (&bounds->max_latitude, &bits, sizeof (double));
+          bits = binaryFeatureData_get_le64 (&ptr);
+          memcpy (&bounds->max_longitude, &bits, sizeof (double));
+
+          return (BFDATA_SUCCESS);
         }
-      break;
 
-    case BFDATA_READONLY:
-      if ((bfdh[hnd].fp = fopen (path, "rb")) == NULL)
+
+      if (bfdh[hnd].lod_poly == NULL && (bfdh[hnd].lod_poly = (BFDATA_POLYGON *) malloc (sizeof (BFDATA_POLYGON))) == NULL)
         {
           bfd_error.system = errno;
+          bfd_error.recnum = recnum;
           strcpy (bfd_error.file, bfdh[hnd].path);
-          return (bfd_error.bfd = BFDATA_OPEN_READONLY_ERROR);
+          return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
         }
 
+      if (binaryFeatureData_do_read_polygon (hnd, recnum, bfdh[hnd].lod_poly) < 0) return (bfd_error.bfd);
 
-      strcpy (bfdh[hnd].a_path, path);
-      sprintf (&bfdh[hnd].a_path[strlen (bfdh[hnd].a_path) - 3], "bfa");
-
-      if ((bfdh[hnd].afp = fopen64 (bfdh[hnd].a_path, "rb")) == NULL)
-        {
-          bfd_error.system = errno;
-          strcpy (bfd_error.file, bfdh[hnd].a_path);
-          return (bfd_error.bfd = BFDATA_OPEN_POLY_READONLY_ERROR);
-        }
-      break;
+      if (binaryFeatureData_polygon_bounds (bfd_record->poly_count, bfdh[hnd].lod_poly->latitude, bfdh[hnd].lod_poly->longitude, bounds))
+        return (BFDATA_SUCCESS);
     }
 
 
-  year[0] = year[1] = 0;
+  bounds->min_latitude = bounds->max_latitude = bfd_record->latitude;
+  bounds->min_longitude = bounds->max_longitude = bfd_record->longitude;
+
+
+  return (BFDATA_SUCCESS);
+}
 
 
-  /*  We want to try to read the first line (version info) with an fread in case we mistakenly asked to
-      load a binary file.  If we try to use bfd_ngets to read a binary file and there are no line feeds in 
-      the first sizeof (varin) characters we would segfault.  */
 
-  if (!fread (varin, 128, 1, bfdh[hnd].fp))
+/*!  Load the handle's bounds array from the polygon bounds file (see binaryFeatureData_save_bounds) if the header's
+     [BOUNDS STAMP] says it goes with this file.  Returns 1 if it did.  If it can't be used we forget about it so we
+     don't try again.  */
+
+static uint8_t binaryFeatureData_load_bounds (int32_t hnd)
+{
+  FILE *bfp;
+  uint8_t buffer[BFDATA_BOUNDS_HEADER_SIZE + 256 * 32];
+  const uint8_t *ptr;
+  BFDATA_POLYGON_BOUNDS *bounds;
+  uint32_t stamp, count, i, j, n;
+  uint64_t bits;
+
+
+  if (!bfdh[hnd].bounds_stamp) return (0);
+
+  if ((bfp = fopen64 (bfdh[hnd].b_path, "rb")) == NULL)
     {
-      strcpy (bfd_error.file, bfdh[hnd].path);
-      return (bfd_error.bfd = BFDATA_NOT_BFD_FILE_ERROR);
+      bfdh[hnd].bounds_stamp = 0;
+      return (0);
     }
 
 
-  /*  Check for the "Binary Feature Data library" or "BFD library" string at the beginning of the file.  Either is acceptable, 
-      it was changed in version 1.02).  */
+  ptr = buffer + 8;
 
-  if (!strstr (varin, "Binary Feature Data library") && !strstr (varin, "BFD library"))
+  if (!fread (buffer, BFDATA_BOUNDS_HEADER_SIZE, 1, bfp) || memcmp (buffer, BFDATA_BOUNDS_MAGIC, 8) ||
+      (stamp = binaryFeatureData_get_le32 (&ptr)) != bfdh[hnd].bounds_stamp ||
+      (count = binaryFeatureData_get_le32 (&ptr)) != bfdh[hnd].bounds_count)
     {
-      strcpy (bfd_error.file, bfdh[hnd].path);
-      return (bfd_error.bfd = BFDATA_NOT_BFD_FILE_ERROR);
+      fclose (bfp);
+      bfdh[hnd].bounds_stamp = 0;
+      return (0);
     }
 
+  if (count > bfdh[hnd].poly_bounds_alloc)
+    {
+      if ((bounds = (BFDATA_POLYGON_BOUNDS *) realloc (bfdh[hnd].poly_bounds, count * sizeof (BFDATA_POLYGON_BOUNDS))) == NULL)
+        {
+          fclose (bfp);
+          return (0);
+        }
 
-  /*  Rewind to the beginning of the file.  Yes, we'll read the version again but we need to check the version number anyway.  */
-
-  fseek (bfdh[hnd].fp, 0, SEEK_SET);
+      bfdh[hnd].poly_bounds = bounds;
+      bfdh[hnd].poly_bounds_alloc = count;
+    }
 
 
-  /*  Note, we're using binaryFeatureData_ngets instead of fgets since we really don't want the CR/LF in the strings.  */
+  bfdh[hnd].poly_bounds_valid = 0;
 
-  while (binaryFeatureData_ngets (varin, sizeof (varin), bfdh[hnd].fp))
+  for (i = 0 ; i < count ; i += n)
     {
-      if (strstr (varin, "[END OF HEADER]")) break;
+      n = count - i < 256 ? count - i : 256;
 
+      if (!fread (buffer, n * 32, 1, bfp))
+        {
+          fclose (bfp);
+          bfdh[hnd].bounds_stamp = 0;
+          return (0);
+        }
 
-      /*  Put everything to the right of the equals sign into 'info'.   */
+      ptr = buffer;
 
-      binaryFeatureData_get_string (varin, info);
+      for (j = 0 ; j < n ; j++)
+        {
+          bounds = &bfdh[hnd].poly_bounds[i + j];
+
+          bits = binaryFeatureData_get_le64 (&ptr);
+          memcpy (&bounds->min_latitude, &bits, sizeof (double));
+          bits = binaryFeatureData_get_le64 (&ptr);
+          memcpy (&bounds->min_longitude, &bits, sizeof (double));
+          bits = binaryFeatureData_get_le64 (&ptr);
+          memcpy (&bounds->max_latitude, &bits, sizeof (double));
+          bits = binaryFeatureData_get_le64 (&ptr);
+          memcpy (&bounds->max_longitude, &bits, sizeof (double));
+        }
+    }
 
+  fclose (bfp);
 
-      /*  Read the version string and check the major version number against the library major version.  */
 
-      if (strstr (varin, "[VERSION]"))
-        {
-          strcpy (bfdh[hnd].header.version, info);
-          strcpy (info, strstr (varin, "library V"));
-          sscanf (info, "library V%f", &tmpf);
-          bfdh[hnd].major_version = (int16_t) tmpf;
+  bfdh[hnd].poly_bounds_count = count;
+  bfdh[hnd].poly_bounds_valid = 1;
 
-          strcpy (info, strstr (BFDATA_VERSION, "library V"));
-          sscanf (info, "library V%f", &tmpf);
-          if (bfdh[hnd].major_version > (int16_t) tmpf)
-            {
-              strcpy (bfd_error.file, bfdh[hnd].path);
-              return (bfd_error.bfd = BFDATA_NEWER_FILE_VERSION_ERROR);
-            }
-        }
+  return (1);
+}
 
 
-      if (strstr (varin, "[ENDIAN]"))
-        {
-          if (binaryFeatureData_big_endian ())
-            {
-              if (strstr (info, "LITTLE"))
-                {
-                  bfdh[hnd].swap = 1;
-                }
-              else
-                {
-                  bfdh[hnd].swap = 0;
-                }
-            }
-          else
-            {
-              if (strstr (info, "BIG"))
-                {
-                  bfdh[hnd].swap = 1;
-                }
-              else
-                {
-                  bfdh[hnd].swap = 0;
-                }
-            }
+
+/*!  Save the handle's bounds array in the polygon bounds file (the BFD file name with a .bfb extension) so that
+     binaryFeatureData_read_all_polygon_bounds and binaryFeatureData_get_polygon_bounds can load it after the next open
+     instead of going through the .bfa file.  The file is:
+
+     <pre>
+     BFDATA_BOUNDS_MAGIC                            8 bytes
+     stamp                                          uint32 (little endian)
+     number of records                              uint32 (little endian)
+     min lat, min lon, max lat, max lon             4 doubles (little endian) for each record
+     </pre>
+
+     The stamp is also put in the header as [BOUNDS STAMP] (the caller has to write the header).  The first write
+     through a handle removes the bounds file (see binaryFeatureData_update_bounds) and older versions of the library
+     drop the stamp when they rewrite the header so a bounds file that doesn't go with the BFD file isn't used.
+     Returns 1 if the file was written.  */
+
+static uint8_t binaryFeatureData_save_bounds (int32_t hnd)
+{
+  FILE *bfp;
+  uint8_t buffer[BFDATA_BOUNDS_HEADER_SIZE + 256 * 32], *ptr;
+  const BFDATA_POLYGON_BOUNDS *bounds;
+  uint32_t stamp, count = bfdh[hnd].poly_bounds_count, i, j, n;
+  uint64_t bits;
+  uint8_t ok;
+  time_t t;
+
+
+  stamp = (uint32_t) time (&t) ^ (uint32_t) binaryFeatureData_nsecs ();
+  if (!stamp) stamp = 1;
+
+
+  if ((bfp = fopen64 (bfdh[hnd].b_path, "wb")) == NULL) return (0);
+
+  ptr = buffer;
+  binaryFeatureData_pack (&ptr, BFDATA_BOUNDS_MAGIC, 8);
+  binaryFeatureData_put_le32 (&ptr, stamp);
+  binaryFeatureData_put_le32 (&ptr, count);
+
+  ok = fwrite (buffer, BFDATA_BOUNDS_HEADER_SIZE, 1, bfp);
+
+  for (i = 0 ; ok && i < count ; i += n)
+    {
+      n = count - i < 256 ? count - i : 256;
+
+      ptr = buffer;
+
+      for (j = 0 ; j < n ; j++)
+        {
+          bounds = &bfdh[hnd].poly_bounds[i + j];
+
+          memcpy (&bits, &bounds->min_latitude, sizeof (double));
+          binaryFeatureData_put_le64 (&ptr, bits);
+          memcpy (&bits, &bounds->min_longitude, sizeof (double));
+          binaryFeatureData_put_le64 (&ptr, bits);
+          memcpy (&bits, &bounds->max_latitude, sizeof (double));
+          binaryFeatureData_put_le64 (&ptr, bits);
+          memcpy (&bits, &bounds->max_longitude, sizeof (double));
+          binaryFeatureData_put_le64 (&ptr, bits);
         }
 
+      ok = fwrite (buffer, n * 32, 1, bfp);
+    }
 
-      if (strstr (varin, "[CREATION YEAR]")) sscanf (info, "%d", &year[0]);
-      if (strstr (varin, "[CREATION DAY OF YEAR]")) sscanf (info, "%d", &jday[0]);
-      if (strstr (varin, "[CREATION HOUR]")) sscanf (info, "%d", &hour[0]);
-      if (strstr (varin, "[CREATION MINUTE]")) sscanf (info, "%d", &minute[0]);
-      if (strstr (varin, "[CREATION SECOND]")) sscanf (info, "%f", &second[0]);
-      if (strstr (varin, "[CREATION SOFTWARE]")) strcpy (bfdh[hnd].header.creation_software, info);
 
-      if (strstr (varin, "[MODIFICATION YEAR]")) sscanf (info, "%d", &year[1]);
-      if (strstr (varin, "[MODIFICATION DAY OF YEAR]")) sscanf (info, "%d", &jday[1]);
-      if (strstr (varin, "[MODIFICATION HOUR]")) sscanf (info, "%d", &hour[1]);
-      if (strstr (varin, "[MODIFICATION MINUTE]")) sscanf (info, "%d", &minute[1]);
-      if (strstr (varin, "[MODIFICATION SECOND]")) sscanf (info, "%f", &second[1]);
-      if (strstr (varin, "[MODIFICATION SOFTWARE]")) strcpy (bfdh[hnd].header.modification_software, info);
+  /*  The header is going to point at this file so it has to get to disk first if the caller asked for that.  */
 
-      if (strstr (varin, "[SECURITY CLASSIFICATION]")) strcpy (bfdh[hnd].header.security_classification, info);
+  if (ok && (bfdh[hnd].durability == BFDATA_DURABILITY_DATASYNC || bfdh[hnd].durability == BFDATA_DURABILITY_GROUP))
+    ok = !binaryFeatureData_sync_stream (bfp);
 
-      if (strstr (varin, "{DISTRIBUTION ="))
+  if (fclose (bfp)) ok = 0;
+
+  if (!ok)
+    {
+      remove (bfdh[hnd].b_path);
+      return (0);
+    }
+
+
+  bfdh[hnd].bounds_stamp = stamp;
+  bfdh[hnd].bounds_count = count;
+
+  return (1);
+}
+
+
+
+/*!  Keep the handle's bounds array (if it has been loaded) up to date when record "recnum" is written.  Without the
+     polygon we use the bounds of the last polygon written if the record points at it (the same record written again
+     with poly set to NULL, see binaryFeatureData_write_record), otherwise a record that is being rewritten keeps the
+     bounds it has.  If we can't do any of that (a new record that points at some other polygon, or we're out of
+     memory) we just drop the array and let the next binaryFeatureData_read_all_polygon_bounds reload it.  */
+
+static void binaryFeatureData_update_bounds (int32_t hnd, uint32_t recnum, const BFDATA_RECORD *bfd_record, const BFDATA_POLYGON *poly)
+{
+  BFDATA_POLYGON_BOUNDS *bounds, box;
+  uint32_t alloc;
+  uint8_t known = 1;
+
+
+  bfdh[hnd].query_valid = 0;
+  bfdh[hnd].point_index_valid = 0;
+
+
+  /*  This is the first write since the bounds file was saved so it's about to be out of date.  Load it first (if we
+      haven't already) so that we can keep the bounds up to date here and save them again on close.  */
+
+  if (bfdh[hnd].bounds_stamp)
+    {
+      if (!bfdh[hnd].poly_bounds_valid) binaryFeatureData_load_bounds (hnd);
+
+      remove (bfdh[hnd].b_path);
+      bfdh[hnd].bounds_stamp = 0;
+    }
+
+
+  if (bfd_record->poly_count && poly != NULL &&
+      binaryFeatureData_polygon_bounds (bfd_record->poly_count, poly->latitude, poly->longitude, &box))
+    {
+      bfdh[hnd].last_poly_address = bfd_record->poly_address;
+      bfdh[hnd].last_poly_bounds = box;
+    }
+  else if (bfd_record->poly_count && poly == NULL)
+    {
+      if (bfdh[hnd].last_poly_address && bfd_record->poly_address == bfdh[hnd].last_poly_address)
         {
-          strcpy (bfdh[hnd].header.distribution, "");
-          while (fgets (varin, sizeof (varin), bfdh[hnd].fp))
-            {
-              if (varin[0] == '}') break;
-              strcat (bfdh[hnd].header.distribution, varin);
-            }
+          box = bfdh[hnd].last_poly_bounds;
+        }
+      else
+        {
+          known = 0;
         }
+    }
+  else
+    {
+      box.min_latitude = box.max_latitude = bfd_record->latitude;
+      box.min_longitude = box.max_longitude = bfd_record->longitude;
+    }
 
-      if (strstr (varin, "{DECLASSIFICATION ="))
+
+  if (!bfdh[hnd].poly_bounds_valid) return;
+
+  if (recnum > bfdh[hnd].poly_bounds_count || (!known && recnum == bfdh[hnd].poly_bounds_count))
+    {
+      bfdh[hnd].poly_bounds_valid = 0;
+      return;
+    }
+
+  if (!known) return;
+
+  if (recnum == bfdh[hnd].poly_bounds_count)
+    {
+      if (recnum == bfdh[hnd].poly_bounds_alloc)
         {
-          strcpy (bfdh[hnd].header.declassification, "");
-          while (fgets (varin, sizeof (varin), bfdh[hnd].fp))
+          alloc = bfdh[hnd].poly_bounds_alloc ? bfdh[hnd].poly_bounds_alloc * 2 : 1024;
+
+          if ((bounds = (BFDATA_POLYGON_BOUNDS *) realloc (bfdh[hnd].poly_bounds, alloc * sizeof (BFDATA_POLYGON_BOUNDS))) == NULL)
             {
-              if (varin[0] == '}') break;
-              strcat (bfdh[hnd].header.declassification, varin);
+              bfdh[hnd].poly_bounds_valid = 0;
+              return;
             }
+
+          bfdh[hnd].poly_bounds = bounds;
+          bfdh[hnd].poly_bounds_alloc = alloc;
         }
 
-      if (strstr (varin, "{SECURITY CLASSIFICATION JUSTIFICATION ="))
+      bfdh[hnd].poly_bounds_count++;
+    }
+
+  bfdh[hnd].poly_bounds[recnum] = box;
+}
+
+
+
+/*!  Unpack count polygon points from the "bytes" bytes in "buffer" that were read from poly_address in the .bfa file.
+     This handles both the raw and delta encoded forms (see binaryFeatureData_build_polygon).  Returns 0 if the data is
+     short or corrupt.  */
+
+static uint8_t binaryFeatureData_decode_polygon (int32_t hnd, int32_t count, const uint8_t *buffer, int64_t bytes, BFDATA_POLYGON *poly)
+{
+  const uint8_t *ptr = buffer, *end;
+  int64_t ilat = 0, ilon = 0, dlat, dlon, size;
+  uint64_t bits;
+  double scale;
+  int32_t i;
+
+
+  if (bytes >= BFDATA_POLY_DELTA_HEADER_SIZE && !memcmp (buffer, BFDATA_POLY_DELTA_MAGIC, 8))
+    {
+      ptr += 8;
+      size = binaryFeatureData_get_le32 (&ptr);
+      ptr += 4;
+      bits = binaryFeatureData_get_le64 (&ptr);
+      memcpy (&scale, &bits, sizeof (double));
+
+      if (BFDATA_POLY_DELTA_HEADER_SIZE + size > bytes || !(scale > 0.0)) return (0);
+
+      end = ptr + size;
+
+      for (i = 0 ; i < count ; i++)
         {
-          strcpy (bfdh[hnd].header.class_just, "");
-          while (fgets (varin, sizeof (varin), bfdh[hnd].fp))
-            {
-              if (varin[0] == '}') break;
-              strcat (bfdh[hnd].header.class_just, varin);
-            }
+          if (!binaryFeatureData_get_varint (&ptr, end, &dlat) || !binaryFeatureData_get_varint (&ptr, end, &dlon)) return (0);
+
+          /*  Unsigned so that a corrupt file gives us junk instead of an overflow.  */
+
+          ilat = (int64_t) ((uint64_t) ilat + (uint64_t) dlat);
+          ilon = (int64_t) ((uint64_t) ilon + (uint64_t) dlon);
+
+          poly->latitude[i] = (double) ilat / scale;
+          poly->longitude[i] = (double) ilon / scale;
+        }
+
+      return (1);
+    }
+
+
+  if (bytes < (int64_t) count * 2 * (int64_t) sizeof (double)) return (0);
+
+  for (i = 0 ; i < count ; i++)
+    {
+      binaryFeatureData_unpack (&ptr, &poly->latitude[i], sizeof (double));
+      binaryFeatureData_unpack (&ptr, &poly->longitude[i], sizeof (double));
+    }
+
+  if (bfdh[hnd].swap) binaryFeatureData_swap_polygon (count, poly);
+
+  return (1);
+}
+
+
+
+
+/*!  Make sure the transaction staging buffer has room for "size" more bytes.  Returns 0 on allocation failure.  */
+
+static uint8_t binaryFeatureData_stage_space (int32_t hnd, int64_t size)
+{
+  uint8_t *data;
+  int64_t alloc;
+
+
+  if (bfdh[hnd].staged_data_size + size <= bfdh[hnd].staged_data_alloc) return (1);
+
+  alloc = bfdh[hnd].staged_data_alloc ? bfdh[hnd].staged_data_alloc * 2 : 65536;
+  while (alloc < bfdh[hnd].staged_data_size + size) alloc *= 2;
+
+  if ((data = (uint8_t *) realloc (bfdh[hnd].staged_data, alloc)) == NULL) return (0);
+
+  bfdh[hnd].staged_data = data;
+  bfdh[hnd].staged_data_alloc = alloc;
+
+  return (1);
+}
+
+
+
+/*!  Compare "size" bytes of "image" with the image stored at "address".  The stored image may still be in the append
+     buffer or staged for a transaction.  Anything we can't read just doesn't match.  */
+
+static uint8_t binaryFeatureData_same_image (int32_t hnd, int64_t address, const uint8_t *image, uint32_t size)
+{
+  uint8_t buffer[65536];
+  uint32_t count;
+
+
+  if (bfdh[hnd].append_data_size && address >= bfdh[hnd].append_bfa_end)
+    {
+      address -= bfdh[hnd].append_bfa_end;
+      return (address + size <= bfdh[hnd].append_data_size && !memcmp (&bfdh[hnd].append_data[address], image, size));
+    }
+
+  if (bfdh[hnd].transaction && address >= bfdh[hnd].txn_base)
+    {
+      address -= bfdh[hnd].txn_base;
+      return (address + size <= bfdh[hnd].staged_data_size && !memcmp (&bfdh[hnd].staged_data[address], image, size));
+    }
+
+
+  if (binaryFeatureData_seek (hnd, bfdh[hnd].afp, address, SEEK_SET) < 0) return (0);
+
+  for ( ; size ; size -= count, image += count)
+    {
+      count = size < sizeof (buffer) ? size : sizeof (buffer);
+
+      if (!binaryFeatureData_read (hnd, buffer, count, 1, bfdh[hnd].afp) || memcmp (buffer, image, count)) return (0);
+    }
+
+  return (1);
+}
+
+
+
+/*!  Look for an identical copy of "image" in the dedup table.  Returns 1 and sets "address" if we find one.  The hash
+     is returned either way so it can be passed to binaryFeatureData_add_image.  */
+
+static uint8_t binaryFeatureData_find_image (int32_t hnd, const uint8_t *image, uint32_t size, uint64_t *hash, int64_t *address)
+{
+  INTERNAL_BFDATA_IMAGE_HASH *entry;
+  uint32_t i, mask = bfdh[hnd].image_hash_size - 1;
+
+
+  *hash = binaryFeatureData_fnv1a64 (BFDATA_FNV1A64_SEED, image, size);
+
+
+  /*  The hash and size only tell us the images are probably the same so we always check the bytes.  */
+
+  for (i = *hash & mask ; bfdh[hnd].image_hash[i].size ; i = (i + 1) & mask)
+    {
+      entry = &bfdh[hnd].image_hash[i];
+
+      if (entry->hash == *hash && entry->size == size && binaryFeatureData_same_image (hnd, entry->address, image, size))
+        {
+          *address = entry->address;
+          return (1);
         }
+    }
 
+  return (0);
+}
 
-      if (strstr (varin, "{DOWNGRADE ="))
+
+
+/*!  Add an image to the dedup table, doubling the table when it gets half full.  Dedup is only an optimization so if we
+     can't get the memory to grow the table we just don't add the image.  */
+
+static void binaryFeatureData_add_image (int32_t hnd, uint64_t hash, uint32_t size, int64_t address)
+{
+  INTERNAL_BFDATA_IMAGE_HASH *table;
+  uint32_t i, j, mask, new_size;
+
+
+  if ((bfdh[hnd].image_hash_count + 1) * 2 > bfdh[hnd].image_hash_size)
+    {
+      new_size = bfdh[hnd].image_hash_size * 2;
+
+      if ((table = (INTERNAL_BFDATA_IMAGE_HASH *) calloc (new_size, sizeof (INTERNAL_BFDATA_IMAGE_HASH))) == NULL) return;
+
+      mask = new_size - 1;
+
+      for (i = 0 ; i < bfdh[hnd].image_hash_size ; i++)
         {
-          strcpy (bfdh[hnd].header.downgrade, "");
-          while (fgets (varin, sizeof (varin), bfdh[hnd].fp))
-            {
-              if (varin[0] == '}') break;
-              strcat (bfdh[hnd].header.downgrade, varin);
-            }
+          if (!bfdh[hnd].image_hash[i].size) continue;
+
+          for (j = bfdh[hnd].image_hash[i].hash & mask ; table[j].size ; j = (j + 1) & mask);
+
+          table[j] = bfdh[hnd].image_hash[i];
+        }
+
+      free (bfdh[hnd].image_hash);
+      bfdh[hnd].image_hash = table;
+      bfdh[hnd].image_hash_size = new_size;
+    }
+
+
+  mask = bfdh[hnd].image_hash_size - 1;
+
+  for (i = hash & mask ; bfdh[hnd].image_hash[i].size ; i = (i + 1) & mask);
+
+  bfdh[hnd].image_hash[i].hash = hash;
+  bfdh[hnd].image_hash[i].size = size;
+  bfdh[hnd].image_hash[i].address = address;
+  bfdh[hnd].image_hash_count++;
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_stage_record
+
+ - Purpose:     Save a record (and its polygon and image, if any) in memory for the active
+                transaction.  Nothing is written until binaryFeatureData_commit_transaction.
+                Nothing else gets written to the .bfa file while the transaction is active so
+                we know exactly where the staged polygon and image will end up and can set
+                the addresses in bfd_record just like binaryFeatureData_write_record does.
+
+ - Date:        10/19/26
+
+ - Arguments:   See binaryFeatureData_write_record
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_MEMORY_ALLOCATION_ERROR
+
+*********************************************************************************************/
+
+static int32_t binaryFeatureData_stage_record (int32_t hnd, int32_t recnum, BFDATA_RECORD *bfd_record, const BFDATA_POLYGON *poly,
+                                               const uint8_t *image)
+{
+  INTERNAL_BFDATA_STAGED *staged;
+  uint64_t hash = 0;
+  uint8_t *data;
+  int64_t size, offset;
+
+
+  if (bfdh[hnd].staged_count == bfdh[hnd].staged_alloc)
+    {
+      uint32_t alloc = bfdh[hnd].staged_alloc ? bfdh[hnd].staged_alloc * 2 : 16;
+
+      staged = (INTERNAL_BFDATA_STAGED *) realloc (bfdh[hnd].staged, alloc * sizeof (INTERNAL_BFDATA_STAGED));
+
+      if (staged == NULL)
+        {
+          bfd_error.system = errno;
+          bfd_error.recnum = recnum;
+          strcpy (bfd_error.file, bfdh[hnd].path);
+          return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
+        }
+
+      bfdh[hnd].staged = staged;
+      bfdh[hnd].staged_alloc = alloc;
+    }
+
+
+  if (bfd_record->poly_count && poly != NULL)
+    {
+      if ((data = binaryFeatureData_build_polygon (hnd, bfd_record, poly, &size, &offset)) == NULL ||
+          !binaryFeatureData_stage_space (hnd, size))
+        {
+          bfd_error.system = errno;
+          bfd_error.recnum = recnum;
+          strcpy (bfd_error.file, bfdh[hnd].path);
+          return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
         }
 
+      bfd_record->poly_address = bfdh[hnd].txn_base + bfdh[hnd].staged_data_size + offset;
+      memcpy (&bfdh[hnd].staged_data[bfdh[hnd].staged_data_size], data, size);
+      bfdh[hnd].staged_data_size += size;
+    }
+
+
+  if (bfd_record->image_size && image != NULL &&
+      !(bfdh[hnd].image_dedup && binaryFeatureData_find_image (hnd, image, bfd_record->image_size, &hash, &bfd_record->image_address)))
+    {
+      if (!binaryFeatureData_stage_space (hnd, bfd_record->image_size))
+        {
+          bfd_error.system = errno;
+          bfd_error.recnum = recnum;
+          strcpy (bfd_error.file, bfdh[hnd].path);
+          return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
+        }
+
+      bfd_record->image_address = bfdh[hnd].txn_base + bfdh[hnd].staged_data_size;
+      memcpy (&bfdh[hnd].staged_data[bfdh[hnd].staged_data_size], image, bfd_record->image_size);
+      bfdh[hnd].staged_data_size += bfd_record->image_size;
+
+      if (bfdh[hnd].image_dedup) binaryFeatureData_add_image (hnd, hash, bfd_record->image_size, bfd_record->image_address);
+    }
+
+
+  if (recnum == BFDATA_NEXT_RECORD) recnum = bfdh[hnd].txn_records++;
+
+  staged = &bfdh[hnd].staged[bfdh[hnd].staged_count];
+
+  staged->record = *bfd_record;
+  staged->recnum = recnum;
+  staged->sequence = bfdh[hnd].staged_count++;
+
+  binaryFeatureData_update_bounds (hnd, recnum, bfd_record, poly);
+
+  bfdh[hnd].recnum = recnum + 1;
+
+
+  bfd_error.system = 0;
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_flush_append
+
+ - Purpose:     Write out anything buffered by append mode (see
+                binaryFeatureData_set_append_buffer).  The buffered polygons and images go to
+                the .bfa file first, then the buffered records go to the end of the BFD file,
+                one seek and one write each.
+
+ - Date:        10/19/26
+
+ - Arguments:   hnd            =    The file handle
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_POLY_WRITE_FSEEK_ERROR
+                - BFDATA_POLY_WRITE_ERROR
+                - BFDATA_RECORD_WRITE_FSEEK_ERROR
+                - BFDATA_RECORD_WRITE_ERROR
+
+*********************************************************************************************/
+
+static int32_t binaryFeatureData_flush_append (int32_t hnd)
+{
+  uint32_t count;
+  int64_t pos;
+
+
+  if (bfdh[hnd].append_data_size)
+    {
+      if (binaryFeatureData_seek (hnd, bfdh[hnd].afp, bfdh[hnd].append_bfa_end, SEEK_SET) < 0)
+        {
+          bfd_error.system = errno;
+          strcpy (bfd_error.file, bfdh[hnd].a_path);
+          return (bfd_error.bfd = BFDATA_POLY_WRITE_FSEEK_ERROR);
+        }
+
+      if (!binaryFeatureData_write (hnd, bfdh[hnd].append_data, bfdh[hnd].append_data_size, 1, bfdh[hnd].afp))
+        {
+          bfd_error.system = errno;
+          strcpy (bfd_error.file, bfdh[hnd].a_path);
+          return (bfd_error.bfd = BFDATA_POLY_WRITE_ERROR);
+        }
+
+      bfdh[hnd].append_data_size = 0;
+    }
+
+
+  if (bfdh[hnd].append_records_size)
+    {
+      /*  The buffered records are always the last ones in the file.  */
+
+      count = bfdh[hnd].append_records_size / bfdh[hnd].record_size;
+      pos = (int64_t) (bfdh[hnd].header.number_of_records - count) * bfdh[hnd].record_size + bfdh[hnd].header_size;
+
+      if (binaryFeatureData_seek (hnd, bfdh[hnd].fp, pos, SEEK_SET) < 0)
+        {
+          bfd_error.system = errno;
+          bfd_error.recnum = bfdh[hnd].header.number_of_records - count;
+          strcpy (bfd_error.file, bfdh[hnd].path);
+          return (bfd_error.bfd = BFDATA_RECORD_WRITE_FSEEK_ERROR);
+        }
+
+      if (!binaryFeatureData_write (hnd, bfdh[hnd].append_records, bfdh[hnd].append_records_size, 1, bfdh[hnd].fp))
+        {
+          bfd_error.system = errno;
+          bfd_error.recnum = bfdh[hnd].header.number_of_records - count;
+          strcpy (bfd_error.file, bfdh[hnd].path);
+          return (bfd_error.bfd = BFDATA_RECORD_WRITE_ERROR);
+        }
+
+      bfdh[hnd].append_records_size = 0;
+    }
+
+
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
+
+
+
+/*!  If the durability mode is BFDATA_DURABILITY_GROUP, count "records" more records written and sync if either of
+     the group intervals has been reached.  */
+
+static int32_t binaryFeatureData_group_sync (int32_t hnd, uint32_t records)
+{
+  if (bfdh[hnd].durability == BFDATA_DURABILITY_GROUP)
+    {
+      bfdh[hnd].unsynced_records += records;
+
+      if ((bfdh[hnd].sync_records && bfdh[hnd].unsynced_records >= bfdh[hnd].sync_records) ||
+          (bfdh[hnd].sync_msecs && binaryFeatureData_msecs () - bfdh[hnd].last_sync >= bfdh[hnd].sync_msecs))
+        {
+          return (binaryFeatureData_do_sync (hnd));
+        }
+    }
+
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_commit_journal
+
+ - Purpose:     Group commit all journal entries written since the last commit.  The associated
+                polygon/image file is synced first (the journaled records point into it), then a
+                commit marker carrying the current number of records is appended to the journal
+                and the journal is synced.  Only committed entries are replayed after a crash.
+
+ - Date:        10/19/26
+
+ - Arguments:   hnd            =    The file handle
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_SYNC_ERROR
+                - BFDATA_JOURNAL_WRITE_ERROR
+
+*********************************************************************************************/
+
+static int32_t binaryFeatureData_commit_journal (int32_t hnd)
+{
+  uint32_t entry[3];
+
+
+  if (bfdh[hnd].jfp == NULL || !bfdh[hnd].journal_pending) return (bfd_error.bfd = BFDATA_SUCCESS);
+
+
+  /*  The journaled records may point at buffered polygons or images.  */
+
+  if (binaryFeatureData_flush_append (hnd) < 0) return (bfd_error.bfd);
+
+
+  if (binaryFeatureData_sync_stream (bfdh[hnd].afp))
+    {
+      bfd_error.system = errno;
+      strcpy (bfd_error.file, bfdh[hnd].a_path);
+      return (bfd_error.bfd = BFDATA_SYNC_ERROR);
+    }
+
+
+  entry[0] = BFDATA_JOURNAL_COMMIT;
+  entry[1] = bfdh[hnd].header.number_of_records;
+  entry[2] = binaryFeatureData_fnv1a (BFDATA_FNV1A_SEED, entry, 2 * sizeof (uint32_t));
+
+  if (!fwrite (entry, sizeof (entry), 1, bfdh[hnd].jfp) || binaryFeatureData_sync_stream (bfdh[hnd].jfp))
+    {
+      bfd_error.system = errno;
+      strcpy (bfd_error.file, bfdh[hnd].j_path);
+      return (bfd_error.bfd = BFDATA_JOURNAL_WRITE_ERROR);
+    }
+
+  bfdh[hnd].journal_pending = 0;
+
+
+  bfd_error.system = 0;
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_journal_entry
+
+ - Purpose:     Append a record entry (record number plus the record exactly as it was written
+                to the BFD file) to the journal.  This does not commit.
+
+ - Date:        10/19/26
+
+ - Arguments:
+                - hnd            =    The file handle
+                - recnum         =    The record number that was written
+                - buffer         =    The on-disk record (bfdh[hnd].record_size bytes)
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_JOURNAL_WRITE_ERROR
+
+*********************************************************************************************/
+
+static int32_t binaryFeatureData_journal_entry (int32_t hnd, uint32_t recnum, const uint8_t *buffer)
+{
+  uint32_t entry[2], checksum;
+
+
+  entry[0] = BFDATA_JOURNAL_RECORD;
+  entry[1] = recnum;
+
+  checksum = binaryFeatureData_fnv1a (BFDATA_FNV1A_SEED, entry, sizeof (entry));
+  checksum = binaryFeatureData_fnv1a (checksum, buffer, bfdh[hnd].record_size);
+
+  if (!fwrite (entry, sizeof (entry), 1, bfdh[hnd].jfp) || !fwrite (buffer, bfdh[hnd].record_size, 1, bfdh[hnd].jfp) ||
+      !fwrite (&checksum, sizeof (uint32_t), 1, bfdh[hnd].jfp))
+    {
+      bfd_error.system = errno;
+      bfd_error.recnum = recnum;
+      strcpy (bfd_error.file, bfdh[hnd].j_path);
+      return (bfd_error.bfd = BFDATA_JOURNAL_WRITE_ERROR);
+    }
+
+  bfdh[hnd].journal_pending++;
+
+
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_journal_record
+
+ - Purpose:     Journal a record that has already been written to the BFD file.  Commits the
+                group when journal_group entries are pending.  If the journal has grown past
+                BFDATA_JOURNAL_CHECKPOINT_SIZE we checkpoint it (binaryFeatureData_sync) so it
+                doesn't grow without bound.
+
+ - Date:        10/19/26
+
+ - Arguments:
+                - hnd            =    The file handle
+                - recnum         =    The record number that was written
+                - buffer         =    The on-disk record (bfdh[hnd].record_size bytes)
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_SYNC_ERROR
+                - BFDATA_JOURNAL_WRITE_ERROR
+                - BFDATA_HEADER_WRITE_FSEEK_ERROR
+                - BFDATA_HEADER_WRITE_ERROR
+
+*********************************************************************************************/
+
+static int32_t binaryFeatureData_journal_record (int32_t hnd, uint32_t recnum, const uint8_t *buffer)
+{
+  if (binaryFeatureData_journal_entry (hnd, recnum, buffer) < 0) return (bfd_error.bfd);
+
+
+  if (bfdh[hnd].journal_pending >= bfdh[hnd].journal_group)
+    {
+      if (binaryFeatureData_commit_journal (hnd) < 0) return (bfd_error.bfd);
+
+      if (ftello64 (bfdh[hnd].jfp) > BFDATA_JOURNAL_CHECKPOINT_SIZE) return (binaryFeatureData_do_sync (hnd));
+    }
+
+
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_reset_journal
+
+ - Purpose:     Throw away everything in the journal (leaving only the journal header).  Only
+                call this after the BFD and associated files have been synced.
+
+ - Date:        10/19/26
+
+ - Arguments:   hnd            =    The file handle
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_JOURNAL_WRITE_ERROR
+
+*********************************************************************************************/
+
+static int32_t binaryFeatureData_reset_journal (int32_t hnd)
+{
+  if (bfdh[hnd].jfp == NULL) return (bfd_error.bfd = BFDATA_SUCCESS);
+
+
+#ifdef NVWIN3X
+  if (fflush (bfdh[hnd].jfp) || _chsize (_fileno (bfdh[hnd].jfp), BFDATA_JOURNAL_HEADER_SIZE) ||
+#else
+  if (fflush (bfdh[hnd].jfp) || ftruncate (fileno (bfdh[hnd].jfp), BFDATA_JOURNAL_HEADER_SIZE) ||
+#endif
+      fseeko64 (bfdh[hnd].jfp, BFDATA_JOURNAL_HEADER_SIZE, SEEK_SET) < 0)
+    {
+      bfd_error.system = errno;
+      strcpy (bfd_error.file, bfdh[hnd].j_path);
+      return (bfd_error.bfd = BFDATA_JOURNAL_WRITE_ERROR);
+    }
+
+  bfdh[hnd].journal_pending = 0;
+
+
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_append_record
+
+ - Purpose:     Append mode version of binaryFeatureData_write_record for BFDATA_NEXT_RECORD.
+                We keep track of the end of the BFD and .bfa files ourselves and pack the
+                record, polygon, and image into the append buffers instead of seeking and
+                writing each one.  The buffers are flushed when either one would grow past
+                bfdh[hnd].append_size bytes.
+
+ - Date:        10/19/26
+
+ - Arguments:   See binaryFeatureData_write_record
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_MEMORY_ALLOCATION_ERROR
+                - BFDATA_POLY_WRITE_FSEEK_ERROR
+                - BFDATA_POLY_WRITE_ERROR
+                - BFDATA_RECORD_WRITE_FSEEK_ERROR
+                - BFDATA_RECORD_WRITE_ERROR
+                - BFDATA_JOURNAL_WRITE_ERROR
+                - BFDATA_SYNC_ERROR
+
+*********************************************************************************************/
+
+static int32_t binaryFeatureData_append_record (int32_t hnd, BFDATA_RECORD *bfd_record, const BFDATA_POLYGON *poly, const uint8_t *image)
+{
+  int64_t poly_size = 0, poly_offset = 0, image_size = 0, alloc;
+  uint64_t hash = 0;
+  uint8_t *ptr, *poly_data = NULL;
+
+
+  if (bfd_record->poly_count && poly != NULL)
+    {
+      if ((poly_data = binaryFeatureData_build_polygon (hnd, bfd_record, poly, &poly_size, &poly_offset)) == NULL)
+        {
+          bfd_error.system = errno;
+          strcpy (bfd_error.file, bfdh[hnd].a_path);
+          return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
+        }
+    }
+
+  if (bfd_record->image_size && image != NULL) image_size = bfd_record->image_size;
+
+
+  /*  No need to buffer an image we already have.  */
+
+  if (image_size && bfdh[hnd].image_dedup && binaryFeatureData_find_image (hnd, image, image_size, &hash, &bfd_record->image_address))
+    image_size = 0;
+
+
+  /*  Flush if this record would push either buffer past the threshold.  */
+
+  if (bfdh[hnd].append_records_size + bfdh[hnd].record_size > bfdh[hnd].append_size ||
+      (poly_size + image_size && bfdh[hnd].append_data_size + poly_size + image_size > bfdh[hnd].append_size))
+    {
+      if (binaryFeatureData_flush_append (hnd) < 0) return (bfd_error.bfd);
+    }
+
+
+  /*  Make sure we have room (a single large image can be bigger than the threshold).  */
+
+  if (bfdh[hnd].append_records_size + bfdh[hnd].record_size > bfdh[hnd].append_records_alloc)
+    {
+      alloc = bfdh[hnd].append_size > bfdh[hnd].record_size ? bfdh[hnd].append_size : bfdh[hnd].record_size;
+
+      if ((ptr = (uint8_t *) realloc (bfdh[hnd].append_records, alloc)) == NULL)
+        {
+          bfd_error.system = errno;
+          strcpy (bfd_error.file, bfdh[hnd].path);
+          return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
+        }
+
+      bfdh[hnd].append_records = ptr;
+      bfdh[hnd].append_records_alloc = alloc;
+    }
+
+  if (bfdh[hnd].append_data_size + poly_size + image_size > bfdh[hnd].append_data_alloc)
+    {
+      alloc = bfdh[hnd].append_data_size + poly_size + image_size;
+      if (alloc < bfdh[hnd].append_size) alloc = bfdh[hnd].append_size;
+
+      if ((ptr = (uint8_t *) realloc (bfdh[hnd].append_data, alloc)) == NULL)
+        {
+          bfd_error.system = errno;
+          strcpy (bfd_error.file, bfdh[hnd].a_path);
+          return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
+        }
+
+      bfdh[hnd].append_data = ptr;
+      bfdh[hnd].append_data_alloc = alloc;
+    }
+
+
+  /*  Find the end of the .bfa file once per buffer load instead of once per polygon and image.  */
+
+  if (poly_size + image_size && !bfdh[hnd].append_data_size)
+    {
+      if (binaryFeatureData_seek (hnd, bfdh[hnd].afp, 0LL, SEEK_END) < 0)
+        {
+          bfd_error.system = errno;
+          strcpy (bfd_error.file, bfdh[hnd].a_path);
+          return (bfd_error.bfd = BFDATA_POLY_WRITE_FSEEK_ERROR);
+        }
+
+      bfdh[hnd].append_bfa_end = ftello64 (bfdh[hnd].afp);
+    }
+
+
+  if (poly_size)
+    {
+      bfd_record->poly_address = bfdh[hnd].append_bfa_end + bfdh[hnd].append_data_size + poly_offset;
+      memcpy (&bfdh[hnd].append_data[bfdh[hnd].append_data_size], poly_data, poly_size);
+      bfdh[hnd].append_data_size += poly_size;
+    }
+
+  if (image_size)
+    {
+      bfd_record->image_address = bfdh[hnd].append_bfa_end + bfdh[hnd].append_data_size;
+      memcpy (&bfdh[hnd].append_data[bfdh[hnd].append_data_size], image, image_size);
+      bfdh[hnd].append_data_size += image_size;
+
+      if (bfdh[hnd].image_dedup) binaryFeatureData_add_image (hnd, hash, image_size, bfd_record->image_address);
+    }
+
+
+  ptr = &bfdh[hnd].append_records[bfdh[hnd].append_records_size];
+  binaryFeatureData_encode_record (hnd, bfd_record, ptr);
+  bfdh[hnd].append_records_size += bfdh[hnd].record_size;
+
+
+  bfdh[hnd].modified = 1;
+  bfdh[hnd].write = 1;
+  bfdh[hnd].last_rec = -1;
+  bfdh[hnd].recnum = ++bfdh[hnd].header.number_of_records;
+
+  binaryFeatureData_update_bounds (hnd, bfdh[hnd].recnum - 1, bfd_record, poly);
+
+
+  if (bfdh[hnd].jfp != NULL)
+    {
+      if (binaryFeatureData_journal_record (hnd, bfdh[hnd].recnum - 1, ptr) < 0) return (bfd_error.bfd);
+    }
+
+  if (binaryFeatureData_group_sync (hnd, 1) < 0) return (bfd_error.bfd);
+
+
+  bfd_error.system = 0;
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_store_image
+
+ - Purpose:     Write an image to the end of the .bfa file and set image_address in the
+                record.  If image dedup is on and an identical image is already stored we
+                just point the record at it.
+
+ - Date:        10/19/26
+
+ - Arguments:
+                - hnd            =    The file handle
+                - recnum         =    The record number (for error reporting)
+                - bfd_record     =    The record (image_size must be set)
+                - image          =    The image
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_IMAGE_WRITE_FSEEK_ERROR
+                - BFDATA_IMAGE_WRITE_ERROR
+
+*********************************************************************************************/
+
+static int32_t binaryFeatureData_store_image (int32_t hnd, int32_t recnum, BFDATA_RECORD *bfd_record, const uint8_t *image)
+{
+  uint64_t hash = 0;
+
+
+  if (bfdh[hnd].image_dedup && binaryFeatureData_find_image (hnd, image, bfd_record->image_size, &hash, &bfd_record->image_address))
+    return (bfd_error.bfd = BFDATA_SUCCESS);
+
+
+  /*  We always want to tack the image data on to the end of the file.  If there was a pre-existing address
+      we're just going to change it and let the data stay there.  We're not going to try to pack the file or 
+      save space since this should be a temporary file anyway.  After all, this is a working format and, at the
+      end of the processing cycle should be converted to the NAVO standard MIW XML format.  */
+
+  if (binaryFeatureData_seek (hnd, bfdh[hnd].afp, 0LL, SEEK_END) < 0)
+    {
+      bfd_error.system = errno;
+      bfd_error.recnum = recnum;
+      strcpy (bfd_error.file, bfdh[hnd].a_path);
+      return (bfd_error.bfd = BFDATA_IMAGE_WRITE_FSEEK_ERROR);
+    }
+
+
+  bfd_record->image_address = ftello64 (bfdh[hnd].afp);
+
+
+  if (!binaryFeatureData_write (hnd, image, bfd_record->image_size, 1, bfdh[hnd].afp))
+    {
+      bfd_error.system = errno;
+      bfd_error.recnum = recnum;
+      strcpy (bfd_error.file, bfdh[hnd].a_path);
+      return (bfd_error.bfd = BFDATA_IMAGE_WRITE_ERROR);
+    }
+
+
+  if (bfdh[hnd].image_dedup) binaryFeatureData_add_image (hnd, hash, bfd_record->image_size, bfd_record->image_address);
+
+
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
+
+
+
+
+/*  binaryFeatureData_write_record without the statistics and tracing (see below).  */
+
+static int32_t binaryFeatureData_do_write_record (int32_t hnd, int32_t recnum, BFDATA_RECORD *bfd_record, const BFDATA_POLYGON *poly,
+                                                  const uint8_t *image)
+{
+  int64_t pos, size, offset;
+  uint8_t buffer[sizeof (BFDATA_RECORD)], *data;
+
+
+  if (recnum < BFDATA_NEXT_RECORD)
+    {
+      bfd_error.recnum = recnum;
+      strcpy (bfd_error.file, bfdh[hnd].path);
+      return (bfd_error.bfd = BFDATA_INVALID_RECORD_NUMBER);
+    }
+
+
+  if (bfd_record->poly_count && poly != NULL && bfd_record->poly_count > BFDATA_POLY_ARRAY_SIZE)
+    {
+      bfd_error.recnum = recnum;
+      strcpy (bfd_error.file, bfdh[hnd].a_path);
+      return (bfd_error.bfd = BFDATA_POLYGON_TOO_LARGE_ERROR);
+    }
+
+
+  /*  Version 3.0 dependency.  Make sure that any application that is unaware of the 3.0 addition of feature_type will
+      set it to BFDATA_HYDROGRAPHIC.  */
+
+  if (bfdh[hnd].major_version >= 3 && bfd_record->feature_type >= BFDATA_FEATURE_TYPES) bfd_record->feature_type = BFDATA_HYDROGRAPHIC;
+
+
+  /*  If a transaction is active we just stage the record.  */
+
+  if (bfdh[hnd].transaction) return (binaryFeatureData_stage_record (hnd, recnum, bfd_record, poly, image));
+
+
+  /*  In append mode, appended records are just buffered.  Anything else has to flush the buffers first.  */
+
+  if (bfdh[hnd].append_size)
+    {
+      if (recnum == BFDATA_NEXT_RECORD) return (binaryFeatureData_append_record (hnd, bfd_record, poly, image));
+
+      if (binaryFeatureData_flush_append (hnd) < 0) return (bfd_error.bfd);
+    }
+
+
+  /*  The record may be in the read-ahead buffer.  */
+
+  bfdh[hnd].ra_count = 0;
+
+
+  if (bfd_record->poly_count && poly != NULL)
+    {
+      if ((data = binaryFeatureData_build_polygon (hnd, bfd_record, poly, &size, &offset)) == NULL)
+        {
+          bfd_error.system = errno;
+          bfd_error.recnum = recnum;
+          strcpy (bfd_error.file, bfdh[hnd].a_path);
+          return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
+        }
+
+
+      /*  We always want to tack the polygon data on to the end of the file.  If there was a pre-existing address
+          we're just going to change it and let the data stay there.  We're not going to try to pack the file or 
+          save space since this should be a temporary file anyway.  After all, this is a working format and, at the
+          end of the processing cycle should be converted to the NAVO standard MIW XML format.  */
+
+      if (binaryFeatureData_seek (hnd, bfdh[hnd].afp, 0LL, SEEK_END) < 0)
+        {
+          bfd_error.system = errno;
+          bfd_error.recnum = recnum;
+          strcpy (bfd_error.file, bfdh[hnd].a_path);
+          return (bfd_error.bfd = BFDATA_POLY_WRITE_FSEEK_ERROR);
+        }
+
+
+      bfd_record->poly_address = ftello64 (bfdh[hnd].afp) + offset;
+
+
+      if (!binaryFeatureData_write (hnd, data, size, 1, bfdh[hnd].afp))
+        {
+          bfd_error.system = errno;
+          bfd_error.recnum = recnum;
+          strcpy (bfd_error.file, bfdh[hnd].a_path);
+          return (bfd_error.bfd = BFDATA_POLY_WRITE_ERROR);
+        }
+    }
+
+
+  if (bfd_record->image_size && image != NULL)
+    {
+      if (binaryFeatureData_store_image (hnd, recnum, bfd_record, image) < 0) return (bfd_error.bfd);
+    }
+
+
+  if (recnum == BFDATA_NEXT_RECORD)
+    {
+      bfdh[hnd].recnum = bfdh[hnd].header.number_of_records;
+      pos = (int64_t) bfdh[hnd].recnum * bfdh[hnd].record_size + bfdh[hnd].header_size;
+    }
+  else
+    {
+      pos = (int64_t) recnum * bfdh[hnd].record_size + bfdh[hnd].header_size;
+      bfdh[hnd].recnum = recnum;
+    }
+
+
+  if (binaryFeatureData_seek (hnd, bfdh[hnd].fp, pos, SEEK_SET) < 0)
+    {
+      bfd_error.system = errno;
+      bfd_error.recnum = recnum;
+      strcpy (bfd_error.file, bfdh[hnd].path);
+      return (bfd_error.bfd = BFDATA_RECORD_WRITE_FSEEK_ERROR);
+    }
+
+
+  if (!binaryFeatureData_put_record (hnd, bfd_record, buffer))
+    {
+      bfd_error.system = errno;
+      bfd_error.recnum = recnum;
+      strcpy (bfd_error.file, bfdh[hnd].path);
+      return (bfd_error.bfd = BFDATA_RECORD_WRITE_ERROR);
+    }
+
+
+  bfdh[hnd].modified = 1;
+  bfdh[hnd].write = 1;
+  bfdh[hnd].last_rec = -1;
+
+  binaryFeatureData_update_bounds (hnd, bfdh[hnd].recnum, bfd_record, poly);
+
+
+  bfdh[hnd].recnum++;
+
+
+  if (recnum == BFDATA_NEXT_RECORD) bfdh[hnd].header.number_of_records++;
+
+
+  /*  Log the on-disk record to the journal if there is one.  */
+
+  if (bfdh[hnd].jfp != NULL)
+    {
+      if (binaryFeatureData_journal_record (hnd, bfdh[hnd].recnum - 1, buffer) < 0) return (bfd_error.bfd);
+    }
+
+
+  /*  Periodic group sync if requested.  */
+
+  if (binaryFeatureData_group_sync (hnd, 1) < 0) return (bfd_error.bfd);
+
+
+  bfd_error.system = 0;
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_write_record
+
+ - Purpose:     Swaps the bytes (if needed) and writes the record and (optionally) the 
+                polygon/polyline.  The polygon and image are not modified so they can be
+                written as is to a file of either byte order.
+
+ - Author:      Jan C. Depner (area.based.editor@gmail.com)
+
+ - Date:        03/27/09
+
+ - Arguments:
+                - hnd            =    The BFD file handle
+                - recnum         =    The record number to write or BFDATA_NEXT_RECORD to append
+                - bfd_record     =    The BFD point record to receive the data
+                - poly           =    The polygon/polyline structure or NULL if you haven't
+                                       modified or created the polygon/polyline 
+                - image          =    The image or NULL if you haven't modified or created an image 
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_INVALID_RECORD_NUMBER
+                - BFDATA_POLYGON_TOO_LARGE_ERROR
+                - BFDATA_POLY_WRITE_FSEEK_ERROR
+                - BFDATA_POLY_WRITE_ERROR
+                - BFDATA_RECORD_WRITE_FSEEK_ERROR
+                - BFDATA_RECORD_WRITE_ERROR
+                - BFDATA_MEMORY_ALLOCATION_ERROR (only while a transaction is active)
+
+ - Caveats:     While a transaction is active (binaryFeatureData_begin_transaction) the record,
+                polygon, and image are only staged in memory.  The polygon and image addresses
+                in bfd_record are still set.
+
+*********************************************************************************************/
+
+BFDATA_DLL int32_t binaryFeatureData_write_record (int32_t hnd, int32_t recnum, BFDATA_RECORD *bfd_record, const BFDATA_POLYGON *poly,
+                                                   const uint8_t *image)
+{
+  INTERNAL_BFDATA_OPERATION operation;
+  int32_t status;
+
+
+  if (!instrumented) return (binaryFeatureData_do_write_record (hnd, recnum, bfd_record, poly, image));
+
+  binaryFeatureData_begin_operation (&operation, BFDATA_OPERATION_WRITE_RECORD, hnd, recnum);
+
+  status = binaryFeatureData_do_write_record (hnd, recnum, bfd_record, poly, image);
+
+  binaryFeatureData_end_operation (&operation, status);
+
+  return (status);
+}
+
+
+
+
+/*  binaryFeatureData_write_record_image_file without the statistics and tracing (see below).  */
+
+static int32_t binaryFeatureData_do_write_record_image_file (int32_t hnd, int32_t recnum, BFDATA_RECORD *bfd_record, const BFDATA_POLYGON *poly,
+                                                             const char *image_file)
+{
+  FILE *ifp;
+  uint8_t *image = NULL;
+  int32_t ret;
+  int64_t size;
+
+
+  if (strlen (image_file) < 2) return (binaryFeatureData_do_write_record (hnd, recnum, bfd_record, poly, NULL));
+
+
+  if ((ifp = fopen (image_file, "rb")) == NULL)
+    {
+      bfd_error.system = errno;
+      bfd_error.recnum = recnum;
+      strcpy (bfd_error.file, image_file);
+      return (bfd_error.bfd = BFDATA_IMAGE_FILE_OPEN_ERROR);
+    }
+
+
+  strcpy (bfd_record->image_name, binaryFeatureData_gen_basename (image_file));
+
+
+  fseeko64 (ifp, 0LL, SEEK_END);
+  size = ftello64 (ifp);
+  fseeko64 (ifp, 0LL, SEEK_SET);
+
+  bfd_record->image_size = size;
+
+
+  /*  Transactions stage the image in memory and dedup needs to hash it so in those cases we have to read it in.  */
+
+  if ((bfdh[hnd].transaction || bfdh[hnd].image_dedup) && size)
+    {
+      if ((image = (uint8_t *) malloc (size)) == NULL)
+        {
+          bfd_error.system = errno;
+          bfd_error.recnum = recnum;
+          strcpy (bfd_error.file, image_file);
+          fclose (ifp);
+          return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
+        }
+
+      if (!fread (image, size, 1, ifp))
+        {
+          bfd_error.system = errno;
+          bfd_error.recnum = recnum;
+          strcpy (bfd_error.file, image_file);
+          free (image);
+          fclose (ifp);
+          return (bfd_error.bfd = BFDATA_IMAGE_FILE_READ_ERROR);
+        }
+
+      fclose (ifp);
+
+      ret = binaryFeatureData_do_write_record (hnd, recnum, bfd_record, poly, image);
+
+      free (image);
+
+      return (ret);
+    }
+
+
+  /*  Otherwise we copy the image file straight to the end of the .bfa file (see binaryFeatureData_write_record for why
+      we always append) and then write the record without an image.  The append buffer has to go out first since we're
+      going to write to the end of the file ourselves.  */
+
+  if (size)
+    {
+      if (binaryFeatureData_flush_append (hnd) < 0)
+        {
+          fclose (ifp);
+          return (bfd_error.bfd);
+        }
+
+      if (binaryFeatureData_seek (hnd, bfdh[hnd].afp, 0LL, SEEK_END) < 0)
+        {
+          bfd_error.system = errno;
+          bfd_error.recnum = recnum;
+          strcpy (bfd_error.file, bfdh[hnd].a_path);
+          fclose (ifp);
+          return (bfd_error.bfd = BFDATA_IMAGE_WRITE_FSEEK_ERROR);
+        }
+
+      bfd_record->image_address = ftello64 (bfdh[hnd].afp);
+
+
+      if ((ret = binaryFeatureData_copy_stream (ifp, 0, bfdh[hnd].afp, size)) < 0)
+        {
+          bfd_error.system = errno;
+          bfd_error.recnum = recnum;
+
+          if (ret == -1)
+            {
+              strcpy (bfd_error.file, image_file);
+              fclose (ifp);
+              return (bfd_error.bfd = BFDATA_IMAGE_FILE_READ_ERROR);
+            }
+
+          strcpy (bfd_error.file, bfdh[hnd].a_path);
+          fclose (ifp);
+          return (bfd_error.bfd = BFDATA_IMAGE_WRITE_ERROR);
+        }
+    }
+
+  fclose (ifp);
+
+
+  return (binaryFeatureData_do_write_record (hnd, recnum, bfd_record, poly, NULL));
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_write_record_image_file
+
+ - Purpose:     This function reads the specified image file instead of a binary image.  It
+                stores the size and basename of the image in the bfd_record and then calls
+                binaryFeatureData_write_record to write the record, polygon, and image.
+                The image file is copied directly into the .bfa file (by the kernel where
+                possible) so it never has to be held in memory, except inside a transaction.
+
+ - Author:      Jan C. Depner (area.based.editor@gmail.com)
+
+ - Date:        03/27/09
+
+ - Arguments:
+                - hnd            =    The BFD file handle
+                - recnum         =    The record number to write or BFDATA_NEXT_RECORD to append
+                - bfd_record     =    The BFD point record to receive the data
+                - poly           =    The polygon/polyline structure or NULL if you haven't
+                                      modified or created the polygon/polyline 
+                - image_file     =    The image file path or "" if no file available
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_INVALID_RECORD_NUMBER
+                - BFDATA_POLYGON_TOO_LARGE_ERROR
+                - BFDATA_POLY_WRITE_FSEEK_ERROR
+                - BFDATA_POLY_WRITE_ERROR
+                - BFDATA_RECORD_WRITE_FSEEK_ERROR
+                - BFDATA_RECORD_WRITE_ERROR
+                - BFDATA_IMAGE_WRITE_FSEEK_ERROR
+                - BFDATA_IMAGE_WRITE_ERROR
+                - BFDATA_IMAGE_FILE_OPEN_ERROR
+                - BFDATA_IMAGE_FILE_READ_ERROR
+                - BFDATA_MEMORY_ALLOCATION_ERROR
+
+*********************************************************************************************/
+
+BFDATA_DLL int32_t binaryFeatureData_write_record_image_file (int32_t hnd, int32_t recnum, BFDATA_RECORD *bfd_record, const BFDATA_POLYGON *poly,
+                                                              const char *image_file)
+{
+  INTERNAL_BFDATA_OPERATION operation;
+  int32_t status;
+
+
+  if (!instrumented) return (binaryFeatureData_do_write_record_image_file (hnd, recnum, bfd_record, poly, image_file));
+
+  binaryFeatureData_begin_operation (&operation, BFDATA_OPERATION_WRITE_RECORD, hnd, recnum);
+
+  status = binaryFeatureData_do_write_record_image_file (hnd, recnum, bfd_record, poly, image_file);
+
+  binaryFeatureData_end_operation (&operation, status);
+
+  return (status);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_begin_transaction
+
+ - Purpose:     Start a transaction.  Until binaryFeatureData_commit_transaction or
+                binaryFeatureData_abort_transaction is called, binaryFeatureData_write_record
+                (and binaryFeatureData_write_record_image_file) only stage the records,
+                polygons, and images in memory.  This is useful for edits that change several
+                linked records at once (e.g. splitting a feature and fixing the parent_record and
+                child_record fields of both halves).
+
+ - Date:        10/19/26
+
+ - Arguments:   hnd            =    The file handle
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_TRANSACTION_ERROR
+                - BFDATA_POLY_WRITE_FSEEK_ERROR
+
+ - Caveats:     Reads during a transaction see the file as it was before the transaction
+                began.
+
+*********************************************************************************************/
+
+BFDATA_DLL int32_t binaryFeatureData_begin_transaction (int32_t hnd)
+{
+  if (bfdh[hnd].transaction)
+    {
+      strcpy (bfd_error.file, bfdh[hnd].path);
+      return (bfd_error.bfd = BFDATA_TRANSACTION_ERROR);
+    }
+
+
+  if (binaryFeatureData_flush_append (hnd) < 0) return (bfd_error.bfd);
+
+
+  if (binaryFeatureData_seek (hnd, bfdh[hnd].afp, 0LL, SEEK_END) < 0)
+    {
+      bfd_error.system = errno;
+      strcpy (bfd_error.file, bfdh[hnd].a_path);
+      return (bfd_error.bfd = BFDATA_POLY_WRITE_FSEEK_ERROR);
+    }
+
+  bfdh[hnd].txn_base = ftello64 (bfdh[hnd].afp);
+  bfdh[hnd].txn_records = bfdh[hnd].header.number_of_records;
+  bfdh[hnd].staged_count = 0;
+  bfdh[hnd].staged_data_size = 0;
+  bfdh[hnd].transaction = 1;
+
+
+  bfd_error.system = 0;
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
+
+
+
+/*!  Sort staged records by record number and then by the order they were staged.  */
+
+static int binaryFeatureData_compare_staged (const void *a, const void *b)
+{
+  const INTERNAL_BFDATA_STAGED *sa = (const INTERNAL_BFDATA_STAGED *) a, *sb = (const INTERNAL_BFDATA_STAGED *) b;
+
+  if (sa->recnum != sb->recnum) return (sa->recnum < sb->recnum ? -1 : 1);
+
+  return (sa->sequence < sb->sequence ? -1 : 1);
+}
+
+
+
+
+/*  binaryFeatureData_commit_transaction without the statistics and tracing (see below).  */
+
+static int32_t binaryFeatureData_do_commit_transaction (int32_t hnd)
+{
+  INTERNAL_BFDATA_STAGED *staged = bfdh[hnd].staged;
+  uint8_t *buffer;
+  uint32_t i, j, count;
+  int64_t pos;
+
+
+  if (!bfdh[hnd].transaction)
+    {
+      strcpy (bfd_error.file, bfdh[hnd].path);
+      return (bfd_error.bfd = BFDATA_TRANSACTION_ERROR);
+    }
+
+  bfdh[hnd].transaction = 0;
+
+  if (!bfdh[hnd].staged_count) return (bfd_error.bfd = BFDATA_SUCCESS);
+
+  bfdh[hnd].ra_count = 0;
+
+
+  /*  A query since the records were staged may have rebuilt the indexes without them.  */
+
+  bfdh[hnd].query_valid = 0;
+  bfdh[hnd].point_index_valid = 0;
+
+
+  /*  All of the polygons and images go out in one write.  */
+
+  if (bfdh[hnd].staged_data_size)
+    {
+      if (binaryFeatureData_seek (hnd, bfdh[hnd].afp, bfdh[hnd].txn_base, SEEK_SET) < 0)
+        {
+          bfd_error.system = errno;
+          strcpy (bfd_error.file, bfdh[hnd].a_path);
+          return (bfd_error.bfd = BFDATA_POLY_WRITE_FSEEK_ERROR);
+        }
+
+      if (!binaryFeatureData_write (hnd, bfdh[hnd].staged_data, bfdh[hnd].staged_data_size, 1, bfdh[hnd].afp))
+        {
+          bfd_error.system = errno;
+          strcpy (bfd_error.file, bfdh[hnd].a_path);
+          return (bfd_error.bfd = BFDATA_POLY_WRITE_ERROR);
+        }
+    }
+
+
+  /*  Sort by record number and only keep the last write to any record.  */
+
+  qsort (staged, bfdh[hnd].staged_count, sizeof (INTERNAL_BFDATA_STAGED), binaryFeatureData_compare_staged);
+
+  for (i = 0, count = 0 ; i < bfdh[hnd].staged_count ; i++)
+    {
+      if (i + 1 < bfdh[hnd].staged_count && staged[i + 1].recnum == staged[i].recnum) continue;
+
+      if (count != i) staged[count] = staged[i];
+      count++;
+    }
+
+
+  if ((buffer = (uint8_t *) malloc ((size_t) count * bfdh[hnd].record_size)) == NULL)
+    {
+      bfd_error.system = errno;
+      strcpy (bfd_error.file, bfdh[hnd].path);
+      return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
+    }
+
+  for (i = 0 ; i < count ; i++) binaryFeatureData_encode_record (hnd, &staged[i].record, &buffer[(size_t) i * bfdh[hnd].record_size]);
+
+
+  if (bfdh[hnd].txn_records > bfdh[hnd].header.number_of_records) bfdh[hnd].header.number_of_records = bfdh[hnd].txn_records;
+
+
+  /*  Journal the whole transaction as one group before we touch the BFD file.  */
+
+  if (bfdh[hnd].jfp != NULL)
+    {
+      for (i = 0 ; i < count ; i++)
+        {
+          if (binaryFeatureData_journal_entry (hnd, staged[i].recnum, &buffer[(size_t) i * bfdh[hnd].record_size]) < 0)
+            {
+              free (buffer);
+              return (bfd_error.bfd);
+            }
+        }
+
+      if (binaryFeatureData_commit_journal (hnd) < 0)
+        {
+          free (buffer);
+          return (bfd_error.bfd);
+        }
+    }
+
+
+  /*  One seek and one write for each run of consecutive record numbers.  */
+
+  for (i = 0 ; i < count ; i = j)
+    {
+      for (j = i + 1 ; j < count && staged[j].recnum == staged[j - 1].recnum + 1 ; j++);
+
+      pos = (int64_t) staged[i].recnum * bfdh[hnd].record_size + bfdh[hnd].header_size;
+
+      if (binaryFeatureData_seek (hnd, bfdh[hnd].fp, pos, SEEK_SET) < 0)
+        {
+          bfd_error.system = errno;
+          bfd_error.recnum = staged[i].recnum;
+          strcpy (bfd_error.file, bfdh[hnd].path);
+          free (buffer);
+          return (bfd_error.bfd = BFDATA_RECORD_WRITE_FSEEK_ERROR);
+        }
+
+      if (!binaryFeatureData_write (hnd, &buffer[(size_t) i * bfdh[hnd].record_size], bfdh[hnd].record_size, j - i, bfdh[hnd].fp))
+        {
+          bfd_error.system = errno;
+          bfd_error.recnum = staged[i].recnum;
+          strcpy (bfd_error.file, bfdh[hnd].path);
+          free (buffer);
+          return (bfd_error.bfd = BFDATA_RECORD_WRITE_ERROR);
+        }
+    }
+
+  free (buffer);
+
+
+  bfdh[hnd].modified = 1;
+  bfdh[hnd].write = 1;
+  bfdh[hnd].last_rec = -1;
+
+
+  if (bfdh[hnd].jfp != NULL && ftello64 (bfdh[hnd].jfp) > BFDATA_JOURNAL_CHECKPOINT_SIZE)
+    {
+      if (binaryFeatureData_do_sync (hnd) < 0) return (bfd_error.bfd);
+    }
+
+  if (binaryFeatureData_group_sync (hnd, count) < 0) return (bfd_error.bfd);
+
+
+  bfd_error.system = 0;
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_commit_transaction
+
+ - Purpose:     Write everything staged by the active transaction.  All of the staged
+                polygons and images are appended to the .bfa file with a single write, the
+                records are sorted by record number (if a record was written more than once
+                only the last write is kept) and runs of consecutive records are written with
+                one seek and one write each.  The record count in the header is only updated
+                once.  If journaling is on (binaryFeatureData_set_journal) the records are
+                journaled and committed before the BFD file is touched so the whole transaction
+                either makes it to disk or is replayed after a crash.
+
+ - Date:        10/19/26
+
+ - Arguments:   hnd            =    The file handle
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_TRANSACTION_ERROR
+                - BFDATA_MEMORY_ALLOCATION_ERROR
+                - BFDATA_POLY_WRITE_FSEEK_ERROR
+                - BFDATA_POLY_WRITE_ERROR
+                - BFDATA_RECORD_WRITE_FSEEK_ERROR
+                - BFDATA_RECORD_WRITE_ERROR
+                - BFDATA_JOURNAL_WRITE_ERROR
+                - BFDATA_SYNC_ERROR
+
+ - Caveats:     The transaction is over whether this succeeds or not.  Without a journal a
+                failure part way through can leave some of the records written.
+
+*********************************************************************************************/
+
+BFDATA_DLL int32_t binaryFeatureData_commit_transaction (int32_t hnd)
+{
+  INTERNAL_BFDATA_OPERATION operation;
+  int32_t status;
+
+
+  if (!instrumented) return (binaryFeatureData_do_commit_transaction (hnd));
+
+  binaryFeatureData_begin_operation (&operation, BFDATA_OPERATION_SYNC, hnd, -1);
+
+  status = binaryFeatureData_do_commit_transaction (hnd);
+
+  binaryFeatureData_end_operation (&operation, status);
+
+  return (status);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_abort_transaction
+
+ - Purpose:     Throw away everything staged by the active transaction.
+
+ - Date:        10/19/26
+
+ - Arguments:   hnd            =    The file handle
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_TRANSACTION_ERROR
+
+*********************************************************************************************/
+
+BFDATA_DLL int32_t binaryFeatureData_abort_transaction (int32_t hnd)
+{
+  if (!bfdh[hnd].transaction)
+    {
+      strcpy (bfd_error.file, bfdh[hnd].path);
+      return (bfd_error.bfd = BFDATA_TRANSACTION_ERROR);
+    }
+
+  bfdh[hnd].transaction = 0;
+  bfdh[hnd].staged_count = 0;
+  bfdh[hnd].staged_data_size = 0;
+
+
+  /*  The bounds array has the staged records in it and the staged polygon addresses will be used again.  */
+
+  bfdh[hnd].poly_bounds_valid = 0;
+  bfdh[hnd].last_poly_address = 0;
+  bfdh[hnd].query_valid = 0;
+  bfdh[hnd].point_index_valid = 0;
+
+
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_write_header
+
+ - Purpose:     Write the bfd_header to the BFD file.
+
+ - Author:      Jan C. Depner (area.based.editor@gmail.com)
+
+ - Date:        03/27/09
+
+ - Arguments:   hnd            =    The BFD file handle
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_HEADER_WRITE_FSEEK_ERROR
+                - BFDATA_HEADER_WRITE_ERROR
+
+*********************************************************************************************/
+
+static int32_t binaryFeatureData_write_header (int32_t hnd)
+{
+  char space[4096];
+  int32_t size, year, jday, hour, minute, month, day;
+  float second;
+
+
+  bfdh[hnd].stats.header_writes++;
+
+  if (binaryFeatureData_seek (hnd, bfdh[hnd].fp, 0, SEEK_SET) < 0)
+    {
+      bfd_error.system = errno;
+      strcpy (bfd_error.file, bfdh[hnd].path);
+      return (bfd_error.bfd = BFDATA_HEADER_WRITE_FSEEK_ERROR);
+    }
+
+
+  fprintf (bfdh[hnd].fp, "[VERSION] = %s\n", BFDATA_VERSION);
+
+  /*  The file's byte order is the machine's unless we're swapping (see binaryFeatureData_set_file_endian).  */
+
+  if (binaryFeatureData_big_endian () ^ bfdh[hnd].swap)
+    {
+      fprintf (bfdh[hnd].fp, "[ENDIAN] = BIG\n");
+    }
+  else
+    {
+      fprintf (bfdh[hnd].fp, "[ENDIAN] = LITTLE\n");
+    }
+
+
+  binaryFeatureData_cvtime (bfdh[hnd].header.creation_tv_sec, bfdh[hnd].header.creation_tv_nsec, &year, &jday, &hour, &minute, &second);
+  binaryFeatureData_jday2mday (year, jday, &month, &day);
+  month++;
+
+  fprintf (bfdh[hnd].fp, "[CREATION YEAR] = %d\n", year + 1900);
+  fprintf (bfdh[hnd].fp, "[CREATION MONTH] = %02d\n", month);
+  fprintf (bfdh[hnd].fp, "[CREATION DAY] = %02d\n", day);
+  fprintf (bfdh[hnd].fp, "[CREATION DAY OF YEAR] = %03d\n", jday);
+  fprintf (bfdh[hnd].fp, "[CREATION HOUR] = %02d\n", hour);
+  fprintf (bfdh[hnd].fp, "[CREATION MINUTE] = %02d\n", minute);
+  fprintf (bfdh[hnd].fp, "[CREATION SECOND] = %5.2f\n", second);
+  if (strlen (bfdh[hnd].header.creation_software) > 2) fprintf (bfdh[hnd].fp, "[CREATION SOFTWARE] = %s\n", bfdh[hnd].header.creation_software);
+
+
+  binaryFeatureData_cvtime (bfdh[hnd].header.modification_tv_sec, bfdh[hnd].header.modification_tv_nsec, &year, &jday, &hour, &minute, &second);
+  binaryFeatureData_jday2mday (year, jday, &month, &day);
+  month++;
+
+  fprintf (bfdh[hnd].fp, "[MODIFICATION YEAR] = %d\n", year + 1900);
+  fprintf (bfdh[hnd].fp, "[MODIFICATION MONTH] = %02d\n", month);
+  fprintf (bfdh[hnd].fp, "[MODIFICATION DAY] = %02d\n", day);
+  fprintf (bfdh[hnd].fp, "[MODIFICATION DAY OF YEAR] = %03d\n", jday);
+  fprintf (bfdh[hnd].fp, "[MODIFICATION HOUR] = %02d\n", hour);
+  fprintf (bfdh[hnd].fp, "[MODIFICATION MINUTE] = %02d\n", minute);
+  fprintf (bfdh[hnd].fp, "[MODIFICATION SECOND] = %5.2f\n", second);
+  if (strlen (bfdh[hnd].header.modification_software) > 2) fprintf (bfdh[hnd].fp, "[MODIFICATION SOFTWARE] = %s\n", bfdh[hnd].header.modification_software);
+
+  if (strlen (bfdh[hnd].header.security_classification) > 2) fprintf (bfdh[hnd].fp, "[SECURITY CLASSIFICATION] = %s\n",
+                                                                      bfdh[hnd].header.security_classification);
+  if (strlen (bfdh[hnd].header.distribution) > 2) fprintf (bfdh[hnd].fp, "{DISTRIBUTION = \n%s\n}\n", bfdh[hnd].header.distribution);
+  if (strlen (bfdh[hnd].header.declassification) > 2) fprintf (bfdh[hnd].fp, "{DECLASSIFICATION = \n%s\n}\n", bfdh[hnd].header.declassification);
+  if (strlen (bfdh[hnd].header.class_just) > 2) fprintf (bfdh[hnd].fp, "{SECURITY CLASSIFICATION JUSTIFICATION = \n%s\n}\n", bfdh[hnd].header.class_just);
+  if (strlen (bfdh[hnd].header.downgrade) > 2) fprintf (bfdh[hnd].fp, "{DOWNGRADE = \n%s\n}\n", bfdh[hnd].header.downgrade);
+
+  fprintf (bfdh[hnd].fp, "[NUMBER OF RECORDS] = %d\n", bfdh[hnd].header.number_of_records);
+  bfdh[hnd].header_size = BFDATA_HEADER_SIZE;
+  fprintf (bfdh[hnd].fp, "[HEADER SIZE] = %d\n", bfdh[hnd].header_size);
+
+
+  /*  Major version 2 or greater.  */
+
+  if (bfdh[hnd].major_version >= 2) fprintf (bfdh[hnd].fp, "[RECORD SIZE] = %d\n", bfdh[hnd].record_size);
+
+
+  /*  Only if the polygon bounds file goes with the file as it is now (see binaryFeatureData_save_bounds).  */
+
+  if (bfdh[hnd].bounds_stamp) fprintf (bfdh[hnd].fp, "[BOUNDS STAMP] = %u\n", bfdh[hnd].bounds_stamp);
+
+
+  if (strlen (bfdh[hnd].header.comments) > 2) fprintf (bfdh[hnd].fp, "{COMMENTS = \n%s\n}\n", bfdh[hnd].header.comments);
+
+
+  /*  Space fill the rest.  This gets called on every binaryFeatureData_sync so we write the fill in blocks instead of
+      a byte at a time.  */
+
+  size = bfdh[hnd].header_size - ftell (bfdh[hnd].fp);
+
+  memset (space, ' ', sizeof (space));
+
+  while (size > 0)
+    {
+      int32_t block = size < (int32_t) sizeof (space) ? size : (int32_t) sizeof (space);
+
+      if (!binaryFeatureData_write (hnd, space, block, 1, bfdh[hnd].fp))
+        {
+          bfd_error.system = errno;
+          strcpy (bfd_error.file, bfdh[hnd].path);
+          return (bfd_error.bfd = BFDATA_HEADER_WRITE_ERROR);
+        }
+
+      size -= block;
+    }
+
+
+  bfdh[hnd].modified = 1;
+  bfdh[hnd].write = 1;
+
+
+  bfd_error.system = 0;
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_read_journal_entry
+
+ - Purpose:     Read the next journal entry and verify its checksum.
+
+ - Date:        10/19/26
+
+ - Arguments:
+                - hnd            =    The file handle
+                - jfp            =    The journal file pointer
+                - tag            =    Returned BFDATA_JOURNAL_RECORD or BFDATA_JOURNAL_COMMIT
+                - value          =    Returned record number (record) or number of records (commit)
+                - buffer         =    Returned on-disk record (record entries only)
+
+ - Returns:
+                - 1 if a complete, valid entry was read
+                - 0 at end of journal or on a torn/corrupt entry
+
+*********************************************************************************************/
+
+static uint8_t binaryFeatureData_read_journal_entry (int32_t hnd, FILE *jfp, uint32_t *tag, uint32_t *value, uint8_t *buffer)
+{
+  uint32_t entry[2], checksum, hash;
+
+
+  if (!fread (entry, sizeof (entry), 1, jfp)) return (0);
+
+  hash = binaryFeatureData_fnv1a (BFDATA_FNV1A_SEED, entry, sizeof (entry));
+
+  if (entry[0] == BFDATA_JOURNAL_RECORD)
+    {
+      if (!fread (buffer, bfdh[hnd].record_size, 1, jfp)) return (0);
+      hash = binaryFeatureData_fnv1a (hash, buffer, bfdh[hnd].record_size);
+    }
+  else if (entry[0] != BFDATA_JOURNAL_COMMIT)
+    {
+      return (0);
+    }
+
+  if (!fread (&checksum, sizeof (uint32_t), 1, jfp) || checksum != hash) return (0);
+
+
+  *tag = entry[0];
+  *value = entry[1];
+
+  return (1);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_replay_journal
+
+ - Purpose:     If a journal was left behind by an unclean shutdown, write all of the committed
+                record entries back into the BFD file, fix [NUMBER OF RECORDS], sync, and
+                remove the journal.  Entries after the last valid commit marker are ignored.
+
+ - Date:        10/19/26
+
+ - Arguments:   hnd            =    The file handle (must be open for update)
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_JOURNAL_REPLAY_ERROR
+                - BFDATA_HEADER_WRITE_FSEEK_ERROR
+                - BFDATA_HEADER_WRITE_ERROR
+                - BFDATA_SYNC_ERROR
+
+*********************************************************************************************/
+
+static int32_t binaryFeatureData_replay_journal (int32_t hnd)
+{
+  FILE *jfp;
+  char magic[8];
+  uint8_t buffer[sizeof (BFDATA_RECORD)];
+  uint32_t sizes[2], tag, value, committed_records = 0;
+  int64_t committed = 0, pos;
+
+
+  if ((jfp = fopen64 (bfdh[hnd].j_path, "rb")) == NULL) return (bfd_error.bfd = BFDATA_SUCCESS);
+
+
+  /*  A journal that doesn't even have a complete header can't have any committed entries.  */
+
+  if (!fread (magic, 8, 1, jfp) || !fread (sizes, sizeof (sizes), 1, jfp))
+    {
+      fclose (jfp);
+      remove (bfdh[hnd].j_path);
+      return (bfd_error.bfd = BFDATA_SUCCESS);
+    }
+
+
+  if (memcmp (magic, BFDATA_JOURNAL_MAGIC, 8) || sizes[0] != bfdh[hnd].record_size || sizes[1] != bfdh[hnd].header_size)
+    {
+      fclose (jfp);
+      strcpy (bfd_error.file, bfdh[hnd].j_path);
+      return (bfd_error.bfd = BFDATA_JOURNAL_REPLAY_ERROR);
+    }
+
+
+  /*  First pass, find the end of the last committed group.  */
+
+  while (binaryFeatureData_read_journal_entry (hnd, jfp, &tag, &value, buffer))
+    {
+      if (tag == BFDATA_JOURNAL_COMMIT)
+        {
+          committed = ftello64 (jfp);
+          committed_records = value;
+        }
+    }
+
+
+  /*  Second pass, apply the committed record entries in the order they were written.  */
+
+  fseeko64 (jfp, BFDATA_JOURNAL_HEADER_SIZE, SEEK_SET);
+
+  while (ftello64 (jfp) < committed && binaryFeatureData_read_journal_entry (hnd, jfp, &tag, &value, buffer))
+    {
+      if (tag != BFDATA_JOURNAL_RECORD) continue;
+
+      pos = (int64_t) value * bfdh[hnd].record_size + bfdh[hnd].header_size;
+
+      if (binaryFeatureData_seek (hnd, bfdh[hnd].fp, pos, SEEK_SET) < 0 || !binaryFeatureData_write (hnd, buffer, bfdh[hnd].record_size, 1, bfdh[hnd].fp))
+        {
+          bfd_error.system = errno;
+          bfd_error.recnum = value;
+          fclose (jfp);
+          strcpy (bfd_error.file, bfdh[hnd].path);
+          return (bfd_error.bfd = BFDATA_JOURNAL_REPLAY_ERROR);
+        }
+    }
+
+  fclose (jfp);
+
+
+  if (committed)
+    {
+      if (committed_records > bfdh[hnd].header.number_of_records) bfdh[hnd].header.number_of_records = committed_records;
+
+
+      /*  The replayed records may have new polygons so the polygon bounds file (if there still is one) is out of date.  */
+
+      bfdh[hnd].bounds_stamp = 0;
+
+      if (binaryFeatureData_write_header (hnd) < 0) return (bfd_error.bfd);
+
+      if (binaryFeatureData_sync_stream (bfdh[hnd].fp))
+        {
+          bfd_error.system = errno;
+          strcpy (bfd_error.file, bfdh[hnd].path);
+          return (bfd_error.bfd = BFDATA_SYNC_ERROR);
+        }
+    }
+
+
+  remove (bfdh[hnd].j_path);
+
+
+  bfd_error.system = 0;
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
+
+
+
+
+/*!  Undo a binaryFeatureData_open_file that failed part way.  Closes whatever was opened, frees the handle so it can be
+     used again, and returns "error" so it can go straight in to the return statement.  Nothing that runs before the
+     open can fail allocates memory so there is nothing to free.  */
+
+static int32_t binaryFeatureData_abandon_open (int32_t hnd, int32_t error)
+{
+  if (bfdh[hnd].fp != NULL) fclose (bfdh[hnd].fp);
+  if (bfdh[hnd].afp != NULL) fclose (bfdh[hnd].afp);
+  if (bfdh[hnd].jfp != NULL) fclose (bfdh[hnd].jfp);
+
+  memset (&bfdh[hnd], 0, sizeof (INTERNAL_BFDATA_STRUCT));
+  bfdh[hnd].fp = NULL;
+  bfdh[hnd].afp = NULL;
+  bfdh[hnd].jfp = NULL;
+  bfdh[hnd].short_feature = NULL;
+
+
+  return (bfd_error.bfd = error);
+}
+
+
+
+
+/*  binaryFeatureData_create_file without the statistics and tracing (see below).  */
+
+static int32_t binaryFeatureData_do_create_file (const char *path, BFDATA_HEADER bfd_header)
+{
+  char space = ' ', info[128];
+  int32_t i, hnd, size;
+  float tmpf;
+
+
+  /*  The first time through we want to initialize (zero) the BFD handle array.  */
+
+  if (first)
+    {
+      for (i = 0 ; i < BFDATA_MAX_FILES ; i++) 
+        {
+          memset (&bfdh[i], 0, sizeof (INTERNAL_BFDATA_STRUCT));
+          bfdh[i].fp = NULL;
+          bfdh[i].afp = NULL;
+          bfdh[i].short_feature = NULL;
+        }
+
+      first = 0;
+    }
+
+
+  /*  Find the next available handle and make sure we haven't opened too many.  */
+
+  hnd = BFDATA_MAX_FILES;
+  for (i = 0 ; i < BFDATA_MAX_FILES ; i++)
+    {
+      if (bfdh[i].fp == NULL)
+        {
+          hnd = i;
+          bfdh[hnd].last_rec = -1;
+          memset (&bfdh[hnd].stats, 0, sizeof (BFDATA_STATS));
+          break;
+        }
+    }
+
+
+  if (hnd == BFDATA_MAX_FILES) return (bfd_error.bfd = BFDATA_TOO_MANY_OPEN_FILES);
+
+
+  /*  Set the major version.  */
+
+  strcpy (info, strstr (BFDATA_VERSION, "library V"));
+  sscanf (info, "library V%f", &tmpf);
+  bfdh[hnd].major_version = (int32_t) tmpf;
+
+
+  /*  New files are native byte order (see binaryFeatureData_set_file_endian).  The handle may have been used for a
+      swapped file before.  */
+
+  bfdh[hnd].swap = 0;
+
+
+  /*  Make sure we know the BFDATA_RECORD size as stored on disk.  */
+
+  bfdh[hnd].record_size = binaryFeatureData_compute_record_size (hnd);
+  binaryFeatureData_compute_field_offsets (hnd);
+  binaryFeatureData_select_codec (hnd);
+
+
+  /*  Save the file name for error messages.  */
+
+  strcpy (bfdh[hnd].path, path);
+
+
+  /*  Open the file and write the header.  */
+
+  if ((bfdh[hnd].fp = fopen (path, "wb+")) == NULL)
+    {
+      bfd_error.system = errno;
+      strcpy (bfd_error.file, bfdh[hnd].path);
+      return (bfd_error.bfd = BFDATA_CREATE_ERROR);
+    }
+
+
+  /*  Open the associated polygon file and write the version string.  */
+
+  if (hnd >= 0)
+    {
+      strcpy (bfdh[hnd].a_path, path);
+      sprintf (&bfdh[hnd].a_path[strlen (bfdh[hnd].a_path) - 3], "bfa");
+
+      if ((bfdh[hnd].afp = fopen64 (bfdh[hnd].a_path, "wb+")) == NULL)
+        {
+          bfd_error.system = errno;
+          strcpy (bfd_error.file, bfdh[hnd].a_path);
+          return (bfd_error.bfd = BFDATA_CREATE_POLY_ERROR);
+        }
+
+
+      /*  Get rid of any journal or polygon bounds file left over from a previous file with the same name.  */
+
+      strcpy (bfdh[hnd].j_path, path);
+      sprintf (&bfdh[hnd].j_path[strlen (bfdh[hnd].j_path) - 3], "bfj");
+      remove (bfdh[hnd].j_path);
+
+      strcpy (bfdh[hnd].b_path, path);
+      sprintf (&bfdh[hnd].b_path[strlen (bfdh[hnd].b_path) - 3], "bfb");
+      remove (bfdh[hnd].b_path);
+
+      fprintf (bfdh[hnd].afp, "%s\n", BFDATA_VERSION);
+
+
+      /*  Space fill the rest.  */
+
+      size = BFDATA_POLY_VERSION_SIZE - ftello64 (bfdh[hnd].afp);
+
+
+      for (i = 0 ; i < size ; i++)
+        {
+          if (!binaryFeatureData_write (hnd, &space, 1, 1, bfdh[hnd].afp))
+            {
+              bfd_error.system = errno;
+              strcpy (bfd_error.file, bfdh[hnd].a_path);
+              return (bfd_error.bfd = BFDATA_HEADER_WRITE_ERROR);
+            }
+        }
+    }
+
+
+  bfdh[hnd].header = bfd_header;
+
+
+  bfdh[hnd].header.number_of_records = 0;
+
+
+  /*  We know the bounds of every polygon in an empty file so we can keep them as they're written and save them on
+      close (see binaryFeatureData_save_bounds).  */
+
+  bfdh[hnd].poly_bounds_valid = 1;
+  bfdh[hnd].poly_bounds_count = 0;
+
+
+  /*  Write the header.  */
+
+  if (binaryFeatureData_write_header (hnd) < 0) return (bfd_error.bfd = BFDATA_HEADER_WRITE_ERROR);
+
+
+  bfdh[hnd].modified = 1;
+  bfdh[hnd].created = 1;
+  bfdh[hnd].write = 1;
+
+
+  bfd_error.system = 0;
+  return (hnd);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_create_file
+
+ - Purpose:     Create a BFD file.
+
+ - Author:      Jan C. Depner (area.based.editor@gmail.com)
+
+ - Date:        03/27/09
+
+ - Arguments:
+                - path           =    The BFD file path
+                - bfd_header     =    BFDATA_HEADER structure to be written to the file
+
+ - Returns:
+                - The file handle (0 or positive)
+                - BFDATA_TOO_MANY_OPEN_FILES
+                - BFDATA_CREATE_ERROR
+                - BFDATA_CREATE_POLY_ERROR
+                - BFDATA_HEADER_WRITE_FSEEK_ERROR
+                - BFDATA_HEADER_WRITE_ERROR
+
+*********************************************************************************************/
+
+BFDATA_DLL int32_t binaryFeatureData_create_file (const char *path, BFDATA_HEADER bfd_header)
+{
+  INTERNAL_BFDATA_OPERATION operation;
+  int32_t status;
+
+
+  if (!instrumented) return (binaryFeatureData_do_create_file (path, bfd_header));
+
+  binaryFeatureData_begin_operation (&operation, BFDATA_OPERATION_OPEN, -1, -1);
+
+  status = binaryFeatureData_do_create_file (path, bfd_header);
+
+  binaryFeatureData_end_operation (&operation, status);
+
+  return (status);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_set_file_endian
+
+ - Purpose:     Set the byte order of a newly created BFD file.  By default files are
+                written in the byte order of the machine that creates them.  This is
+                mostly useful for building test files that look like they came from a
+                machine with the other byte order.
+
+ - Date:        10/19/26
+
+ - Arguments:
+                - hnd            =    The file handle (from binaryFeatureData_create_file)
+                - big            =    1 for big endian, 0 for little endian
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_INVALID_ENDIAN
+                - BFDATA_HEADER_WRITE_FSEEK_ERROR
+                - BFDATA_HEADER_WRITE_ERROR
+
+ - Caveats:     This has to be called before anything has been written to the file.
+
+*********************************************************************************************/
+
+BFDATA_DLL int32_t binaryFeatureData_set_file_endian (int32_t hnd, int32_t big)
+{
+  if (!bfdh[hnd].created || bfdh[hnd].header.number_of_records)
+    {
+      bfd_error.system = 0;
+      strcpy (bfd_error.file, bfdh[hnd].path);
+      return (bfd_error.bfd = BFDATA_INVALID_ENDIAN);
+    }
+
+
+  bfdh[hnd].swap = ((big != 0) != (binaryFeatureData_big_endian () != 0));
+  binaryFeatureData_select_codec (hnd);
+
+
+  /*  Rewrite the header so that the [ENDIAN] tag matches.  */
+
+  if (binaryFeatureData_write_header (hnd) < 0) return (bfd_error.bfd = BFDATA_HEADER_WRITE_ERROR);
+
+
+  bfd_error.system = 0;
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
+
+
+
+/*  binaryFeatureData_open_file without the statistics and tracing (see below).  */
+
+static int32_t binaryFeatureData_do_open_file (const char *path, BFDATA_HEADER *bfd_header, int32_t mode)
+{
+  int32_t i, hnd, year[4], jday[4], hour[4], minute[4], eof;
+  float second[4], tmpf;
+  char varin[8192], info[8192];
+
+
+  /*  The first time through we want to initialize (zero) the bfd handle array.  */
+
+  if (first)
+    {
+      for (i = 0 ; i < BFDATA_MAX_FILES ; i++) 
+        {
+          memset (&bfdh[i], 0, sizeof (INTERNAL_BFDATA_STRUCT));
+          bfdh[i].fp = NULL;
+          bfdh[i].afp = NULL;
+          bfdh[i].short_feature = NULL;
+        }
+
+      first = 0;
+    }
+
+
+  /*  Find the next available handle and make sure we haven't opened too many.  */
+
+  hnd = BFDATA_MAX_FILES;
+  for (i = 0 ; i < BFDATA_MAX_FILES ; i++)
+    {
+      if (bfdh[i].fp == NULL)
+        {
+          hnd = i;
+          bfdh[hnd].last_rec = -1;
+          memset (&bfdh[hnd].stats, 0, sizeof (BFDATA_STATS));
+          break;
+        }
+    }
+
+
+  if (hnd == BFDATA_MAX_FILES) return (bfd_error.bfd = BFDATA_TOO_MANY_OPEN_FILES);
+
+
+  /*  Internal structs are zeroed above and on close of file so we don't have to do it here.  */
+
+
+  /*  Save the file name for error messages.  */
+
+  strcpy (bfdh[hnd].path, path);
+
+
+  /*  Open the file and read the header.  */
+
+  switch (mode)
+    {
+    case BFDATA_UPDATE:
+      if ((bfdh[hnd].fp = fopen (path, "rb+")) == NULL)
+        {
+          bfd_error.system = errno;
+          strcpy (bfd_error.file, bfdh[hnd].path);
+          return (binaryFeatureData_abandon_open (hnd, BFDATA_OPEN_UPDATE_ERROR));
+        }
+
+
+      strcpy (bfdh[hnd].a_path, path);
+      sprintf (&bfdh[hnd].a_path[strlen (bfdh[hnd].a_path) - 3], "bfa");
+
+      if ((bfdh[hnd].afp = fopen64 (bfdh[hnd].a_path, "rb+")) == NULL)
+        {
+          bfd_error.system = errno;
+          strcpy (bfd_error.file, bfdh[hnd].a_path);
+          return (binaryFeatureData_abandon_open (hnd, BFDATA_OPEN_POLY_UPDATE_ERROR));
+        }
+      break;
+
+    case BFDATA_READONLY:
+      if ((bfdh[hnd].fp = fopen (path, "rb")) == NULL)
+        {
+          bfd_error.system = errno;
+          strcpy (bfd_error.file, bfdh[hnd].path);
+          return (binaryFeatureData_abandon_open (hnd, BFDATA_OPEN_READONLY_ERROR));
+        }
+
+
+      strcpy (bfdh[hnd].a_path, path);
+      sprintf (&bfdh[hnd].a_path[strlen (bfdh[hnd].a_path) - 3], "bfa");
+
+      if ((bfdh[hnd].afp = fopen64 (bfdh[hnd].a_path, "rb")) == NULL)
+        {
+          bfd_error.system = errno;
+          strcpy (bfd_error.file, bfdh[hnd].a_path);
+          return (binaryFeatureData_abandon_open (hnd, BFDATA_OPEN_POLY_READONLY_ERROR));
+        }
+      break;
+    }
+
+
+  year[0] = year[1] = 0;
+
+
+  /*  We want to try to read the first line (version info) with an fread in case we mistakenly asked to
+      load a binary file.  If we try to use bfd_ngets to read a binary file and there are no line feeds in 
+      the first sizeof (varin) characters we would segfault.  */
+
+  if (!binaryFeatureData_read (hnd, varin, 128, 1, bfdh[hnd].fp))
+    {
+      strcpy (bfd_error.file, bfdh[hnd].path);
+      return (binaryFeatureData_abandon_open (hnd, BFDATA_NOT_BFD_FILE_ERROR));
+    }
+
+
+  /*  Check for the "Binary Feature Data library" or "BFD library" string at the beginning of the file.  Either is acceptable, 
+      it was changed in version 1.02).  */
+
+  if (!strstr (varin, "Binary Feature Data library") && !strstr (varin, "BFD library"))
+    {
+      strcpy (bfd_error.file, bfdh[hnd].path);
+      return (binaryFeatureData_abandon_open (hnd, BFDATA_NOT_BFD_FILE_ERROR));
+    }
+
+
+  /*  Rewind to the beginning of the file.  Yes, we'll read the version again but we need to check the version number anyway.  */
+
+  binaryFeatureData_seek (hnd, bfdh[hnd].fp, 0, SEEK_SET);
+
+
+  /*  Note, we're using binaryFeatureData_ngets instead of fgets since we really don't want the CR/LF in the strings.  */
+
+  while (binaryFeatureData_ngets (varin, sizeof (varin), bfdh[hnd].fp))
+    {
+      if (strstr (varin, "[END OF HEADER]")) break;
+
+
+      /*  Put everything to the right of the equals sign into 'info'.   */
+
+      binaryFeatureData_get_string (varin, info);
+
+
+      /*  Read the version string and check the major version number against the library major version.  */
+
+      if (strstr (varin, "[VERSION]"))
+        {
+          strcpy (bfdh[hnd].header.version, info);
+          strcpy (info, strstr (varin, "library V"));
+          sscanf (info, "library V%f", &tmpf);
+          bfdh[hnd].major_version = (int16_t) tmpf;
+
+          strcpy (info, strstr (BFDATA_VERSION, "library V"));
+          sscanf (info, "library V%f", &tmpf);
+          if (bfdh[hnd].major_version > (int16_t) tmpf)
+            {
+              strcpy (bfd_error.file, bfdh[hnd].path);
+              return (binaryFeatureData_abandon_open (hnd, BFDATA_NEWER_FILE_VERSION_ERROR));
+            }
+        }
+
+
+      if (strstr (varin, "[ENDIAN]"))
+        {
+          if (binaryFeatureData_big_endian ())
+            {
+              if (strstr (info, "LITTLE"))
+                {
+                  bfdh[hnd].swap = 1;
+                }
+              else
+                {
+                  bfdh[hnd].swap = 0;
+                }
+            }
+          else
+            {
+              if (strstr (info, "BIG"))
+                {
+                  bfdh[hnd].swap = 1;
+                }
+              else
+                {
+                  bfdh[hnd].swap = 0;
+                }
+            }
+        }
+
+
+      if (strstr (varin, "[CREATION YEAR]")) sscanf (info, "%d", &year[0]);
+      if (strstr (varin, "[CREATION DAY OF YEAR]")) sscanf (info, "%d", &jday[0]);
+      if (strstr (varin, "[CREATION HOUR]")) sscanf (info, "%d", &hour[0]);
+      if (strstr (varin, "[CREATION MINUTE]")) sscanf (info, "%d", &minute[0]);
+      if (strstr (varin, "[CREATION SECOND]")) sscanf (info, "%f", &second[0]);
+      if (strstr (varin, "[CREATION SOFTWARE]")) strcpy (bfdh[hnd].header.creation_software, info);
+
+      if (strstr (varin, "[MODIFICATION YEAR]")) sscanf (info, "%d", &year[1]);
+      if (strstr (varin, "[MODIFICATION DAY OF YEAR]")) sscanf (info, "%d", &jday[1]);
+      if (strstr (varin, "[MODIFICATION HOUR]")) sscanf (info, "%d", &hour[1]);
+      if (strstr (varin, "[MODIFICATION MINUTE]")) sscanf (info, "%d", &minute[1]);
+      if (strstr (varin, "[MODIFICATION SECOND]")) sscanf (info, "%f", &second[1]);
+      if (strstr (varin, "[MODIFICATION SOFTWARE]")) strcpy (bfdh[hnd].header.modification_software, info);
+
+      if (strstr (varin, "[SECURITY CLASSIFICATION]")) strcpy (bfdh[hnd].header.security_classification, info);
+
+      if (strstr (varin, "{DISTRIBUTION ="))
+        {
+          strcpy (bfdh[hnd].header.distribution, "");
+          while (fgets (varin, sizeof (varin), bfdh[hnd].fp))
+            {
+              if (varin[0] == '}') break;
+              strcat (bfdh[hnd].header.distribution, varin);
+            }
+        }
+
+      if (strstr (varin, "{DECLASSIFICATION ="))
+        {
+          strcpy (bfdh[hnd].header.declassification, "");
+          while (fgets (varin, sizeof (varin), bfdh[hnd].fp))
+            {
+              if (varin[0] == '}') break;
+              strcat (bfdh[hnd].header.declassification, varin);
+            }
+        }
+
+      if (strstr (varin, "{SECURITY CLASSIFICATION JUSTIFICATION ="))
+        {
+          strcpy (bfdh[hnd].header.class_just, "");
+          while (fgets (varin, sizeof (varin), bfdh[hnd].fp))
+            {
+              if (varin[0] == '}') break;
+              strcat (bfdh[hnd].header.class_just, varin);
+            }
+        }
+
+
+      if (strstr (varin, "{DOWNGRADE ="))
+        {
+          strcpy (bfdh[hnd].header.downgrade, "");
+          while (fgets (varin, sizeof (varin), bfdh[hnd].fp))
+            {
+              if (varin[0] == '}') break;
+              strcat (bfdh[hnd].header.downgrade, varin);
+            }
+        }
+
+
+      if (strstr (varin, "[SECURITY CLASSIFICATION]")) strcpy (bfdh[hnd].header.security_classification, info);
+
+      if (strstr (varin, "[NUMBER OF RECORDS]")) sscanf (info, "%d", &bfdh[hnd].header.number_of_records);
+
+      if (strstr (varin, "{COMMENTS ="))
+        {
+          strcpy (bfdh[hnd].header.comments, "");
+          while (fgets (varin, sizeof (varin), bfdh[hnd].fp))
+            {
+              if (varin[0] == '}') break;
+              strcat (bfdh[hnd].header.comments, varin);
+            }
+        }
+
+
+      if (strstr (varin, "[HEADER SIZE]")) sscanf (info, "%d", &bfdh[hnd].header_size);
+      if (strstr (varin, "[RECORD SIZE]")) sscanf (info, "%d", &bfdh[hnd].record_size);
+      if (strstr (varin, "[BOUNDS STAMP]")) sscanf (info, "%u", &bfdh[hnd].bounds_stamp);
+    }
+
+
+  /*  Pre 2.00 screwup.  I used the structure size even though I wasn't writing structures.  DOH!  */
+
+  if (bfdh[hnd].major_version < 2)
+    {
+      /*  Try to determine the correct record size since it was different when written on 32 vs 64 bit.  */
+
+
+      binaryFeatureData_seek (hnd, bfdh[hnd].fp, 0, SEEK_END);
+      eof = ftell (bfdh[hnd].fp);
+      binaryFeatureData_seek (hnd, bfdh[hnd].fp, 0, SEEK_SET);
+
+      eof -= bfdh[hnd].header_size;
+      bfdh[hnd].record_size = NINT ((float) eof / (float) bfdh[hnd].header.number_of_records);
+
+      if (bfdh[hnd].record_size != sizeof (BFDATA_RECORD))
+        {
+	  /*  Record size of 544 was written on a 32 bit system.  */
+
+	  if (bfdh[hnd].record_size == 544)
+	    {
+	      fprintf (stderr, "\n\nBig problem!  Pre 2.00 file written on 32 bit system.\n");
+	      fprintf (stderr, "The easiest solution is to log in to a 32 bit system and run\n");
+	      fprintf (stderr, "bfd2miw then miw2bfd.  This will convert the file to BFD 2.0 format.\n\n\n");
+	    }
+	  else
+	    {
+	      fprintf (stderr, "\n\nBig problem!  Pre 2.00 file written on 64 bit system.\n");
+	      fprintf (stderr, "The easiest solution is to log in to a 64 bit system and run\n");
+	      fprintf (stderr, "bfd2miw then miw2bfd.  This will convert the file to BFD 2.0 format.\n\n\n");
+	    }
+	  exit (-1);
+        }
+    }
+
+
+  binaryFeatureData_compute_field_offsets (hnd);
+  binaryFeatureData_select_codec (hnd);
+
+
+  bfdh[hnd].modified = 0;
+  bfdh[hnd].created = 0;
+  bfdh[hnd].write = 0;
+  bfdh[hnd].read_only = (mode == BFDATA_READONLY);
+
+
+  binaryFeatureData_inv_cvtime (year[0] - 1900, jday[0], hour[0], minute[0], second[0], &bfdh[hnd].header.creation_tv_sec,
+                  &bfdh[hnd].header.creation_tv_nsec);
+
+  binaryFeatureData_inv_cvtime (year[1] - 1900, jday[1], hour[1], minute[1], second[1], &bfdh[hnd].header.modification_tv_sec,
+                  &bfdh[hnd].header.modification_tv_nsec);
+
+
+  /*  If we're opening for update and a journal was left behind by an unclean shutdown, replay it.  This has to come
+      after the header times are set since the replay rewrites the header.  */
+
+  strcpy (bfdh[hnd].j_path, path);
+  sprintf (&bfdh[hnd].j_path[strlen (bfdh[hnd].j_path) - 3], "bfj");
+
+
+  /*  The polygon bounds file is only loaded when it's needed.  It has to have the record count we have now.  */
+
+  strcpy (bfdh[hnd].b_path, path);
+  sprintf (&bfdh[hnd].b_path[strlen (bfdh[hnd].b_path) - 3], "bfb");
+  bfdh[hnd].bounds_count = bfdh[hnd].header.number_of_records;
+
+  if (!bfdh[hnd].read_only)
+    {
+      if (binaryFeatureData_replay_journal (hnd) < 0) return (binaryFeatureData_abandon_open (hnd, bfd_error.bfd));
+    }
+
+
+  *bfd_header = bfdh[hnd].header;
+
+
+  bfd_error.system = 0;
+  return (hnd);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_open_file
+
+ - Purpose:     Open a BFD file.
+
+ - Author:      Jan C. Depner (area.based.editor@gmail.com)
+
+ - Date:        03/25/09
+
+ - Arguments:
+                - path           =    The BFD file path
+                - bfd_header     =    BFDATA_HEADER structure to be populated
+                - mode           =    BFDATA_UPDATE or BFDATA_READ_ONLY
+
+ - Returns:
+                - The file handle (0 or positive) or
+                - BFDATA_TOO_MANY_OPEN_FILES
+                - BFDATA_OPEN_UPDATE_ERROR
+                - BFDATA_OPEN_POLY_UPDATE_ERROR
+                - BFDATA_OPEN_READONLY_ERROR
+                - BFDATA_OPEN_POLY_READONLY_ERROR
+                - BFDATA_NOT_BFD_FILE_ERROR
+
+*********************************************************************************************/
+
+BFDATA_DLL int32_t binaryFeatureData_open_file (const char *path, BFDATA_HEADER *bfd_header, int32_t mode)
+{
+  INTERNAL_BFDATA_OPERATION operation;
+  int32_t status;
+
+
+  if (!instrumented) return (binaryFeatureData_do_open_file (path, bfd_header, mode));
+
+  binaryFeatureData_begin_operation (&operation, BFDATA_OPERATION_OPEN, -1, -1);
+
+  status = binaryFeatureData_do_open_file (path, bfd_header, mode);
+
+  binaryFeatureData_end_operation (&operation, status);
+
+  return (status);
+}
+
+
+
+/*  binaryFeatureData_close_file without the statistics and tracing (see below).  */
+
+static int32_t binaryFeatureData_do_close_file (int32_t hnd)
+{
+  time_t t;
+  int32_t status = BFDATA_SUCCESS;
+
+
+  /*  Just in case we've already closed this file.  */
+
+  if (bfdh[hnd].fp == NULL) return (bfd_error.bfd = BFDATA_SUCCESS);
+
+
+  /*  From here on a failure doesn't stop us.  We still close the files and free the handle, we just return the first
+      error at the end.  */
+
+  if (binaryFeatureData_flush_append (hnd) < 0) status = bfd_error.bfd;
+
+
+  if (bfdh[hnd].modified)
+    {
+      bfdh[hnd].header.modification_tv_sec = time (&t);
+      bfdh[hnd].header.modification_tv_nsec = 0;
+    }
+
+  if (bfdh[hnd].created)
+    {
+      bfdh[hnd].header.creation_tv_sec = time (&t);
+      bfdh[hnd].header.creation_tv_nsec = 0;
+    }
+
+
+  /*  If the append buffer didn't make it out the header's record count would include records that aren't there so we
+      leave the old header (and the journal, below) alone.  */
+
+  if ((bfdh[hnd].created || bfdh[hnd].modified) && status == BFDATA_SUCCESS)
+    {
+      /*  If we've kept the bounds of every polygon save them for the next open.  This gives the header a new
+          [BOUNDS STAMP].  Staged records would be thrown away so not if there's an open transaction.  */
+
+      if (!bfdh[hnd].bounds_stamp && !bfdh[hnd].transaction && bfdh[hnd].poly_bounds_valid &&
+          bfdh[hnd].poly_bounds_count == bfdh[hnd].header.number_of_records) binaryFeatureData_save_bounds (hnd);
+
+      if (binaryFeatureData_write_header (hnd) < 0) status = BFDATA_HEADER_WRITE_ERROR;
+    }
+
+
+  /*  Make sure the data gets where it's going if the caller asked for it.  The associated file goes first so that the
+      BFD file never points at polygons or images that didn't make it to disk.  */
+
+  switch (bfdh[hnd].durability)
+    {
+    case BFDATA_DURABILITY_FLUSH:
+      if ((fflush (bfdh[hnd].afp) || fflush (bfdh[hnd].fp)) && status == BFDATA_SUCCESS)
+        {
+          bfd_error.system = errno;
+          strcpy (bfd_error.file, bfdh[hnd].path);
+          status = BFDATA_SYNC_ERROR;
+        }
+      break;
+
+    case BFDATA_DURABILITY_DATASYNC:
+    case BFDATA_DURABILITY_GROUP:
+      if (binaryFeatureData_sync_stream (bfdh[hnd].afp))
+        {
+          if (status == BFDATA_SUCCESS)
+            {
+              bfd_error.system = errno;
+              strcpy (bfd_error.file, bfdh[hnd].a_path);
+              status = BFDATA_SYNC_ERROR;
+            }
+        }
+      else if (binaryFeatureData_sync_stream (bfdh[hnd].fp) && status == BFDATA_SUCCESS)
+        {
+          bfd_error.system = errno;
+          strcpy (bfd_error.file, bfdh[hnd].path);
+          status = BFDATA_SYNC_ERROR;
+        }
+      break;
+    }
+
+
+  /*  If we're journaling, everything has to be on disk before we can throw the journal away.  If it isn't we leave the
+      journal so that the next binaryFeatureData_open_file can replay it.  */
+
+  if (bfdh[hnd].jfp != NULL)
+    {
+      if (status == BFDATA_SUCCESS && bfdh[hnd].durability != BFDATA_DURABILITY_DATASYNC &&
+          bfdh[hnd].durability != BFDATA_DURABILITY_GROUP)
+        {
+          if (binaryFeatureData_sync_stream (bfdh[hnd].afp) || binaryFeatureData_sync_stream (bfdh[hnd].fp))
+            {
+              bfd_error.system = errno;
+              strcpy (bfd_error.file, bfdh[hnd].path);
+              status = BFDATA_SYNC_ERROR;
+            }
+        }
+
+      fclose (bfdh[hnd].jfp);
+      if (status == BFDATA_SUCCESS) remove (bfdh[hnd].j_path);
+    }
+
+
+  /*  The first error is the one we report.  */
+
+  if (fclose (bfdh[hnd].fp) && status == BFDATA_SUCCESS)
+    {
+      bfd_error.system = errno;
+      strcpy (bfd_error.file, bfdh[hnd].path);
+      status = BFDATA_CLOSE_ERROR;
+    }
+
+
+  if (fclose (bfdh[hnd].afp) && status == BFDATA_SUCCESS)
+    {
+      bfd_error.system = errno;
+      strcpy (bfd_error.file, bfdh[hnd].a_path);
+      status = BFDATA_CLOSE_POLY_ERROR;
+    }
+
+
+  /*  Clear up the short_feature memory if it was allocated.  */
+
+  if (bfdh[hnd].short_feature != NULL) free (bfdh[hnd].short_feature);
+
+
+  /*  An unfinished transaction is just thrown away.  */
+
+  if (bfdh[hnd].staged != NULL) free (bfdh[hnd].staged);
+  if (bfdh[hnd].staged_data != NULL) free (bfdh[hnd].staged_data);
+
+
+  /*  The append buffers were flushed above.  */
+
+  if (bfdh[hnd].append_records != NULL) free (bfdh[hnd].append_records);
+  if (bfdh[hnd].append_data != NULL) free (bfdh[hnd].append_data);
+  if (bfdh[hnd].ra_buffer != NULL) free (bfdh[hnd].ra_buffer);
+  if (bfdh[hnd].image_hash != NULL) free (bfdh[hnd].image_hash);
+  if (bfdh[hnd].poly_buffer != NULL) free (bfdh[hnd].poly_buffer);
+  if (bfdh[hnd].lod_buffer != NULL) free (bfdh[hnd].lod_buffer);
+  if (bfdh[hnd].lod_poly != NULL) free (bfdh[hnd].lod_poly);
+  if (bfdh[hnd].poly_meta != NULL) free (bfdh[hnd].poly_meta);
+  if (bfdh[hnd].poly_bounds != NULL) free (bfdh[hnd].poly_bounds);
+  if (bfdh[hnd].query_lat != NULL) free (bfdh[hnd].query_lat);
+  if (bfdh[hnd].query_lon != NULL) free (bfdh[hnd].query_lon);
+  if (bfdh[hnd].query_vertex != NULL) free (bfdh[hnd].query_vertex);
+  if (bfdh[hnd].grid_start != NULL) free (bfdh[hnd].grid_start);
+  if (bfdh[hnd].grid_record != NULL) free (bfdh[hnd].grid_record);
+  if (bfdh[hnd].query_mark != NULL) free (bfdh[hnd].query_mark);
+  if (bfdh[hnd].hit_index != NULL) free (bfdh[hnd].hit_index);
+  if (bfdh[hnd].hit_record != NULL) free (bfdh[hnd].hit_record);
+  if (bfdh[hnd].hit_distance != NULL) free (bfdh[hnd].hit_distance);
+  if (bfdh[hnd].kd_point != NULL) free (bfdh[hnd].kd_point);
+  if (bfdh[hnd].neighbor != NULL) free (bfdh[hnd].neighbor);
+
+
+  /*  Save the I/O total for the close trace event (see binaryFeatureData_end_operation).  */
+
+  closed_io = binaryFeatureData_io_bytes (hnd);
+
+
+  /*  Clear the internal structure.  */
+
+  memset (&bfdh[hnd], 0, sizeof (INTERNAL_BFDATA_STRUCT));
+  bfdh[hnd].fp = NULL;
+  bfdh[hnd].afp = NULL;
+  bfdh[hnd].short_feature = NULL;
+
+
+  if (status < 0) return (bfd_error.bfd = status);
+
+
+  bfd_error.system = 0;
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_close_file
+
+ - Purpose:     Close a BFD file.
+
+ - Author:      Jan C. Depner (area.based.editor@gmail.com)
+
+ - Date:        03/27/09
+
+ - Arguments:   hnd            =    The file handle
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_CLOSE_ERROR
+                - BFDATA_CLOSE_POLY_ERROR
+
+*********************************************************************************************/
+
+BFDATA_DLL int32_t binaryFeatureData_close_file (int32_t hnd)
+{
+  INTERNAL_BFDATA_OPERATION operation;
+  int32_t status;
+
+
+  if (!instrumented) return (binaryFeatureData_do_close_file (hnd));
+
+  binaryFeatureData_begin_operation (&operation, BFDATA_OPERATION_CLOSE, hnd, -1);
+
+  status = binaryFeatureData_do_close_file (hnd);
+
+  binaryFeatureData_end_operation (&operation, status);
+
+  return (status);
+}
+
+
+
+
+/*  binaryFeatureData_read_record without the statistics and tracing (see below).  */
+
+static int32_t binaryFeatureData_do_read_record (int32_t hnd, int32_t recnum, BFDATA_RECORD *bfd_record)
+{
+  uint8_t buffer[sizeof (BFDATA_RECORD)];
+  const uint8_t *raw;
+  uint32_t rec;
+
+
+  /*  Appended records may still be sitting in the append buffer.  */
+
+  if (binaryFeatureData_flush_append (hnd) < 0) return (bfd_error.bfd);
+
+
+  if (recnum < BFDATA_NEXT_RECORD || (recnum != BFDATA_NEXT_RECORD && (uint32_t) recnum >= bfdh[hnd].header.number_of_records))
+    {
+      bfd_error.recnum = recnum;
+      strcpy (bfd_error.file, bfdh[hnd].path);
+      return (bfd_error.bfd = BFDATA_INVALID_RECORD_NUMBER);
+    }
+
+  if (recnum == BFDATA_NEXT_RECORD)
+    {
+      if (bfdh[hnd].recnum >= bfdh[hnd].header.number_of_records)
+        {
+          bfd_error.recnum = bfdh[hnd].recnum;
+          strcpy (bfd_error.file, bfdh[hnd].path);
+          return (bfd_error.bfd = BFDATA_END_OF_FILE);
+        }
+
+      rec = bfdh[hnd].recnum;
+    }
+  else
+    {
+      rec = recnum;
+
+      bfdh[hnd].recnum = recnum;
+    }
+
+
+  if ((raw = binaryFeatureData_fetch_record (hnd, rec, buffer, 0)) == NULL) return (bfd_error.bfd);
+
+  binaryFeatureData_decode_record (hnd, raw, bfd_record);
+
+
+  bfd_record->record_number = bfdh[hnd].recnum;
+
+
+  bfdh[hnd].write = 0;
+
+
+  bfdh[hnd].last_rec = bfdh[hnd].recnum;
+  bfdh[hnd].record = *bfd_record;
+
+
+  bfdh[hnd].recnum++;
+
+
+  bfd_error.system = 0;
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_read_record
+
+ - Purpose:     Retrieve a BFD point from a BFD file.
+
+ - Author:      Jan C. Depner (area.based.editor@gmail.com)
+
+ - Date:        03/25/09
+
+ - Arguments:
+                - hnd            =    The file handle
+                - recnum         =    The record number of the BFD record to be retrieved (or
+                                      BFDATA_NEXT_RECORD)
+                - bfd_record     =    The returned BFDATA_RECORD structure
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_INVALID_RECORD_NUMBER
+                - BFDATA_RECORD_READ_FSEEK_ERROR
+                - BFDATA_RECORD_READ_ERROR
+                - BFDATA_END_OF_FILE
+
+ - Caveats:     Once a few records have been read in order (with BFDATA_NEXT_RECORD or
+                with increasing record numbers) records are read from the file
+                BFDATA_READ_AHEAD_SIZE bytes at a time and handed out from memory.
+
+*********************************************************************************************/
+
+BFDATA_DLL int32_t binaryFeatureData_read_record (int32_t hnd, int32_t recnum, BFDATA_RECORD *bfd_record)
+{
+  INTERNAL_BFDATA_OPERATION operation;
+  int32_t status;
+
+
+  if (!instrumented) return (binaryFeatureData_do_read_record (hnd, recnum, bfd_record));
+
+  binaryFeatureData_begin_operation (&operation, BFDATA_OPERATION_READ_RECORD, hnd, recnum);
+
+  status = binaryFeatureData_do_read_record (hnd, recnum, bfd_record);
+
+  binaryFeatureData_end_operation (&operation, status);
+
+  return (status);
+}
+
+
+
+
+/*  binaryFeatureData_read_record_fields without the statistics and tracing (see below).  */
+
+static int32_t binaryFeatureData_do_read_record_fields (int32_t hnd, int32_t recnum, uint32_t mask, BFDATA_RECORD *bfd_record)
+{
+  uint8_t buffer[sizeof (BFDATA_RECORD)];
+  const uint8_t *raw;
+  uint32_t rec;
+
+
+  /*  The whole record also keeps the polygon and image reads from having to read it again.  */
+
+  if ((mask & BFDATA_ALL_FIELDS) == BFDATA_ALL_FIELDS) return (binaryFeatureData_do_read_record (hnd, recnum, bfd_record));
+
+
+  if (binaryFeatureData_flush_append (hnd) < 0) return (bfd_error.bfd);
+
+
+  if (recnum < BFDATA_NEXT_RECORD || (recnum != BFDATA_NEXT_RECORD && (uint32_t) recnum >= bfdh[hnd].header.number_of_records))
+    {
+      bfd_error.recnum = recnum;
+      strcpy (bfd_error.file, bfdh[hnd].path);
+      return (bfd_error.bfd = BFDATA_INVALID_RECORD_NUMBER);
+    }
+
+  if (recnum == BFDATA_NEXT_RECORD)
+    {
+      if (bfdh[hnd].recnum >= bfdh[hnd].header.number_of_records)
+        {
+          bfd_error.recnum = bfdh[hnd].recnum;
+          strcpy (bfd_error.file, bfdh[hnd].path);
+          return (bfd_error.bfd = BFDATA_END_OF_FILE);
+        }
+
+      rec = bfdh[hnd].recnum;
+    }
+  else
+    {
+      rec = recnum;
+    }
+
+
+  if ((raw = binaryFeatureData_fetch_record (hnd, rec, buffer, 0)) == NULL) return (bfd_error.bfd);
+
+  binaryFeatureData_decode_fields (hnd, raw, mask, bfd_record);
+
+  bfd_record->record_number = rec;
+
+
+  bfdh[hnd].write = 0;
+  bfdh[hnd].recnum = rec + 1;
+
+
+  bfd_error.system = 0;
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_read_record_fields
+
+ - Purpose:     Retrieve only some of the fields of a BFD record.  Only the fields in "mask"
+                are decoded from the on-disk record so, for instance, reading just the
+                position and depth doesn't copy any of the strings.
+
+ - Date:        10/19/26
+
+ - Arguments:
+                - hnd            =    The file handle
+                - recnum         =    The record number or BFDATA_NEXT_RECORD
+                - mask           =    Fields to read (BFDATA_FIELD_MASK values or'ed
+                                      together, or BFDATA_ALL_FIELDS)
+                - bfd_record     =    The record.  Only the record_number and the fields
+                                      in mask are set, the rest are left alone.
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_INVALID_RECORD_NUMBER
+                - BFDATA_END_OF_FILE
+                - BFDATA_RECORD_READ_FSEEK_ERROR
+                - BFDATA_RECORD_READ_ERROR
+
+*********************************************************************************************/
+
+BFDATA_DLL int32_t binaryFeatureData_read_record_fields (int32_t hnd, int32_t recnum, uint32_t mask, BFDATA_RECORD *bfd_record)
+{
+  INTERNAL_BFDATA_OPERATION operation;
+  int32_t status;
+
+
+  if (!instrumented) return (binaryFeatureData_do_read_record_fields (hnd, recnum, mask, bfd_record));
+
+  binaryFeatureData_begin_operation (&operation, BFDATA_OPERATION_READ_RECORD, hnd, recnum);
+
+  status = binaryFeatureData_do_read_record_fields (hnd, recnum, mask, bfd_record);
+
+  binaryFeatureData_end_operation (&operation, status);
+
+  return (status);
+}
+
+
+
+
+/*  binaryFeatureData_read_record_range without the statistics and tracing (see below).  */
+
+static int32_t binaryFeatureData_do_read_record_range (int32_t hnd, uint32_t start, uint32_t count, uint32_t mask, BFDATA_RECORD *bfd_record)
+{
+  uint8_t buffer[sizeof (BFDATA_RECORD)];
+  const uint8_t *raw;
+  uint32_t i;
+
+
+  if (binaryFeatureData_flush_append (hnd) < 0) return (bfd_error.bfd);
+
+
+  if (start > bfdh[hnd].header.number_of_records || count > bfdh[hnd].header.number_of_records - start)
+    {
+      bfd_error.recnum = start;
+      strcpy (bfd_error.file, bfdh[hnd].path);
+      return (bfd_error.bfd = BFDATA_INVALID_RECORD_NUMBER);
+    }
+
+
+  for (i = 0 ; i < count ; i++)
+    {
+      if ((raw = binaryFeatureData_fetch_record (hnd, start + i, buffer, 1)) == NULL) return (bfd_error.bfd);
+
+      binaryFeatureData_decode_fields (hnd, raw, mask, &bfd_record[i]);
+
+      bfd_record[i].record_number = start + i;
+    }
+
+
+  bfdh[hnd].write = 0;
+  bfdh[hnd].recnum = start + count;
+
+
+  bfd_error.system = 0;
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_read_record_range
+
+ - Purpose:     Retrieve some (or all) of the fields of a range of BFD records.  The
+                records are read in big blocks and only the fields in "mask" are decoded.
+
+ - Date:        10/19/26
+
+ - Arguments:
+                - hnd            =    The file handle
+                - start          =    The first record number
+                - count          =    Number of records
+                - mask           =    Fields to read (BFDATA_FIELD_MASK values or'ed
+                                      together, or BFDATA_ALL_FIELDS)
+                - bfd_record     =    Array of count records.  Only the record_number and
+                                      the fields in mask are set, the rest are left alone.
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_INVALID_RECORD_NUMBER
+                - BFDATA_RECORD_READ_FSEEK_ERROR
+                - BFDATA_RECORD_READ_ERROR
+
+*********************************************************************************************/
+
+BFDATA_DLL int32_t binaryFeatureData_read_record_range (int32_t hnd, uint32_t start, uint32_t count, uint32_t mask, BFDATA_RECORD *bfd_record)
+{
+  INTERNAL_BFDATA_OPERATION operation;
+  int32_t status;
+
+
+  if (!instrumented) return (binaryFeatureData_do_read_record_range (hnd, start, count, mask, bfd_record));
+
+  binaryFeatureData_begin_operation (&operation, BFDATA_OPERATION_READ_RECORD, hnd, (int32_t) start);
+
+  status = binaryFeatureData_do_read_record_range (hnd, start, count, mask, bfd_record);
+
+  binaryFeatureData_end_operation (&operation, status);
+
+  return (status);
+}
+
+
+
+
+/*  binaryFeatureData_read_all_short_features without the statistics and tracing (see below).  */
+
+static int32_t binaryFeatureData_do_read_all_short_features (int32_t hnd, BFDATA_SHORT_FEATURE **bfd_feature)
+{
+  uint32_t i;
+  BFDATA_RECORD bfd_record;
+  BFDATA_SHORT_FEATURE *short_feature;
+
+
+  short_feature = (BFDATA_SHORT_FEATURE *) realloc (bfdh[hnd].short_feature, bfdh[hnd].header.number_of_records * sizeof (BFDATA_SHORT_FEATURE));
+
+  if (short_feature == NULL && bfdh[hnd].header.number_of_records)
+    {
+      bfd_error.system = errno;
+      strcpy (bfd_error.file, bfdh[hnd].path);
+      return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
+    }
+
+  bfdh[hnd].short_feature = short_feature;
+
+  for (i = 0 ; i < bfdh[hnd].header.number_of_records ; i++)
+    {
+      if (binaryFeatureData_do_read_record (hnd, (int32_t) i, &bfd_record) < 0) return (bfd_error.bfd);
+
+      bfdh[hnd].short_feature[i].record_number = i;
+      bfdh[hnd].short_feature[i].feature_type = bfd_record.feature_type;
+      bfdh[hnd].short_feature[i].event_tv_sec = bfd_record.event_tv_sec;
+      bfdh[hnd].short_feature[i].event_tv_nsec = bfd_record.event_tv_nsec;
+      bfdh[hnd].short_feature[i].latitude = bfd_record.latitude;
+      bfdh[hnd].short_feature[i].longitude = bfd_record.longitude;
+      bfdh[hnd].short_feature[i].depth = bfd_record.depth;
+      bfdh[hnd].short_feature[i].confidence_level = bfd_record.confidence_level;
+      strcpy (bfdh[hnd].short_feature[i].description, bfd_record.description);
+      strcpy (bfdh[hnd].short_feature[i].remarks, bfd_record.remarks);
+      bfdh[hnd].short_feature[i].poly_count = bfd_record.poly_count;
+      bfdh[hnd].short_feature[i].poly_type = bfd_record.poly_type;
+      bfdh[hnd].short_feature[i].parent_record = bfd_record.parent_record;
+      bfdh[hnd].short_feature[i].child_record = bfd_record.child_record;
+    }
+
+
+  *bfd_feature = bfdh[hnd].short_feature;
+
+
+  bfdh[hnd].write = 0;
+
+
+  bfd_error.system = 0;
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_read_all_short_features
+
+ - Purpose:     Reads all BFD records in a file, allocates memory for them, and returns the 
+                allocated array to the caller.  Memory will be cleaned up on bfd_file_close.
+
+ - Author:      Jan C. Depner (area.based.editor@gmail.com)
+
+ - Date:        03/25/09
+
+ - Arguments:
+                - hnd            =    The file handle
+                - bfd_feature    =    The returned array of BFDATA_SHORT_FEATURE structures.
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_INVALID_RECORD_NUMBER
+                - BFDATA_READ_FSEEK_ERROR
+                - BFDATA_END_OF_FILE
+                - BFDATA_MEMORY_ALLOCATION_ERROR
+
+*********************************************************************************************/
+
+BFDATA_DLL int32_t binaryFeatureData_read_all_short_features (int32_t hnd, BFDATA_SHORT_FEATURE **bfd_feature)
+{
+  INTERNAL_BFDATA_OPERATION operation;
+  int32_t status;
+
+
+  if (!instrumented) return (binaryFeatureData_do_read_all_short_features (hnd, bfd_feature));
+
+  binaryFeatureData_begin_operation (&operation, BFDATA_OPERATION_READ_SHORT_FEATURES, hnd, -1);
+
+  status = binaryFeatureData_do_read_all_short_features (hnd, bfd_feature);
+
+  binaryFeatureData_end_operation (&operation, status);
+
+  return (status);
+}
+
+
+
+/*!  Copy string field "field" of "bfd_record" to "text" (at least 129 bytes) with a terminating NULL.  Returns 0 if the
+     field isn't a string.  */
+
+static uint8_t binaryFeatureData_field_string (const BFDATA_RECORD *bfd_record, int32_t field, char *text)
+{
+  const char *string;
+  size_t size;
+
+
+  switch (field)
+    {
+    case BFDATA_FIELD_CONTACT_ID:
+      string = bfd_record->contact_id;
+      size = sizeof (bfd_record->contact_id);
+      break;
+
+    case BFDATA_FIELD_DESCRIPTION:
+      string = bfd_record->description;
+      size = sizeof (bfd_record->description);
+      break;
+
+    case BFDATA_FIELD_REMARKS:
+      string = bfd_record->remarks;
+      size = sizeof (bfd_record->remarks);
+      break;
+
+    case BFDATA_FIELD_ANALYST_ACTIVITY:
+      string = bfd_record->analyst_activity;
+      size = sizeof (bfd_record->analyst_activity);
+      break;
+
+    case BFDATA_FIELD_IMAGE_NAME:
+      string = bfd_record->image_name;
+      size = sizeof (bfd_record->image_name);
+      break;
+
+    default:
+      return (0);
+    }
+
+
+  /*  The strings aren't necessarily terminated on disk.  */
+
+  for (; size && *string ; size--) *text++ = *string++;
+  *text = 0;
+
+
+  return (1);
+}
+
+
+
+/*!  Value of numeric field "field" of "bfd_record".  */
+
+static double binaryFeatureData_field_value (const BFDATA_RECORD *bfd_record, int32_t field)
+{
+  switch (field)
+    {
+    case BFDATA_FIELD_FEATURE_TYPE: return ((double) bfd_record->feature_type);
+    case BFDATA_FIELD_EVENT_TV_SEC: return ((double) bfd_record->event_tv_sec);
+    case BFDATA_FIELD_EVENT_TV_NSEC: return ((double) bfd_record->event_tv_nsec);
+    case BFDATA_FIELD_LATITUDE: return (bfd_record->latitude);
+    case BFDATA_FIELD_LONGITUDE: return (bfd_record->longitude);
+    case BFDATA_FIELD_LENGTH: return ((double) bfd_record->length);
+    case BFDATA_FIELD_WIDTH: return ((double) bfd_record->width);
+    case BFDATA_FIELD_HEIGHT: return ((double) bfd_record->height);
+    case BFDATA_FIELD_DEPTH: return ((double) bfd_record->depth);
+    case BFDATA_FIELD_DATUM: return ((double) bfd_record->datum);
+    case BFDATA_FIELD_HORIZONTAL_ORIENTATION: return ((double) bfd_record->horizontal_orientation);
+    case BFDATA_FIELD_VERTICAL_ORIENTATION: return ((double) bfd_record->vertical_orientation);
+    case BFDATA_FIELD_SONAR_TYPE: return ((double) bfd_record->sonar_type);
+    case BFDATA_FIELD_EQUIP_TYPE: return ((double) bfd_record->equip_type);
+    case BFDATA_FIELD_PLATFORM_TYPE: return ((double) bfd_record->platform_type);
+    case BFDATA_FIELD_NAV_SYSTEM: return ((double) bfd_record->nav_system);
+    case BFDATA_FIELD_HEADING: return ((double) bfd_record->heading);
+    case BFDATA_FIELD_CONFIDENCE_LEVEL: return ((double) bfd_record->confidence_level);
+    case BFDATA_FIELD_POLY_ADDRESS: return ((double) bfd_record->poly_address);
+    case BFDATA_FIELD_POLY_COUNT: return ((double) bfd_record->poly_count);
+    case BFDATA_FIELD_POLY_TYPE: return ((double) bfd_record->poly_type);
+    case BFDATA_FIELD_IMAGE_ADDRESS: return ((double) bfd_record->image_address);
+    case BFDATA_FIELD_IMAGE_SIZE: return ((double) bfd_record->image_size);
+    case BFDATA_FIELD_PARENT_RECORD: return ((double) bfd_record->parent_record);
+    case BFDATA_FIELD_CHILD_RECORD: return ((double) bfd_record->child_record);
+    }
+
+
+  return (0.0);
+}
+
+
+
+/*!  Make sure a scan predicate makes sense.  Returns 0 if it's bad.  */
+
+static uint8_t binaryFeatureData_check_predicate (int32_t count, const BFDATA_PREDICATE *predicate)
+{
+  BFDATA_RECORD bfd_record;
+  char text[129];
+  int32_t i;
+
+
+  if (count < 0 || (count && predicate == NULL)) return (0);
+
+  memset (&bfd_record, 0, sizeof (BFDATA_RECORD));
+
+  for (i = 0 ; i < count ; i++)
+    {
+      if (predicate[i].field < 0 || predicate[i].field >= BFDATA_FIELD_COUNT) return (0);
+
+      if (binaryFeatureData_field_string (&bfd_record, predicate[i].field, text))
+        {
+          if (predicate[i].string == NULL ||
+              (predicate[i].op != BFDATA_OP_EQ && predicate[i].op != BFDATA_OP_NE && predicate[i].op != BFDATA_OP_CONTAINS)) return (0);
+        }
+      else
+        {
+          if (predicate[i].op < BFDATA_OP_EQ || predicate[i].op > BFDATA_OP_GE) return (0);
+        }
+    }
+
+
+  return (1);
+}
+
+
+
+/*!  Test the on-disk record in "buffer" against a (checked) scan predicate.  Only the fields that the predicate uses
+     are decoded (into "scratch") and we quit at the first term that fails.  */
+
+static uint8_t binaryFeatureData_match_predicate (int32_t hnd, const uint8_t *buffer, int32_t count, const BFDATA_PREDICATE *predicate,
+                                                  BFDATA_RECORD *scratch)
+{
+  char text[129];
+  double value;
+  int32_t i, cmp;
+
+
+  for (i = 0 ; i < count ; i++)
+    {
+      binaryFeatureData_decode_field (hnd, buffer, predicate[i].field, scratch);
+
+      if (binaryFeatureData_field_string (scratch, predicate[i].field, text))
+        {
+          if (predicate[i].op == BFDATA_OP_CONTAINS)
+            {
+              if (strstr (text, predicate[i].string) == NULL) return (0);
+            }
+          else
+            {
+              cmp = strcmp (text, predicate[i].string);
+
+              if ((predicate[i].op == BFDATA_OP_EQ) != (cmp == 0)) return (0);
+            }
+        }
+      else
+        {
+          value = binaryFeatureData_field_value (scratch, predicate[i].field);
+
+          switch (predicate[i].op)
+            {
+            case BFDATA_OP_EQ:
+              if (!(value == predicate[i].value)) return (0);
+              break;
+
+            case BFDATA_OP_NE:
+              if (!(value != predicate[i].value)) return (0);
+              break;
+
+            case BFDATA_OP_LT:
+              if (!(value < predicate[i].value)) return (0);
+              break;
+
+            case BFDATA_OP_LE:
+              if (!(value <= predicate[i].value)) return (0);
+              break;
+
+            case BFDATA_OP_GT:
+              if (!(value > predicate[i].value)) return (0);
+              break;
+
+            case BFDATA_OP_GE:
+              if (!(value >= predicate[i].value)) return (0);
+              break;
+            }
+        }
+    }
+
+
+  return (1);
+}
+
+
+
+
+/*  binaryFeatureData_scan_fields without the statistics and tracing (see below).  */
+
+static int32_t binaryFeatureData_do_scan_fields (int32_t hnd, uint32_t *recnum, int32_t count, const BFDATA_PREDICATE *predicate,
+                                                 uint32_t mask, BFDATA_RECORD *bfd_record)
+{
+  BFDATA_RECORD scratch;
+  uint8_t buffer[sizeof (BFDATA_RECORD)];
+  const uint8_t *raw;
+  uint32_t rec;
+
+
+  if (!binaryFeatureData_check_predicate (count, predicate))
+    {
+      bfd_error.system = 0;
+      strcpy (bfd_error.file, bfdh[hnd].path);
+      return (bfd_error.bfd = BFDATA_INVALID_PREDICATE);
+    }
+
+
+  /*  Appended records may still be sitting in the append buffer.  */
+
+  if (binaryFeatureData_flush_append (hnd) < 0) return (bfd_error.bfd);
+
+
+  for (rec = *recnum ; rec < bfdh[hnd].header.number_of_records ; rec++)
+    {
+      if ((raw = binaryFeatureData_fetch_record (hnd, rec, buffer, 1)) == NULL) return (bfd_error.bfd);
+
+      if (binaryFeatureData_match_predicate (hnd, raw, count, predicate, &scratch))
+        {
+          *recnum = rec + 1;
+
+          if ((mask & BFDATA_ALL_FIELDS) == BFDATA_ALL_FIELDS) return (binaryFeatureData_do_read_record (hnd, rec, bfd_record));
+
+          binaryFeatureData_decode_fields (hnd, raw, mask, bfd_record);
+          bfd_record->record_number = rec;
+
+          bfd_error.system = 0;
+          return (bfd_error.bfd = BFDATA_SUCCESS);
+        }
+    }
+
+  *recnum = rec;
+
+
+  bfd_error.recnum = rec;
+  strcpy (bfd_error.file, bfdh[hnd].path);
+  return (bfd_error.bfd = BFDATA_END_OF_FILE);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_scan_fields
+
+ - Purpose:     Find the next record that matches a predicate.  The predicate is a list of
+                terms (field, comparison, value) that all have to be true.  Records are
+                tested straight from the on-disk bytes, decoding only the fields used by the
+                predicate, and only the fields in "mask" of the matching records are decoded.
+                To scan the whole file set *recnum to 0 and call this until it returns
+                BFDATA_END_OF_FILE.
+
+ - Date:        10/19/26
+
+ - Arguments:
+                - hnd            =    The file handle
+                - recnum         =    Record number to start at.  On success it's set to
+                                      the record after the match.
+                - count          =    Number of predicate terms (0 matches every record)
+                - predicate      =    The predicate terms.  String fields (contact_id,
+                                      description, remarks, analyst_activity, image_name)
+                                      can only be compared with BFDATA_OP_EQ, BFDATA_OP_NE,
+                                      or BFDATA_OP_CONTAINS.  BFDATA_FIELD_DEPTH is the
+                                      datum corrected depth.
+                - mask           =    Fields to return (BFDATA_FIELD_MASK values or'ed
+                                      together, or BFDATA_ALL_FIELDS)
+                - bfd_record     =    The matching record.  Only the record_number and the
+                                      fields in mask are set.
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_END_OF_FILE
+                - BFDATA_INVALID_PREDICATE
+                - BFDATA_RECORD_READ_FSEEK_ERROR
+                - BFDATA_RECORD_READ_ERROR
+
+ - Caveats:     With BFDATA_ALL_FIELDS this leaves the handle's current record set to the
+                match just like binaryFeatureData_read_record.
+
+*********************************************************************************************/
+
+BFDATA_DLL int32_t binaryFeatureData_scan_fields (int32_t hnd, uint32_t *recnum, int32_t count, const BFDATA_PREDICATE *predicate,
+                                                  uint32_t mask, BFDATA_RECORD *bfd_record)
+{
+  INTERNAL_BFDATA_OPERATION operation;
+  int32_t status;
+
+
+  if (!instrumented) return (binaryFeatureData_do_scan_fields (hnd, recnum, count, predicate, mask, bfd_record));
+
+  binaryFeatureData_begin_operation (&operation, BFDATA_OPERATION_SCAN, hnd, (int32_t) *recnum);
+
+  status = binaryFeatureData_do_scan_fields (hnd, recnum, count, predicate, mask, bfd_record);
+
+  binaryFeatureData_end_operation (&operation, status);
+
+  return (status);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_scan
+
+ - Purpose:     Find the next record that matches a predicate (see
+                binaryFeatureData_scan_fields).  Only the matching records are fully
+                decoded.
+
+ - Date:        10/19/26
+
+ - Arguments:
+                - hnd            =    The file handle
+                - recnum         =    Record number to start at.  On success it's set to
+                                      the record after the match.
+                - count          =    Number of predicate terms (0 matches every record)
+                - predicate      =    The predicate terms
+                - bfd_record     =    The matching record
+
+ - Returns:
+                - See binaryFeatureData_scan_fields
+
+*********************************************************************************************/
+
+BFDATA_DLL int32_t binaryFeatureData_scan (int32_t hnd, uint32_t *recnum, int32_t count, const BFDATA_PREDICATE *predicate,
+                                           BFDATA_RECORD *bfd_record)
+{
+  return (binaryFeatureData_scan_fields (hnd, recnum, count, predicate, BFDATA_ALL_FIELDS, bfd_record));
+}
+
+
+
+
+/*  binaryFeatureData_read_polygon without the statistics and tracing (see below).  */
+
+static int32_t binaryFeatureData_do_read_polygon (int32_t hnd, int32_t recnum, BFDATA_POLYGON *poly)
+{
+  int64_t size;
+
+
+  if (binaryFeatureData_flush_append (hnd) < 0) return (bfd_error.bfd);
+
+
+  if ((uint32_t) recnum != bfdh[hnd].last_rec)
+    {
+      if (binaryFeatureData_do_read_record (hnd, recnum, &bfdh[hnd].record) < 0) return (bfd_error.bfd);
+    }
+  else
+    {
+      bfdh[hnd].stats.last_rec_hits++;
+    }
+
+
+  if (!bfdh[hnd].record.poly_address)
+    {
+      bfd_error.recnum = recnum;
+      strcpy (bfd_error.file, bfdh[hnd].a_path);
+      return (bfd_error.bfd = BFDATA_NO_POLYGON_AVAILABLE);
+    }
+
+
+  if (binaryFeatureData_seek (hnd, bfdh[hnd].afp, bfdh[hnd].record.poly_address, SEEK_SET) < 0)
+    {
+      bfd_error.system = errno;
+      bfd_error.recnum = recnum;
+      strcpy (bfd_error.file, bfdh[hnd].a_path);
+      return (bfd_error.bfd = BFDATA_POLY_READ_FSEEK_ERROR);
+    }
+
+
+  /*  A delta encoded polygon is always smaller than the raw one so reading the raw size gets either one.  An encoded
+      polygon at the end of the file gives us a short read, which is fine.  */
+
+  size = (int64_t) bfdh[hnd].record.poly_count * 2 * sizeof (double);
+
+  if (!binaryFeatureData_poly_space (hnd, size))
+    {
+      bfd_error.system = errno;
+      bfd_error.recnum = recnum;
+      strcpy (bfd_error.file, bfdh[hnd].a_path);
+      return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
+    }
+
+  size = binaryFeatureData_read (hnd, bfdh[hnd].poly_buffer, 1, size, bfdh[hnd].afp);
+
+  if (!binaryFeatureData_decode_polygon (hnd, bfdh[hnd].record.poly_count, bfdh[hnd].poly_buffer, size, poly))
+    {
+      bfd_error.system = errno;
+      bfd_error.recnum = recnum;
+      strcpy (bfd_error.file, bfdh[hnd].a_path);
+      return (bfd_error.bfd = BFDATA_POLY_READ_ERROR);
+    }
+
+  bfdh[hnd].stats.polygons_read++;
+
+
+  bfdh[hnd].write = 0;
+
+
+  bfd_error.system = 0;
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_read_polygon
+
+ - Purpose:     Retrieve a BFD polygon structure for the given record.
+
+ - Author:      Jan C. Depner (area.based.editor@gmail.com)
+
+ - Date:        03/25/09
+
+ - Arguments:
+                - hnd            =    The file handle
+                - recnum         =    The record number of the BFD polygon to be retrieved
+                - poly           =    The BFDATA_POLYGON structure to hold the data.
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_NO_POLYGON_AVAILABLE
+                - BFDATA_INVALID_RECORD_NUMBER
+                - BFDATA_POLY_READ_FSEEK_ERROR
+                - BFDATA_POLY_READ_ERROR
+                - BFDATA_MEMORY_ALLOCATION_ERROR
+
+*********************************************************************************************/
+
+BFDATA_DLL int32_t binaryFeatureData_read_polygon (int32_t hnd, int32_t recnum, BFDATA_POLYGON *poly)
+{
+  INTERNAL_BFDATA_OPERATION operation;
+  int32_t status;
+
+
+  if (!instrumented) return (binaryFeatureData_do_read_polygon (hnd, recnum, poly));
+
+  binaryFeatureData_begin_operation (&operation, BFDATA_OPERATION_READ_POLYGON, hnd, recnum);
+
+  status = binaryFeatureData_do_read_polygon (hnd, recnum, poly);
+
+  binaryFeatureData_end_operation (&operation, status);
+
+  return (status);
+}
+
+
+
+/*!  Make sure the record for "recnum" is loaded, that it has an image, and position the .bfa file "offset" bytes into
+     the image.  Used by the image read functions.  */
+
+static int32_t binaryFeatureData_seek_image (int32_t hnd, int32_t recnum, uint32_t offset)
+{
+  if (binaryFeatureData_flush_append (hnd) < 0) return (bfd_error.bfd);
+
+
+  if ((uint32_t) recnum != bfdh[hnd].last_rec)
+    {
+      if (binaryFeatureData_do_read_record (hnd, recnum, &bfdh[hnd].record) < 0) return (bfd_error.bfd);
+    }
+  else
+    {
+      bfdh[hnd].stats.last_rec_hits++;
+    }
+
+
+  if (!bfdh[hnd].record.image_size)
+    {
+      bfd_error.recnum = recnum;
+      strcpy (bfd_error.file, bfdh[hnd].a_path);
+      return (bfd_error.bfd = BFDATA_NO_IMAGE_AVAILABLE);
+    }
+
+
+  if (offset > bfdh[hnd].record.image_size)
+    {
+      bfd_error.recnum = recnum;
+      strcpy (bfd_error.file, bfdh[hnd].a_path);
+      return (bfd_error.bfd = BFDATA_INVALID_IMAGE_RANGE);
+    }
+
+
+  if (binaryFeatureData_seek (hnd, bfdh[hnd].afp, bfdh[hnd].record.image_address + offset, SEEK_SET) < 0)
+    {
+      bfd_error.system = errno;
+      bfd_error.recnum = recnum;
+      strcpy (bfd_error.file, bfdh[hnd].a_path);
+      return (bfd_error.bfd = BFDATA_IMAGE_READ_FSEEK_ERROR);
+    }
+
+
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
+
+
+
+
+/*  binaryFeatureData_read_polygon_lod without the statistics and tracing (see below).  */
+
+static int32_t binaryFeatureData_do_read_polygon_lod (int32_t hnd, int32_t recnum, double tolerance, BFDATA_POLYGON *poly, uint32_t *count)
+{
+  const uint8_t *ptr;
+  uint32_t meta_size, length, levels, i, level_count, level_size, best_count = 0, best_size = 0;
+  uint64_t bits, back, best_back = 0;
+  double level_tolerance;
+  int64_t size;
+
+
+  if (binaryFeatureData_flush_append (hnd) < 0) return (bfd_error.bfd);
+
+
+  if ((uint32_t) recnum != bfdh[hnd].last_rec)
+    {
+      if (binaryFeatureData_do_read_record (hnd, recnum, &bfdh[hnd].record) < 0) return (bfd_error.bfd);
+    }
+  else
+    {
+      bfdh[hnd].stats.last_rec_hits++;
+    }
+
+
+  if (!bfdh[hnd].record.poly_address)
+    {
+      bfd_error.recnum = recnum;
+      strcpy (bfd_error.file, bfdh[hnd].a_path);
+      return (bfd_error.bfd = BFDATA_NO_POLYGON_AVAILABLE);
+    }
+
+
+  /*  The levels are stored in order of increasing tolerance so the last one that's good enough is the simplest.  */
+
+  if (tolerance > 0.0 && (meta_size = binaryFeatureData_read_poly_meta (hnd, bfdh[hnd].record.poly_address)) &&
+      (ptr = binaryFeatureData_find_poly_section (hnd, meta_size, BFDATA_POLY_SECTION_LOD, &length)) != NULL && length >= 8)
+    {
+      levels = binaryFeatureData_get_le32 (&ptr);
+      ptr += 4;
+
+      for (i = 0 ; i < levels && 8 + (i + 1) * 24 <= length ; i++)
+        {
+          bits = binaryFeatureData_get_le64 (&ptr);
+          memcpy (&level_tolerance, &bits, sizeof (double));
+          level_count = binaryFeatureData_get_le32 (&ptr);
+          level_size = binaryFeatureData_get_le32 (&ptr);
+          back = binaryFeatureData_get_le64 (&ptr);
+
+          if (level_tolerance > tolerance) break;
+
+          if (level_count && level_count <= BFDATA_POLY_ARRAY_SIZE && back <= (uint64_t) bfdh[hnd].record.poly_address)
+            {
+              best_count = level_count;
+              best_size = level_size;
+              best_back = back;
+            }
+        }
+    }
+
+
+  if (!best_count)
+    {
+      *count = bfdh[hnd].record.poly_count;
+      return (binaryFeatureData_do_read_polygon (hnd, recnum, poly));
+    }
+
+
+  if (!binaryFeatureData_poly_space (hnd, best_size))
+    {
+      bfd_error.system = errno;
+      bfd_error.recnum = recnum;
+      strcpy (bfd_error.file, bfdh[hnd].a_path);
+      return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
+    }
+
+  if (binaryFeatureData_seek (hnd, bfdh[hnd].afp, bfdh[hnd].record.poly_address - best_back, SEEK_SET) < 0)
+    {
+      bfd_error.system = errno;
+      bfd_error.recnum = recnum;
+      strcpy (bfd_error.file, bfdh[hnd].a_path);
+      return (bfd_error.bfd = BFDATA_POLY_READ_FSEEK_ERROR);
+    }
+
+  size = binaryFeatureData_read (hnd, bfdh[hnd].poly_buffer, 1, best_size, bfdh[hnd].afp);
+
+  if (!binaryFeatureData_decode_polygon (hnd, best_count, bfdh[hnd].poly_buffer, size, poly))
+    {
+      bfd_error.system = errno;
+      bfd_error.recnum = recnum;
+      strcpy (bfd_error.file, bfdh[hnd].a_path);
+      return (bfd_error.bfd = BFDATA_POLY_READ_ERROR);
+    }
+
+  *count = best_count;
+
+  bfdh[hnd].stats.polygons_read++;
+
+
+  bfdh[hnd].write = 0;
+
+
+  bfd_error.system = 0;
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_read_polygon_lod
+
+ - Purpose:     Retrieve the simplest stored version of the polygon for the given record that
+                is within "tolerance" of the original (see binaryFeatureData_set_polygon_lod).
+                If there isn't one (or the polygon was written without levels of detail) you
+                get the full polygon.
+
+ - Date:        10/19/26
+
+ - Arguments:
+                - hnd            =    The file handle
+                - recnum         =    The record number of the BFD polygon to be retrieved
+                - tolerance      =    Largest acceptable error in degrees (of latitude).  A
+                                      good choice is the size of a screen pixel in degrees.
+                - poly           =    The BFDATA_POLYGON structure to hold the data
+                - count          =    The number of points returned in poly
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_NO_POLYGON_AVAILABLE
+                - BFDATA_INVALID_RECORD_NUMBER
+                - BFDATA_POLY_READ_FSEEK_ERROR
+                - BFDATA_POLY_READ_ERROR
+                - BFDATA_MEMORY_ALLOCATION_ERROR
+
+*********************************************************************************************/
+
+BFDATA_DLL int32_t binaryFeatureData_read_polygon_lod (int32_t hnd, int32_t recnum, double tolerance, BFDATA_POLYGON *poly, uint32_t *count)
+{
+  INTERNAL_BFDATA_OPERATION operation;
+  int32_t status;
+
+
+  if (!instrumented) return (binaryFeatureData_do_read_polygon_lod (hnd, recnum, tolerance, poly, count));
+
+  binaryFeatureData_begin_operation (&operation, BFDATA_OPERATION_READ_POLYGON, hnd, recnum);
+
+  status = binaryFeatureData_do_read_polygon_lod (hnd, recnum, tolerance, poly, count);
+
+  binaryFeatureData_end_operation (&operation, status);
+
+  return (status);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_read_all_polygon_bounds
+
+ - Purpose:     Returns the bounding box of the polygon of every record in the file so that
+                applications can cull features against a view without reading any polygons.
+                The bounds are worked out as the polygons are written and saved on close in a
+                polygon bounds file next to the BFD file (the same name with a .bfb
+                extension).  The first call on a handle loads that file so the .bfa file isn't
+                touched.  If there isn't one that goes with the file the first call scans the
+                file instead: it reads every record and, for each record with a polygon, seeks
+                to and reads the polygon's trailer in the .bfa file (see
+                binaryFeatureData_build_trailer) to get its bounds.  Either way the bounds are
+                then kept up to date as records are written through this handle so later calls
+                (and binaryFeatureData_get_polygon_bounds) don't touch the files.  Records
+                without a polygon get a box around the feature position.  Memory will be
+                cleaned up on binaryFeatureData_close_file.
+
+ - Date:        10/19/26
+
+ - Arguments:
+                - hnd            =    The file handle
+                - bounds         =    The returned array of header.number_of_records
+                                      BFDATA_POLYGON_BOUNDS structures
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_INVALID_RECORD_NUMBER
+                - BFDATA_READ_FSEEK_ERROR
+                - BFDATA_END_OF_FILE
+                - BFDATA_POLY_READ_FSEEK_ERROR
+                - BFDATA_POLY_READ_ERROR
+                - BFDATA_MEMORY_ALLOCATION_ERROR
+
+ - Caveats:     Polygons written before version 3.11 of the library have no bounds in their
+                trailer so they have to be read (once) to compute them.  The polygon bounds
+                file is only saved by a handle that had the bounds of every record when it
+                was closed.  That's one that created the file, opened it when it had a bounds
+                file, or called this function.  Files last written by a version of the library
+                before 3.25 don't have one.
+
+*********************************************************************************************/
+
+BFDATA_DLL int32_t binaryFeatureData_read_all_polygon_bounds (int32_t hnd, BFDATA_POLYGON_BOUNDS **bounds)
+{
+  uint32_t i;
+  BFDATA_RECORD bfd_record;
+  BFDATA_POLYGON_BOUNDS *poly_bounds;
+
+
+  if (binaryFeatureData_flush_append (hnd) < 0) return (bfd_error.bfd);
+
+
+  /*  If we don't have them all, try the polygon bounds file before scanning.  */
+
+  if ((!bfdh[hnd].poly_bounds_valid || bfdh[hnd].poly_bounds_count != bfdh[hnd].header.number_of_records) &&
+      !(binaryFeatureData_load_bounds (hnd) && bfdh[hnd].poly_bounds_count == bfdh[hnd].header.number_of_records))
+    {
+      bfdh[hnd].poly_bounds_valid = 0;
+
+      if (bfdh[hnd].header.number_of_records > bfdh[hnd].poly_bounds_alloc)
+        {
+          poly_bounds = (BFDATA_POLYGON_BOUNDS *) realloc (bfdh[hnd].poly_bounds, bfdh[hnd].header.number_of_records *
+                                                           sizeof (BFDATA_POLYGON_BOUNDS));
+
+          if (poly_bounds == NULL)
+            {
+              bfd_error.system = errno;
+              strcpy (bfd_error.file, bfdh[hnd].path);
+              return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
+            }
+
+          bfdh[hnd].poly_bounds = poly_bounds;
+          bfdh[hnd].poly_bounds_alloc = bfdh[hnd].header.number_of_records;
+        }
+
+      for (i = 0 ; i < bfdh[hnd].header.number_of_records ; i++)
+        {
+          if (binaryFeatureData_do_read_record (hnd, i, &bfd_record) < 0) return (bfd_error.bfd);
+
+          if (binaryFeatureData_record_bounds (hnd, i, &bfd_record, &bfdh[hnd].poly_bounds[i]) < 0) return (bfd_error.bfd);
+        }
+
+      bfdh[hnd].poly_bounds_count = bfdh[hnd].header.number_of_records;
+      bfdh[hnd].poly_bounds_valid = 1;
+    }
+
+
+  *bounds = bfdh[hnd].poly_bounds;
+
+
+  bfdh[hnd].write = 0;
+
+
+  bfd_error.system = 0;
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_get_polygon_bounds
+
+ - Purpose:     Retrieve the bounding box of the polygon for the given record.  If the file
+                has a polygon bounds file (see binaryFeatureData_read_all_polygon_bounds) it is
+                loaded on the first call and this comes straight from memory, the same as
+                after binaryFeatureData_read_all_polygon_bounds has been called.  Otherwise
+                only the record and the small polygon trailer are read.
+
+ - Date:        10/19/26
+
+ - Arguments:
+                - hnd            =    The file handle
+                - recnum         =    The record number
+                - bounds         =    The returned bounding box (a box around the feature
+                                      position if the record has no polygon)
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_INVALID_RECORD_NUMBER
+                - BFDATA_READ_FSEEK_ERROR
+                - BFDATA_END_OF_FILE
+                - BFDATA_POLY_READ_FSEEK_ERROR
+                - BFDATA_POLY_READ_ERROR
+                - BFDATA_MEMORY_ALLOCATION_ERROR
+
+*********************************************************************************************/
+
+BFDATA_DLL int32_t binaryFeatureData_get_polygon_bounds (int32_t hnd, int32_t recnum, BFDATA_POLYGON_BOUNDS *bounds)
+{
+  if (!bfdh[hnd].poly_bounds_valid) binaryFeatureData_load_bounds (hnd);
+
+
+  /*  Staged (uncommitted) records are in the array but can't be read yet.  */
+
+  if (bfdh[hnd].poly_bounds_valid && recnum >= 0 && (uint32_t) recnum < bfdh[hnd].poly_bounds_count &&
+      (uint32_t) recnum < bfdh[hnd].header.number_of_records)
+    {
+      *bounds = bfdh[hnd].poly_bounds[recnum];
+
+      bfd_error.system = 0;
+      return (bfd_error.bfd = BFDATA_SUCCESS);
+    }
+
+
+  if (binaryFeatureData_flush_append (hnd) < 0) return (bfd_error.bfd);
+
+
+  if ((uint32_t) recnum != bfdh[hnd].last_rec)
+    {
+      if (binaryFeatureData_do_read_record (hnd, recnum, &bfdh[hnd].record) < 0) return (bfd_error.bfd);
+    }
+  else
+    {
+      bfdh[hnd].stats.last_rec_hits++;
+    }
+
+  if (binaryFeatureData_record_bounds (hnd, recnum, &bfdh[hnd].record, bounds) < 0) return (bfd_error.bfd);
+
+
+  bfdh[hnd].write = 0;
+
+
+  bfd_error.system = 0;
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
+
+
+
+/*!  Grid cell (row * grid_cols + col) of a point inside the query index extent.  */
+
+static uint32_t binaryFeatureData_grid_cell (int32_t hnd, double lat, double lon)
+{
+  uint32_t col, row;
+
+
+  col = (uint32_t) ((lon - bfdh[hnd].query_extent.min_longitude) / bfdh[hnd].grid_dlon);
+  row = (uint32_t) ((lat - bfdh[hnd].query_extent.min_latitude) / bfdh[hnd].grid_dlat);
+
+  if (col >= bfdh[hnd].grid_cols) col = bfdh[hnd].grid_cols - 1;
+  if (row >= bfdh[hnd].grid_rows) row = bfdh[hnd].grid_rows - 1;
+
+  return (row * bfdh[hnd].grid_cols + col);
+}
+
+
+
+/*!  Range of grid cells covered by a bounding box (clipped to the query index extent).  */
+
+static void binaryFeatureData_grid_cells (int32_t hnd, BFDATA_POLYGON_BOUNDS *bounds, uint32_t *col0, uint32_t *col1, uint32_t *row0,
+                                          uint32_t *row1)
+{
+  double lat, lon;
+
+
+  lat = bounds->min_latitude > bfdh[hnd].query_extent.min_latitude ? bounds->min_latitude : bfdh[hnd].query_extent.min_latitude;
+  lon = bounds->min_longitude > bfdh[hnd].query_extent.min_longitude ? bounds->min_longitude : bfdh[hnd].query_extent.min_longitude;
+
+  *col0 = binaryFeatureData_grid_cell (hnd, lat, lon) % bfdh[hnd].grid_cols;
+  *row0 = binaryFeatureData_grid_cell (hnd, lat, lon) / bfdh[hnd].grid_cols;
+
+  lat = bounds->max_latitude < bfdh[hnd].query_extent.max_latitude ? bounds->max_latitude : bfdh[hnd].query_extent.max_latitude;
+  lon = bounds->max_longitude < bfdh[hnd].query_extent.max_longitude ? bounds->max_longitude : bfdh[hnd].query_extent.max_longitude;
+
+  *col1 = binaryFeatureData_grid_cell (hnd, lat, lon) % bfdh[hnd].grid_cols;
+  *row1 = binaryFeatureData_grid_cell (hnd, lat, lon) / bfdh[hnd].grid_cols;
+}
+
+
+
+/*!  qsort comparison for record numbers.  */
+
+static int binaryFeatureData_compare_uint32 (const void *a, const void *b)
+{
+  uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+
+  return (x < y ? -1 : x > y);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_build_query_index
+
+ - Purpose:     Build (if it isn't already built) the polygon query index used by
+                binaryFeatureData_points_in_polygons and
+                binaryFeatureData_overlapping_polygons.  The index is a uniform grid over the
+                extent of all of the polygons (poly_type 1) in the file.  Each cell lists the
+                records whose bounding box overlaps it.  The polygon points are held in
+                memory so that queries don't need to read the .bfa file.  Any write through
+                the handle drops the index and it gets rebuilt on the next query.
+
+ - Date:        10/19/26
+
+ - Arguments:
+                - hnd            =    The file handle
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - Any error from binaryFeatureData_read_all_polygon_bounds or
+                  binaryFeatureData_read_polygon
+                - BFDATA_MEMORY_ALLOCATION_ERROR
+
+*********************************************************************************************/
+
+static int32_t binaryFeatureData_build_query_index (int32_t hnd)
+{
+  BFDATA_POLYGON_BOUNDS *bounds, extent;
+  BFDATA_RECORD bfd_record;
+  uint32_t i, n, polygons = 0, cells, col, row, col0, col1, row0, row1, *grid_start = NULL, *grid_record = NULL;
+  int64_t vertices = 0, alloc = 0, items = 0;
+  double *lat, *lon, width, height;
+
+
+  if (bfdh[hnd].query_valid) return (BFDATA_SUCCESS);
+
+  if (binaryFeatureData_read_all_polygon_bounds (hnd, &bounds) < 0) return (bfd_error.bfd);
+
+  n = bfdh[hnd].header.number_of_records;
+
+
+  free (bfdh[hnd].query_vertex);
+  free (bfdh[hnd].query_mark);
+  free (bfdh[hnd].grid_start);
+  free (bfdh[hnd].grid_record);
+  bfdh[hnd].grid_start = bfdh[hnd].grid_record = NULL;
+  bfdh[hnd].grid_cols = bfdh[hnd].grid_rows = 0;
+
+  bfdh[hnd].query_vertex = (int64_t *) malloc ((n + 1) * sizeof (int64_t));
+  bfdh[hnd].query_mark = (uint32_t *) calloc (n + 1, sizeof (uint32_t));
+  bfdh[hnd].query_stamp = 0;
+
+  if (bfdh[hnd].query_vertex == NULL || bfdh[hnd].query_mark == NULL ||
+      (bfdh[hnd].lod_poly == NULL && (bfdh[hnd].lod_poly = (BFDATA_POLYGON *) malloc (sizeof (BFDATA_POLYGON))) == NULL))
+    {
+      bfd_error.system = errno;
+      strcpy (bfd_error.file, bfdh[hnd].path);
+      return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
+    }
+
+
+  /*  Load the polygons.  Records that aren't indexed have no points (query_vertex[i] == query_vertex[i + 1]).  */
+
+  memset (&extent, 0, sizeof (BFDATA_POLYGON_BOUNDS));
+
+  for (i = 0 ; i < n ; i++)
+    {
+      bfdh[hnd].query_vertex[i] = vertices;
+
+      if (binaryFeatureData_do_read_record (hnd, i, &bfd_record) < 0) return (bfd_error.bfd);
+
+      if (bfd_record.poly_type != 1 || bfd_record.poly_count < 3 || !bfd_record.poly_address) continue;
+
+      if (binaryFeatureData_do_read_polygon (hnd, i, bfdh[hnd].lod_poly) < 0) return (bfd_error.bfd);
+
+      if (vertices + bfd_record.poly_count > alloc)
+        {
+          alloc = (vertices + bfd_record.poly_count) * 2;
+
+          lat = (double *) realloc (bfdh[hnd].query_lat, alloc * sizeof (double));
+          if (lat != NULL) bfdh[hnd].query_lat = lat;
+          lon = (double *) realloc (bfdh[hnd].query_lon, alloc * sizeof (double));
+          if (lon != NULL) bfdh[hnd].query_lon = lon;
+
+          if (lat == NULL || lon == NULL)
+            {
+              bfd_error.system = errno;
+              strcpy (bfd_error.file, bfdh[hnd].path);
+              return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
+            }
+        }
+
+      memcpy (&bfdh[hnd].query_lat[vertices], bfdh[hnd].lod_poly->latitude, bfd_record.poly_count * sizeof (double));
+      memcpy (&bfdh[hnd].query_lon[vertices], bfdh[hnd].lod_poly->longitude, bfd_record.poly_count * sizeof (double));
+      vertices += bfd_record.poly_count;
+
+      if (!polygons++)
+        {
+          extent = bounds[i];
+        }
+      else
+        {
+          if (bounds[i].min_latitude < extent.min_latitude) extent.min_latitude = bounds[i].min_latitude;
+          if (bounds[i].max_latitude > extent.max_latitude) extent.max_latitude = bounds[i].max_latitude;
+          if (bounds[i].min_longitude < extent.min_longitude) extent.min_longitude = bounds[i].min_longitude;
+          if (bounds[i].max_longitude > extent.max_longitude) extent.max_longitude = bounds[i].max_longitude;
+        }
+    }
+
+  bfdh[hnd].query_vertex[n] = vertices;
+  bfdh[hnd].query_extent = extent;
+
+
+  /*  Aim for about one cell per polygon but shrink the grid if big polygons would end up listed in too many cells.  */
+
+  width = extent.max_longitude - extent.min_longitude;
+  height = extent.max_latitude - extent.min_latitude;
+
+  cells = polygons < 4194304 ? polygons : 4194304;
+
+  while (cells)
+    {
+      if (width <= 0.0 || height <= 0.0)
+        {
+          bfdh[hnd].grid_cols = width > 0.0 ? cells : 1;
+          bfdh[hnd].grid_rows = height > 0.0 ? cells : 1;
+        }
+      else
+        {
+          bfdh[hnd].grid_cols = (uint32_t) (sqrt (cells * width / height) + 0.5);
+          if (!bfdh[hnd].grid_cols) bfdh[hnd].grid_cols = 1;
+          if (bfdh[hnd].grid_cols > cells) bfdh[hnd].grid_cols = cells;
+          bfdh[hnd].grid_rows = cells / bfdh[hnd].grid_cols;
+        }
+
+      bfdh[hnd].grid_dlon = width > 0.0 ? width / bfdh[hnd].grid_cols : 1.0;
+      bfdh[hnd].grid_dlat = height > 0.0 ? height / bfdh[hnd].grid_rows : 1.0;
+
+
+      items = 0;
+
+      for (i = 0 ; i < n ; i++)
+        {
+          if (bfdh[hnd].query_vertex[i] == bfdh[hnd].query_vertex[i + 1]) continue;
+
+          binaryFeatureData_grid_cells (hnd, &bounds[i], &col0, &col1, &row0, &row1);
+          items += (int64_t) (col1 - col0 + 1) * (row1 - row0 + 1);
+        }
+
+      if (items <= (int64_t) polygons * 8 + cells || cells == 1) break;
+
+      cells /= 4;
+      if (!cells) cells = 1;
+    }
+
+
+  if (polygons)
+    {
+      cells = bfdh[hnd].grid_cols * bfdh[hnd].grid_rows;
+
+      grid_start = (uint32_t *) calloc (cells + 1, sizeof (uint32_t));
+      grid_record = (uint32_t *) malloc (items * sizeof (uint32_t));
+
+      if (grid_start == NULL || grid_record == NULL)
+        {
+          free (grid_start);
+          free (grid_record);
+          bfd_error.system = errno;
+          strcpy (bfd_error.file, bfdh[hnd].path);
+          return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
+        }
+
+
+      /*  Count, turn the counts into starts, then fill (which shifts the starts back where they belong).  */
+
+      for (i = 0 ; i < n ; i++)
+        {
+          if (bfdh[hnd].query_vertex[i] == bfdh[hnd].query_vertex[i + 1]) continue;
+
+          binaryFeatureData_grid_cells (hnd, &bounds[i], &col0, &col1, &row0, &row1);
+
+          for (row = row0 ; row <= row1 ; row++)
+            for (col = col0 ; col <= col1 ; col++) grid_start[row * bfdh[hnd].grid_cols + col + 1]++;
+        }
+
+      for (i = 0 ; i < cells ; i++) grid_start[i + 1] += grid_start[i];
+
+      for (i = 0 ; i < n ; i++)
+        {
+          if (bfdh[hnd].query_vertex[i] == bfdh[hnd].query_vertex[i + 1]) continue;
+
+          binaryFeatureData_grid_cells (hnd, &bounds[i], &col0, &col1, &row0, &row1);
+
+          for (row = row0 ; row <= row1 ; row++)
+            for (col = col0 ; col <= col1 ; col++) grid_record[grid_start[row * bfdh[hnd].grid_cols + col]++] = i;
+        }
+
+      for (i = cells ; i > 0 ; i--) grid_start[i] = grid_start[i - 1];
+      grid_start[0] = 0;
+    }
+  else
+    {
+      bfdh[hnd].grid_cols = bfdh[hnd].grid_rows = 0;
+    }
+
+  bfdh[hnd].grid_start = grid_start;
+  bfdh[hnd].grid_record = grid_record;
+  bfdh[hnd].query_valid = 1;
+
+
+  return (BFDATA_SUCCESS);
+}
+
+
+
+/*!  Add record "recnum" to the query results (growing hit_record if needed).  Returns 0 if we're out of memory.  */
+
+static uint8_t binaryFeatureData_add_hit (int32_t hnd, uint32_t *hits, uint32_t recnum)
+{
+  uint32_t *hit_record, alloc;
+
+
+  if (*hits == bfdh[hnd].hit_record_alloc)
+    {
+      alloc = bfdh[hnd].hit_record_alloc ? bfdh[hnd].hit_record_alloc * 2 : 1024;
+
+      if ((hit_record = (uint32_t *) realloc (bfdh[hnd].hit_record, alloc * sizeof (uint32_t))) == NULL) return (0);
+
+      bfdh[hnd].hit_record = hit_record;
+      bfdh[hnd].hit_record_alloc = alloc;
+    }
+
+  bfdh[hnd].hit_record[(*hits)++] = recnum;
+
+  return (1);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_points_in_polygons
+
+ - Purpose:     Find the feature polygons (poly_type 1) that contain each of a list of points.
+                The hits for point i are hit_record[hit_index[i]] through
+                hit_record[hit_index[i + 1] - 1].  The first query builds an in-memory index
+                of the polygons (see binaryFeatureData_build_query_index) so later queries
+                don't touch the files.
+
+ - Date:        10/19/26
+
+ - Arguments:
+                - hnd            =    The file handle
+                - count          =    Number of points
+                - lat            =    Point latitudes
+                - lon            =    Point longitudes
+                - hit_index      =    Returned array of count + 1 indices into hit_record
+                - hit_record     =    Returned array of record numbers
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - Any error from binaryFeatureData_read_all_polygon_bounds or
+                  binaryFeatureData_read_polygon
+                - BFDATA_MEMORY_ALLOCATION_ERROR
+
+ - Caveats:     The returned arrays belong to the handle.  They are overwritten by the next
+                query and freed by binaryFeatureData_close_file.  Points exactly on a polygon
+                edge may or may not be counted as inside.
+
+*********************************************************************************************/
+
+BFDATA_DLL int32_t binaryFeatureData_points_in_polygons (int32_t hnd, uint32_t count, const double *lat, const double *lon,
+                                                         uint32_t **hit_index, uint32_t **hit_record)
+{
+  uint32_t i, j, *index, hits = 0, cell, recnum;
+  BFDATA_POLYGON_BOUNDS *bounds;
+  int64_t start;
+
+
+  if (binaryFeatureData_build_query_index (hnd) < 0) return (bfd_error.bfd);
+
+
+  if (count + 1 > bfdh[hnd].hit_index_alloc)
+    {
+      if ((index = (uint32_t *) realloc (bfdh[hnd].hit_index, (count + 1) * sizeof (uint32_t))) == NULL)
+        {
+          bfd_error.system = errno;
+          strcpy (bfd_error.file, bfdh[hnd].path);
+          return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
+        }
+
+      bfdh[hnd].hit_index = index;
+      bfdh[hnd].hit_index_alloc = count + 1;
+    }
+
+
+  for (i = 0 ; i < count ; i++)
+    {
+      bfdh[hnd].hit_index[i] = hits;
+
+      if (!bfdh[hnd].grid_cols || !(lat[i] >= bfdh[hnd].query_extent.min_latitude && lat[i] <= bfdh[hnd].query_extent.max_latitude &&
+                                    lon[i] >= bfdh[hnd].query_extent.min_longitude && lon[i] <= bfdh[hnd].query_extent.max_longitude))
+        continue;
+
+      cell = binaryFeatureData_grid_cell (hnd, lat[i], lon[i]);
+
+      for (j = bfdh[hnd].grid_start[cell] ; j < bfdh[hnd].grid_start[cell + 1] ; j++)
+        {
+          recnum = bfdh[hnd].grid_record[j];
+          bounds = &bfdh[hnd].poly_bounds[recnum];
+
+          if (lat[i] < bounds->min_latitude || lat[i] > bounds->max_latitude || lon[i] < bounds->min_longitude ||
+              lon[i] > bounds->max_longitude) continue;
+
+          start = bfdh[hnd].query_vertex[recnum];
+
+          if (binaryFeatureData_point_in_polygon (bfdh[hnd].query_vertex[recnum + 1] - start, &bfdh[hnd].query_lat[start],
+                                                  &bfdh[hnd].query_lon[start], lat[i], lon[i]))
+            {
+              if (!binaryFeatureData_add_hit (hnd, &hits, recnum))
+                {
+                  bfd_error.system = errno;
+                  strcpy (bfd_error.file, bfdh[hnd].path);
+                  return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
+                }
+            }
+        }
+    }
+
+  bfdh[hnd].hit_index[count] = hits;
+
+
+  *hit_index = bfdh[hnd].hit_index;
+  *hit_record = bfdh[hnd].hit_record;
+
+
+  bfd_error.system = 0;
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_overlapping_polygons
+
+ - Purpose:     Find the feature polygons (poly_type 1) that overlap (or touch) a polygon.
+                To find the features that overlap feature N just pass in the polygon from
+                binaryFeatureData_read_polygon (N will be in the results).  Uses the same
+                in-memory index as binaryFeatureData_points_in_polygons.
+
+ - Date:        10/19/26
+
+ - Arguments:
+                - hnd            =    The file handle
+                - count          =    Number of points in the query polygon
+                - lat            =    Query polygon latitudes
+                - lon            =    Query polygon longitudes
+                - hit_count      =    Returned number of overlapping polygons
+                - hit_record     =    Returned array of record numbers (in record order)
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_INVALID_QUERY
+                - Any error from binaryFeatureData_read_all_polygon_bounds or
+                  binaryFeatureData_read_polygon
+                - BFDATA_MEMORY_ALLOCATION_ERROR
+
+ - Caveats:     The returned array belongs to the handle.  It is overwritten by the next
+                query and freed by binaryFeatureData_close_file.
+
+*********************************************************************************************/
+
+BFDATA_DLL int32_t binaryFeatureData_overlapping_polygons (int32_t hnd, int32_t count, const double *lat, const double *lon,
+                                                           uint32_t *hit_count, uint32_t **hit_record)
+{
+  uint32_t i, hits = 0, col, row, col0, col1, row0, row1, cell, recnum;
+  BFDATA_POLYGON_BOUNDS query, *bounds;
+  int64_t start;
+
+
+  if (count < 3)
+    {
+      strcpy (bfd_error.file, bfdh[hnd].path);
+      return (bfd_error.bfd = BFDATA_INVALID_QUERY);
+    }
+
+  if (binaryFeatureData_build_query_index (hnd) < 0) return (bfd_error.bfd);
+
+
+  if (bfdh[hnd].grid_cols && binaryFeatureData_polygon_bounds (count, lat, lon, &query) &&
+      query.max_latitude >= bfdh[hnd].query_extent.min_latitude && query.min_latitude <= bfdh[hnd].query_extent.max_latitude &&
+      query.max_longitude >= bfdh[hnd].query_extent.min_longitude && query.min_longitude <= bfdh[hnd].query_extent.max_longitude)
+    {
+      /*  A polygon can be listed in more than one cell so we stamp the records we've already looked at.  */
+
+      if (!++bfdh[hnd].query_stamp)
+        {
+          memset (bfdh[hnd].query_mark, 0, (bfdh[hnd].header.number_of_records + 1) * sizeof (uint32_t));
+          bfdh[hnd].query_stamp = 1;
+        }
+
+      binaryFeatureData_grid_cells (hnd, &query, &col0, &col1, &row0, &row1);
+
+      for (row = row0 ; row <= row1 ; row++)
+        {
+          for (col = col0 ; col <= col1 ; col++)
+            {
+              cell = row * bfdh[hnd].grid_cols + col;
+
+              for (i = bfdh[hnd].grid_start[cell] ; i < bfdh[hnd].grid_start[cell + 1] ; i++)
+                {
+                  recnum = bfdh[hnd].grid_record[i];
+
+                  if (bfdh[hnd].query_mark[recnum] == bfdh[hnd].query_stamp) continue;
+                  bfdh[hnd].query_mark[recnum] = bfdh[hnd].query_stamp;
+
+                  bounds = &bfdh[hnd].poly_bounds[recnum];
+
+                  if (query.max_latitude < bounds->min_latitude || query.min_latitude > bounds->max_latitude ||
+                      query.max_longitude < bounds->min_longitude || query.min_longitude > bounds->max_longitude) continue;
+
+                  start = bfdh[hnd].query_vertex[recnum];
+
+                  if (binaryFeatureData_polygons_overlap (count, lat, lon, bfdh[hnd].query_vertex[recnum + 1] - start,
+                                                          &bfdh[hnd].query_lat[start], &bfdh[hnd].query_lon[start]))
+                    {
+                      if (!binaryFeatureData_add_hit (hnd, &hits, recnum))
+                        {
+                          bfd_error.system = errno;
+                          strcpy (bfd_error.file, bfdh[hnd].path);
+                          return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+
+  if (hits > 1) qsort (bfdh[hnd].hit_record, hits, sizeof (uint32_t), binaryFeatureData_compare_uint32);
+
+
+  *hit_count = hits;
+  *hit_record = bfdh[hnd].hit_record;
+
+
+  bfd_error.system = 0;
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
+
+
+
+/*!  Build the kd-tree over kd_point[lo] through kd_point[hi - 1].  The tree is implicit, the node for a range is the
+     median (mid) which splits the range on the axis with the largest spread (stored in the node).  */
+
+static void binaryFeatureData_kd_build (INTERNAL_BFDATA_KD_POINT *point, uint32_t lo, uint32_t hi)
+{
+  int64_t i, j, left, right, mid;
+  double min[3], max[3], pivot;
+  INTERNAL_BFDATA_KD_POINT tmp;
+  uint8_t dim, k;
+
+
+  if (hi - lo < 2) return;
+
+  for (k = 0 ; k < 3 ; k++) min[k] = max[k] = point[lo].v[k];
+
+  for (i = lo + 1 ; i < hi ; i++)
+    {
+      for (k = 0 ; k < 3 ; k++)
+        {
+          if (point[i].v[k] < min[k]) min[k] = point[i].v[k];
+          if (point[i].v[k] > max[k]) max[k] = point[i].v[k];
+        }
+    }
+
+  dim = 0;
+  if (max[1] - min[1] > max[dim] - min[dim]) dim = 1;
+  if (max[2] - min[2] > max[dim] - min[dim]) dim = 2;
+
+
+  /*  Quickselect the median.  */
+
+  mid = lo + (hi - lo) / 2;
+  left = lo;
+  right = hi - 1;
+
+  while (left < right)
+    {
+      pivot = point[(left + right) / 2].v[dim];
+      i = left;
+      j = right;
+
+      while (i <= j)
+        {
+          while (point[i].v[dim] < pivot) i++;
+          while (point[j].v[dim] > pivot) j--;
+
+          if (i <= j)
+            {
+              tmp = point[i];
+              point[i] = point[j];
+              point[j] = tmp;
+              i++;
+              j--;
+            }
+        }
+
+      if (mid <= j)
+        {
+          right = j;
+        }
+      else if (mid >= i)
+        {
+          left = i;
+        }
+      else
+        {
+          break;
+        }
+    }
+
+  point[mid].dim = dim;
+
+  binaryFeatureData_kd_build (point, lo, mid);
+  binaryFeatureData_kd_build (point, mid + 1, hi);
+}
+
+
+
+/*!  Push a neighbor on to the max heap (by distance) of the k nearest found so far.  */
+
+static void binaryFeatureData_kd_push (INTERNAL_BFDATA_NEIGHBOR *heap, uint32_t *n, uint32_t k, double dist2, uint32_t recnum)
+{
+  uint32_t i, child;
+  INTERNAL_BFDATA_NEIGHBOR tmp;
+
+
+  if (*n < k)
+    {
+      i = (*n)++;
+      heap[i].dist2 = dist2;
+      heap[i].recnum = recnum;
+
+      while (i && heap[(i - 1) / 2].dist2 < heap[i].dist2)
+        {
+          tmp = heap[i];
+          heap[i] = heap[(i - 1) / 2];
+          heap[(i - 1) / 2] = tmp;
+          i = (i - 1) / 2;
+        }
+
+      return;
+    }
+
+  if (dist2 >= heap[0].dist2) return;
+
+
+  /*  Replace the farthest and sift down.  */
+
+  heap[0].dist2 = dist2;
+  heap[0].recnum = recnum;
+
+  for (i = 0 ; (child = 2 * i + 1) < *n ; i = child)
+    {
+      if (child + 1 < *n && heap[child + 1].dist2 > heap[child].dist2) child++;
+
+      if (heap[child].dist2 <= heap[i].dist2) break;
+
+      tmp = heap[i];
+      heap[i] = heap[child];
+      heap[child] = tmp;
+    }
+}
+
+
+
+/*!  k nearest neighbor search of kd[lo] through kd[hi - 1].  The n neighbors found so far are in the max heap "heap".  */
+
+static void binaryFeatureData_kd_nearest (INTERNAL_BFDATA_KD_POINT *kd, INTERNAL_BFDATA_NEIGHBOR *heap, uint32_t lo, uint32_t hi,
+                                          const double *v, uint32_t k, uint32_t *n)
+{
+  INTERNAL_BFDATA_KD_POINT *point;
+  uint32_t mid;
+  double diff, dist2;
+
+
+  while (hi > lo)
+    {
+      mid = lo + (hi - lo) / 2;
+      point = &kd[mid];
+
+      dist2 = (point->v[0] - v[0]) * (point->v[0] - v[0]) + (point->v[1] - v[1]) * (point->v[1] - v[1]) +
+        (point->v[2] - v[2]) * (point->v[2] - v[2]);
+
+      binaryFeatureData_kd_push (heap, n, k, dist2, point->recnum);
+
+      if (hi - lo == 1) return;
+
+      diff = v[point->dim] - point->v[point->dim];
+
+
+      /*  Search the near side first then only look at the far side if it could have something closer.  */
+
+      if (diff < 0.0)
+        {
+          binaryFeatureData_kd_nearest (kd, heap, lo, mid, v, k, n);
+          if (*n == k && diff * diff >= heap[0].dist2) return;
+          lo = mid + 1;
+        }
+      else
+        {
+          binaryFeatureData_kd_nearest (kd, heap, mid + 1, hi, v, k, n);
+          if (*n == k && diff * diff >= heap[0].dist2) return;
+          hi = mid;
+        }
+    }
+}
+
+
+
+/*!  Radius search of kd[lo] through kd[hi - 1].  The n neighbors found so far are in *neighbor which has room for *alloc.
+     Returns 0 if we couldn't grow the neighbor array.  */
+
+static uint8_t binaryFeatureData_kd_radius (INTERNAL_BFDATA_KD_POINT *kd, INTERNAL_BFDATA_NEIGHBOR **neighbor, uint32_t *alloc, uint32_t lo,
+                                            uint32_t hi, const double *v, double radius2, uint32_t *n)
+{
+  INTERNAL_BFDATA_KD_POINT *point;
+  INTERNAL_BFDATA_NEIGHBOR *grow;
+  uint32_t mid, size;
+  double diff, dist2;
+
+
+  while (hi > lo)
+    {
+      mid = lo + (hi - lo) / 2;
+      point = &kd[mid];
+
+      dist2 = (point->v[0] - v[0]) * (point->v[0] - v[0]) + (point->v[1] - v[1]) * (point->v[1] - v[1]) +
+        (point->v[2] - v[2]) * (point->v[2] - v[2]);
+
+      if (dist2 <= radius2)
+        {
+          if (*n == *alloc)
+            {
+              size = *alloc ? *alloc * 2 : 256;
+
+              if ((grow = (INTERNAL_BFDATA_NEIGHBOR *) realloc (*neighbor, size * sizeof (INTERNAL_BFDATA_NEIGHBOR))) == NULL) return (0);
+
+              *neighbor = grow;
+              *alloc = size;
+            }
+
+          (*neighbor)[*n].dist2 = dist2;
+          (*neighbor)[(*n)++].recnum = point->recnum;
+        }
+
+      if (hi - lo == 1) return (1);
+
+      diff = v[point->dim] - point->v[point->dim];
+
+      if (diff < 0.0)
+        {
+          if (!binaryFeatureData_kd_radius (kd, neighbor, alloc, lo, mid, v, radius2, n)) return (0);
+          if (diff * diff > radius2) return (1);
+          lo = mid + 1;
+        }
+      else
+        {
+          if (!binaryFeatureData_kd_radius (kd, neighbor, alloc, mid + 1, hi, v, radius2, n)) return (0);
+          if (diff * diff > radius2) return (1);
+          hi = mid;
+        }
+    }
+
+  return (1);
+}
+
+
+
+/*!  qsort comparison for neighbors (by distance, then record number).  */
+
+static int binaryFeatureData_compare_neighbor (const void *a, const void *b)
+{
+  const INTERNAL_BFDATA_NEIGHBOR *x = (const INTERNAL_BFDATA_NEIGHBOR *) a, *y = (const INTERNAL_BFDATA_NEIGHBOR *) b;
+
+  if (x->dist2 != y->dist2) return (x->dist2 < y->dist2 ? -1 : 1);
+
+  return (x->recnum < y->recnum ? -1 : x->recnum > y->recnum);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_build_point_index
+
+ - Purpose:     Build (if it isn't already built) the kd-tree of feature positions used by
+                the nearest neighbor and radius searches.  Positions are stored as unit
+                vectors on the sphere so the straight line (chord) distance between two of
+                them orders features exactly like the great circle distance does, with no
+                trouble at the poles or the dateline.  Any write through the handle drops
+                the index and it gets rebuilt on the next search.
+
+ - Date:        10/19/26
+
+ - Arguments:
+                - hnd            =    The file handle
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - Any error from binaryFeatureData_read_record
+                - BFDATA_MEMORY_ALLOCATION_ERROR
+
+*********************************************************************************************/
+
+static int32_t binaryFeatureData_build_point_index (int32_t hnd)
+{
+  INTERNAL_BFDATA_KD_POINT *point;
+  BFDATA_RECORD bfd_record;
+  uint32_t i, n;
+
+
+  if (bfdh[hnd].point_index_valid) return (BFDATA_SUCCESS);
+
+  if (binaryFeatureData_flush_append (hnd) < 0) return (bfd_error.bfd);
+
+
+  n = bfdh[hnd].header.number_of_records;
+
+  if ((point = (INTERNAL_BFDATA_KD_POINT *) realloc (bfdh[hnd].kd_point, (n ? n : 1) * sizeof (INTERNAL_BFDATA_KD_POINT))) == NULL)
+    {
+      bfd_error.system = errno;
+      strcpy (bfd_error.file, bfdh[hnd].path);
+      return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
+    }
+
+  bfdh[hnd].kd_point = point;
+
+  for (i = 0 ; i < n ; i++)
+    {
+      if (binaryFeatureData_do_read_record (hnd, i, &bfd_record) < 0) return (bfd_error.bfd);
+
+      binaryFeatureData_unit_vector (bfd_record.latitude, bfd_record.longitude, point[i].v);
+      point[i].recnum = i;
+      point[i].dim = 0;
+    }
+
+  binaryFeatureData_kd_build (point, 0, n);
+
+  bfdh[hnd].kd_count = n;
+  bfdh[hnd].point_index_valid = 1;
+
+
+  bfdh[hnd].write = 0;
+
+
+  return (BFDATA_SUCCESS);
+}
+
+
+
+/*!  Shared code for the nearest neighbor and radius searches.  If k is 0 it's a radius search.  */
+
+static int32_t binaryFeatureData_search_points (int32_t hnd, uint32_t count, const double *lat, const double *lon, uint32_t k, double radius,
+                                                uint32_t **hit_index, uint32_t **hit_record, double **hit_distance)
+{
+  INTERNAL_BFDATA_NEIGHBOR *neighbor;
+  uint32_t i, j, n, hits = 0, *index;
+  double v[3], chord, radius2 = 0.0, *distance;
+  uint8_t nearest = (k != 0);
+
+
+  if (binaryFeatureData_build_point_index (hnd) < 0) return (bfd_error.bfd);
+
+
+  if (k > bfdh[hnd].kd_count) k = bfdh[hnd].kd_count;
+
+
+  /*  Convert the radius to the (squared) chord length.  Anything past half way around the world is everything.  */
+
+  if (!nearest)
+    {
+      chord = radius / (2.0 * BFDATA_EARTH_RADIUS) >= 1.5707963267948966 ? 2.0 : 2.0 * sin (radius / (2.0 * BFDATA_EARTH_RADIUS));
+      radius2 = chord * chord;
+    }
+
+
+  if (count + 1 > bfdh[hnd].hit_index_alloc)
+    {
+      if ((index = (uint32_t *) realloc (bfdh[hnd].hit_index, (count + 1) * sizeof (uint32_t))) == NULL)
+        {
+          bfd_error.system = errno;
+          strcpy (bfd_error.file, bfdh[hnd].path);
+          return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
+        }
+
+      bfdh[hnd].hit_index = index;
+      bfdh[hnd].hit_index_alloc = count + 1;
+    }
+
+  if (k > bfdh[hnd].neighbor_alloc)
+    {
+      if ((neighbor = (INTERNAL_BFDATA_NEIGHBOR *) realloc (bfdh[hnd].neighbor, k * sizeof (INTERNAL_BFDATA_NEIGHBOR))) == NULL)
+        {
+          bfd_error.system = errno;
+          strcpy (bfd_error.file, bfdh[hnd].path);
+          return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
+        }
+
+      bfdh[hnd].neighbor = neighbor;
+      bfdh[hnd].neighbor_alloc = k;
+    }
+
+
+  for (i = 0 ; i < count ; i++)
+    {
+      bfdh[hnd].hit_index[i] = hits;
+
+      if (isnan (lat[i]) || isnan (lon[i])) continue;
+
+      binaryFeatureData_unit_vector (lat[i], lon[i], v);
+
+      n = 0;
+
+      if (nearest)
+        {
+          if (k) binaryFeatureData_kd_nearest (bfdh[hnd].kd_point, bfdh[hnd].neighbor, 0, bfdh[hnd].kd_count, v, k, &n);
+        }
+      else if (!binaryFeatureData_kd_radius (bfdh[hnd].kd_point, &bfdh[hnd].neighbor, &bfdh[hnd].neighbor_alloc, 0, bfdh[hnd].kd_count, v,
+                                             radius2, &n))
+        {
+          bfd_error.system = errno;
+          strcpy (bfd_error.file, bfdh[hnd].path);
+          return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
+        }
+
+      if (n > 1) qsort (bfdh[hnd].neighbor, n, sizeof (INTERNAL_BFDATA_NEIGHBOR), binaryFeatureData_compare_neighbor);
+
+
+      for (j = 0 ; j < n ; j++)
+        {
+          if (!binaryFeatureData_add_hit (hnd, &hits, bfdh[hnd].neighbor[j].recnum))
+            {
+              bfd_error.system = errno;
+              strcpy (bfd_error.file, bfdh[hnd].path);
+              return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
+            }
+
+          if (bfdh[hnd].hit_record_alloc > bfdh[hnd].hit_distance_alloc)
+            {
+              if ((distance = (double *) realloc (bfdh[hnd].hit_distance, bfdh[hnd].hit_record_alloc * sizeof (double))) == NULL)
+                {
+                  bfd_error.system = errno;
+                  strcpy (bfd_error.file, bfdh[hnd].path);
+                  return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
+                }
+
+              bfdh[hnd].hit_distance = distance;
+              bfdh[hnd].hit_distance_alloc = bfdh[hnd].hit_record_alloc;
+            }
+
+
+          /*  Chord length to great circle distance.  */
+
+          chord = sqrt (bfdh[hnd].neighbor[j].dist2);
+          bfdh[hnd].hit_distance[hits - 1] = 2.0 * BFDATA_EARTH_RADIUS * asin (chord < 2.0 ? chord / 2.0 : 1.0);
+        }
+    }
+
+  bfdh[hnd].hit_index[count] = hits;
+
+
+  *hit_index = bfdh[hnd].hit_index;
+  *hit_record = bfdh[hnd].hit_record;
+  *hit_distance = bfdh[hnd].hit_distance;
+
+
+  bfd_error.system = 0;
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_nearest_features_batch
+
+ - Purpose:     Find the k features (by record position) nearest to each of a list of
+                points.  Distances are great circle distances on a sphere of radius
+                BFDATA_EARTH_RADIUS.  The hits for point i are hit_record[hit_index[i]]
+                through hit_record[hit_index[i + 1] - 1], nearest first, with the matching
+                distances in hit_distance.  The first search builds an in-memory kd-tree of
+                the feature positions (see binaryFeatureData_build_point_index).
+
+ - Date:        10/19/26
+
+ - Arguments:
+                - hnd            =    The file handle
+                - count          =    Number of points
+                - lat            =    Point latitudes
+                - lon            =    Point longitudes
+                - k              =    Number of neighbors to find for each point
+                - hit_index      =    Returned array of count + 1 indices into hit_record
+                - hit_record     =    Returned array of record numbers
+                - hit_distance   =    Returned array of distances in meters
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - Any error from binaryFeatureData_read_record
+                - BFDATA_MEMORY_ALLOCATION_ERROR
+
+ - Caveats:     The returned arrays belong to the handle.  They are overwritten by the next
+                query (including binaryFeatureData_points_in_polygons) and freed by
+                binaryFeatureData_close_file.
+
+*********************************************************************************************/
+
+BFDATA_DLL int32_t binaryFeatureData_nearest_features_batch (int32_t hnd, uint32_t count, const double *lat, const double *lon, uint32_t k,
+                                                             uint32_t **hit_index, uint32_t **hit_record, double **hit_distance)
+{
+  if (!k)
+    {
+      bfd_error.system = 0;
+      strcpy (bfd_error.file, bfdh[hnd].path);
+      return (bfd_error.bfd = BFDATA_INVALID_QUERY);
+    }
+
+  return (binaryFeatureData_search_points (hnd, count, lat, lon, k, 0.0, hit_index, hit_record, hit_distance));
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_nearest_features
+
+ - Purpose:     Find the k features nearest to a point.  See
+                binaryFeatureData_nearest_features_batch.
+
+ - Date:        10/19/26
+
+ - Arguments:
+                - hnd            =    The file handle
+                - lat            =    Point latitude
+                - lon            =    Point longitude
+                - k              =    Number of neighbors to find
+                - count          =    Returned number of neighbors found (less than k if
+                                      there aren't k features in the file)
+                - recnum         =    Returned array of record numbers, nearest first
+                - distance       =    Returned array of distances in meters
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_INVALID_QUERY
+                - Any error from binaryFeatureData_read_record
+                - BFDATA_MEMORY_ALLOCATION_ERROR
+
+*********************************************************************************************/
+
+BFDATA_DLL int32_t binaryFeatureData_nearest_features (int32_t hnd, double lat, double lon, uint32_t k, uint32_t *count, uint32_t **recnum,
+                                                       double **distance)
+{
+  uint32_t *hit_index;
+
+
+  if (binaryFeatureData_nearest_features_batch (hnd, 1, &lat, &lon, k, &hit_index, recnum, distance) < 0) return (bfd_error.bfd);
+
+  *count = hit_index[1];
+
+
+  return (BFDATA_SUCCESS);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_features_within_radius_batch
+
+ - Purpose:     Find all of the features (by record position) within "radius" meters of
+                each of a list of points.  The results are returned the same way as
+                binaryFeatureData_nearest_features_batch (nearest first).
+
+ - Date:        10/19/26
+
+ - Arguments:
+                - hnd            =    The file handle
+                - count          =    Number of points
+                - lat            =    Point latitudes
+                - lon            =    Point longitudes
+                - radius         =    Search radius in meters
+                - hit_index      =    Returned array of count + 1 indices into hit_record
+                - hit_record     =    Returned array of record numbers
+                - hit_distance   =    Returned array of distances in meters
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_INVALID_QUERY
+                - Any error from binaryFeatureData_read_record
+                - BFDATA_MEMORY_ALLOCATION_ERROR
+
+ - Caveats:     The returned arrays belong to the handle (see
+                binaryFeatureData_nearest_features_batch).
+
+*********************************************************************************************/
+
+BFDATA_DLL int32_t binaryFeatureData_features_within_radius_batch (int32_t hnd, uint32_t count, const double *lat, const double *lon,
+                                                                   double radius, uint32_t **hit_index, uint32_t **hit_record,
+                                                                   double **hit_distance)
+{
+  if (!(radius >= 0.0))
+    {
+      bfd_error.system = 0;
+      strcpy (bfd_error.file, bfdh[hnd].path);
+      return (bfd_error.bfd = BFDATA_INVALID_QUERY);
+    }
+
+  return (binaryFeatureData_search_points (hnd, count, lat, lon, 0, radius, hit_index, hit_record, hit_distance));
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_features_within_radius
+
+ - Purpose:     Find all of the features within "radius" meters of a point.  See
+                binaryFeatureData_features_within_radius_batch.
+
+ - Date:        10/19/26
+
+ - Arguments:
+                - hnd            =    The file handle
+                - lat            =    Point latitude
+                - lon            =    Point longitude
+                - radius         =    Search radius in meters
+                - count          =    Returned number of features found
+                - recnum         =    Returned array of record numbers, nearest first
+                - distance       =    Returned array of distances in meters
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_INVALID_QUERY
+                - Any error from binaryFeatureData_read_record
+                - BFDATA_MEMORY_ALLOCATION_ERROR
+
+*********************************************************************************************/
+
+BFDATA_DLL int32_t binaryFeatureData_features_within_radius (int32_t hnd, double lat, double lon, double radius, uint32_t *count,
+                                                             uint32_t **recnum, double **distance)
+{
+  uint32_t *hit_index;
+
+
+  if (binaryFeatureData_features_within_radius_batch (hnd, 1, &lat, &lon, radius, &hit_index, recnum, distance) < 0) return (bfd_error.bfd);
+
+  *count = hit_index[1];
+
+
+  return (BFDATA_SUCCESS);
+}
+
+
+
+/*!  Union-find root of feature i (with path halving).  */
+
+static uint32_t binaryFeatureData_find_root (uint32_t *parent, uint32_t i)
+{
+  while (parent[i] != i)
+    {
+      parent[i] = parent[parent[i]];
+      i = parent[i];
+    }
+
+  return (i);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_find_duplicates
+
+ - Purpose:     Find groups of features (across one or more open files) that are probably
+                the same object.  Two features are linked if they are within "distance"
+                meters of each other, their event times are within "time" seconds, and
+                their depths are within "depth" meters.  Groups are the connected sets of
+                linked features (so A and C are in the same group if A matches B and B
+                matches C).  The pairs are found with a kd-tree radius search (see
+                binaryFeatureData_build_point_index) so this is roughly N log N rather than
+                N squared.
+
+ - Date:        10/19/26
+
+ - Arguments:
+                - count          =    Number of file handles
+                - hnd            =    The file handles
+                - distance       =    Maximum distance between duplicates in meters
+                - time           =    Maximum difference in event time in seconds (negative
+                                      to ignore time)
+                - depth          =    Maximum difference in depth in meters (negative to
+                                      ignore depth)
+                - group_count    =    Returned number of groups (with 2 or more features)
+                - group_index    =    Returned array of group_count + 1 indices into feature.
+                                      Group g is feature[group_index[g]] through
+                                      feature[group_index[g + 1] - 1].
+                - feature        =    Returned array of features in file handle order then
+                                      record order within each group
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_INVALID_QUERY
+                - Any error from binaryFeatureData_read_record
+                - BFDATA_MEMORY_ALLOCATION_ERROR
+
+ - Caveats:     Unlike the other queries the returned arrays are allocated for the caller
+                since they don't belong to any one handle.  Free them with free ().  Depths
+                are compared after the datum shift.
+
+*********************************************************************************************/
+
+BFDATA_DLL int32_t binaryFeatureData_find_duplicates (int32_t count, const int32_t *hnd, double distance, double time, double depth,
+                                                      uint32_t *group_count, uint32_t **group_index, BFDATA_FEATURE_REF **feature)
+{
+  INTERNAL_BFDATA_KD_POINT *kd;
+  INTERNAL_BFDATA_NEIGHBOR *neighbor = NULL;
+  BFDATA_FEATURE_REF *ref, *out;
+  BFDATA_RECORD bfd_record;
+  uint32_t i, j, n = 0, total = 0, neighbor_alloc = 0, found, a, b, groups = 0, *parent, *index, *group;
+  double *event, *feature_depth, chord, radius2, v[3];
+  uint8_t *block;
+  int32_t h;
+
+
+  *group_count = 0;
+  *group_index = NULL;
+  *feature = NULL;
+
+
+  if (count < 1 || hnd == NULL || !(distance >= 0.0))
+    {
+      bfd_error.system = 0;
+      strcpy (bfd_error.file, "binaryFeatureData_find_duplicates");
+      return (bfd_error.bfd = BFDATA_INVALID_QUERY);
+    }
+
+  for (h = 0 ; h < count ; h++)
+    {
+      if (hnd[h] < 0 || hnd[h] >= BFDATA_MAX_FILES || bfdh[hnd[h]].fp == NULL)
+        {
+          bfd_error.system = 0;
+          strcpy (bfd_error.file, "binaryFeatureData_find_duplicates");
+          return (bfd_error.bfd = BFDATA_INVALID_QUERY);
+        }
+
+      if (binaryFeatureData_flush_append (hnd[h]) < 0) return (bfd_error.bfd);
+
+      total += bfdh[hnd[h]].header.number_of_records;
+    }
+
+
+  /*  All of the per feature work arrays come out of one block (largest alignment first) so they're easy to clean up.  */
+
+  block = (uint8_t *) malloc ((size_t) (total ? total : 1) * (sizeof (INTERNAL_BFDATA_KD_POINT) + 2 * sizeof (double) +
+                                                              sizeof (BFDATA_FEATURE_REF) + 2 * sizeof (uint32_t)));
+  index = (uint32_t *) calloc (total + 1, sizeof (uint32_t));
+
+  if (block == NULL || index == NULL)
+    {
+      free (block);
+      free (index);
+      bfd_error.system = errno;
+      strcpy (bfd_error.file, "binaryFeatureData_find_duplicates");
+      return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
+    }
+
+  kd = (INTERNAL_BFDATA_KD_POINT *) block;
+  event = (double *) (kd + total);
+  feature_depth = event + total;
+  ref = (BFDATA_FEATURE_REF *) (feature_depth + total);
+  parent = (uint32_t *) (ref + total);
+  group = parent + total;
+
+
+  /*  Gather the features that have a position.  */
+
+  for (h = 0 ; h < count ; h++)
+    {
+      for (i = 0 ; i < bfdh[hnd[h]].header.number_of_records ; i++)
+        {
+          if (binaryFeatureData_do_read_record (hnd[h], i, &bfd_record) < 0)
+            {
+              free (block);
+              free (index);
+              return (bfd_error.bfd);
+            }
+
+          if (isnan (bfd_record.latitude) || isnan (bfd_record.longitude)) continue;
+
+          binaryFeatureData_unit_vector (bfd_record.latitude, bfd_record.longitude, kd[n].v);
+          kd[n].recnum = n;
+          kd[n].dim = 0;
+
+          ref[n].hnd = hnd[h];
+          ref[n].record_number = i;
+          event[n] = (double) bfd_record.event_tv_sec + (double) bfd_record.event_tv_nsec / 1000000000.0;
+          feature_depth[n] = bfd_record.depth;
+          parent[n] = n;
+          n++;
+        }
+    }
+
+  binaryFeatureData_kd_build (kd, 0, n);
+
+
+  /*  Link each feature to the matching features found by a radius search around it.  */
+
+  chord = distance / (2.0 * BFDATA_EARTH_RADIUS) >= 1.5707963267948966 ? 2.0 : 2.0 * sin (distance / (2.0 * BFDATA_EARTH_RADIUS));
+  radius2 = chord * chord;
+
+  for (i = 0 ; i < n ; i++)
+    {
+      a = kd[i].recnum;
+      v[0] = kd[i].v[0];
+      v[1] = kd[i].v[1];
+      v[2] = kd[i].v[2];
+
+      found = 0;
+
+      if (!binaryFeatureData_kd_radius (kd, &neighbor, &neighbor_alloc, 0, n, v, radius2, &found))
+        {
+          free (block);
+          free (index);
+          free (neighbor);
+          bfd_error.system = errno;
+          strcpy (bfd_error.file, "binaryFeatureData_find_duplicates");
+          return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
+        }
+
+      for (j = 0 ; j < found ; j++)
+        {
+          b = neighbor[j].recnum;
+
+          if (b <= a) continue;
+
+          if (time >= 0.0 && fabs (event[a] - event[b]) > time) continue;
+
+          if (depth >= 0.0 && fabs (feature_depth[a] - feature_depth[b]) > depth) continue;
+
+          a = binaryFeatureData_find_root (parent, a);
+          b = binaryFeatureData_find_root (parent, b);
+
+          if (a != b) parent[a > b ? a : b] = a < b ? a : b;
+
+          a = kd[i].recnum;
+        }
+    }
+
+  free (neighbor);
+
+
+  /*  Count the group sizes (in "index", by root) and number the groups with more than one feature in order of their
+      first feature.  Because a root is always the smallest feature in its group, roots come before their members.  */
+
+  for (i = 0 ; i < n ; i++) index[binaryFeatureData_find_root (parent, i)]++;
+
+  for (i = 0 ; i < n ; i++)
+    {
+      a = binaryFeatureData_find_root (parent, i);
+
+      if (a == i)
+        {
+          group[i] = index[i] > 1 ? groups++ : 0xffffffff;
+        }
+      else
+        {
+          group[i] = group[a];
+        }
+    }
+
+
+  /*  Build the output (index is reused for the group starts).  */
+
+  memset (index, 0, (n + 1) * sizeof (uint32_t));
+
+  for (i = 0 ; i < n ; i++) if (group[i] != 0xffffffff) index[group[i] + 1]++;
+
+  for (i = 0 ; i < groups ; i++) index[i + 1] += index[i];
+
+  if ((out = (BFDATA_FEATURE_REF *) malloc ((index[groups] ? index[groups] : 1) * sizeof (BFDATA_FEATURE_REF))) == NULL)
+    {
+      free (block);
+      free (index);
+      bfd_error.system = errno;
+      strcpy (bfd_error.file, "binaryFeatureData_find_duplicates");
+      return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
+    }
+
+  for (i = 0 ; i < n ; i++) if (group[i] != 0xffffffff) out[index[group[i]]++] = ref[i];
+
+  for (i = groups ; i > 0 ; i--) index[i] = index[i - 1];
+  index[0] = 0;
+
+
+  free (block);
+
+
+  *group_count = groups;
+  *group_index = index;
+  *feature = out;
+
+
+  bfd_error.system = 0;
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
+
+
+
+/*!  Copy the image of "bfd_record" (from the .bfa file open as "ifp") to the end of the .bfa file of "hnd" (see
+     binaryFeatureData_write_record_image_file) and point the record at the copy.  Records without an image are
+     cleared.  */
+
+static int32_t binaryFeatureData_copy_image (int32_t hnd, int32_t recnum, FILE *ifp, const char *i_path, BFDATA_RECORD *bfd_record)
+{
+  int64_t address;
+  int32_t ret;
+
+
+  if (!bfd_record->image_size || !bfd_record->image_address)
+    {
+      bfd_record->image_size = 0;
+      bfd_record->image_address = 0;
+      return (BFDATA_SUCCESS);
+    }
+
+
+  if (binaryFeatureData_flush_append (hnd) < 0) return (bfd_error.bfd);
+
+  if (binaryFeatureData_seek (hnd, bfdh[hnd].afp, 0LL, SEEK_END) < 0)
+    {
+      bfd_error.system = errno;
+      bfd_error.recnum = recnum;
+      strcpy (bfd_error.file, bfdh[hnd].a_path);
+      return (bfd_error.bfd = BFDATA_IMAGE_WRITE_FSEEK_ERROR);
+    }
+
+  address = ftello64 (bfdh[hnd].afp);
+
+  if ((ret = binaryFeatureData_copy_stream (ifp, bfd_record->image_address, bfdh[hnd].afp, bfd_record->image_size)) < 0)
+    {
+      bfd_error.system = errno;
+      bfd_error.recnum = recnum;
+      strcpy (bfd_error.file, ret == -1 ? i_path : bfdh[hnd].a_path);
+      return (bfd_error.bfd = (ret == -1 ? BFDATA_IMAGE_READ_ERROR : BFDATA_IMAGE_WRITE_ERROR));
+    }
+
+  bfd_record->image_address = address;
+
+
+  return (BFDATA_SUCCESS);
+}
+
+
+
+/*!  qsort comparison for merge keys (by time, then record number).  */
+
+static int binaryFeatureData_compare_merge_key (const void *a, const void *b)
+{
+  const INTERNAL_BFDATA_MERGE_KEY *x = (const INTERNAL_BFDATA_MERGE_KEY *) a, *y = (const INTERNAL_BFDATA_MERGE_KEY *) b;
+
+  if (x->time != y->time) return (x->time < y->time ? -1 : 1);
+
+  return (x->recnum < y->recnum ? -1 : x->recnum > y->recnum);
+}
+
+
+
+/*!  Merge scan (run in a thread per input).  Reads the event time of every record in the input and sorts them.  */
+
+static void *binaryFeatureData_merge_scan (void *arg)
+{
+  INTERNAL_BFDATA_MERGE_INPUT *input = (INTERNAL_BFDATA_MERGE_INPUT *) arg;
+  BFDATA_RECORD bfd_record;
+  uint32_t i;
+
+
+  for (i = 0 ; i < input->count ; i++)
+    {
+      if (binaryFeatureData_do_read_record (input->hnd, i, &bfd_record) < 0)
+        {
+          input->error = bfd_error;
+          input->status = bfd_error.bfd;
+          return (NULL);
+        }
+
+      input->key[i].time = (double) bfd_record.event_tv_sec + (double) bfd_record.event_tv_nsec / 1000000000.0;
+      input->key[i].recnum = i;
+    }
+
+  qsort (input->key, input->count, sizeof (INTERNAL_BFDATA_MERGE_KEY), binaryFeatureData_compare_merge_key);
+
+
+  return (NULL);
+}
+
+
+
+/*!  Read the "index"th record (in output order) of a merge input and its polygon into "slot".  */
+
+static int32_t binaryFeatureData_merge_load (INTERNAL_BFDATA_MERGE_INPUT *input, uint32_t index, INTERNAL_BFDATA_MERGE_SLOT *slot)
+{
+  uint32_t recnum = input->key != NULL ? input->key[index].recnum : index;
+
+
+  slot->poly = NULL;
+
+  if (binaryFeatureData_do_read_record (input->hnd, recnum, &slot->record) < 0) return (bfd_error.bfd);
+
+  if (slot->record.poly_count && slot->record.poly_address)
+    {
+      if (binaryFeatureData_do_read_polygon (input->hnd, recnum, input->poly) < 0) return (bfd_error.bfd);
+
+      if ((slot->poly = (double *) malloc (slot->record.poly_count * 2 * sizeof (double))) == NULL)
+        {
+          bfd_error.system = errno;
+          bfd_error.recnum = recnum;
+          strcpy (bfd_error.file, bfdh[input->hnd].path);
+          return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
+        }
+
+      memcpy (slot->poly, input->poly->latitude, slot->record.poly_count * sizeof (double));
+      memcpy (slot->poly + slot->record.poly_count, input->poly->longitude, slot->record.poly_count * sizeof (double));
+    }
+
+
+  return (BFDATA_SUCCESS);
+}
+
+
+
+/*!  Restore the merge heap (inputs ordered by the time of their next record, then by input number) below "i".  */
+
+static void binaryFeatureData_merge_sift (INTERNAL_BFDATA_MERGE_INPUT *inputs, uint32_t *heap, uint32_t count, uint32_t i)
+{
+  INTERNAL_BFDATA_MERGE_KEY *a, *b;
+  uint32_t child, tmp;
+
+
+  while ((child = i * 2 + 1) < count)
+    {
+      if (child + 1 < count)
+        {
+          a = &inputs[heap[child + 1]].key[inputs[heap[child + 1]].next];
+          b = &inputs[heap[child]].key[inputs[heap[child]].next];
+
+          if (a->time < b->time || (a->time == b->time && heap[child + 1] < heap[child])) child++;
+        }
+
+      a = &inputs[heap[child]].key[inputs[heap[child]].next];
+      b = &inputs[heap[i]].key[inputs[heap[i]].next];
+
+      if (a->time > b->time || (a->time == b->time && heap[child] > heap[i])) break;
+
+      tmp = heap[i];
+      heap[i] = heap[child];
+      heap[child] = tmp;
+
+      i = child;
+    }
+}
+
+
+
+#ifndef NVWIN3X
+
+/*!  Merge reader (run in a thread per input).  Keeps the input's queue full of records (and polygons) in output order
+     so that the writer never has to wait on the inputs.  */
+
+static void *binaryFeatureData_merge_read (void *arg)
+{
+  INTERNAL_BFDATA_MERGE_INPUT *input = (INTERNAL_BFDATA_MERGE_INPUT *) arg;
+  INTERNAL_BFDATA_MERGE_SLOT *slot;
+  uint32_t i;
+  int32_t status;
+  uint8_t stop;
+
+
+  for (i = 0 ; i < input->count ; i++)
+    {
+      pthread_mutex_lock (&input->mutex);
+
+      while (input->head - input->tail == BFDATA_MERGE_QUEUE_SIZE && !input->stop) pthread_cond_wait (&input->space, &input->mutex);
+
+      stop = input->stop;
+
+      pthread_mutex_unlock (&input->mutex);
+
+      if (stop) return (NULL);
+
+
+      /*  Only this thread touches the slot between head and tail + BFDATA_MERGE_QUEUE_SIZE.  */
+
+      slot = &input->slot[input->head % BFDATA_MERGE_QUEUE_SIZE];
+
+      status = binaryFeatureData_merge_load (input, i, slot);
+
+      pthread_mutex_lock (&input->mutex);
+
+      if (status < 0)
+        {
+          input->error = bfd_error;
+          input->status = status;
+        }
+      else
+        {
+          input->head++;
+        }
+
+      pthread_cond_signal (&input->ready);
+      pthread_mutex_unlock (&input->mutex);
+
+      if (status < 0) return (NULL);
+    }
+
+
+  return (NULL);
+}
+
+#endif
+
+
+
+/*!  Get the next record from a merge input's queue.  Call binaryFeatureData_merge_release when done with it.  */
+
+static INTERNAL_BFDATA_MERGE_SLOT *binaryFeatureData_merge_next (INTERNAL_BFDATA_MERGE_INPUT *input)
+{
+  INTERNAL_BFDATA_MERGE_SLOT *slot;
+
+
+#ifdef NVWIN3X
+
+  slot = &input->slot[0];
+
+  if (binaryFeatureData_merge_load (input, input->tail, slot) < 0) return (NULL);
+
+#else
+
+  pthread_mutex_lock (&input->mutex);
+
+  while (input->head == input->tail && input->status == BFDATA_SUCCESS) pthread_cond_wait (&input->ready, &input->mutex);
+
+  if (input->head == input->tail)
+    {
+      bfd_error = input->error;
+      pthread_mutex_unlock (&input->mutex);
+      return (NULL);
+    }
+
+  slot = &input->slot[input->tail % BFDATA_MERGE_QUEUE_SIZE];
+
+  pthread_mutex_unlock (&input->mutex);
+
+#endif
+
+
+  return (slot);
+}
+
+
+
+static void binaryFeatureData_merge_release (INTERNAL_BFDATA_MERGE_INPUT *input, INTERNAL_BFDATA_MERGE_SLOT *slot)
+{
+  free (slot->poly);
+  slot->poly = NULL;
+
+
+#ifndef NVWIN3X
+
+  pthread_mutex_lock (&input->mutex);
+
+  input->tail++;
+
+  pthread_cond_signal (&input->space);
+  pthread_mutex_unlock (&input->mutex);
+
+#else
+
+  input->tail++;
+
+#endif
+}
+
+
+
+/*!  Stop any merge threads and free everything.  The error state is left alone.  */
+
+static void binaryFeatureData_merge_cleanup (INTERNAL_BFDATA_MERGE_INPUT *inputs, int32_t count, int32_t out)
+{
+  BFDATA_ERROR_STRUCT error = bfd_error;
+  uint32_t i;
+  int32_t j;
+
+
+  for (j = 0 ; j < count ; j++)
+    {
+#ifndef NVWIN3X
+
+      if (inputs[j].running)
+        {
+          pthread_mutex_lock (&inputs[j].mutex);
+          inputs[j].stop = 1;
+          pthread_cond_signal (&inputs[j].space);
+          pthread_mutex_unlock (&inputs[j].mutex);
+
+          pthread_join (inputs[j].thread, NULL);
+        }
+
+      pthread_mutex_destroy (&inputs[j].mutex);
+      pthread_cond_destroy (&inputs[j].ready);
+      pthread_cond_destroy (&inputs[j].space);
+
+#endif
+
+      for (i = 0 ; i < BFDATA_MERGE_QUEUE_SIZE ; i++) free (inputs[j].slot[i].poly);
+
+      free (inputs[j].key);
+      free (inputs[j].map);
+      free (inputs[j].poly);
+
+      if (inputs[j].ifp != NULL) fclose (inputs[j].ifp);
+
+      if (inputs[j].hnd >= 0) binaryFeatureData_do_close_file (inputs[j].hnd);
+    }
+
+  free (inputs);
+
+  if (out >= 0) binaryFeatureData_do_close_file (out);
+
+  bfd_error = error;
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_merge_files
+
+ - Purpose:     Merge a number of BFD files into a new one.  Each input is read by its own
+                thread (which keeps a small queue of decoded records and polygons ahead of
+                the writer) and, if order_by_time is set, the inputs are first scanned and
+                sorted in parallel and then k-way merged by event time.  Otherwise the
+                records are written input by input in record order.  Images are copied
+                straight from the input .bfa files to the output .bfa file (by the kernel
+                where possible) and parent_record/child_record links are remapped to the
+                new record numbers.  Links that point outside of their own input are
+                dropped.
+
+ - Date:        10/19/26
+
+ - Arguments:
+                - count          =    Number of input files
+                - input          =    Input file names
+                - output         =    Output file name (it will be created)
+                - bfd_header     =    Header for the output file (see
+                                      binaryFeatureData_create_file)
+                - order_by_time  =    1 to order the output by event time (ties in input
+                                      then record order), 0 to keep input order
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_INVALID_QUERY
+                - BFDATA_TOO_MANY_OPEN_FILES (all of the inputs plus the output have to be
+                  open at once)
+                - Any error from binaryFeatureData_open_file, binaryFeatureData_create_file,
+                  binaryFeatureData_read_record, binaryFeatureData_read_polygon, or
+                  binaryFeatureData_write_record
+                - BFDATA_IMAGE_READ_ERROR
+                - BFDATA_IMAGE_WRITE_ERROR
+                - BFDATA_MEMORY_ALLOCATION_ERROR
+
+ - Caveats:     On error the partial output file is left behind.
+
+*********************************************************************************************/
+
+BFDATA_DLL int32_t binaryFeatureData_merge_files (int32_t count, const char **input, const char *output, BFDATA_HEADER bfd_header,
+                                                  uint8_t order_by_time)
+{
+  INTERNAL_BFDATA_MERGE_INPUT *inputs;
+  INTERNAL_BFDATA_MERGE_SLOT *slot;
+  BFDATA_HEADER header;
+  BFDATA_POLYGON *poly;
+  uint32_t i, total = 0, out_rec, link, *heap = NULL, *source = NULL, heap_count;
+  int32_t h, out = -1, ret;
+
+
+  if (count < 1 || input == NULL || output == NULL)
+    {
+      bfd_error.system = 0;
+      strcpy (bfd_error.file, "binaryFeatureData_merge_files");
+      return (bfd_error.bfd = BFDATA_INVALID_QUERY);
+    }
+
+
+  if ((inputs = (INTERNAL_BFDATA_MERGE_INPUT *) calloc (count, sizeof (INTERNAL_BFDATA_MERGE_INPUT))) == NULL)
+    {
+      bfd_error.system = errno;
+      strcpy (bfd_error.file, output);
+      return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
+    }
+
+  for (h = 0 ; h < count ; h++)
+    {
+      inputs[h].hnd = -1;
+
+#ifndef NVWIN3X
+      pthread_mutex_init (&inputs[h].mutex, NULL);
+      pthread_cond_init (&inputs[h].ready, NULL);
+      pthread_cond_init (&inputs[h].space, NULL);
+#endif
+    }
+
+
+  /*  Open everything (this isn't thread safe so it all happens here).  Images are copied through a separate stream so
+      that the writer doesn't get in the way of the reader thread.  */
+
+  for (h = 0 ; h < count ; h++)
+    {
+      if ((inputs[h].hnd = binaryFeatureData_do_open_file (input[h], &header, BFDATA_READONLY)) < 0)
+        {
+          inputs[h].hnd = -1;
+          binaryFeatureData_merge_cleanup (inputs, count, out);
+          return (bfd_error.bfd);
+        }
+
+      inputs[h].count = header.number_of_records;
+      inputs[h].base = total;
+      total += inputs[h].count;
+
+      if ((inputs[h].ifp = fopen64 (bfdh[inputs[h].hnd].a_path, "rb")) == NULL)
+        {
+          bfd_error.system = errno;
+          strcpy (bfd_error.file, bfdh[inputs[h].hnd].a_path);
+          bfd_error.bfd = BFDATA_OPEN_POLY_READONLY_ERROR;
+          binaryFeatureData_merge_cleanup (inputs, count, out);
+          return (bfd_error.bfd);
+        }
+
+      if ((inputs[h].poly = (BFDATA_POLYGON *) malloc (sizeof (BFDATA_POLYGON))) == NULL ||
+          (order_by_time && (inputs[h].key = (INTERNAL_BFDATA_MERGE_KEY *) malloc ((inputs[h].count + 1) *
+                                                                                   sizeof (INTERNAL_BFDATA_MERGE_KEY))) == NULL) ||
+          (order_by_time && (inputs[h].map = (uint32_t *) malloc ((inputs[h].count + 1) * sizeof (uint32_t))) == NULL))
+        {
+          bfd_error.system = errno;
+          strcpy (bfd_error.file, input[h]);
+          bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR;
+          binaryFeatureData_merge_cleanup (inputs, count, out);
+          return (bfd_error.bfd);
+        }
+    }
+
+  if ((out = binaryFeatureData_do_create_file (output, bfd_header)) < 0)
+    {
+      out = -1;
+      binaryFeatureData_merge_cleanup (inputs, count, out);
+      return (bfd_error.bfd);
+    }
+
+  if ((poly = (BFDATA_POLYGON *) malloc (sizeof (BFDATA_POLYGON))) == NULL || (source = (uint32_t *) malloc ((total + 1) * sizeof (uint32_t))) == NULL ||
+      (heap = (uint32_t *) malloc (count * sizeof (uint32_t))) == NULL)
+    {
+      free (poly);
+      free (source);
+      bfd_error.system = errno;
+      strcpy (bfd_error.file, output);
+      bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR;
+      binaryFeatureData_merge_cleanup (inputs, count, out);
+      return (bfd_error.bfd);
+    }
+
+
+  if (order_by_time)
+    {
+      /*  Scan and sort all of the inputs at once.  */
+
+#ifndef NVWIN3X
+
+      for (h = 0 ; h < count ; h++)
+        {
+          if (pthread_create (&inputs[h].thread, NULL, binaryFeatureData_merge_scan, &inputs[h])) binaryFeatureData_merge_scan (&inputs[h]);
+          else inputs[h].running = 1;
+        }
+
+      for (h = 0 ; h < count ; h++)
+        {
+          if (inputs[h].running) pthread_join (inputs[h].thread, NULL);
+          inputs[h].running = 0;
+        }
+
+#else
+
+      for (h = 0 ; h < count ; h++) binaryFeatureData_merge_scan (&inputs[h]);
+
+#endif
+
+      for (h = 0 ; h < count ; h++)
+        {
+          if (inputs[h].status < 0)
+            {
+              bfd_error = inputs[h].error;
+              free (poly);
+              free (source);
+              free (heap);
+              binaryFeatureData_merge_cleanup (inputs, count, out);
+              return (bfd_error.bfd);
+            }
+        }
+
+
+      /*  k-way merge of the sorted inputs using a min heap of input numbers (keyed on each input's next record).  The
+          merge gives us the output order (source) and the new record number of every input record (map).  */
+
+      heap_count = 0;
+
+      for (h = 0 ; h < count ; h++)
+        {
+          inputs[h].next = 0;
+          if (inputs[h].count) heap[heap_count++] = h;
+        }
+
+      for (i = heap_count / 2 ; i-- > 0 ;) binaryFeatureData_merge_sift (inputs, heap, heap_count, i);
+
+      for (out_rec = 0 ; heap_count ; out_rec++)
+        {
+          h = heap[0];
+
+          source[out_rec] = h;
+          inputs[h].map[inputs[h].key[inputs[h].next].recnum] = out_rec;
+
+          if (++inputs[h].next == inputs[h].count) heap[0] = heap[--heap_count];
+
+          binaryFeatureData_merge_sift (inputs, heap, heap_count, 0);
+        }
+    }
+  else
+    {
+      for (h = 0, out_rec = 0 ; h < count ; h++)
+        for (i = 0 ; i < inputs[h].count ; i++) source[out_rec++] = h;
+    }
+
+  free (heap);
+
+
+  /*  Start the readers.  */
+
+#ifndef NVWIN3X
+
+  for (h = 0 ; h < count ; h++)
+    {
+      inputs[h].status = BFDATA_SUCCESS;
+
+      if ((ret = pthread_create (&inputs[h].thread, NULL, binaryFeatureData_merge_read, &inputs[h])))
+        {
+          bfd_error.system = ret;
+          strcpy (bfd_error.file, "binaryFeatureData_merge_files");
+          bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR;
+          free (poly);
+          free (source);
+          binaryFeatureData_merge_cleanup (inputs, count, out);
+          return (bfd_error.bfd);
+        }
+
+      inputs[h].running = 1;
+    }
+
+#endif
+
+
+  /*  Write the merged file.  */
+
+  binaryFeatureData_set_append_buffer (out, BFDATA_APPEND_BUFFER_SIZE);
+
+  for (out_rec = 0 ; out_rec < total ; out_rec++)
+    {
+      h = source[out_rec];
+
+      if ((slot = binaryFeatureData_merge_next (&inputs[h])) == NULL)
+        {
+          free (poly);
+          free (source);
+          binaryFeatureData_merge_cleanup (inputs, count, out);
+          return (bfd_error.bfd);
+        }
+
+
+      /*  Remap the links (stored as record number plus 1).  */
+
+      link = slot->record.parent_record;
+      slot->record.parent_record = link && link <= inputs[h].count ? (inputs[h].map != NULL ? inputs[h].map[link - 1] : inputs[h].base + link - 1) + 1 : 0;
+      link = slot->record.child_record;
+      slot->record.child_record = link && link <= inputs[h].count ? (inputs[h].map != NULL ? inputs[h].map[link - 1] : inputs[h].base + link - 1) + 1 : 0;
+
+
+      if (slot->poly != NULL)
+        {
+          memcpy (poly->latitude, slot->poly, slot->record.poly_count * sizeof (double));
+          memcpy (poly->longitude, slot->poly + slot->record.poly_count, slot->record.poly_count * sizeof (double));
+        }
+      else
+        {
+          slot->record.poly_count = 0;
+          slot->record.poly_address = 0;
+        }
+
+
+      if (binaryFeatureData_copy_image (out, out_rec, inputs[h].ifp, bfdh[inputs[h].hnd].a_path, &slot->record) < 0)
+        {
+          binaryFeatureData_merge_release (&inputs[h], slot);
+          free (poly);
+          free (source);
+          binaryFeatureData_merge_cleanup (inputs, count, out);
+          return (bfd_error.bfd);
+        }
+
+
+      ret = binaryFeatureData_do_write_record (out, BFDATA_NEXT_RECORD, &slot->record, slot->poly != NULL ? poly : NULL, NULL);
+
+      binaryFeatureData_merge_release (&inputs[h], slot);
+
+      if (ret < 0)
+        {
+          free (poly);
+          free (source);
+          binaryFeatureData_merge_cleanup (inputs, count, out);
+          return (bfd_error.bfd);
+        }
+    }
+
+  free (poly);
+  free (source);
+
+
+  /*  Closing the output writes the header (and flushes the append buffer) so check it.  */
+
+  ret = binaryFeatureData_do_close_file (out);
+  out = -1;
+
+  if (ret < 0)
+    {
+      binaryFeatureData_merge_cleanup (inputs, count, out);
+      return (bfd_error.bfd);
+    }
+
+  binaryFeatureData_merge_cleanup (inputs, count, out);
+
+
+  bfd_error.system = 0;
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
+
+
+
+/*!  Output record number (plus 1) in a split tile of the input record "link" (plus 1), or 0 if that record isn't in the
+     tile.  */
+
+static uint32_t binaryFeatureData_split_link (INTERNAL_BFDATA_SPLIT_TILE *tile, uint32_t link)
+{
+  uint32_t lo = 0, hi = tile->count, mid;
+
+
+  if (!link) return (0);
+
+  link--;
+
+  while (lo < hi)
+    {
+      mid = lo + (hi - lo) / 2;
+
+      if (tile->record[mid] < link)
+        {
+          lo = mid + 1;
+        }
+      else
+        {
+          hi = mid;
+        }
+    }
+
+
+  return (lo < tile->count && tile->record[lo] == link ? lo + 1 : 0);
+}
+
+
+
+/*!  Write one queued record (and its polygon and image) to a split tile.  The slot's polygon is freed.  */
+
+static int32_t binaryFeatureData_split_write (INTERNAL_BFDATA_SPLIT_TILE *tile, INTERNAL_BFDATA_MERGE_SLOT *slot)
+{
+  int32_t ret;
+
+
+  slot->record.parent_record = binaryFeatureData_split_link (tile, slot->record.parent_record);
+  slot->record.child_record = binaryFeatureData_split_link (tile, slot->record.child_record);
+
+  if (slot->poly != NULL)
+    {
+      memcpy (tile->poly->latitude, slot->poly, slot->record.poly_count * sizeof (double));
+      memcpy (tile->poly->longitude, slot->poly + slot->record.poly_count, slot->record.poly_count * sizeof (double));
+
+      free (slot->poly);
+      slot->poly = NULL;
+    }
+  else
+    {
+      slot->record.poly_count = 0;
+      slot->record.poly_address = 0;
+    }
+
+  if (binaryFeatureData_copy_image (tile->hnd, tile->tail, tile->ifp, tile->i_path, &slot->record) < 0) return (bfd_error.bfd);
+
+  ret = binaryFeatureData_do_write_record (tile->hnd, BFDATA_NEXT_RECORD, &slot->record, slot->record.poly_count ? tile->poly : NULL, NULL);
+
+
+  return (ret);
+}
+
+
+
+#ifndef NVWIN3X
+
+/*!  Split writer (run in a thread per tile).  Writes the tile's records as they show up in its queue.  */
+
+static void *binaryFeatureData_split_thread (void *arg)
+{
+  INTERNAL_BFDATA_SPLIT_TILE *tile = (INTERNAL_BFDATA_SPLIT_TILE *) arg;
+  INTERNAL_BFDATA_MERGE_SLOT *slot;
+  int32_t status;
+
+
+  while (tile->tail < tile->count)
+    {
+      pthread_mutex_lock (&tile->mutex);
+
+      while (tile->head == tile->tail && !tile->stop) pthread_cond_wait (&tile->ready, &tile->mutex);
+
+      if (tile->stop)
+        {
+          pthread_mutex_unlock (&tile->mutex);
+          return (NULL);
+        }
+
+      pthread_mutex_unlock (&tile->mutex);
+
+
+      /*  The reader doesn't touch this slot until we move the tail past it.  */
+
+      slot = &tile->slot[tile->tail % BFDATA_MERGE_QUEUE_SIZE];
+
+      status = binaryFeatureData_split_write (tile, slot);
+
+      pthread_mutex_lock (&tile->mutex);
+
+      if (status < 0)
+        {
+          tile->error = bfd_error;
+          tile->status = status;
+        }
+      else
+        {
+          tile->tail++;
+        }
+
+      pthread_cond_signal (&tile->space);
+      pthread_mutex_unlock (&tile->mutex);
+
+      if (status < 0) return (NULL);
+    }
+
+
+  return (NULL);
+}
+
+#endif
+
+
+
+/*!  Queue a record (and its polygon, if poly isn't NULL) for a split tile.  */
+
+static int32_t binaryFeatureData_split_push (INTERNAL_BFDATA_SPLIT_TILE *tile, BFDATA_RECORD *bfd_record, BFDATA_POLYGON *poly)
+{
+  INTERNAL_BFDATA_MERGE_SLOT *slot;
+
+
+#ifdef NVWIN3X
+
+  slot = &tile->slot[0];
+
+#else
+
+  pthread_mutex_lock (&tile->mutex);
+
+  while (tile->head - tile->tail == BFDATA_MERGE_QUEUE_SIZE && tile->status == BFDATA_SUCCESS) pthread_cond_wait (&tile->space, &tile->mutex);
+
+  if (tile->status < 0)
+    {
+      bfd_error = tile->error;
+      pthread_mutex_unlock (&tile->mutex);
+      return (bfd_error.bfd);
+    }
+
+  pthread_mutex_unlock (&tile->mutex);
+
+  slot = &tile->slot[tile->head % BFDATA_MERGE_QUEUE_SIZE];
+
+#endif
+
+
+  slot->record = *bfd_record;
+  slot->poly = NULL;
+
+  if (poly != NULL)
+    {
+      if ((slot->poly = (double *) malloc (bfd_record->poly_count * 2 * sizeof (double))) == NULL)
+        {
+          bfd_error.system = errno;
+          bfd_error.recnum = tile->head;
+          strcpy (bfd_error.file, bfdh[tile->hnd].path);
+          return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
+        }
+
+      memcpy (slot->poly, poly->latitude, bfd_record->poly_count * sizeof (double));
+      memcpy (slot->poly + bfd_record->poly_count, poly->longitude, bfd_record->poly_count * sizeof (double));
+    }
+
+
+#ifdef NVWIN3X
+
+  tile->head++;
+
+  if (binaryFeatureData_split_write (tile, slot) < 0) return (bfd_error.bfd);
+
+  tile->tail++;
+
+#else
+
+  pthread_mutex_lock (&tile->mutex);
+
+  tile->head++;
+
+  pthread_cond_signal (&tile->ready);
+  pthread_mutex_unlock (&tile->mutex);
+
+#endif
+
+
+  return (BFDATA_SUCCESS);
+}
+
+
+
+/*!  Stop any split threads, close the tile files, and free everything.  The error state is left alone.  */
+
+static void binaryFeatureData_split_cleanup (INTERNAL_BFDATA_SPLIT_TILE *tiles, int32_t count)
+{
+  BFDATA_ERROR_STRUCT error = bfd_error;
+  uint32_t i;
+  int32_t j;
+
+
+  for (j = 0 ; j < count ; j++)
+    {
+#ifndef NVWIN3X
+
+      if (tiles[j].running)
+        {
+          pthread_mutex_lock (&tiles[j].mutex);
+          tiles[j].stop = 1;
+          pthread_cond_signal (&tiles[j].ready);
+          pthread_mutex_unlock (&tiles[j].mutex);
+
+          pthread_join (tiles[j].thread, NULL);
+        }
+
+      pthread_mutex_destroy (&tiles[j].mutex);
+      pthread_cond_destroy (&tiles[j].ready);
+      pthread_cond_destroy (&tiles[j].space);
+
+#endif
+
+      for (i = 0 ; i < BFDATA_MERGE_QUEUE_SIZE ; i++) free (tiles[j].slot[i].poly);
+
+      free (tiles[j].poly);
+
+      if (tiles[j].ifp != NULL) fclose (tiles[j].ifp);
+
+      if (tiles[j].hnd >= 0) binaryFeatureData_do_close_file (tiles[j].hnd);
+    }
+
+  free (tiles);
+
+  bfd_error = error;
+}
+
+
+
+/*!  Write "count" tiles of the file open as "hnd" (tile_record[tile_index[i]] through tile_record[tile_index[i + 1] - 1]
+     are the records that go in output[i]).  The input is read once in record order and each tile has its own writer
+     thread.  If there aren't enough free handles for all of the tiles at once they're done in batches.  */
+
+static int32_t binaryFeatureData_split (int32_t hnd, BFDATA_HEADER bfd_header, int32_t count, const char **output, const uint32_t *tile_index,
+                                        const uint32_t *tile_record)
+{
+  INTERNAL_BFDATA_SPLIT_TILE *tiles;
+  BFDATA_RECORD bfd_record;
+  BFDATA_POLYGON *poly;
+  uint32_t recnum;
+  int32_t i, j, start, batch = 0, ret;
+  uint8_t wanted;
+
+
+  for (i = 0 ; i < BFDATA_MAX_FILES ; i++) if (bfdh[i].fp == NULL) batch++;
+
+  if (!batch)
+    {
+      bfd_error.system = 0;
+      strcpy (bfd_error.file, output[0]);
+      return (bfd_error.bfd = BFDATA_TOO_MANY_OPEN_FILES);
+    }
+
+  if ((poly = (BFDATA_POLYGON *) malloc (sizeof (BFDATA_POLYGON))) == NULL)
+    {
+      bfd_error.system = errno;
+      strcpy (bfd_error.file, bfdh[hnd].path);
+      return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
+    }
+
+
+  for (start = 0 ; start < count ; start += batch)
+    {
+      if (batch > count - start) batch = count - start;
+
+      if ((tiles = (INTERNAL_BFDATA_SPLIT_TILE *) calloc (batch, sizeof (INTERNAL_BFDATA_SPLIT_TILE))) == NULL)
+        {
+          bfd_error.system = errno;
+          strcpy (bfd_error.file, output[start]);
+          free (poly);
+          return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
+        }
+
+      for (j = 0 ; j < batch ; j++)
+        {
+          tiles[j].hnd = -1;
+          tiles[j].i_path = bfdh[hnd].a_path;
+          tiles[j].count = tile_index[start + j + 1] - tile_index[start + j];
+          tiles[j].record = &tile_record[tile_index[start + j]];
+
+#ifndef NVWIN3X
+          pthread_mutex_init (&tiles[j].mutex, NULL);
+          pthread_cond_init (&tiles[j].ready, NULL);
+          pthread_cond_init (&tiles[j].space, NULL);
+#endif
+        }
+
+
+      /*  Create the outputs (this isn't thread safe so it all happens here).  */
+
+      for (j = 0 ; j < batch ; j++)
+        {
+          if ((tiles[j].hnd = binaryFeatureData_do_create_file (output[start + j], bfd_header)) < 0)
+            {
+              tiles[j].hnd = -1;
+              binaryFeatureData_split_cleanup (tiles, batch);
+              free (poly);
+              return (bfd_error.bfd);
+            }
+
+          binaryFeatureData_set_append_buffer (tiles[j].hnd, BFDATA_APPEND_BUFFER_SIZE);
+
+          if ((tiles[j].ifp = fopen64 (bfdh[hnd].a_path, "rb")) == NULL)
+            {
+              bfd_error.system = errno;
+              strcpy (bfd_error.file, bfdh[hnd].a_path);
+              bfd_error.bfd = BFDATA_OPEN_POLY_READONLY_ERROR;
+              binaryFeatureData_split_cleanup (tiles, batch);
+              free (poly);
+              return (bfd_error.bfd);
+            }
+
+          if ((tiles[j].poly = (BFDATA_POLYGON *) malloc (sizeof (BFDATA_POLYGON))) == NULL)
+            {
+              bfd_error.system = errno;
+              strcpy (bfd_error.file, output[start + j]);
+              bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR;
+              binaryFeatureData_split_cleanup (tiles, batch);
+              free (poly);
+              return (bfd_error.bfd);
+            }
+
+#ifndef NVWIN3X
+
+          if ((ret = pthread_create (&tiles[j].thread, NULL, binaryFeatureData_split_thread, &tiles[j])))
+            {
+              bfd_error.system = ret;
+              strcpy (bfd_error.file, output[start + j]);
+              bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR;
+              binaryFeatureData_split_cleanup (tiles, batch);
+              free (poly);
+              return (bfd_error.bfd);
+            }
+
+          tiles[j].running = 1;
+
+#endif
+        }
+
+
+      /*  One pass through the input handing each record to the tiles that want it.  */
+
+      for (recnum = 0 ; recnum < bfdh[hnd].header.number_of_records ; recnum++)
+        {
+          wanted = 0;
+          for (j = 0 ; j < batch ; j++)
+            {
+              if (tiles[j].next < tiles[j].count && tiles[j].record[tiles[j].next] == recnum)
+                {
+                  wanted = 1;
+                  break;
+                }
+            }
+
+          if (!wanted) continue;
+
+
+          if (binaryFeatureData_do_read_record (hnd, recnum, &bfd_record) < 0 ||
+              (bfd_record.poly_count && bfd_record.poly_address && binaryFeatureData_do_read_polygon (hnd, recnum, poly) < 0))
+            {
+              binaryFeatureData_split_cleanup (tiles, batch);
+              free (poly);
+              return (bfd_error.bfd);
+            }
+
+          for (j = 0 ; j < batch ; j++)
+            {
+              if (tiles[j].next < tiles[j].count && tiles[j].record[tiles[j].next] == recnum)
+                {
+                  tiles[j].next++;
+
+                  if (binaryFeatureData_split_push (&tiles[j], &bfd_record, bfd_record.poly_count && bfd_record.poly_address ? poly : NULL) < 0)
+                    {
+                      binaryFeatureData_split_cleanup (tiles, batch);
+                      free (poly);
+                      return (bfd_error.bfd);
+                    }
+                }
+            }
+        }
+
+
+      /*  Wait for the writers and close the outputs (which writes their headers).  */
+
+      for (j = 0 ; j < batch ; j++)
+        {
+#ifndef NVWIN3X
+
+          pthread_join (tiles[j].thread, NULL);
+          tiles[j].running = 0;
+
+#endif
+
+          if (tiles[j].status < 0)
+            {
+              bfd_error = tiles[j].error;
+              binaryFeatureData_split_cleanup (tiles, batch);
+              free (poly);
+              return (bfd_error.bfd);
+            }
+        }
+
+      for (j = 0 ; j < batch ; j++)
+        {
+          ret = binaryFeatureData_do_close_file (tiles[j].hnd);
+          tiles[j].hnd = -1;
+
+          if (ret < 0)
+            {
+              binaryFeatureData_split_cleanup (tiles, batch);
+              free (poly);
+              return (bfd_error.bfd);
+            }
+        }
+
+      binaryFeatureData_split_cleanup (tiles, batch);
+    }
+
+  free (poly);
+
+
+  bfd_error.system = 0;
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_split_file
+
+ - Purpose:     Split a BFD file into one BFD file per tile, where the tiles are a list of
+                (possibly overlapping) bounding boxes.  A feature goes into every tile that
+                contains its position (edges included).  Polygons and images go with their
+                records (images are copied straight from .bfa file to .bfa file) and
+                parent_record/child_record links are remapped within each tile.  Links to
+                records that aren't in the same tile are dropped.  The input is read once
+                and each tile is written by its own thread.
+
+ - Date:        10/19/26
+
+ - Arguments:
+                - input          =    Input file name
+                - count          =    Number of tiles
+                - tiles          =    Tile bounding boxes
+                - output         =    Output file names (one per tile, they will be
+                                      created even if the tile is empty)
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_INVALID_QUERY
+                - BFDATA_TOO_MANY_OPEN_FILES
+                - Any error from binaryFeatureData_open_file, binaryFeatureData_create_file,
+                  binaryFeatureData_read_record, binaryFeatureData_read_polygon, or
+                  binaryFeatureData_write_record
+                - BFDATA_IMAGE_READ_ERROR
+                - BFDATA_IMAGE_WRITE_ERROR
+                - BFDATA_MEMORY_ALLOCATION_ERROR
+
+ - Caveats:     The tiles are written BFDATA_MAX_FILES less the number of open files at a
+                time so a large number of tiles means more than one pass through the input.
+                Bounding boxes don't wrap across 180 degrees.
+
+*********************************************************************************************/
+
+BFDATA_DLL int32_t binaryFeatureData_split_file (const char *input, int32_t count, const BFDATA_POLYGON_BOUNDS *tiles, const char **output)
+{
+  BFDATA_HEADER bfd_header;
+  BFDATA_SHORT_FEATURE *feature;
+  BFDATA_ERROR_STRUCT error;
+  uint32_t *tile_index, *tile_record, i, n;
+  int32_t hnd, j, ret;
+
+
+  if (count < 1 || input == NULL || tiles == NULL || output == NULL)
+    {
+      bfd_error.system = 0;
+      strcpy (bfd_error.file, "binaryFeatureData_split_file");
+      return (bfd_error.bfd = BFDATA_INVALID_QUERY);
+    }
+
+  if ((hnd = binaryFeatureData_do_open_file (input, &bfd_header, BFDATA_READONLY)) < 0) return (bfd_error.bfd);
+
+  if (binaryFeatureData_do_read_all_short_features (hnd, &feature) < 0)
+    {
+      error = bfd_error;
+      binaryFeatureData_do_close_file (hnd);
+      bfd_error = error;
+      return (bfd_error.bfd);
+    }
+
+  n = bfd_header.number_of_records;
+
+
+  /*  Count the records in each tile, then fill in the (ascending) record lists.  */
+
+  if ((tile_index = (uint32_t *) calloc (count + 1, sizeof (uint32_t))) == NULL)
+    {
+      bfd_error.system = errno;
+      strcpy (bfd_error.file, input);
+      binaryFeatureData_do_close_file (hnd);
+      return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
+    }
+
+  for (i = 0 ; i < n ; i++)
+    {
+      for (j = 0 ; j < count ; j++)
+        {
+          if (feature[i].latitude >= tiles[j].min_latitude && feature[i].latitude <= tiles[j].max_latitude &&
+              feature[i].longitude >= tiles[j].min_longitude && feature[i].longitude <= tiles[j].max_longitude) tile_index[j + 1]++;
+        }
+    }
+
+  for (j = 0 ; j < count ; j++) tile_index[j + 1] += tile_index[j];
+
+  if ((tile_record = (uint32_t *) malloc ((tile_index[count] + 1) * sizeof (uint32_t))) == NULL)
+    {
+      bfd_error.system = errno;
+      strcpy (bfd_error.file, input);
+      free (tile_index);
+      binaryFeatureData_do_close_file (hnd);
+      return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
+    }
+
+  for (i = 0 ; i < n ; i++)
+    {
+      for (j = 0 ; j < count ; j++)
+        {
+          if (feature[i].latitude >= tiles[j].min_latitude && feature[i].latitude <= tiles[j].max_latitude &&
+              feature[i].longitude >= tiles[j].min_longitude && feature[i].longitude <= tiles[j].max_longitude)
+            tile_record[tile_index[j]++] = i;
+        }
+    }
+
+  for (j = count ; j > 0 ; j--) tile_index[j] = tile_index[j - 1];
+  tile_index[0] = 0;
+
+
+  ret = binaryFeatureData_split (hnd, bfd_header, count, output, tile_index, tile_record);
+
+  free (tile_index);
+  free (tile_record);
+
+  error = bfd_error;
+  binaryFeatureData_do_close_file (hnd);
+  bfd_error = error;
+
+
+  return (ret);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_split_file_grid
+
+ - Purpose:     Split a BFD file into one BFD file per tile of a regular grid (see
+                binaryFeatureData_split_file).  Each feature inside the grid area goes into
+                exactly one tile.  Features on the north or east edge of the area go into the
+                last row or column.  Features outside of the area are not written.
+
+ - Date:        10/19/26
+
+ - Arguments:
+                - input          =    Input file name
+                - area           =    Area covered by the grid
+                - rows           =    Number of rows (south to north)
+                - cols           =    Number of columns (west to east)
+                - output         =    rows * cols output file names, row by row starting
+                                      in the southwest corner
+
+ - Returns:
+                - See binaryFeatureData_split_file
+
+*********************************************************************************************/
+
+BFDATA_DLL int32_t binaryFeatureData_split_file_grid (const char *input, BFDATA_POLYGON_BOUNDS area, int32_t rows, int32_t cols,
+                                                      const char **output)
+{
+  BFDATA_HEADER bfd_header;
+  BFDATA_SHORT_FEATURE *feature;
+  BFDATA_ERROR_STRUCT error;
+  uint32_t *tile_index, *tile_record, *tile, i, n;
+  int32_t hnd, j, row, col, count, ret;
+  double dlat, dlon;
+
+
+  if (rows < 1 || cols < 1 || rows > INT32_MAX / cols || input == NULL || output == NULL || !(area.max_latitude > area.min_latitude) ||
+      !(area.max_longitude > area.min_longitude))
+    {
+      bfd_error.system = 0;
+      strcpy (bfd_error.file, "binaryFeatureData_split_file_grid");
+      return (bfd_error.bfd = BFDATA_INVALID_QUERY);
+    }
+
+  count = rows * cols;
+  dlat = (area.max_latitude - area.min_latitude) / rows;
+  dlon = (area.max_longitude - area.min_longitude) / cols;
+
+  if ((hnd = binaryFeatureData_do_open_file (input, &bfd_header, BFDATA_READONLY)) < 0) return (bfd_error.bfd);
+
+  if (binaryFeatureData_do_read_all_short_features (hnd, &feature) < 0)
+    {
+      error = bfd_error;
+      binaryFeatureData_do_close_file (hnd);
+      bfd_error = error;
+      return (bfd_error.bfd);
+    }
+
+  n = bfd_header.number_of_records;
+
+
+  if ((tile_index = (uint32_t *) calloc (count + 1, sizeof (uint32_t))) == NULL ||
+      (tile = (uint32_t *) malloc ((n + 1) * sizeof (uint32_t))) == NULL)
+    {
+      bfd_error.system = errno;
+      strcpy (bfd_error.file, input);
+      free (tile_index);
+      binaryFeatureData_do_close_file (hnd);
+      return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
+    }
+
+
+  /*  Work out the tile of each record (count means it's outside of the area) then bucket them.  */
+
+  for (i = 0 ; i < n ; i++)
+    {
+      tile[i] = count;
+
+      if (feature[i].latitude >= area.min_latitude && feature[i].latitude <= area.max_latitude &&
+          feature[i].longitude >= area.min_longitude && feature[i].longitude <= area.max_longitude)
+        {
+          row = (int32_t) ((feature[i].latitude - area.min_latitude) / dlat);
+          col = (int32_t) ((feature[i].longitude - area.min_longitude) / dlon);
+
+          if (row >= rows) row = rows - 1;
+          if (col >= cols) col = cols - 1;
+
+          tile[i] = row * cols + col;
+          tile_index[tile[i] + 1]++;
+        }
+    }
+
+  for (j = 0 ; j < count ; j++) tile_index[j + 1] += tile_index[j];
+
+  if ((tile_record = (uint32_t *) malloc ((tile_index[count] + 1) * sizeof (uint32_t))) == NULL)
+    {
+      bfd_error.system = errno;
+      strcpy (bfd_error.file, input);
+      free (tile_index);
+      free (tile);
+      binaryFeatureData_do_close_file (hnd);
+      return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
+    }
+
+  for (i = 0 ; i < n ; i++) if (tile[i] < (uint32_t) count) tile_record[tile_index[tile[i]]++] = i;
+
+  for (j = count ; j > 0 ; j--) tile_index[j] = tile_index[j - 1];
+  tile_index[0] = 0;
+
+  free (tile);
+
+
+  ret = binaryFeatureData_split (hnd, bfd_header, count, output, tile_index, tile_record);
+
+  free (tile_index);
+  free (tile_record);
+
+  error = bfd_error;
+  binaryFeatureData_do_close_file (hnd);
+  bfd_error = error;
+
+
+  return (ret);
+}
+
+
+
+
+/*  binaryFeatureData_read_image without the statistics and tracing (see below).  */
+
+static int32_t binaryFeatureData_do_read_image (int32_t hnd, int32_t recnum, uint8_t *image)
+{
+  if (binaryFeatureData_seek_image (hnd, recnum, 0) < 0) return (bfd_error.bfd);
+
+
+  if (!binaryFeatureData_read (hnd, image, bfdh[hnd].record.image_size, 1, bfdh[hnd].afp))
+    {
+      bfd_error.system = errno;
+      bfd_error.recnum = recnum;
+      strcpy (bfd_error.file, bfdh[hnd].a_path);
+      return (bfd_error.bfd = BFDATA_IMAGE_READ_ERROR);
+    }
+
+  bfdh[hnd].stats.images_read++;
+
+
+  bfdh[hnd].write = 0;
+
+
+  bfd_error.system = 0;
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_read_image
+
+ - Purpose:     Retrieve the associated image for the given record.
+
+ - Author:      Jan C. Depner (area.based.editor@gmail.com)
+
+ - Date:        03/25/09
+
+ - Arguments:
+                - hnd            =    The file handle
+                - recnum         =    The record number of the BFD polygon to be retrieved
+                - image          =    The image.
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_NO_IMAGE_AVAILABLE
+                - BFDATA_INVALID_RECORD_NUMBER
+                - BFDATA_IMAGE_READ_FSEEK_ERROR
+                - BFDATA_IMAGE_READ_ERROR
+
+*********************************************************************************************/
+
+BFDATA_DLL int32_t binaryFeatureData_read_image (int32_t hnd, int32_t recnum, uint8_t *image)
+{
+  INTERNAL_BFDATA_OPERATION operation;
+  int32_t status;
+
+
+  if (!instrumented) return (binaryFeatureData_do_read_image (hnd, recnum, image));
+
+  binaryFeatureData_begin_operation (&operation, BFDATA_OPERATION_READ_IMAGE, hnd, recnum);
+
+  status = binaryFeatureData_do_read_image (hnd, recnum, image);
+
+  binaryFeatureData_end_operation (&operation, status);
+
+  return (status);
+}
+
+
+
+
+/*  binaryFeatureData_read_image_chunk without the statistics and tracing (see below).  */
+
+static int32_t binaryFeatureData_do_read_image_chunk (int32_t hnd, int32_t recnum, uint32_t offset, uint32_t length, uint8_t *buffer,
+                                                      uint32_t *bytes_read)
+{
+  *bytes_read = 0;
+
+
+  if (binaryFeatureData_seek_image (hnd, recnum, offset) < 0) return (bfd_error.bfd);
+
+
+  if (length > bfdh[hnd].record.image_size - offset) length = bfdh[hnd].record.image_size - offset;
+
+  if (length && !binaryFeatureData_read (hnd, buffer, length, 1, bfdh[hnd].afp))
+    {
+      bfd_error.system = errno;
+      bfd_error.recnum = recnum;
+      strcpy (bfd_error.file, bfdh[hnd].a_path);
+      return (bfd_error.bfd = BFDATA_IMAGE_READ_ERROR);
+    }
+
+  *bytes_read = length;
+
+  bfdh[hnd].stats.images_read++;
+
+
+  bfdh[hnd].write = 0;
+
+
+  bfd_error.system = 0;
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_read_image_chunk
+
+ - Purpose:     Retrieve part of the associated image for the given record.  This lets an
+                application read just the start of an image (to get its dimensions, for
+                instance) or read a large image in pieces without allocating a buffer for
+                the whole thing.
+
+ - Date:        10/19/26
+
+ - Arguments:
+                - hnd            =    The file handle
+                - recnum         =    The record number of the BFD image to be retrieved
+                - offset         =    Offset in bytes from the start of the image
+                - length         =    Number of bytes wanted (size of buffer)
+                - buffer         =    Where to put the bytes
+                - bytes_read     =    Number of bytes actually read.  This is less than length
+                                      when the chunk runs past the end of the image and 0 when
+                                      offset is equal to image_size.
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_NO_IMAGE_AVAILABLE
+                - BFDATA_INVALID_RECORD_NUMBER
+                - BFDATA_INVALID_IMAGE_RANGE
+                - BFDATA_IMAGE_READ_FSEEK_ERROR
+                - BFDATA_IMAGE_READ_ERROR
+
+*********************************************************************************************/
+
+BFDATA_DLL int32_t binaryFeatureData_read_image_chunk (int32_t hnd, int32_t recnum, uint32_t offset, uint32_t length, uint8_t *buffer,
+                                                       uint32_t *bytes_read)
+{
+  INTERNAL_BFDATA_OPERATION operation;
+  int32_t status;
+
+
+  if (!instrumented) return (binaryFeatureData_do_read_image_chunk (hnd, recnum, offset, length, buffer, bytes_read));
+
+  binaryFeatureData_begin_operation (&operation, BFDATA_OPERATION_READ_IMAGE, hnd, recnum);
+
+  status = binaryFeatureData_do_read_image_chunk (hnd, recnum, offset, length, buffer, bytes_read);
+
+  binaryFeatureData_end_operation (&operation, status);
+
+  return (status);
+}
+
+
+
+
+/*  binaryFeatureData_read_image_stream without the statistics and tracing (see below).  */
+
+static int32_t binaryFeatureData_do_read_image_stream (int32_t hnd, int32_t recnum, uint32_t chunk_size, BFDATA_IMAGE_CALLBACK callback,
+                                                       void *user_data)
+{
+  uint8_t *chunk;
+  uint32_t offset, length;
+
+
+  if (binaryFeatureData_seek_image (hnd, recnum, 0) < 0) return (bfd_error.bfd);
+
+
+  if (!chunk_size) chunk_size = BFDATA_IMAGE_CHUNK_SIZE;
+  if (chunk_size > bfdh[hnd].record.image_size) chunk_size = bfdh[hnd].record.image_size;
+
+  if ((chunk = (uint8_t *) malloc (chunk_size)) == NULL)
+    {
+      bfd_error.system = errno;
+      bfd_error.recnum = recnum;
+      strcpy (bfd_error.file, bfdh[hnd].a_path);
+      return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
+    }
+
+
+  /*  The .bfa file is already positioned so we just keep reading.  */
+
+  for (offset = 0 ; offset < bfdh[hnd].record.image_size ; offset += length)
+    {
+      length = bfdh[hnd].record.image_size - offset;
+      if (length > chunk_size) length = chunk_size;
+
+      if (!binaryFeatureData_read (hnd, chunk, length, 1, bfdh[hnd].afp))
+        {
+          free (chunk);
+          bfd_error.system = errno;
+          bfd_error.recnum = recnum;
+          strcpy (bfd_error.file, bfdh[hnd].a_path);
+          return (bfd_error.bfd = BFDATA_IMAGE_READ_ERROR);
+        }
+
+      if ((*callback) (chunk, offset, length, user_data)) break;
+    }
+
+  free (chunk);
+
+  bfdh[hnd].stats.images_read++;
+
+
+  bfdh[hnd].write = 0;
+
+
+  bfd_error.system = 0;
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_read_image_stream
+
+ - Purpose:     Read the associated image for the given record in chunks, handing each chunk
+                to "callback" as it is read.  Only one chunk sized buffer is ever allocated so
+                an application can display or decode a large image progressively.
+
+ - Date:        10/19/26
+
+ - Arguments:
+                - hnd            =    The file handle
+                - recnum         =    The record number of the BFD image to be retrieved
+                - chunk_size     =    Chunk size in bytes (0 = BFDATA_IMAGE_CHUNK_SIZE)
+                - callback       =    Function called with each chunk (see BFDATA_IMAGE_CALLBACK).
+                                      If it returns non-zero we stop reading.
+                - user_data      =    Passed through to callback
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_NO_IMAGE_AVAILABLE
+                - BFDATA_INVALID_RECORD_NUMBER
+                - BFDATA_MEMORY_ALLOCATION_ERROR
+                - BFDATA_IMAGE_READ_FSEEK_ERROR
+                - BFDATA_IMAGE_READ_ERROR
+
+ - Caveats:     Don't call other functions on this handle from inside callback.
+
+*********************************************************************************************/
+
+BFDATA_DLL int32_t binaryFeatureData_read_image_stream (int32_t hnd, int32_t recnum, uint32_t chunk_size, BFDATA_IMAGE_CALLBACK callback,
+                                                        void *user_data)
+{
+  INTERNAL_BFDATA_OPERATION operation;
+  int32_t status;
+
+
+  if (!instrumented) return (binaryFeatureData_do_read_image_stream (hnd, recnum, chunk_size, callback, user_data));
+
+  binaryFeatureData_begin_operation (&operation, BFDATA_OPERATION_READ_IMAGE, hnd, recnum);
+
+  status = binaryFeatureData_do_read_image_stream (hnd, recnum, chunk_size, callback, user_data);
+
+  binaryFeatureData_end_operation (&operation, status);
+
+  return (status);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_update_header
+
+ - Purpose:     Update the modifiable fields of the header record.  See BFDATA_HEADER in bfd.h to
+                determine which fields are modifiable after file creation.
+
+ - Author:      Jan C. Depner (area.based.editor@gmail.com)
+
+ - Date:        03/27/09
+
+ - Arguments:
+                - hnd            =    The file handle
+                - bfd_header     =    The BFDATA_HEADER structure.
+
+ - Returns:
+                - void
+
+*********************************************************************************************/
+
+BFDATA_DLL void binaryFeatureData_update_header (int32_t hnd, BFDATA_HEADER bfd_header)
+{
+  strcpy (bfdh[hnd].header.modification_software, bfd_header.modification_software);
+  strcpy (bfdh[hnd].header.security_classification, bfd_header.security_classification);
+  strcpy (bfdh[hnd].header.distribution, bfd_header.distribution);
+  strcpy (bfdh[hnd].header.declassification, bfd_header.declassification);
+  strcpy (bfdh[hnd].header.class_just, bfd_header.class_just);
+  strcpy (bfdh[hnd].header.downgrade, bfd_header.downgrade);
+  strcpy (bfdh[hnd].header.comments, bfd_header.comments);
+
+
+  /*  Force a header write when we close the file.  */
+
+  bfdh[hnd].modified = 1;
+  bfdh[hnd].write = 1;
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_set_durability
+
+ - Purpose:     Set the durability mode for an open BFD file.  This controls when (or if) the
+                library forces the BFD and associated polygon/image files to disk.  Throughput
+                oriented applications will want BFDATA_DURABILITY_NONE or
+                BFDATA_DURABILITY_GROUP, interactive editors will probably want
+                BFDATA_DURABILITY_DATASYNC.
+
+ - Date:        10/19/26
+
+ - Arguments:
+                - hnd            =    The file handle
+                - mode           =    BFDATA_DURABILITY_NONE, BFDATA_DURABILITY_FLUSH,
+                                      BFDATA_DURABILITY_DATASYNC, or BFDATA_DURABILITY_GROUP
+                - records        =    For BFDATA_DURABILITY_GROUP, sync after this many records
+                                      have been written (0 to ignore)
+                - msecs          =    For BFDATA_DURABILITY_GROUP, sync on the first record
+                                      written at least this many milliseconds after the last sync
+                                      (0 to ignore)
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_INVALID_DURABILITY_MODE
+
+ - Caveats:     A group sync rewrites the header (so that [NUMBER OF RECORDS] is correct on disk)
+                and then fdatasyncs both files.  It is only checked when a record is written so
+                the msecs interval is not a timer.
+
+*********************************************************************************************/
+
+BFDATA_DLL int32_t binaryFeatureData_set_durability (int32_t hnd, int32_t mode, uint32_t records, uint32_t msecs)
+{
+  if (mode < BFDATA_DURABILITY_NONE || mode > BFDATA_DURABILITY_GROUP)
+    {
+      strcpy (bfd_error.file, bfdh[hnd].path);
+      return (bfd_error.bfd = BFDATA_INVALID_DURABILITY_MODE);
+    }
+
+
+  bfdh[hnd].durability = mode;
+  bfdh[hnd].sync_records = records;
+  bfdh[hnd].sync_msecs = msecs;
+  bfdh[hnd].unsynced_records = 0;
+  bfdh[hnd].last_sync = binaryFeatureData_msecs ();
+
+
+  bfd_error.system = 0;
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
+
+
+
+
+/*  binaryFeatureData_sync without the statistics and tracing (see below).  */
 
-      if (strstr (varin, "[SECURITY CLASSIFICATION]")) strcpy (bfdh[hnd].header.security_classification, info);
+static int32_t binaryFeatureData_do_sync (int32_t hnd)
+{
+  /*  Nothing to do if the file isn't open.  */
 
-      if (strstr (varin, "[NUMBER OF RECORDS]")) sscanf (info, "%d", &bfdh[hnd].header.number_of_records);
+  if (bfdh[hnd].fp == NULL) return (bfd_error.bfd = BFDATA_SUCCESS);
 
-      if (strstr (varin, "{COMMENTS ="))
-        {
-          strcpy (bfdh[hnd].header.comments, "");
-          while (fgets (varin, sizeof (varin), bfdh[hnd].fp))
-            {
-              if (varin[0] == '}') break;
-              strcat (bfdh[hnd].header.comments, varin);
-            }
-        }
 
+  if (binaryFeatureData_flush_append (hnd) < 0) return (bfd_error.bfd);
 
-      if (strstr (varin, "[HEADER SIZE]")) sscanf (info, "%d", &bfdh[hnd].header_size);
-      if (strstr (varin, "[RECORD SIZE]")) sscanf (info, "%d", &bfdh[hnd].record_size);
+
+  if (bfdh[hnd].created || bfdh[hnd].modified)
+    {
+      if (binaryFeatureData_write_header (hnd) < 0) return (bfd_error.bfd);
     }
 
 
-  /*  Pre 2.00 screwup.  I used the structure size even though I wasn't writing structures.  DOH!  */
+  if (binaryFeatureData_sync_stream (bfdh[hnd].afp))
+    {
+      bfd_error.system = errno;
+      strcpy (bfd_error.file, bfdh[hnd].a_path);
+      return (bfd_error.bfd = BFDATA_SYNC_ERROR);
+    }
 
-  if (bfdh[hnd].major_version < 2)
+  if (binaryFeatureData_sync_stream (bfdh[hnd].fp))
     {
-      /*  Try to determine the correct record size since it was different when written on 32 vs 64 bit.  */
+      bfd_error.system = errno;
+      strcpy (bfd_error.file, bfdh[hnd].path);
+      return (bfd_error.bfd = BFDATA_SYNC_ERROR);
+    }
 
 
-      fseek (bfdh[hnd].fp, 0, SEEK_END);
-      eof = ftell (bfdh[hnd].fp);
-      fseek (bfdh[hnd].fp, 0, SEEK_SET);
+  /*  Everything in the journal is on disk now.  */
 
-      eof -= bfdh[hnd].header_size;
-      bfdh[hnd].record_size = NINT ((float) eof / (float) bfdh[hnd].header.number_of_records);
+  if (binaryFeatureData_reset_journal (hnd) < 0) return (bfd_error.bfd);
 
-      if (bfdh[hnd].record_size != sizeof (BFDATA_RECORD))
-        {
-	  /*  Record size of 544 was written on a 32 bit system.  */
 
-	  if (bfdh[hnd].record_size == 544)
-	    {
-	      fprintf (stderr, "\n\nBig problem!  Pre 2.00 file written on 32 bit system.\n");
-	      fprintf (stderr, "The easiest solution is to log in to a 32 bit system and run\n");
-	      fprintf (stderr, "bfd2miw then miw2bfd.  This will convert the file to BFD 2.0 format.\n\n\n");
-	    }
-	  else
-	    {
-	      fprintf (stderr, "\n\nBig problem!  Pre 2.00 file written on 64 bit system.\n");
-	      fprintf (stderr, "The easiest solution is to log in to a 64 bit system and run\n");
-	      fprintf (stderr, "bfd2miw then miw2bfd.  This will convert the file to BFD 2.0 format.\n\n\n");
-	    }
-	  exit (-1);
-        }
-    }
+  bfdh[hnd].unsynced_records = 0;
+  bfdh[hnd].last_sync = binaryFeatureData_msecs ();
 
 
-  bfdh[hnd].modified = 0;
-  bfdh[hnd].created = 0;
-  bfdh[hnd].write = 0;
+  bfd_error.system = 0;
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
 
 
-  binaryFeatureData_inv_cvtime (year[0] - 1900, jday[0], hour[0], minute[0], second[0], &bfdh[hnd].header.creation_tv_sec,
-                  &bfdh[hnd].header.creation_tv_nsec);
 
-  binaryFeatureData_inv_cvtime (year[1] - 1900, jday[1], hour[1], minute[1], second[1], &bfdh[hnd].header.modification_tv_sec,
-                  &bfdh[hnd].header.modification_tv_nsec);
+/********************************************************************************************/
+/*!
 
+ - Function:    binaryFeatureData_sync
 
-  *bfd_header = bfdh[hnd].header;
+ - Purpose:     Force everything written so far to disk.  If the file has been modified the
+                header is rewritten first so that the on-disk [NUMBER OF RECORDS] matches what
+                has been written.  The associated polygon/image file is synced before the BFD
+                file.
 
+ - Date:        10/19/26
 
-  bfd_error.system = 0;
-  return (hnd);
+ - Arguments:   hnd            =    The file handle
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_HEADER_WRITE_FSEEK_ERROR
+                - BFDATA_HEADER_WRITE_ERROR
+                - BFDATA_SYNC_ERROR
+
+*********************************************************************************************/
+
+BFDATA_DLL int32_t binaryFeatureData_sync (int32_t hnd)
+{
+  INTERNAL_BFDATA_OPERATION operation;
+  int32_t status;
+
+
+  if (!instrumented) return (binaryFeatureData_do_sync (hnd));
+
+  binaryFeatureData_begin_operation (&operation, BFDATA_OPERATION_SYNC, hnd, -1);
+
+  status = binaryFeatureData_do_sync (hnd);
+
+  binaryFeatureData_end_operation (&operation, status);
+
+  return (status);
 }
 
 
+
 /********************************************************************************************/
 /*!
 
- - Function:    binaryFeatureData_close_file
-
- - Purpose:     Close a BFD file.
+ - Function:    binaryFeatureData_set_journal
 
- - Author:      Jan C. Depner (area.based.editor@gmail.com)
+ - Purpose:     Turn write-ahead journaling on or off for a BFD file opened for update (or
+                created).  When journaling is on, every record written by
+                binaryFeatureData_write_record is also logged to the .bfj journal file.  The
+                journal is group committed every "group" records (one sync of the .bfa file
+                and one sync of the journal per group, the 64KB header is not rewritten).  If
+                the application crashes before the file is closed, the next
+                binaryFeatureData_open_file (BFDATA_UPDATE) replays the committed entries.  The
+                journal is checkpointed (emptied) by binaryFeatureData_sync and removed by
+                binaryFeatureData_close_file.
 
- - Date:        03/27/09
+ - Date:        10/19/26
 
- - Arguments:   hnd            =    The file handle
+ - Arguments:
+                - hnd            =    The file handle
+                - group          =    Number of records per group commit or 0 to turn
+                                      journaling off
 
  - Returns:
                 - BFDATA_SUCCESS
-                - BFDATA_CLOSE_ERROR
-                - BFDATA_CLOSE_POLY_ERROR
+                - BFDATA_JOURNAL_OPEN_ERROR
+                - BFDATA_JOURNAL_WRITE_ERROR
+                - BFDATA_SYNC_ERROR
+
+ - Caveats:     Records written since the last group commit are not protected.  Call
+                binaryFeatureData_sync to commit everything at a point of your choosing.
 
 *********************************************************************************************/
 
-BFDATA_DLL int32_t binaryFeatureData_close_file (int32_t hnd)
+BFDATA_DLL int32_t binaryFeatureData_set_journal (int32_t hnd, uint32_t group)
 {
-  time_t t;
-  struct tm *cur_tm;
+  uint32_t sizes[2];
 
 
-  /*  Just in case we've already closed this file.  */
+  /*  Turning it off.  Checkpoint and get rid of the journal.  */
 
-  if (bfdh[hnd].fp == NULL) return (bfd_error.bfd = BFDATA_SUCCESS);
+  if (!group)
+    {
+      if (bfdh[hnd].jfp == NULL) return (bfd_error.bfd = BFDATA_SUCCESS);
 
+      if (binaryFeatureData_do_sync (hnd) < 0) return (bfd_error.bfd);
 
-  if (bfdh[hnd].modified)
-    {
-      t = time (&t);
-      cur_tm = gmtime (&t);
-      binaryFeatureData_inv_cvtime (cur_tm->tm_year, cur_tm->tm_yday + 1, cur_tm->tm_hour, cur_tm->tm_min, cur_tm->tm_sec, 
-				    &bfdh[hnd].header.modification_tv_sec, &bfdh[hnd].header.modification_tv_nsec);
-    }
+      fclose (bfdh[hnd].jfp);
+      bfdh[hnd].jfp = NULL;
+      remove (bfdh[hnd].j_path);
 
-  if (bfdh[hnd].created)
-    {
-      t = time (&t);
-      cur_tm = gmtime (&t);
-      binaryFeatureData_inv_cvtime (cur_tm->tm_year, cur_tm->tm_yday + 1, cur_tm->tm_hour, cur_tm->tm_min, cur_tm->tm_sec, 
-				    &bfdh[hnd].header.creation_tv_sec, &bfdh[hnd].header.creation_tv_nsec);
+      return (bfd_error.bfd = BFDATA_SUCCESS);
     }
 
-  if (bfdh[hnd].created || bfdh[hnd].modified)
+
+  bfdh[hnd].journal_group = group;
+
+  if (bfdh[hnd].jfp != NULL) return (bfd_error.bfd = BFDATA_SUCCESS);
+
+
+  if (bfdh[hnd].read_only)
     {
-      if (binaryFeatureData_write_header (hnd) < 0) return (bfd_error.bfd = BFDATA_HEADER_WRITE_ERROR);
+      bfd_error.system = EBADF;
+      strcpy (bfd_error.file, bfdh[hnd].j_path);
+      return (bfd_error.bfd = BFDATA_JOURNAL_OPEN_ERROR);
     }
 
 
-  if (fclose (bfdh[hnd].fp))
+  if ((bfdh[hnd].jfp = fopen64 (bfdh[hnd].j_path, "wb+")) == NULL)
     {
       bfd_error.system = errno;
-      strcpy (bfd_error.file, bfdh[hnd].path);
-      return (bfd_error.bfd = BFDATA_CLOSE_ERROR);
+      strcpy (bfd_error.file, bfdh[hnd].j_path);
+      return (bfd_error.bfd = BFDATA_JOURNAL_OPEN_ERROR);
     }
 
 
-  if (fclose (bfdh[hnd].afp))
+  sizes[0] = bfdh[hnd].record_size;
+  sizes[1] = bfdh[hnd].header_size;
+
+  if (!fwrite (BFDATA_JOURNAL_MAGIC, 8, 1, bfdh[hnd].jfp) || !fwrite (sizes, sizeof (sizes), 1, bfdh[hnd].jfp))
     {
       bfd_error.system = errno;
-      strcpy (bfd_error.file, bfdh[hnd].a_path);
-      return (bfd_error.bfd = BFDATA_CLOSE_POLY_ERROR);
+      strcpy (bfd_error.file, bfdh[hnd].j_path);
+      return (bfd_error.bfd = BFDATA_JOURNAL_WRITE_ERROR);
     }
 
+  bfdh[hnd].journal_pending = 0;
 
-  /*  Clear up the short_feature memory if it was allocated.  */
 
-  if (bfdh[hnd].short_feature != NULL) free (bfdh[hnd].short_feature);
+  bfd_error.system = 0;
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
 
 
-  /*  Clear the internal structure.  */
 
-  memset (&bfdh[hnd], 0, sizeof (INTERNAL_BFDATA_STRUCT));
-  bfdh[hnd].fp = NULL;
-  bfdh[hnd].afp = NULL;
-  bfdh[hnd].short_feature = NULL;
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_set_append_buffer
+
+ - Purpose:     Turn sequential append mode on or off.  In append mode records written with
+                BFDATA_NEXT_RECORD (and their polygons and images) are packed into memory
+                buffers and written in large chunks instead of seeking to the end of the BFD
+                and .bfa files and writing each one separately.  The buffers are flushed when
+                they reach "size" bytes, before any write to a specific record number, before
+                any read, and on sync or close.
+
+ - Date:        10/19/26
+
+ - Arguments:
+                - hnd            =    The file handle
+                - size           =    Buffer size in bytes (BFDATA_APPEND_BUFFER_SIZE is a
+                                      reasonable choice) or 0 to turn append mode off
+
+ - Returns:
+                - BFDATA_SUCCESS
+                - BFDATA_POLY_WRITE_FSEEK_ERROR
+                - BFDATA_POLY_WRITE_ERROR
+                - BFDATA_RECORD_WRITE_FSEEK_ERROR
+                - BFDATA_RECORD_WRITE_ERROR
+
+*********************************************************************************************/
+
+BFDATA_DLL int32_t binaryFeatureData_set_append_buffer (int32_t hnd, uint32_t size)
+{
+  if (binaryFeatureData_flush_append (hnd) < 0) return (bfd_error.bfd);
+
+  bfdh[hnd].append_size = size;
 
 
-  bfd_error.system = 0;
   return (bfd_error.bfd = BFDATA_SUCCESS);
 }
 
@@ -1323,88 +9071,139 @@ BFDATA_DLL int32_t binaryFeatureData_close_file (int32_t hnd)
 /********************************************************************************************/
 /*!
 
- - Function:    binaryFeatureData_read_record
-
- - Purpose:     Retrieve a BFD point from a BFD file.
+ - Function:    binaryFeatureData_set_image_dedup
 
- - Author:      Jan C. Depner (area.based.editor@gmail.com)
+ - Purpose:     Turn image deduplication on or off.  With dedup on, each image written is
+                hashed (64 bit FNV-1a) and looked up in a table of the images already in the
+                .bfa file.  If the same bytes are already stored the record just points at
+                the existing copy instead of appending another one.  When dedup is turned on
+                the images already in the file are read and added to the table.
 
- - Date:        03/25/09
+ - Date:        10/19/26
 
  - Arguments:
                 - hnd            =    The file handle
-                - recnum         =    The record number of the BFD record to be retrieved (or
-                                      BFDATA_NEXT_RECORD)
-                - bfd_record     =    The returned BFDATA_RECORD structure
+                - enable         =    1 to turn dedup on, 0 to turn it off
 
  - Returns:
                 - BFDATA_SUCCESS
-                - BFDATA_INVALID_RECORD_NUMBER
-                - BFDATA_READ_FSEEK_ERROR
-                - BFDATA_END_OF_FILE
+                - BFDATA_MEMORY_ALLOCATION_ERROR
+                - BFDATA_RECORD_READ_FSEEK_ERROR
+                - BFDATA_RECORD_READ_ERROR
+                - BFDATA_IMAGE_READ_FSEEK_ERROR
+                - BFDATA_IMAGE_READ_ERROR
+
+ - Caveats:     Since records can now share an image, rewriting an image always appends
+                a new copy (the old one may still be in use) just as it did before.
+                With dedup on, binaryFeatureData_write_record_image_file reads the image
+                file into memory so it can be hashed.
 
 *********************************************************************************************/
 
-BFDATA_DLL int32_t binaryFeatureData_read_record (int32_t hnd, int32_t recnum, BFDATA_RECORD *bfd_record)
+BFDATA_DLL int32_t binaryFeatureData_set_image_dedup (int32_t hnd, uint8_t enable)
 {
-  int32_t pos;
+  BFDATA_RECORD bfd_record;
+  uint8_t buffer[65536];
+  uint32_t i, size, count, recnum;
+  uint64_t hash;
 
 
-  if (recnum >= bfdh[hnd].header.number_of_records || recnum < BFDATA_NEXT_RECORD)
+  if (!enable)
     {
-      bfd_error.recnum = recnum;
-      strcpy (bfd_error.file, bfdh[hnd].path);
-      return (bfd_error.bfd = BFDATA_INVALID_RECORD_NUMBER);
+      if (bfdh[hnd].image_hash != NULL) free (bfdh[hnd].image_hash);
+      bfdh[hnd].image_hash = NULL;
+      bfdh[hnd].image_hash_count = bfdh[hnd].image_hash_size = 0;
+      bfdh[hnd].image_dedup = 0;
+
+      return (bfd_error.bfd = BFDATA_SUCCESS);
     }
 
-  if (recnum == BFDATA_NEXT_RECORD)
-    {
-      if (bfdh[hnd].recnum == bfdh[hnd].header.number_of_records)
-        {
-          bfd_error.recnum = bfdh[hnd].recnum;
-          strcpy (bfd_error.file, bfdh[hnd].path);
-          return (bfd_error.bfd = BFDATA_END_OF_FILE);
-        }
+  if (bfdh[hnd].image_dedup) return (bfd_error.bfd = BFDATA_SUCCESS);
 
-      pos = bfdh[hnd].recnum * bfdh[hnd].record_size + bfdh[hnd].header_size;
-    }
-  else
-    {
-      pos = recnum * bfdh[hnd].record_size + bfdh[hnd].header_size;
 
-      bfdh[hnd].recnum = recnum;
-    }
+  if (binaryFeatureData_flush_append (hnd) < 0) return (bfd_error.bfd);
+
 
-  if (fseek (bfdh[hnd].fp, pos, SEEK_SET) < 0)
+  bfdh[hnd].image_hash_size = 1024;
+  bfdh[hnd].image_hash_count = 0;
+
+  if ((bfdh[hnd].image_hash = (INTERNAL_BFDATA_IMAGE_HASH *) calloc (bfdh[hnd].image_hash_size, sizeof (INTERNAL_BFDATA_IMAGE_HASH))) == NULL)
     {
       bfd_error.system = errno;
-      bfd_error.recnum = recnum;
       strcpy (bfd_error.file, bfdh[hnd].path);
-      return (bfd_error.bfd = BFDATA_RECORD_READ_FSEEK_ERROR);
+      return (bfd_error.bfd = BFDATA_MEMORY_ALLOCATION_ERROR);
     }
 
 
-  if (!binaryFeatureData_get_record (hnd, bfd_record))
+  /*  Hash the images that are already in the file.  Reading the records in order lets read-ahead do its thing.  We
+      put the current record number back when we're done so that BFDATA_NEXT_RECORD reads pick up where they were.  */
+
+  recnum = bfdh[hnd].recnum;
+
+  for (i = 0 ; i < bfdh[hnd].header.number_of_records ; i++)
     {
-      bfd_error.system = errno;
-      bfd_error.recnum = recnum;
-      strcpy (bfd_error.file, bfdh[hnd].path);
-      return (bfd_error.bfd = BFDATA_RECORD_READ_ERROR);
-    }
+      if (binaryFeatureData_do_read_record (hnd, i, &bfd_record) < 0) break;
 
+      if (!bfd_record.image_size) continue;
 
 
-  bfd_record->record_number = bfdh[hnd].recnum;
+      if (binaryFeatureData_seek (hnd, bfdh[hnd].afp, bfd_record.image_address, SEEK_SET) < 0)
+        {
+          bfd_error.system = errno;
+          bfd_error.recnum = i;
+          strcpy (bfd_error.file, bfdh[hnd].a_path);
+          bfd_error.bfd = BFDATA_IMAGE_READ_FSEEK_ERROR;
+          break;
+        }
 
+      hash = BFDATA_FNV1A64_SEED;
 
-  bfdh[hnd].write = 0;
+      for (size = bfd_record.image_size ; size ; size -= count)
+        {
+          count = size < sizeof (buffer) ? size : sizeof (buffer);
 
+          if (!binaryFeatureData_read (hnd, buffer, count, 1, bfdh[hnd].afp)) break;
 
-  bfdh[hnd].last_rec = bfdh[hnd].recnum;
-  bfdh[hnd].record = *bfd_record;
+          hash = binaryFeatureData_fnv1a64 (hash, buffer, count);
+        }
 
+      if (size)
+        {
+          bfd_error.system = errno;
+          bfd_error.recnum = i;
+          strcpy (bfd_error.file, bfdh[hnd].a_path);
+          bfd_error.bfd = BFDATA_IMAGE_READ_ERROR;
+          break;
+        }
 
-  bfdh[hnd].recnum++;
+
+      /*  Records that already share an image (or share identical bytes) only need one entry.  */
+
+      size = bfd_record.image_size;
+
+      for (count = hash & (bfdh[hnd].image_hash_size - 1) ; bfdh[hnd].image_hash[count].size ;
+           count = (count + 1) & (bfdh[hnd].image_hash_size - 1))
+        {
+          if (bfdh[hnd].image_hash[count].hash == hash && bfdh[hnd].image_hash[count].size == size) break;
+        }
+
+      if (!bfdh[hnd].image_hash[count].size) binaryFeatureData_add_image (hnd, hash, size, bfd_record.image_address);
+    }
+
+  bfdh[hnd].recnum = recnum;
+
+
+  if (i < bfdh[hnd].header.number_of_records)
+    {
+      free (bfdh[hnd].image_hash);
+      bfdh[hnd].image_hash = NULL;
+      bfdh[hnd].image_hash_count = bfdh[hnd].image_hash_size = 0;
+
+      return (bfd_error.bfd);
+    }
+
+
+  bfdh[hnd].image_dedup = 1;
 
 
   bfd_error.system = 0;
@@ -1416,70 +9215,47 @@ BFDATA_DLL int32_t binaryFeatureData_read_record (int32_t hnd, int32_t recnum, B
 /********************************************************************************************/
 /*!
 
- - Function:    binaryFeatureData_read_all_short_features
-
- - Purpose:     Reads all BFD records in a file, allocates memory for them, and returns the 
-                allocated array to the caller.  Memory will be cleaned up on bfd_file_close.
+ - Function:    binaryFeatureData_set_polygon_encoding
 
- - Author:      Jan C. Depner (area.based.editor@gmail.com)
+ - Purpose:     Set how polygons written through this handle are stored in the .bfa file.
+                BFDATA_POLYGON_DELTA stores each point as the difference from the previous
+                point in units of 1/scale degrees, using zigzag varints.  Outlines usually
+                shrink to 2 to 6 bytes per point instead of 16.  Polygons that wouldn't get
+                smaller are still stored raw.  Reading is automatic, whatever the setting.
 
- - Date:        03/25/09
+ - Date:        10/19/26
 
  - Arguments:
                 - hnd            =    The file handle
-                - bfd_feature    =    The returned array of BFDATA_SHORT_FEATURE structures.
+                - mode           =    BFDATA_POLYGON_RAW or BFDATA_POLYGON_DELTA
+                - scale          =    For BFDATA_POLYGON_DELTA, integer units per degree
+                                      (0.0 = BFDATA_POLYGON_DEFAULT_SCALE)
 
  - Returns:
                 - BFDATA_SUCCESS
-                - BFDATA_INVALID_RECORD_NUMBER
-                - BFDATA_READ_FSEEK_ERROR
-                - BFDATA_END_OF_FILE
-
-*********************************************************************************************/
-
-BFDATA_DLL int32_t binaryFeatureData_read_all_short_features (int32_t hnd, BFDATA_SHORT_FEATURE **bfd_feature)
-{
-  int32_t i;
-  BFDATA_RECORD bfd_record;
-
-
-  bfdh[hnd].short_feature = (BFDATA_SHORT_FEATURE *) realloc (bfdh[hnd].short_feature, bfdh[hnd].header.number_of_records * sizeof (BFDATA_SHORT_FEATURE));
-
-  if (bfdh[hnd].short_feature == NULL)
-    {
-      perror ("Allocating short feature array in bfd_read_all_short_features");
-      fflush (stderr);
-      exit (-1);
-    }
-
-  for (i = 0 ; i < bfdh[hnd].header.number_of_records ; i++)
-    {
-      if (binaryFeatureData_read_record (hnd, i, &bfd_record) < 0) return (bfd_error.bfd);
-
-      bfdh[hnd].short_feature[i].record_number = i;
-      bfdh[hnd].short_feature[i].feature_type = bfd_record.feature_type;
-      bfdh[hnd].short_feature[i].event_tv_sec = bfd_record.event_tv_sec;
-      bfdh[hnd].short_feature[i].event_tv_nsec = bfd_record.event_tv_nsec;
-      bfdh[hnd].short_feature[i].latitude = bfd_record.latitude;
-      bfdh[hnd].short_feature[i].longitude = bfd_record.longitude;
-      bfdh[hnd].short_feature[i].depth = bfd_record.depth;
-      bfdh[hnd].short_feature[i].confidence_level = bfd_record.confidence_level;
-      strcpy (bfdh[hnd].short_feature[i].description, bfd_record.description);
-      strcpy (bfdh[hnd].short_feature[i].remarks, bfd_record.remarks);
-      bfdh[hnd].short_feature[i].poly_count = bfd_record.poly_count;
-      bfdh[hnd].short_feature[i].poly_type = bfd_record.poly_type;
-      bfdh[hnd].short_feature[i].parent_record = bfd_record.parent_record;
-      bfdh[hnd].short_feature[i].child_record = bfd_record.child_record;
-    }
+                - BFDATA_INVALID_POLYGON_ENCODING
 
+ - Caveats:     Delta encoding is lossy.  Points are rounded to the nearest 1/scale degrees
+                (the default is about a centimeter).  Older versions of the library can't
+                read delta encoded polygons.
 
-  *bfd_feature = bfdh[hnd].short_feature;
+*********************************************************************************************/
 
+BFDATA_DLL int32_t binaryFeatureData_set_polygon_encoding (int32_t hnd, int32_t mode, double scale)
+{
+  if (scale == 0.0) scale = BFDATA_POLYGON_DEFAULT_SCALE;
 
-  bfdh[hnd].write = 0;
+  if ((mode != BFDATA_POLYGON_RAW && mode != BFDATA_POLYGON_DELTA) || !(scale > 0.0 && scale <= 1.0e15))
+    {
+      strcpy (bfd_error.file, bfdh[hnd].path);
+      return (bfd_error.bfd = BFDATA_INVALID_POLYGON_ENCODING);
+    }
+
+
+  bfdh[hnd].poly_encoding = mode;
+  bfdh[hnd].poly_scale = scale;
 
 
-  bfd_error.system = 0;
   return (bfd_error.bfd = BFDATA_SUCCESS);
 }
 
@@ -1488,66 +9264,59 @@ BFDATA_DLL int32_t binaryFeatureData_read_all_short_features (int32_t hnd, BFDAT
 /********************************************************************************************/
 /*!
 
- - Function:    binaryFeatureData_read_polygon
-
- - Purpose:     Retrieve a BFD polygon structure for the given record.
+ - Function:    binaryFeatureData_set_polygon_lod
 
- - Author:      Jan C. Depner (area.based.editor@gmail.com)
+ - Purpose:     Turn on generation of simplified polygons (levels of detail) when polygons
+                are written through this handle.  Each polygon is simplified with
+                Douglas-Peucker at each of the tolerances and a level is stored (in front
+                of the polygon in the .bfa file, see binaryFeatureData_build_trailer) if it
+                has no more than half the points of the previous level.  Use
+                binaryFeatureData_read_polygon_lod to read them.
 
- - Date:        03/25/09
+ - Date:        10/19/26
 
  - Arguments:
                 - hnd            =    The file handle
-                - recnum         =    The record number of the BFD polygon to be retrieved
-                - poly           =    The BFDATA_POLYGON structure to hold the data.
+                - levels         =    Number of tolerances (0 to turn levels of detail off,
+                                      maximum BFDATA_MAX_LOD_LEVELS)
+                - tolerances     =    Increasing tolerances in degrees (of latitude) or NULL
+                                      to use the first "levels" of 0.00001, 0.0001, 0.001,
+                                      0.01, and 0.1 (roughly 1 m to 10 km)
 
  - Returns:
                 - BFDATA_SUCCESS
-                - BFDATA_NO_POLYGON_AVAILABLE
-                - BFDATA_INVALID_RECORD_NUMBER
-                - BFDATA_POLY_READ_FSEEK_ERROR
-                - BFDATA_POLY_READ_ERROR
+                - BFDATA_INVALID_LOD
 
 *********************************************************************************************/
 
-BFDATA_DLL int32_t binaryFeatureData_read_polygon (int32_t hnd, int32_t recnum, BFDATA_POLYGON *poly)
+BFDATA_DLL int32_t binaryFeatureData_set_polygon_lod (int32_t hnd, int32_t levels, const double *tolerances)
 {
-  if (recnum != bfdh[hnd].last_rec)
-    {
-      if (binaryFeatureData_read_record (hnd, recnum, &bfdh[hnd].record) < 0) return (bfd_error.bfd);
-    }
-
+  static const double default_tolerance[5] = {0.00001, 0.0001, 0.001, 0.01, 0.1};
+  int32_t i;
 
-  if (!bfdh[hnd].record.poly_address)
-    {
-      bfd_error.recnum = recnum;
-      strcpy (bfd_error.file, bfdh[hnd].a_path);
-      return (bfd_error.bfd = BFDATA_NO_POLYGON_AVAILABLE);
-    }
 
+  if (tolerances == NULL) tolerances = default_tolerance;
 
-  if (fseeko64 (bfdh[hnd].afp, bfdh[hnd].record.poly_address, SEEK_SET) < 0)
+  if (levels < 0 || levels > BFDATA_MAX_LOD_LEVELS || (tolerances == default_tolerance && levels > 5))
     {
-      bfd_error.system = errno;
-      bfd_error.recnum = recnum;
-      strcpy (bfd_error.file, bfdh[hnd].a_path);
-      return (bfd_error.bfd = BFDATA_POLY_READ_FSEEK_ERROR);
+      strcpy (bfd_error.file, bfdh[hnd].path);
+      return (bfd_error.bfd = BFDATA_INVALID_LOD);
     }
 
-
-  if (!binaryFeatureData_get_polygon (hnd, bfdh[hnd].record.poly_count, poly))
+  for (i = 0 ; i < levels ; i++)
     {
-      bfd_error.system = errno;
-      bfd_error.recnum = recnum;
-      strcpy (bfd_error.file, bfdh[hnd].a_path);
-      return (bfd_error.bfd = BFDATA_POLY_READ_ERROR);
+      if (!(tolerances[i] > 0.0) || (i && tolerances[i] <= tolerances[i - 1]))
+        {
+          strcpy (bfd_error.file, bfdh[hnd].path);
+          return (bfd_error.bfd = BFDATA_INVALID_LOD);
+        }
     }
 
+  for (i = 0 ; i < levels ; i++) bfdh[hnd].lod_tolerance[i] = tolerances[i];
 
-  bfdh[hnd].write = 0;
+  bfdh[hnd].lod_levels = levels;
 
 
-  bfd_error.system = 0;
   return (bfd_error.bfd = BFDATA_SUCCESS);
 }
 
@@ -1556,66 +9325,59 @@ BFDATA_DLL int32_t binaryFeatureData_read_polygon (int32_t hnd, int32_t recnum,
 /********************************************************************************************/
 /*!
 
- - Function:    binaryFeatureData_read_image
-
- - Purpose:     Retrieve the associated image for the given record.
+ - Function:    binaryFeatureData_get_stats
 
- - Author:      Jan C. Depner (area.based.editor@gmail.com)
+ - Purpose:     Get the I/O statistics for an open file.  The counters and latency
+                histograms start at zero when the file is opened (or created) or when
+                binaryFeatureData_reset_stats is called.  Latencies are only recorded
+                after binaryFeatureData_set_latency_stats has turned them on.
 
- - Date:        03/25/09
+ - Date:        10/19/26
 
  - Arguments:
                 - hnd            =    The file handle
-                - recnum         =    The record number of the BFD polygon to be retrieved
-                - image          =    The image.
+                - stats          =    BFDATA_STATS structure to be populated
 
  - Returns:
                 - BFDATA_SUCCESS
-                - BFDATA_NO_IMAGE_AVAILABLE
-                - BFDATA_INVALID_RECORD_NUMBER
-                - BFDATA_IMAGE_READ_FSEEK_ERROR
-                - BFDATA_IMAGE_READ_ERROR
+
+ - Caveats:     binaryFeatureData_close_file frees the handle so the statistics have to be
+                read before the file is closed and BFDATA_OPERATION_CLOSE is never counted.
 
 *********************************************************************************************/
 
-BFDATA_DLL int32_t binaryFeatureData_read_image (int32_t hnd, int32_t recnum, uint8_t *image)
+BFDATA_DLL int32_t binaryFeatureData_get_stats (int32_t hnd, BFDATA_STATS *stats)
 {
-  if (recnum != bfdh[hnd].last_rec)
-    {
-      if (binaryFeatureData_read_record (hnd, recnum, &bfdh[hnd].record) < 0) return (bfd_error.bfd);
-    }
+  *stats = bfdh[hnd].stats;
 
 
-  if (!bfdh[hnd].record.image_size)
-    {
-      bfd_error.recnum = recnum;
-      strcpy (bfd_error.file, bfdh[hnd].a_path);
-      return (bfd_error.bfd = BFDATA_NO_IMAGE_AVAILABLE);
-    }
+  return (bfd_error.bfd = BFDATA_SUCCESS);
+}
 
 
-  if (fseeko64 (bfdh[hnd].afp, bfdh[hnd].record.image_address, SEEK_SET) < 0)
-    {
-      bfd_error.system = errno;
-      bfd_error.recnum = recnum;
-      strcpy (bfd_error.file, bfdh[hnd].a_path);
-      return (bfd_error.bfd = BFDATA_IMAGE_READ_FSEEK_ERROR);
-    }
 
+/********************************************************************************************/
+/*!
 
-  if (!fread (image, bfdh[hnd].record.image_size, 1, bfdh[hnd].afp))
-    {
-      bfd_error.system = errno;
-      bfd_error.recnum = recnum;
-      strcpy (bfd_error.file, bfdh[hnd].a_path);
-      return (bfd_error.bfd = BFDATA_IMAGE_READ_ERROR);
-    }
+ - Function:    binaryFeatureData_reset_stats
 
+ - Purpose:     Zero the I/O statistics for an open file (see binaryFeatureData_get_stats).
 
-  bfdh[hnd].write = 0;
+ - Date:        10/19/26
+
+ - Arguments:
+                - hnd            =    The file handle
+
+ - Returns:
+                - BFDATA_SUCCESS
+
+*********************************************************************************************/
+
+BFDATA_DLL int32_t binaryFeatureData_reset_stats (int32_t hnd)
+{
+  memset (&bfdh[hnd].stats, 0, sizeof (BFDATA_STATS));
 
 
-  bfd_error.system = 0;
   return (bfd_error.bfd = BFDATA_SUCCESS);
 }
 
@@ -1624,39 +9386,69 @@ BFDATA_DLL int32_t binaryFeatureData_read_image (int32_t hnd, int32_t recnum, ui
 /********************************************************************************************/
 /*!
 
- - Function:    binaryFeatureData_update_header
-
- - Purpose:     Update the modifiable fields of the header record.  See BFDATA_HEADER in bfd.h to
-                determine which fields are modifiable after file creation.
+ - Function:    binaryFeatureData_set_latency_stats
 
- - Author:      Jan C. Depner (area.based.editor@gmail.com)
+ - Purpose:     Turn the latency histograms (see binaryFeatureData_get_stats) on or off for
+                all files.  When they're on every call to one of the public operations
+                listed with the BFDATA_OPERATION_* IDs reads the clock twice, which costs
+                about as much as reading a record from the read-ahead buffer, so they're
+                off by default.  Only the application's calls are timed, not the calls
+                made inside the library.  The other counters are always kept.
 
- - Date:        03/27/09
+ - Date:        10/19/26
 
  - Arguments:
-                - hnd            =    The file handle
-                - bfd_header     =    The BFDATA_HEADER structure.
+                - enable         =    1 to time operations, 0 to stop
 
- - Returns:
-                - void
+ - Caveats:     This should be set before any other threads start using the library.
 
 *********************************************************************************************/
 
-BFDATA_DLL void binaryFeatureData_update_header (int32_t hnd, BFDATA_HEADER bfd_header)
+BFDATA_DLL void binaryFeatureData_set_latency_stats (uint8_t enable)
 {
-  strcpy (bfdh[hnd].header.modification_software, bfd_header.modification_software);
-  strcpy (bfdh[hnd].header.security_classification, bfd_header.security_classification);
-  strcpy (bfdh[hnd].header.distribution, bfd_header.distribution);
-  strcpy (bfdh[hnd].header.declassification, bfd_header.declassification);
-  strcpy (bfdh[hnd].header.class_just, bfd_header.class_just);
-  strcpy (bfdh[hnd].header.downgrade, bfd_header.downgrade);
-  strcpy (bfdh[hnd].header.comments, bfd_header.comments);
+  latency_stats = enable;
 
+  instrumented = (latency_stats || trace_begin != NULL || trace_end != NULL);
+}
 
-  /*  Force a header write when we close the file.  */
 
-  bfdh[hnd].modified = 1;
-  bfdh[hnd].write = 1;
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_set_trace_hooks
+
+ - Purpose:     Set the functions to be called at the beginning and end of each of the
+                public operations listed with the BFDATA_OPERATION_* IDs so that they
+                can be fed to an external tracing system.  The hooks get a
+                BFDATA_TRACE_EVENT with the operation, handle, record number, and (in the
+                end event) the return status and the number of bytes read from and
+                written to the .bfd and .bfa files by the call.  Only the application's
+                calls are traced, not the calls made inside the library.  With no hooks
+                (and no latency stats, see binaryFeatureData_set_latency_stats) each
+                operation only checks one flag.
+
+ - Date:        10/19/26
+
+ - Arguments:
+                - begin          =    Function called before the operation (or NULL)
+                - end            =    Function called after the operation (or NULL)
+                - user_data      =    Passed to the hooks untouched
+
+ - Caveats:     The hooks are shared by all files and threads.  They should be set before
+                any other threads start using the library and they have to be thread
+                safe if the library is used from more than one thread.  They must not
+                call back into the library with the same handle.
+
+*********************************************************************************************/
+
+BFDATA_DLL void binaryFeatureData_set_trace_hooks (BFDATA_TRACE_CALLBACK begin, BFDATA_TRACE_CALLBACK end, void *user_data)
+{
+  trace_begin = begin;
+  trace_end = end;
+  trace_data = user_data;
+
+  instrumented = (latency_stats || trace_begin != NULL || trace_end != NULL);
 }
 
 
@@ -1845,6 +9637,64 @@ BFDATA_DLL char *binaryFeatureData_strerror ()
       sprintf (message ,"File : %s\nError reading image file :\n%s\n",
                bfd_error.file, strerror (bfd_error.system));
       break;
+
+    case BFDATA_SYNC_ERROR:
+      sprintf (message ,"File : %s\nError syncing file to disk :\n%s\n",
+               bfd_error.file, strerror (bfd_error.system));
+      break;
+
+    case BFDATA_INVALID_DURABILITY_MODE:
+      sprintf (message ,"File : %s\nInvalid durability mode.\n", bfd_error.file);
+      break;
+
+    case BFDATA_JOURNAL_OPEN_ERROR:
+      sprintf (message ,"File : %s\nError opening journal file :\n%s\n",
+               bfd_error.file, strerror (bfd_error.system));
+      break;
+
+    case BFDATA_JOURNAL_WRITE_ERROR:
+      sprintf (message ,"File : %s\nError writing journal file :\n%s\n",
+               bfd_error.file, strerror (bfd_error.system));
+      break;
+
+    case BFDATA_TRANSACTION_ERROR:
+      sprintf (message ,"File : %s\nTransaction already active or no transaction active.\n", bfd_error.file);
+      break;
+
+    case BFDATA_MEMORY_ALLOCATION_ERROR:
+      sprintf (message ,"File : %s\nError allocating memory :\n%s\n",
+               bfd_error.file, strerror (bfd_error.system));
+      break;
+
+    case BFDATA_INVALID_POLYGON_ENCODING:
+      sprintf (message ,"File : %s\nInvalid polygon encoding or scale.\n", bfd_error.file);
+      break;
+
+    case BFDATA_INVALID_ENDIAN:
+      sprintf (message ,"File : %s\nByte order can only be set on a new, empty file.\n", bfd_error.file);
+      break;
+
+    case BFDATA_INVALID_PREDICATE:
+      sprintf (message ,"File : %s\nInvalid scan predicate.\n", bfd_error.file);
+      break;
+
+    case BFDATA_INVALID_QUERY:
+      sprintf (message ,"File : %s\nInvalid query polygon.\n", bfd_error.file);
+      break;
+
+    case BFDATA_INVALID_LOD:
+      sprintf (message ,"File : %s\nInvalid level of detail settings.\n", bfd_error.file);
+      break;
+
+    case BFDATA_INVALID_IMAGE_RANGE:
+      sprintf (message ,"File : %s\nRecord : %d\nImage offset is past the end of the image\n",
+               bfd_error.file, bfd_error.recnum);
+      break;
+
+    case BFDATA_JOURNAL_REPLAY_ERROR:
+      sprintf (message ,"File : %s\nRecord : %d\nError replaying journal :\n%s\n",
+               bfd_error.file, bfd_error.recnum, strerror (bfd_error.system));
+      break;
     }
 
   return (message);
@@ -1971,9 +9821,10 @@ BFDATA_DLL void binaryFeatureData_dump_record (BFDATA_RECORD bfd_record)
 
 
 
-/*  Months start at zero, days at 1 (go figure).  */
+/*  Months start at zero, days at 1 (go figure).  February is adjusted for leap years as needed (not in place, so that
+    this is safe to use from more than one thread).  */
 
-static int32_t              months[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+static const int32_t        months[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
 
 
 
@@ -1999,40 +9850,102 @@ static int32_t              months[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31
  - Returns:
                 - void
 
- - Caveats:     The localtime function will return the year as a 2 digit year (offset from 1900).
+ - Caveats:     The year is returned as an offset from 1900 (like localtime).  This is
+                always UTC and is done with integer calendar arithmetic so it doesn't touch
+                the TZ environment variable and is thread safe.
 
 *********************************************************************************************/
  
 BFDATA_DLL void binaryFeatureData_cvtime (time_t tv_sec, long tv_nsec, int32_t *year, int32_t *jday, int32_t *hour,
 					  int32_t *minute, float *second)
 {
-  static int32_t       tz_set = 0;
-  struct tm            time_struct, *time_ptr = &time_struct;
+  int64_t days, secs, l_year;
+  int32_t month, mday;
 
-  if (!tz_set)
+
+  days = (int64_t) tv_sec / 86400;
+  secs = (int64_t) tv_sec - days * 86400;
+
+  if (secs < 0)
     {
-#ifdef NVWIN3X
-#if defined (__MINGW64__) || defined (__MINGW32__)
-      putenv ("TZ=GMT");
-      tzset ();
-  #else
-      _putenv ("TZ=GMT");
-      _tzset ();
-  #endif
-#else
-      putenv ("TZ=GMT");
-      tzset ();
-#endif
-      tz_set = 1;
+      days--;
+      secs += 86400;
     }
 
-  time_ptr = localtime (&tv_sec);
+  binaryFeatureData_civil_from_days (days, &l_year, &month, &mday);
+
+  *year = (int32_t) (l_year - 1900);
+  *jday = (int32_t) (days - binaryFeatureData_days_from_civil (l_year, 1, 1)) + 1;
+  *hour = (int32_t) (secs / 3600);
+  *minute = (int32_t) (secs % 3600) / 60;
+  *second = (float) (secs % 60) + (float) ((double) tv_nsec / 1000000000.);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_cvtime_batch
+
+ - Purpose:     Convert arrays of POSIX times to year, day of year, hour, minute, second
+                (see binaryFeatureData_cvtime).
+
+ - Date:        10/19/26
+
+ - Arguments:
+                - count          =    Number of times
+                - tv_sec         =    POSIX seconds from epoch (Jan. 1, 1970)
+                - tv_nsec        =    POSIX nanoseconds of second (or NULL for 0)
+                - year           =    4 digit year - 1900
+                - jday           =    day of year
+                - hour           =    hour of day
+                - minute         =    minute of hour
+                - second         =    seconds of minute
+
+ - Returns:
+                - void
+
+*********************************************************************************************/
+
+BFDATA_DLL void binaryFeatureData_cvtime_batch (int32_t count, const time_t *tv_sec, const long *tv_nsec, int32_t *year, int32_t *jday,
+                                                int32_t *hour, int32_t *minute, float *second)
+{
+  int64_t days, secs, last_days = 0, l_year;
+  int32_t i, month, mday, last_year = 0, last_jday = 0;
+  uint8_t have_last = 0;
+
+
+  for (i = 0 ; i < count ; i++)
+    {
+      days = (int64_t) tv_sec[i] / 86400;
+      secs = (int64_t) tv_sec[i] - days * 86400;
+
+      if (secs < 0)
+        {
+          days--;
+          secs += 86400;
+        }
 
-  *year = (int16_t) time_ptr->tm_year;
-  *jday = (int16_t) time_ptr->tm_yday + 1;
-  *hour = (int16_t) time_ptr->tm_hour;
-  *minute = (int16_t) time_ptr->tm_min;
-  *second = (float) time_ptr->tm_sec + (float) ((double) tv_nsec / 1000000000.);
+
+      /*  Features tend to come in time order so most of the time we're still on the same day.  */
+
+      if (!have_last || days != last_days)
+        {
+          binaryFeatureData_civil_from_days (days, &l_year, &month, &mday);
+
+          last_year = (int32_t) (l_year - 1900);
+          last_jday = (int32_t) (days - binaryFeatureData_days_from_civil (l_year, 1, 1)) + 1;
+          last_days = days;
+          have_last = 1;
+        }
+
+      year[i] = last_year;
+      jday[i] = last_jday;
+      hour[i] = (int32_t) (secs / 3600);
+      minute[i] = (int32_t) (secs % 3600) / 60;
+      second[i] = (float) (secs % 60) + (float) ((double) (tv_nsec != NULL ? tv_nsec[i] : 0) / 1000000000.);
+    }
 }
 
 
@@ -2060,47 +9973,72 @@ BFDATA_DLL void binaryFeatureData_cvtime (time_t tv_sec, long tv_nsec, int32_t *
  - Returns:
                 - void
 
- - Caveats:     The mktime function takes a 2 digit year (offset from 1900).
+ - Caveats:     The year is an offset from 1900 (like mktime).  As with mktime, values
+                outside of their normal ranges (e.g. jday 0 or hour 24) roll over into the
+                neighboring fields.  This is always UTC and thread safe (see
+                binaryFeatureData_cvtime).
 
 *********************************************************************************************/
  
 BFDATA_DLL void binaryFeatureData_inv_cvtime (int32_t year, int32_t jday, int32_t hour, int32_t min, float sec,
 					      time_t *tv_sec, long *tv_nsec)
 {
-  struct tm                    tm;
-  static int32_t               tz_set = 0;
+  int64_t days;
+
 
-  void                    binaryFeatureData_jday2mday (int32_t, int32_t, int32_t *, int32_t *);
+  days = binaryFeatureData_days_from_civil ((int64_t) year + 1900, 1, 1) + jday - 1;
+
+  *tv_sec = (time_t) (days * 86400 + (int64_t) hour * 3600 + (int64_t) min * 60 + (int32_t) sec);
+  *tv_nsec = (long)(fmod ((double) sec, 1.0) * 1.0e9);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+ - Function:    binaryFeatureData_inv_cvtime_batch
+
+ - Purpose:     Convert arrays of year, day of year, hour, minute, second to POSIX times
+                (see binaryFeatureData_inv_cvtime).
+
+ - Date:        10/19/26
+
+ - Arguments:
+                - count          =    Number of times
+                - year           =    4 digit year - 1900
+                - jday           =    day of year
+                - hour           =    hour of day
+                - minute         =    minute of hour
+                - second         =    seconds of minute
+                - time_t tv_sec  =    POSIX seconds from epoch (Jan. 1, 1970)
+                - long tv_nsec   =    POSIX nanoseconds of second
 
+ - Returns:
+                - void
 
-  tm.tm_year = year;
+*********************************************************************************************/
 
-  binaryFeatureData_jday2mday (year, jday, &tm.tm_mon, &tm.tm_mday);
+BFDATA_DLL void binaryFeatureData_inv_cvtime_batch (int32_t count, const int32_t *year, const int32_t *jday, const int32_t *hour,
+                                                    const int32_t *minute, const float *second, time_t *tv_sec, long *tv_nsec)
+{
+  int64_t year_days = 0;
+  int32_t i, last_year = 0;
+  uint8_t have_last = 0;
 
-  tm.tm_hour = hour;
-  tm.tm_min = min;
-  tm.tm_sec = (int32_t) sec;
-  tm.tm_isdst = 0;
 
-  if (!tz_set)
+  for (i = 0 ; i < count ; i++)
     {
-#ifdef NVWIN3X
-#if defined (__MINGW64__) || defined (__MINGW32__)
-      putenv ("TZ=GMT");
-      tzset ();
-  #else
-      _putenv ("TZ=GMT");
-      _tzset ();
-  #endif
-#else
-      putenv ("TZ=GMT");
-      tzset ();
-#endif
-      tz_set = 1;
-    }
+      if (!have_last || year[i] != last_year)
+        {
+          year_days = binaryFeatureData_days_from_civil ((int64_t) year[i] + 1900, 1, 1);
+          last_year = year[i];
+          have_last = 1;
+        }
 
-  *tv_sec = mktime (&tm);
-  *tv_nsec = (long)(fmod ((double) sec, 1.0) * 1.0e9);
+      tv_sec[i] = (time_t) ((year_days + jday[i] - 1) * 86400 + (int64_t) hour[i] * 3600 + (int64_t) minute[i] * 60 + (int32_t) second[i]);
+      tv_nsec[i] = (long)(fmod ((double) second[i], 1.0) * 1.0e9);
+    }
 }
 
 
@@ -2129,30 +10067,22 @@ BFDATA_DLL void binaryFeatureData_inv_cvtime (int32_t year, int32_t jday, int32_
  
 BFDATA_DLL void binaryFeatureData_jday2mday (int32_t year, int32_t jday, int32_t *mon, int32_t *mday)
 {
-  int32_t l_year;
+  int32_t l_year, leap, length;
 
   l_year = year;
 
   if (year < 1899) l_year += 1900;
 
-
-  /*  If the year is evenly divisible by 4 but not by 100, or it's evenly divisible by 400, this is a leap year.  */
-
-  if ((!(l_year % 4) && (l_year % 100)) || !(l_year % 400))
-    {
-      months[1] = 29;
-    }
-  else
-    {
-      months[1] = 28;
-    }
+  leap = binaryFeatureData_leap_year (l_year);
 
   *mday = jday;
   for (*mon = 0 ; *mon < 12 ; (*mon)++)
     {
-      if (*mday - months[*mon] <= 0) break;
+      length = months[*mon] + (*mon == 1 ? leap : 0);
 
-      *mday -= months[*mon];
+      if (*mday - length <= 0) break;
+
+      *mday -= length;
     }
 }
 
@@ -2182,25 +10112,15 @@ BFDATA_DLL void binaryFeatureData_jday2mday (int32_t year, int32_t jday, int32_t
  
 BFDATA_DLL void binaryFeatureData_mday2jday (int32_t year, int32_t mon, int32_t mday, int32_t *jday)
 {
-  int32_t i, l_year;
+  int32_t i, l_year, leap;
 
   l_year = year;
 
   if (year < 1899) l_year += 1900;
 
-
-  /*  If the year is evenly divisible by 4 but not by 100, or it's evenly divisible by 400, this is a leap year.  */
-
-  if ((!(l_year % 4) && (l_year % 100)) || !(l_year % 400))
-    {
-      months[1] = 29;
-    }
-  else
-    {
-      months[1] = 28;
-    }
+  leap = binaryFeatureData_leap_year (l_year);
 
 
   *jday = mday;
-  for (i = 0 ; i < mon - 1 ; i++) *jday += months[i];
+  for (i = 0 ; i < mon - 1 ; i++) *jday += months[i] + (i == 1 ? leap : 0);
 }
@@ -171,6 +171,25 @@ extern "C" {
        image data it will be appended to the file and the size, name, and address fields will be changed.
 
 
+       <br><br>\section sec4a Journal
+
+       If an application turns on journaling (binaryFeatureData_set_journal) every record written is also logged to
+       a journal file that has a .bfj extension.  Journal entries are group committed (one sync of the .bfa and .bfj
+       files per group) so that a crash before binaryFeatureData_close_file doesn't lose the appended records.  The
+       journal is removed when the file is closed.  If binaryFeatureData_open_file finds a journal when opening a file
+       for update it replays the committed entries into the BFD file and fixes the header.
+
+
+       <br><br>\section sec4b Polygon Bounds
+
+       The bounding box of every polygon is kept in memory while a file is written and saved, when it is closed, in a
+       file that has a .bfb extension.  The [BOUNDS STAMP] field in the header says which .bfb file goes with the
+       file.  binaryFeatureData_read_all_polygon_bounds and binaryFeatureData_get_polygon_bounds load it instead of
+       going through the .bfa file.  It is removed on the first write after the file is opened and saved again on
+       close.  The .bfb file is only a cache.  If it is missing or doesn't match, the bounds are read from the .bfa
+       file.
+
+
        <br><br>\section sec5 BFD API I/O function definitions
 
        The BFD API is very simple and consists of only about 20 functions.  The public functions and data structures
@@ -261,6 +280,101 @@ extern "C" {
 
 
 
+  /*!  Polygon bounding box (see binaryFeatureData_read_all_polygon_bounds).  */
+
+  typedef struct
+  {
+    double           min_latitude;
+    double           min_longitude;
+    double           max_latitude;
+    double           max_longitude;
+  } BFDATA_POLYGON_BOUNDS;
+
+
+
+  /*!  A feature in one of several open files (see binaryFeatureData_find_duplicates).  */
+
+  typedef struct
+  {
+    int32_t          hnd;                            /*!<  File handle.  */
+    uint32_t         record_number;                  /*!<  Record number.  */
+  } BFDATA_FEATURE_REF;
+
+
+
+  /*!  One term of a scan predicate (see binaryFeatureData_scan).  A record matches when all of the terms are true.  */
+
+  typedef struct
+  {
+    int32_t          field;                          /*!<  Field to test (BFDATA_FIELD_*).  */
+    int32_t          op;                             /*!<  Comparison (BFDATA_OP_*).  */
+    double           value;                          /*!<  Value to compare numeric fields to.  */
+    const char       *string;                        /*!<  String to compare string fields to.  */
+  } BFDATA_PREDICATE;
+
+
+
+  /*!  Latency histogram for one operation (see BFDATA_STATS).  Bucket i counts the calls that took from 2^i to
+       2^(i+1) - 1 nanoseconds (the last bucket also gets everything longer).  */
+
+  typedef struct
+  {
+    uint64_t         count;                          /*!<  Number of calls.  */
+    uint64_t         total_ns;                       /*!<  Total time in nanoseconds.  */
+    uint64_t         max_ns;                         /*!<  Longest call in nanoseconds.  */
+    uint64_t         bucket[BFDATA_LATENCY_BUCKETS]; /*!<  Log2 histogram of call times.  */
+  } BFDATA_LATENCY;
+
+
+
+  /*!  Per handle I/O statistics (see binaryFeatureData_get_stats).  The latency histograms are only kept after
+       binaryFeatureData_set_latency_stats (1).  The read and write calls are the stdio calls made on the .bfd and .bfa
+       files (one read or write call is usually, but not always, one system call).  */
+
+  typedef struct
+  {
+    uint64_t         bfd_bytes_read;                 /*!<  Bytes read from the .bfd file.  */
+    uint64_t         bfd_bytes_written;              /*!<  Bytes written to the .bfd file.  */
+    uint64_t         bfa_bytes_read;                 /*!<  Bytes read from the .bfa file.  */
+    uint64_t         bfa_bytes_written;              /*!<  Bytes written to the .bfa file.  */
+    uint64_t         read_calls;                     /*!<  Number of read calls.  */
+    uint64_t         write_calls;                    /*!<  Number of write calls.  */
+    uint64_t         seeks;                          /*!<  Number of seeks.  */
+    uint64_t         records_decoded;                /*!<  Records decoded from the on-disk format.  */
+    uint64_t         records_encoded;                /*!<  Records encoded to the on-disk format.  */
+    uint64_t         polygons_read;                  /*!<  Polygons read.  */
+    uint64_t         images_read;                    /*!<  Images read (a chunk or stream read counts as one).  */
+    uint64_t         header_writes;                  /*!<  Number of times the header was rewritten.  */
+    uint64_t         last_rec_hits;                  /*!<  Polygon/image reads that didn't have to re-read the record.  */
+    uint64_t         read_ahead_hits;                /*!<  Records found in the read-ahead buffer.  */
+    BFDATA_LATENCY   latency[BFDATA_OPERATIONS];     /*!<  Latency histograms indexed by BFDATA_OPERATION_*.  */
+  } BFDATA_STATS;
+
+
+
+  /*!  Tracing event (see binaryFeatureData_set_trace_hooks).  */
+
+  typedef struct
+  {
+    int32_t          operation;                      /*!<  Operation (BFDATA_OPERATION_*).  */
+    int32_t          hnd;                            /*!<  File handle (-1 in the begin event of an open or create, or
+                                                           in the end event of a failed one).  */
+    int32_t          recnum;                         /*!<  Record number argument (BFDATA_NEXT_RECORD for next record
+                                                           writes, -1 if the operation isn't about one record).  The
+                                                           end event of a BFDATA_NEXT_RECORD read has the record read.  */
+    int32_t          status;                         /*!<  Return value of the operation (end event only).  */
+    uint64_t         bytes;                          /*!<  Bytes read from and written to the .bfd and .bfa files
+                                                           (end event only).  */
+  } BFDATA_TRACE_EVENT;
+
+
+
+  /*!  Tracing hook (see binaryFeatureData_set_trace_hooks).  */
+
+  typedef void (*BFDATA_TRACE_CALLBACK) (const BFDATA_TRACE_EVENT *event, void *user_data);
+
+
+
   /*!  Short feature (target) structure - to be held in memory by the API for use by an application.  See BFDATA_RECORD above for 
        field definitions.  */
 
@@ -284,26 +398,87 @@ extern "C" {
 
 
 
+  /*!  Callback used by binaryFeatureData_read_image_stream.  It is handed each chunk of the image in order along with
+       the chunk's offset from the start of the image.  Return 0 to keep going or anything else to stop early.  */
+
+  typedef int32_t (*BFDATA_IMAGE_CALLBACK) (const uint8_t *chunk, uint32_t offset, uint32_t length, void *user_data);
+
+
+
 
   /*  Public API functions.  */
 
-  BFDATA_DLL int32_t binaryFeatureData_write_record (int32_t hnd, int32_t recnum, BFDATA_RECORD *bfd_record, BFDATA_POLYGON *poly, uint8_t *image);
-  BFDATA_DLL int32_t binaryFeatureData_write_record_image_file (int32_t hnd, int32_t recnum, BFDATA_RECORD *bfd_record, BFDATA_POLYGON *poly,
+  BFDATA_DLL int32_t binaryFeatureData_write_record (int32_t hnd, int32_t recnum, BFDATA_RECORD *bfd_record, const BFDATA_POLYGON *poly,
+                                                     const uint8_t *image);
+  BFDATA_DLL int32_t binaryFeatureData_write_record_image_file (int32_t hnd, int32_t recnum, BFDATA_RECORD *bfd_record, const BFDATA_POLYGON *poly,
                                                                 const char *image_file);
   BFDATA_DLL int32_t binaryFeatureData_create_file (const char *path, BFDATA_HEADER bfd_header);
+  BFDATA_DLL int32_t binaryFeatureData_set_file_endian (int32_t hnd, int32_t big);
   BFDATA_DLL int32_t binaryFeatureData_open_file (const char *path, BFDATA_HEADER *bfd_header, int32_t mode);
   BFDATA_DLL int32_t binaryFeatureData_close_file (int32_t hnd);
   BFDATA_DLL int32_t binaryFeatureData_read_record (int32_t hnd, int32_t recnum, BFDATA_RECORD *bfd_record);
   BFDATA_DLL int32_t binaryFeatureData_read_all_short_features (int32_t hnd, BFDATA_SHORT_FEATURE **bfd_feature);
+  BFDATA_DLL int32_t binaryFeatureData_read_record_fields (int32_t hnd, int32_t recnum, uint32_t mask, BFDATA_RECORD *bfd_record);
+  BFDATA_DLL int32_t binaryFeatureData_read_record_range (int32_t hnd, uint32_t start, uint32_t count, uint32_t mask,
+                                                          BFDATA_RECORD *bfd_record);
+  BFDATA_DLL int32_t binaryFeatureData_scan (int32_t hnd, uint32_t *recnum, int32_t count, const BFDATA_PREDICATE *predicate,
+                                             BFDATA_RECORD *bfd_record);
+  BFDATA_DLL int32_t binaryFeatureData_scan_fields (int32_t hnd, uint32_t *recnum, int32_t count, const BFDATA_PREDICATE *predicate,
+                                                    uint32_t mask, BFDATA_RECORD *bfd_record);
   BFDATA_DLL int32_t binaryFeatureData_read_polygon (int32_t hnd, int32_t recnum, BFDATA_POLYGON *poly);
+  BFDATA_DLL int32_t binaryFeatureData_read_polygon_lod (int32_t hnd, int32_t recnum, double tolerance, BFDATA_POLYGON *poly, uint32_t *count);
+  BFDATA_DLL int32_t binaryFeatureData_read_all_polygon_bounds (int32_t hnd, BFDATA_POLYGON_BOUNDS **bounds);
+  BFDATA_DLL int32_t binaryFeatureData_get_polygon_bounds (int32_t hnd, int32_t recnum, BFDATA_POLYGON_BOUNDS *bounds);
+  BFDATA_DLL int32_t binaryFeatureData_points_in_polygons (int32_t hnd, uint32_t count, const double *lat, const double *lon,
+                                                           uint32_t **hit_index, uint32_t **hit_record);
+  BFDATA_DLL int32_t binaryFeatureData_overlapping_polygons (int32_t hnd, int32_t count, const double *lat, const double *lon,
+                                                             uint32_t *hit_count, uint32_t **hit_record);
+  BFDATA_DLL int32_t binaryFeatureData_nearest_features (int32_t hnd, double lat, double lon, uint32_t k, uint32_t *count, uint32_t **recnum,
+                                                         double **distance);
+  BFDATA_DLL int32_t binaryFeatureData_nearest_features_batch (int32_t hnd, uint32_t count, const double *lat, const double *lon, uint32_t k,
+                                                               uint32_t **hit_index, uint32_t **hit_record, double **hit_distance);
+  BFDATA_DLL int32_t binaryFeatureData_features_within_radius (int32_t hnd, double lat, double lon, double radius, uint32_t *count,
+                                                               uint32_t **recnum, double **distance);
+  BFDATA_DLL int32_t binaryFeatureData_features_within_radius_batch (int32_t hnd, uint32_t count, const double *lat, const double *lon,
+                                                                     double radius, uint32_t **hit_index, uint32_t **hit_record,
+                                                                     double **hit_distance);
+  BFDATA_DLL int32_t binaryFeatureData_find_duplicates (int32_t count, const int32_t *hnd, double distance, double time, double depth,
+                                                        uint32_t *group_count, uint32_t **group_index, BFDATA_FEATURE_REF **feature);
+  BFDATA_DLL int32_t binaryFeatureData_merge_files (int32_t count, const char **input, const char *output, BFDATA_HEADER bfd_header,
+                                                    uint8_t order_by_time);
+  BFDATA_DLL int32_t binaryFeatureData_split_file (const char *input, int32_t count, const BFDATA_POLYGON_BOUNDS *tiles, const char **output);
+  BFDATA_DLL int32_t binaryFeatureData_split_file_grid (const char *input, BFDATA_POLYGON_BOUNDS area, int32_t rows, int32_t cols,
+                                                        const char **output);
   BFDATA_DLL int32_t binaryFeatureData_read_image (int32_t hnd, int32_t recnum, uint8_t *image);
+  BFDATA_DLL int32_t binaryFeatureData_read_image_chunk (int32_t hnd, int32_t recnum, uint32_t offset, uint32_t length, uint8_t *buffer,
+                                                         uint32_t *bytes_read);
+  BFDATA_DLL int32_t binaryFeatureData_read_image_stream (int32_t hnd, int32_t recnum, uint32_t chunk_size, BFDATA_IMAGE_CALLBACK callback,
+                                                          void *user_data);
   BFDATA_DLL void binaryFeatureData_update_header (int32_t hnd, BFDATA_HEADER bfd_header);
+  BFDATA_DLL int32_t binaryFeatureData_set_durability (int32_t hnd, int32_t mode, uint32_t records, uint32_t msecs);
+  BFDATA_DLL int32_t binaryFeatureData_sync (int32_t hnd);
+  BFDATA_DLL int32_t binaryFeatureData_set_journal (int32_t hnd, uint32_t group);
+  BFDATA_DLL int32_t binaryFeatureData_begin_transaction (int32_t hnd);
+  BFDATA_DLL int32_t binaryFeatureData_commit_transaction (int32_t hnd);
+  BFDATA_DLL int32_t binaryFeatureData_abort_transaction (int32_t hnd);
+  BFDATA_DLL int32_t binaryFeatureData_set_append_buffer (int32_t hnd, uint32_t size);
+  BFDATA_DLL int32_t binaryFeatureData_set_image_dedup (int32_t hnd, uint8_t enable);
+  BFDATA_DLL int32_t binaryFeatureData_set_polygon_encoding (int32_t hnd, int32_t mode, double scale);
+  BFDATA_DLL int32_t binaryFeatureData_set_polygon_lod (int32_t hnd, int32_t levels, const double *tolerances);
+  BFDATA_DLL int32_t binaryFeatureData_get_stats (int32_t hnd, BFDATA_STATS *stats);
+  BFDATA_DLL int32_t binaryFeatureData_reset_stats (int32_t hnd);
+  BFDATA_DLL void binaryFeatureData_set_latency_stats (uint8_t enable);
+  BFDATA_DLL void binaryFeatureData_set_trace_hooks (BFDATA_TRACE_CALLBACK begin, BFDATA_TRACE_CALLBACK end, void *user_data);
   BFDATA_DLL char *binaryFeatureData_strerror ();
   BFDATA_DLL void binaryFeatureData_perror ();
   BFDATA_DLL char *binaryFeatureData_get_version ();
   BFDATA_DLL void binaryFeatureData_dump_record (BFDATA_RECORD bfd_record);
   BFDATA_DLL void binaryFeatureData_cvtime (time_t tv_sec, long tv_nsec, int32_t *year, int32_t *jday, int32_t *hour, int32_t *minute, float *second);
+  BFDATA_DLL void binaryFeatureData_cvtime_batch (int32_t count, const time_t *tv_sec, const long *tv_nsec, int32_t *year, int32_t *jday,
+                                                  int32_t *hour, int32_t *minute, float *second);
   BFDATA_DLL void binaryFeatureData_inv_cvtime (int32_t year, int32_t jday, int32_t hour, int32_t min, float sec, time_t *tv_sec, long *tv_nsec);
+  BFDATA_DLL void binaryFeatureData_inv_cvtime_batch (int32_t count, const int32_t *year, const int32_t *jday, const int32_t *hour,
+                                                      const int32_t *minute, const float *second, time_t *tv_sec, long *tv_nsec);
   BFDATA_DLL void binaryFeatureData_jday2mday (int32_t year, int32_t jday, int32_t *mon, int32_t *mday);
   BFDATA_DLL void binaryFeatureData_mday2jday (int32_t year, int32_t mon, int32_t mday, int32_t *jday);
 
@@ -0,0 +1,519 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! are being used by Doxygen to document the
+    software.  Dashes in these comment blocks are used to create bullet lists.  The lack of
+    blank lines after a block of dash preceeded comments means that the next block of dash
+    preceeded comments is a new, indented bullet list.  I've tried to keep the Doxygen
+    formatting to a minimum but there are some other items (like <br> and <pre>) that need
+    to be left alone.  If you see a comment that starts with / * ! and there is something
+    that looks a bit weird it is probably due to some arcane Doxygen syntax.  Be very
+    careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+/*!
+
+    C++17 wrapper for the BFD API.  This is header only, just link with the C library as usual.
+
+    - bfdata::BfdFile owns a BFD file handle.  It can be moved but not copied and it closes the file
+      when it's destroyed, so handles don't leak when an exception is thrown.
+    - Errors are reported by throwing bfdata::Error (with the BFDATA_* error code and the
+      binaryFeatureData_strerror message).
+    - Polygons, images, and the short feature array are returned as bfdata::Span views (sized by
+      poly_count, image_size, and number_of_records) of storage that is reused from call to call,
+      or copied into caller supplied vectors so their capacity is reused.  The 160KB
+      BFDATA_POLYGON is never copied.
+    - BfdFile::records () returns a range of records that works with range-for and the standard
+      algorithms that take input iterators.
+
+    <pre>
+
+    bfdata::BfdFile file = bfdata::BfdFile::open ("features.bfd");
+
+    for (const BFDATA_RECORD &record : file.records ())
+      {
+        if (record.poly_count)
+          {
+            bfdata::Polygon poly = file.polygon (record.record_number);
+            ...
+          }
+      }
+
+    </pre>
+
+*/
+
+
+#ifndef __BINARYFEATUREDATA_HPP__
+#define __BINARYFEATUREDATA_HPP__
+
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "binaryFeatureData.h"
+
+
+namespace bfdata
+{
+  /*!  Exception thrown when a BFD call fails.  code () is the BFDATA_* error code.  */
+
+  class Error : public std::runtime_error
+  {
+  public:
+
+    explicit Error (int32_t code) : std::runtime_error (binaryFeatureData_strerror ()), code_ (code) {}
+
+    int32_t code () const noexcept {return (code_);}
+
+  private:
+
+    int32_t          code_;
+  };
+
+
+
+  /*!  Throw an Error if a BFD call returned an error code.  Returns the status otherwise.  */
+
+  inline int32_t check (int32_t status)
+  {
+    if (status < 0) throw Error (status);
+
+    return (status);
+  }
+
+
+
+  /*!  Non-owning view of a contiguous array (std::span is C++20).  */
+
+  template <typename T> class Span
+  {
+  public:
+
+    using element_type = T;
+    using value_type = typename std::remove_cv<T>::type;
+    using size_type = std::size_t;
+    using iterator = T *;
+
+    constexpr Span () noexcept : data_ (nullptr), size_ (0) {}
+    constexpr Span (T *data, size_type size) noexcept : data_ (data), size_ (size) {}
+
+
+    /*  Anything with data () and size () (std::vector, std::array, another Span) with a compatible element type.  */
+
+    template <typename Container, typename = typename std::enable_if<
+                std::is_convertible<decltype (std::declval<Container &> ().data ()), T *>::value>::type>
+    constexpr Span (Container &container) noexcept : data_ (container.data ()), size_ (container.size ()) {}
+
+    constexpr T *data () const noexcept {return (data_);}
+    constexpr size_type size () const noexcept {return (size_);}
+    constexpr bool empty () const noexcept {return (size_ == 0);}
+    constexpr T &operator[] (size_type i) const noexcept {return (data_[i]);}
+    constexpr iterator begin () const noexcept {return (data_);}
+    constexpr iterator end () const noexcept {return (data_ + size_);}
+
+  private:
+
+    T                *data_;
+    size_type        size_;
+  };
+
+
+
+  /*!  A polygon/polyline as returned by BfdFile::polygon.  The views point into the BfdFile's scratch polygon and are
+       only valid until the next polygon read or write on that BfdFile.  */
+
+  struct Polygon
+  {
+    Span<const double> latitude;
+    Span<const double> longitude;
+    uint8_t          type;                           /*!<  BFDATA_RECORD poly_type (0 = polyline, 1 = polygon).  */
+
+    std::size_t size () const noexcept {return (latitude.size ());}
+  };
+
+
+
+  /*!  Input iterator over the records of a BfdFile (see BfdFile::records).  All of the iterators of one RecordRange
+       share the range's record buffer so dereferencing gives a reference that is only good until the iterator is
+       incremented.  */
+
+  class RecordIterator
+  {
+  public:
+
+    using iterator_category = std::input_iterator_tag;
+    using value_type = BFDATA_RECORD;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const BFDATA_RECORD *;
+    using reference = const BFDATA_RECORD &;
+
+    RecordIterator () noexcept : hnd_ (-1), recnum_ (0), end_ (0), record_ (nullptr) {}
+
+    RecordIterator (int32_t hnd, uint32_t recnum, uint32_t end, BFDATA_RECORD *record) :
+      hnd_ (hnd), recnum_ (recnum), end_ (end), record_ (record)
+    {
+      load ();
+    }
+
+    reference operator* () const noexcept {return (*record_);}
+    pointer operator-> () const noexcept {return (record_);}
+
+    /*!  What it++ returns.  A copy of the iterator would share the record buffer and see the next record, so this
+         holds a copy of the record it pointed to instead.  That makes *it++ work.  */
+
+    class PostIncrement
+    {
+    public:
+
+      explicit PostIncrement (const BFDATA_RECORD &record) noexcept : record_ (record) {}
+
+      reference operator* () const noexcept {return (record_);}
+      pointer operator-> () const noexcept {return (&record_);}
+
+    private:
+
+      BFDATA_RECORD  record_;
+    };
+
+
+    RecordIterator &operator++ ()
+    {
+      recnum_++;
+      load ();
+      return (*this);
+    }
+
+    PostIncrement operator++ (int)
+    {
+      PostIncrement old (*record_);
+
+      ++*this;
+
+      return (old);
+    }
+
+    bool operator== (const RecordIterator &other) const noexcept {return (recnum_ == other.recnum_);}
+    bool operator!= (const RecordIterator &other) const noexcept {return (recnum_ != other.recnum_);}
+
+  private:
+
+    void load ()
+    {
+      if (recnum_ < end_) check (binaryFeatureData_read_record (hnd_, (int32_t) recnum_, record_));
+    }
+
+    int32_t          hnd_;
+    uint32_t         recnum_;
+    uint32_t         end_;
+    BFDATA_RECORD    *record_;
+  };
+
+
+
+  /*!  Range of records [first, last) of a BfdFile (see BfdFile::records).  Reading in order lets the library's read-ahead
+       kick in.  The range must outlive its iterators and the BfdFile must outlive the range.  */
+
+  class RecordRange
+  {
+  public:
+
+    RecordRange (int32_t hnd, uint32_t first, uint32_t last) noexcept : hnd_ (hnd), first_ (first), last_ (last), record_ () {}
+
+    RecordRange (const RecordRange &) = delete;
+    RecordRange &operator= (const RecordRange &) = delete;
+
+    RecordIterator begin () {return (RecordIterator (hnd_, first_, last_, &record_));}
+    RecordIterator end () noexcept {return (RecordIterator (hnd_, last_, last_, &record_));}
+
+    uint32_t size () const noexcept {return (last_ - first_);}
+
+  private:
+
+    int32_t          hnd_;
+    uint32_t         first_;
+    uint32_t         last_;
+    BFDATA_RECORD    record_;
+  };
+
+
+
+  /*!  An open BFD file.  Moveable, not copyable, and closed when destroyed (errors from that close are ignored, call
+       close () to see them).  */
+
+  class BfdFile
+  {
+  public:
+
+    BfdFile () noexcept : hnd_ (-1), header_ () {}
+
+    ~BfdFile () {if (hnd_ >= 0) binaryFeatureData_close_file (hnd_);}
+
+    BfdFile (const BfdFile &) = delete;
+    BfdFile &operator= (const BfdFile &) = delete;
+
+    BfdFile (BfdFile &&other) noexcept : hnd_ (other.hnd_), header_ (other.header_), poly_ (std::move (other.poly_)),
+                                         record_ (std::move (other.record_))
+    {
+      other.hnd_ = -1;
+    }
+
+    BfdFile &operator= (BfdFile &&other) noexcept
+    {
+      if (this != &other)
+        {
+          if (hnd_ >= 0) binaryFeatureData_close_file (hnd_);
+
+          hnd_ = other.hnd_;
+          header_ = other.header_;
+          poly_ = std::move (other.poly_);
+          record_ = std::move (other.record_);
+
+          other.hnd_ = -1;
+        }
+
+      return (*this);
+    }
+
+
+    /*!  Open an existing file (BFDATA_READONLY or BFDATA_UPDATE).  */
+
+    static BfdFile open (const std::string &path, int32_t mode = BFDATA_READONLY)
+    {
+      BfdFile file;
+
+      file.hnd_ = check (binaryFeatureData_open_file (path.c_str (), &file.header_, mode));
+
+      return (file);
+    }
+
+
+    /*!  Create a new file.  */
+
+    static BfdFile create (const std::string &path, const BFDATA_HEADER &header)
+    {
+      BfdFile file;
+
+      file.hnd_ = check (binaryFeatureData_create_file (path.c_str (), header));
+      file.header_ = header;
+      file.header_.number_of_records = 0;
+
+      return (file);
+    }
+
+
+    /*!  Close the file now.  Does nothing if it isn't open.  */
+
+    void close ()
+    {
+      int32_t hnd = hnd_;
+
+      if (hnd < 0) return;
+
+      hnd_ = -1;
+      check (binaryFeatureData_close_file (hnd));
+    }
+
+
+    bool is_open () const noexcept {return (hnd_ >= 0);}
+
+
+    /*!  The C API handle, for calls that aren't wrapped here.  */
+
+    int32_t handle () const noexcept {return (hnd_);}
+
+
+    /*!  The header as of open/create (number_of_records includes records appended through this object).  */
+
+    const BFDATA_HEADER &header () const noexcept {return (header_);}
+
+    uint32_t size () const noexcept {return (header_.number_of_records);}
+
+
+    /*!  Read one record.  */
+
+    void read (int32_t recnum, BFDATA_RECORD &record) {check (binaryFeatureData_read_record (hnd_, recnum, &record));}
+
+    BFDATA_RECORD read (int32_t recnum)
+    {
+      BFDATA_RECORD record;
+
+      read (recnum, record);
+
+      return (record);
+    }
+
+
+    /*!  Records [first, last) (last is clipped to size ()).  */
+
+    RecordRange records (uint32_t first = 0, uint32_t last = UINT32_MAX) const noexcept
+    {
+      if (last > header_.number_of_records) last = header_.number_of_records;
+      if (first > last) first = last;
+
+      return (RecordRange (hnd_, first, last));
+    }
+
+
+    /*!  Read the polygon of a record into the BfdFile's scratch polygon (allocated the first time).  */
+
+    Polygon polygon (int32_t recnum)
+    {
+      Polygon poly;
+
+      load_record (recnum);
+
+      if (poly_ == nullptr) poly_.reset (new BFDATA_POLYGON);
+
+      check (binaryFeatureData_read_polygon (hnd_, recnum, poly_.get ()));
+
+      poly.latitude = Span<const double> (poly_->latitude, record_->poly_count);
+      poly.longitude = Span<const double> (poly_->longitude, record_->poly_count);
+      poly.type = record_->poly_type;
+
+      return (poly);
+    }
+
+
+    /*!  Copy the polygon of a record into the caller's vectors (reusing their capacity).  */
+
+    void polygon (int32_t recnum, std::vector<double> &latitude, std::vector<double> &longitude)
+    {
+      Polygon poly = polygon (recnum);
+
+      latitude.assign (poly.latitude.begin (), poly.latitude.end ());
+      longitude.assign (poly.longitude.begin (), poly.longitude.end ());
+    }
+
+
+    /*!  Read the image of a record into the caller's vector (resized to image_size, reusing its capacity).  */
+
+    void image (int32_t recnum, std::vector<uint8_t> &image)
+    {
+      load_record (recnum);
+
+      image.resize (record_->image_size);
+
+      if (record_->image_size) check (binaryFeatureData_read_image (hnd_, recnum, image.data ()));
+    }
+
+    std::vector<uint8_t> image (int32_t recnum)
+    {
+      std::vector<uint8_t> data;
+
+      image (recnum, data);
+
+      return (data);
+    }
+
+
+    /*!  All of the short features.  The array belongs to the library and is valid until the file is closed or this is
+         called again.  */
+
+    Span<const BFDATA_SHORT_FEATURE> short_features ()
+    {
+      BFDATA_SHORT_FEATURE *feature;
+
+      check (binaryFeatureData_read_all_short_features (hnd_, &feature));
+
+      return (Span<const BFDATA_SHORT_FEATURE> (feature, header_.number_of_records));
+    }
+
+
+    /*!  Write a record (see binaryFeatureData_write_record).  If latitude/longitude aren't empty they're the new
+         polygon (and set record.poly_count), if image isn't empty it's the new image (and sets record.image_size).  The
+         polygon and image addresses are set in record.  */
+
+    void write (BFDATA_RECORD &record, int32_t recnum = BFDATA_NEXT_RECORD, Span<const double> latitude = Span<const double> (),
+                Span<const double> longitude = Span<const double> (), Span<const uint8_t> image = Span<const uint8_t> ())
+    {
+      const BFDATA_POLYGON *poly = nullptr;
+
+
+      if (latitude.size () != longitude.size ()) throw std::invalid_argument ("bfdata::BfdFile::write: latitude/longitude size mismatch");
+      if (latitude.size () > BFDATA_POLY_ARRAY_SIZE) throw std::invalid_argument ("bfdata::BfdFile::write: polygon too large");
+
+      if (!latitude.empty ())
+        {
+          if (poly_ == nullptr) poly_.reset (new BFDATA_POLYGON);
+
+          std::copy (latitude.begin (), latitude.end (), poly_->latitude);
+          std::copy (longitude.begin (), longitude.end (), poly_->longitude);
+
+          record.poly_count = (uint32_t) latitude.size ();
+          poly = poly_.get ();
+        }
+
+      if (!image.empty ()) record.image_size = (uint32_t) image.size ();
+
+
+      check (binaryFeatureData_write_record (hnd_, recnum, &record, poly, image.empty () ? nullptr : image.data ()));
+
+      if (recnum == BFDATA_NEXT_RECORD) header_.number_of_records++;
+    }
+
+
+    /*!  I/O statistics (see binaryFeatureData_get_stats).  */
+
+    BFDATA_STATS stats () const
+    {
+      BFDATA_STATS stats;
+
+      check (binaryFeatureData_get_stats (hnd_, &stats));
+
+      return (stats);
+    }
+
+  private:
+
+    /*  Read the record (into the scratch record) so we know the polygon and image sizes.  The library remembers the
+        last record read so the polygon or image read that follows doesn't read it again.  */
+
+    void load_record (int32_t recnum)
+    {
+      if (record_ == nullptr) record_.reset (new BFDATA_RECORD);
+
+      check (binaryFeatureData_read_record (hnd_, recnum, record_.get ()));
+    }
+
+    int32_t          hnd_;
+    BFDATA_HEADER    header_;
+    std::unique_ptr<BFDATA_POLYGON> poly_;
+    std::unique_ptr<BFDATA_RECORD> record_;
+  };
+}
+
+
+#endif
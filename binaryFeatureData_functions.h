@@ -60,8 +60,6 @@ static char *binaryFeatureData_ngets (char *s, int32_t size, FILE *stream)
 
   while (strlen(s) > 0 && (s[strlen(s) - 1] == '\n' || s[strlen(s) - 1] == '\r')) s[strlen(s) - 1] = '\0';
 
-  if (s[strlen (s) - 1] == '\n') s[strlen (s) - 1] = 0;
-
 
   return (s);
 }
@@ -329,3 +327,1022 @@ static char *binaryFeatureData_gen_basename (const char *path)
 
   return (basename);
 }
+
+
+
+/********************************************************************************************/
+/*!
+
+  - Module Name:        msecs
+
+  - Date Written:       October 2026
+
+  - Purpose:            Returns a monotonic clock reading in milliseconds.  Only useful for
+                        computing elapsed time.
+
+*********************************************************************************************/
+
+static int64_t binaryFeatureData_msecs ()
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+
+  return ((int64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+
+
+
+/********************************************************************************************/
+/*!
+
+  - Module Name:        nsecs
+
+  - Date Written:       October 2026
+
+  - Purpose:            Returns a monotonic clock reading in nanoseconds.  Only useful for
+                        computing elapsed time.
+
+*********************************************************************************************/
+
+static int64_t binaryFeatureData_nsecs ()
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+
+  return ((int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+  - Module Name:        ilog2
+
+  - Date Written:       October 2026
+
+  - Purpose:            Returns the integer base 2 log of a value (0 for 0).
+
+  - Arguments:          value               -   the value
+
+  - Return Value:       Index of the highest set bit
+
+*********************************************************************************************/
+
+static int32_t binaryFeatureData_ilog2 (uint64_t value)
+{
+#ifdef __GNUC__
+
+  if (!value) return (0);
+
+  return (63 - __builtin_clzll (value));
+
+#else
+
+  int32_t bit = 0;
+
+  while (value >>= 1) bit++;
+
+  return (bit);
+
+#endif
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+  - Module Name:        sync_stream
+
+  - Date Written:       October 2026
+
+  - Purpose:            Flushes the stdio buffer of the stream and forces the file data
+                        out to the storage device (fdatasync on POSIX, _commit on Windoze).
+
+  - Arguments:          fp                  -   stream to sync
+
+  - Return Value:
+                        - 0 on success
+                        - -1 on error (errno is set)
+
+*********************************************************************************************/
+
+static int32_t binaryFeatureData_sync_stream (FILE *fp)
+{
+  if (fflush (fp)) return (-1);
+
+#ifdef NVWIN3X
+  return (_commit (_fileno (fp)));
+#else
+  return (fdatasync (fileno (fp)));
+#endif
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+  - Module Name:        copy_stream
+
+  - Date Written:       October 2026
+
+  - Purpose:            Copies size bytes from offset in ifp to the current position of
+                        ofp.  On Linux we let the kernel do the copy (copy_file_range, then
+                        sendfile) so the data never has to come into user space.  If neither
+                        works for these files (different file systems, old kernel), or one
+                        stops part way through, we stream whatever is left through a small
+                        buffer.  That also tells us which side failed.
+
+  - Arguments:
+                        - ifp                 -   input stream
+                        - offset              -   where to start reading in ifp
+                        - ofp                 -   output stream, positioned where the data goes
+                        - size                -   number of bytes to copy
+
+  - Return Value:
+                        - 0 on success (ofp is left just past the copied data)
+                        - -1 on a read error or if ifp is short (errno is set)
+                        - -2 on a write error (errno is set)
+
+*********************************************************************************************/
+
+static int32_t binaryFeatureData_copy_stream (FILE *ifp, int64_t offset, FILE *ofp, int64_t size)
+{
+  uint8_t buffer[65536];
+  size_t count;
+
+
+#ifdef __linux__
+
+  int in_fd = fileno (ifp), out_fd = fileno (ofp);
+  loff_t in_off = offset, out_off, start;
+  off_t s_off = offset;
+  int64_t left = size;
+  ssize_t ret = -1;
+
+
+  if (fflush (ofp)) return (-2);
+
+  out_off = start = ftello64 (ofp);
+
+
+  /*  Either kernel copy can fail up front for reasons that just mean it can't be done for these two files.  In that
+      case we go on to the streaming copy.  */
+
+  while (left > 0 && (ret = copy_file_range (in_fd, &in_off, out_fd, &out_off, left, 0)) > 0) left -= ret;
+
+  if (left == size && ret < 0 && (errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP))
+    {
+      if (lseek64 (out_fd, start, SEEK_SET) < 0) return (-2);
+
+      while (left > 0 && (ret = sendfile (out_fd, in_fd, &s_off, left)) > 0) left -= ret;
+    }
+
+
+  /*  Put the stream back in sync with the file descriptor, just past whatever the kernel copied.  The end of the file
+      isn't necessarily there (we may be overwriting).  */
+
+  if (fseeko64 (ofp, start + (size - left), SEEK_SET) < 0) return (-2);
+
+  if (!left) return (0);
+
+
+  /*  The streaming copy picks up where the kernel left off.  */
+
+  offset += size - left;
+  size = left;
+
+#endif
+
+
+  if (fseeko64 (ifp, offset, SEEK_SET) < 0) return (-1);
+
+  while (size > 0)
+    {
+      count = size > (int64_t) sizeof (buffer) ? sizeof (buffer) : (size_t) size;
+
+      if (!fread (buffer, count, 1, ifp)) return (-1);
+      if (!fwrite (buffer, count, 1, ofp)) return (-2);
+
+      size -= count;
+    }
+
+
+  return (0);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+  - Module Name:        pack
+
+  - Date Written:       October 2026
+
+  - Purpose:            Copies size bytes from src to *ptr and advances *ptr past them.  Used
+                        to build on-disk records in memory.
+
+  - Arguments:
+                        - ptr                 -   address of the output pointer
+                        - src                 -   data to copy
+                        - size                -   number of bytes
+
+*********************************************************************************************/
+
+static inline void binaryFeatureData_pack (uint8_t **ptr, const void *src, size_t size)
+{
+  memcpy (*ptr, src, size);
+  *ptr += size;
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+  - Module Name:        unpack
+
+  - Date Written:       October 2026
+
+  - Purpose:            Copies size bytes from *ptr to dst and advances *ptr past them.  The
+                        inverse of pack.
+
+  - Arguments:
+                        - ptr                 -   address of the input pointer
+                        - dst                 -   where to put the data
+                        - size                -   number of bytes
+
+*********************************************************************************************/
+
+static inline void binaryFeatureData_unpack (const uint8_t **ptr, void *dst, size_t size)
+{
+  memcpy (dst, *ptr, size);
+  *ptr += size;
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+  - Module Name:        reverse32
+
+  - Date Written:       October 2026
+
+  - Purpose:            Reverses the byte order of a 32 bit value.  Written with shifts and masks
+                        so that compilers turn it into a single byte swap instruction.
+
+  - Arguments:
+                        - value               -   the value
+
+  - Return Value:       The byte swapped value
+
+*********************************************************************************************/
+
+static inline uint32_t binaryFeatureData_reverse32 (uint32_t value)
+{
+  value = ((value & 0x0000ffff) << 16) | (value >> 16);
+
+  return (((value & 0x00ff00ff) << 8) | ((value >> 8) & 0x00ff00ff));
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+  - Module Name:        reverse64
+
+  - Date Written:       October 2026
+
+  - Purpose:            Reverses the byte order of a 64 bit value (see reverse32).
+
+  - Arguments:
+                        - value               -   the value
+
+  - Return Value:       The byte swapped value
+
+*********************************************************************************************/
+
+static inline uint64_t binaryFeatureData_reverse64 (uint64_t value)
+{
+  value = ((value & 0x00000000ffffffffULL) << 32) | (value >> 32);
+  value = ((value & 0x0000ffff0000ffffULL) << 16) | ((value >> 16) & 0x0000ffff0000ffffULL);
+
+  return (((value & 0x00ff00ff00ff00ffULL) << 8) | ((value >> 8) & 0x00ff00ff00ff00ffULL));
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+  - Module Name:        pack_swap
+
+  - Date Written:       October 2026
+
+  - Purpose:            Same as pack but reverses the byte order of the value if swap is set.
+                        The record codecs call this with constant size and swap so it turns
+                        into a plain store or a byte swapped store.  Values other than 8 bytes
+                        are taken to be 4 bytes.
+
+  - Arguments:
+                        - ptr                 -   address of the output pointer
+                        - src                 -   value to copy
+                        - size                -   size of the value in bytes (4 or 8)
+                        - swap                -   1 to reverse the bytes
+
+*********************************************************************************************/
+
+BFDATA_FORCE_INLINE void binaryFeatureData_pack_swap (uint8_t **ptr, const void *src, size_t size, int32_t swap)
+{
+  uint64_t value64;
+  uint32_t value32;
+
+
+  if (swap && size == 8)
+    {
+      memcpy (&value64, src, 8);
+      value64 = binaryFeatureData_reverse64 (value64);
+      memcpy (*ptr, &value64, 8);
+    }
+  else if (swap)
+    {
+      memcpy (&value32, src, 4);
+      value32 = binaryFeatureData_reverse32 (value32);
+      memcpy (*ptr, &value32, 4);
+    }
+  else
+    {
+      memcpy (*ptr, src, size);
+    }
+
+  *ptr += size;
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+  - Module Name:        unpack_swap
+
+  - Date Written:       October 2026
+
+  - Purpose:            Same as unpack but reverses the byte order of the value if swap is set.
+                        The inverse of pack_swap.
+
+  - Arguments:
+                        - ptr                 -   address of the input pointer
+                        - dst                 -   where to put the value
+                        - size                -   size of the value in bytes (4 or 8)
+                        - swap                -   1 to reverse the bytes
+
+*********************************************************************************************/
+
+BFDATA_FORCE_INLINE void binaryFeatureData_unpack_swap (const uint8_t **ptr, void *dst, size_t size, int32_t swap)
+{
+  uint64_t value64;
+  uint32_t value32;
+
+
+  if (swap && size == 8)
+    {
+      memcpy (&value64, *ptr, 8);
+      value64 = binaryFeatureData_reverse64 (value64);
+      memcpy (dst, &value64, 8);
+    }
+  else if (swap)
+    {
+      memcpy (&value32, *ptr, 4);
+      value32 = binaryFeatureData_reverse32 (value32);
+      memcpy (dst, &value32, 4);
+    }
+  else
+    {
+      memcpy (dst, *ptr, size);
+    }
+
+  *ptr += size;
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+  - Module Name:        put_varint
+
+  - Date Written:       October 2026
+
+  - Purpose:            Stores a signed value as a zigzag encoded varint (7 bits per byte, low
+                        bits first, high bit set on all but the last byte) and advances *ptr.
+                        Small magnitudes of either sign take one byte.  At most 10 bytes are
+                        written.
+
+  - Arguments:
+                        - ptr                 -   address of the output pointer
+                        - value               -   value to store
+
+*********************************************************************************************/
+
+static inline void binaryFeatureData_put_varint (uint8_t **ptr, int64_t value)
+{
+  uint64_t zz = ((uint64_t) value << 1) ^ (uint64_t) (value >> 63);
+
+  while (zz >= 0x80)
+    {
+      *(*ptr)++ = (uint8_t) (zz | 0x80);
+      zz >>= 7;
+    }
+
+  *(*ptr)++ = (uint8_t) zz;
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+  - Module Name:        get_varint
+
+  - Date Written:       October 2026
+
+  - Purpose:            Reads a zigzag encoded varint written by put_varint and advances *ptr.
+
+  - Arguments:
+                        - ptr                 -   address of the input pointer
+                        - end                 -   end of the input data
+                        - value               -   the returned value
+
+  - Return Value:
+                        - 1 on success
+                        - 0 if the data ran out or the varint is too long
+
+*********************************************************************************************/
+
+static inline uint8_t binaryFeatureData_get_varint (const uint8_t **ptr, const uint8_t *end, int64_t *value)
+{
+  const uint8_t *p = *ptr;
+  uint64_t zz = 0;
+  int32_t shift;
+
+
+  for (shift = 0 ; p < end && shift < 64 ; shift += 7)
+    {
+      zz |= (uint64_t) (*p & 0x7f) << shift;
+
+      if (!(*p++ & 0x80))
+        {
+          *value = (int64_t) (zz >> 1) ^ -(int64_t) (zz & 1);
+          *ptr = p;
+          return (1);
+        }
+    }
+
+  return (0);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+  - Module Name:        put_le64
+
+  - Date Written:       October 2026
+
+  - Purpose:            Stores a 64 bit value in little endian byte order regardless of the
+                        host byte order and advances *ptr.  Use put_le32 for 32 bit values.
+
+  - Arguments:
+                        - ptr                 -   address of the output pointer
+                        - value               -   value to store
+
+*********************************************************************************************/
+
+static inline void binaryFeatureData_put_le64 (uint8_t **ptr, uint64_t value)
+{
+  int32_t i;
+
+  for (i = 0 ; i < 8 ; i++) *(*ptr)++ = (uint8_t) (value >> (i * 8));
+}
+
+static inline void binaryFeatureData_put_le32 (uint8_t **ptr, uint32_t value)
+{
+  int32_t i;
+
+  for (i = 0 ; i < 4 ; i++) *(*ptr)++ = (uint8_t) (value >> (i * 8));
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+  - Module Name:        get_le64
+
+  - Date Written:       October 2026
+
+  - Purpose:            Reads a 64 bit value stored by put_le64 and advances *ptr.  Use
+                        get_le32 for 32 bit values.
+
+  - Arguments:
+                        - ptr                 -   address of the input pointer
+
+  - Return Value:       The value
+
+*********************************************************************************************/
+
+static inline uint64_t binaryFeatureData_get_le64 (const uint8_t **ptr)
+{
+  uint64_t value = 0;
+  int32_t i;
+
+  for (i = 0 ; i < 8 ; i++) value |= (uint64_t) *(*ptr)++ << (i * 8);
+
+  return (value);
+}
+
+static inline uint32_t binaryFeatureData_get_le32 (const uint8_t **ptr)
+{
+  uint32_t value = 0;
+  int32_t i;
+
+  for (i = 0 ; i < 4 ; i++) value |= (uint32_t) *(*ptr)++ << (i * 8);
+
+  return (value);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+  - Module Name:        fnv1a
+
+  - Date Written:       October 2026
+
+  - Purpose:            32 bit FNV-1a hash.  Call with hash = BFDATA_FNV1A_SEED for the first
+                        block and pass the previous result back in to hash several blocks.
+                        This is a checksum, not a cryptographic hash.
+
+  - Arguments:
+                        - hash                -   previous hash value or BFDATA_FNV1A_SEED
+                        - data                -   data to hash
+                        - size                -   number of bytes
+
+  - Return Value:       The updated hash value
+
+*********************************************************************************************/
+
+#define BFDATA_FNV1A_SEED 2166136261U
+
+static uint32_t binaryFeatureData_fnv1a (uint32_t hash, const void *data, size_t size)
+{
+  const uint8_t *ptr = (const uint8_t *) data;
+  size_t i;
+
+  for (i = 0 ; i < size ; i++)
+    {
+      hash ^= ptr[i];
+      hash *= 16777619U;
+    }
+
+  return (hash);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+  - Module Name:        fnv1a64
+
+  - Date Written:       October 2026
+
+  - Purpose:            64 bit FNV-1a hash.  Same as fnv1a but with fewer collisions for
+                        content hashing.  Call with hash = BFDATA_FNV1A64_SEED for the first
+                        block.
+
+  - Arguments:
+                        - hash                -   previous hash value or BFDATA_FNV1A64_SEED
+                        - data                -   data to hash
+                        - size                -   number of bytes
+
+  - Return Value:       The updated hash value
+
+*********************************************************************************************/
+
+#define BFDATA_FNV1A64_SEED 14695981039346656037ULL
+
+static uint64_t binaryFeatureData_fnv1a64 (uint64_t hash, const void *data, size_t size)
+{
+  const uint8_t *ptr = (const uint8_t *) data;
+  size_t i;
+
+  for (i = 0 ; i < size ; i++)
+    {
+      hash ^= ptr[i];
+      hash *= 1099511628211ULL;
+    }
+
+  return (hash);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+  - Module Name:        polygon_significance
+
+  - Date Written:       October 2026
+
+  - Purpose:            Runs Douglas-Peucker once over a polyline and records, for each point,
+                        the largest tolerance at which Douglas-Peucker would still keep it.
+                        The simplified line for any tolerance t is then just the points with
+                        sig > t so we can build as many levels of detail as we like from one
+                        pass.  Longitudes are scaled by the cosine of the mean latitude so the
+                        distances are (roughly) in degrees of latitude.  The end points get
+                        DBL_MAX.
+
+  - Arguments:
+                        - count               -   number of points
+                        - lat                 -   latitudes
+                        - lon                 -   longitudes
+                        - sig                 -   returned significance of each point
+                        - stack               -   scratch space for 2 * count int32_t values
+
+*********************************************************************************************/
+
+static void binaryFeatureData_polygon_significance (int32_t count, const double *lat, const double *lon, double *sig, int32_t *stack)
+{
+  int32_t i, a, b, k, top = 0;
+  double coslat = 0.0, dx, dy, px, py, t, d, len2, max_d;
+
+
+  if (count < 1) return;
+
+  for (i = 0 ; i < count ; i++)
+    {
+      coslat += lat[i];
+      sig[i] = 0.0;
+    }
+
+  coslat = cos (coslat / count * 0.017453292519943295);
+
+  sig[0] = sig[count - 1] = DBL_MAX;
+
+  if (count < 3) return;
+
+
+  stack[top++] = 0;
+  stack[top++] = count - 1;
+
+  while (top)
+    {
+      b = stack[--top];
+      a = stack[--top];
+
+      dx = (lon[b] - lon[a]) * coslat;
+      dy = lat[b] - lat[a];
+      len2 = dx * dx + dy * dy;
+
+      max_d = -1.0;
+      k = -1;
+
+      for (i = a + 1 ; i < b ; i++)
+        {
+          px = (lon[i] - lon[a]) * coslat;
+          py = lat[i] - lat[a];
+
+
+          /*  Distance to the segment, not the line, so that closed polygons (a == b) work.  */
+
+          t = len2 > 0.0 ? (px * dx + py * dy) / len2 : 0.0;
+          if (t < 0.0) t = 0.0;
+          if (t > 1.0) t = 1.0;
+
+          px -= t * dx;
+          py -= t * dy;
+          d = px * px + py * py;
+
+          if (d > max_d || k < 0)
+            {
+              max_d = d;
+              k = i;
+            }
+        }
+
+
+      /*  A point can't be more significant than the one that split its segment off.  */
+
+      d = max_d > 0.0 ? sqrt (max_d) : 0.0;
+      sig[k] = d < sig[a] && d < sig[b] ? d : (sig[a] < sig[b] ? sig[a] : sig[b]);
+
+      if (k - a > 1)
+        {
+          stack[top++] = a;
+          stack[top++] = k;
+        }
+
+      if (b - k > 1)
+        {
+          stack[top++] = k;
+          stack[top++] = b;
+        }
+    }
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+  - Module Name:        polygon_bounds
+
+  - Date Written:       October 2026
+
+  - Purpose:            Computes the bounding box of a polygon/polyline.  Points with a NaN
+                        latitude or longitude are skipped.
+
+  - Arguments:
+                        - count               -   number of points
+                        - lat                 -   latitudes
+                        - lon                 -   longitudes
+                        - bounds              -   returned bounding box
+
+  - Return Value:       1 if there was at least one valid point, otherwise 0
+
+*********************************************************************************************/
+
+static uint8_t binaryFeatureData_polygon_bounds (int32_t count, const double *lat, const double *lon, BFDATA_POLYGON_BOUNDS *bounds)
+{
+  int32_t i;
+  uint8_t valid = 0;
+
+
+  for (i = 0 ; i < count ; i++)
+    {
+      if (isnan (lat[i]) || isnan (lon[i])) continue;
+
+      if (!valid)
+        {
+          bounds->min_latitude = bounds->max_latitude = lat[i];
+          bounds->min_longitude = bounds->max_longitude = lon[i];
+          valid = 1;
+          continue;
+        }
+
+      if (lat[i] < bounds->min_latitude) bounds->min_latitude = lat[i];
+      if (lat[i] > bounds->max_latitude) bounds->max_latitude = lat[i];
+      if (lon[i] < bounds->min_longitude) bounds->min_longitude = lon[i];
+      if (lon[i] > bounds->max_longitude) bounds->max_longitude = lon[i];
+    }
+
+  return (valid);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+  - Module Name:        point_in_polygon
+
+  - Date Written:       October 2026
+
+  - Purpose:            Even-odd (ray crossing) test of a point against a closed polygon.
+                        Longitudes are treated as plain X values so polygons that cross the
+                        dateline need to use continuous longitudes (e.g. 179 to 181).
+
+  - Arguments:
+                        - count               -   number of polygon points
+                        - plat                -   polygon latitudes
+                        - plon                -   polygon longitudes
+                        - lat                 -   point latitude
+                        - lon                 -   point longitude
+
+  - Return Value:       1 if the point is inside the polygon, otherwise 0
+
+*********************************************************************************************/
+
+static uint8_t binaryFeatureData_point_in_polygon (int32_t count, const double *plat, const double *plon, double lat, double lon)
+{
+  int32_t i, j;
+  uint8_t inside = 0;
+
+
+  for (i = 0, j = count - 1 ; i < count ; j = i++)
+    {
+      if ((plat[i] > lat) != (plat[j] > lat) &&
+          lon < (plon[j] - plon[i]) * (lat - plat[i]) / (plat[j] - plat[i]) + plon[i]) inside = !inside;
+    }
+
+  return (inside);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+  - Module Name:        polygons_overlap
+
+  - Date Written:       October 2026
+
+  - Purpose:            Tests whether two closed polygons overlap (share any area or touch).
+                        They overlap if any pair of edges intersect or if one polygon is
+                        entirely inside the other.
+
+  - Arguments:
+                        - a_count             -   number of points in polygon a
+                        - a_lat               -   polygon a latitudes
+                        - a_lon               -   polygon a longitudes
+                        - b_count             -   number of points in polygon b
+                        - b_lat               -   polygon b latitudes
+                        - b_lon               -   polygon b longitudes
+
+  - Return Value:       1 if the polygons overlap, otherwise 0
+
+*********************************************************************************************/
+
+static uint8_t binaryFeatureData_polygons_overlap (int32_t a_count, const double *a_lat, const double *a_lon, int32_t b_count,
+                                                   const double *b_lat, const double *b_lon)
+{
+  int32_t i, j, k, l;
+  double d1, d2, d3, d4;
+
+
+  for (i = 0, j = a_count - 1 ; i < a_count ; j = i++)
+    {
+      for (k = 0, l = b_count - 1 ; k < b_count ; l = k++)
+        {
+          /*  Which side of each segment the ends of the other segment are on.  */
+
+          d1 = (a_lon[i] - a_lon[j]) * (b_lat[k] - a_lat[j]) - (a_lat[i] - a_lat[j]) * (b_lon[k] - a_lon[j]);
+          d2 = (a_lon[i] - a_lon[j]) * (b_lat[l] - a_lat[j]) - (a_lat[i] - a_lat[j]) * (b_lon[l] - a_lon[j]);
+          d3 = (b_lon[k] - b_lon[l]) * (a_lat[i] - b_lat[l]) - (b_lat[k] - b_lat[l]) * (a_lon[i] - b_lon[l]);
+          d4 = (b_lon[k] - b_lon[l]) * (a_lat[j] - b_lat[l]) - (b_lat[k] - b_lat[l]) * (a_lon[j] - b_lon[l]);
+
+          if (((d1 <= 0.0 && d2 >= 0.0) || (d1 >= 0.0 && d2 <= 0.0)) && ((d3 <= 0.0 && d4 >= 0.0) || (d3 >= 0.0 && d4 <= 0.0)) &&
+              (d1 != 0.0 || d2 != 0.0 || d3 != 0.0 || d4 != 0.0)) return (1);
+        }
+    }
+
+
+  /*  No edges cross so either one is inside the other or they're disjoint.  */
+
+  if (binaryFeatureData_point_in_polygon (b_count, b_lat, b_lon, a_lat[0], a_lon[0])) return (1);
+
+  if (binaryFeatureData_point_in_polygon (a_count, a_lat, a_lon, b_lat[0], b_lon[0])) return (1);
+
+
+  return (0);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+  - Module Name:        unit_vector
+
+  - Date Written:       October 2026
+
+  - Purpose:            Converts a latitude and longitude to a unit vector from the center of
+                        a spherical earth.
+
+  - Arguments:
+                        - lat                 -   latitude in degrees
+                        - lon                 -   longitude in degrees
+                        - v                   -   returned x, y, z
+
+  - Return Value:       None
+
+*********************************************************************************************/
+
+static void binaryFeatureData_unit_vector (double lat, double lon, double *v)
+{
+  double coslat;
+
+
+  lat *= 0.017453292519943295;
+  lon *= 0.017453292519943295;
+
+  coslat = cos (lat);
+
+  v[0] = coslat * cos (lon);
+  v[1] = coslat * sin (lon);
+  v[2] = sin (lat);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+  - Module Name:        leap_year
+
+  - Date Written:       October 2026
+
+  - Purpose:            Checks for a Gregorian leap year.
+
+  - Arguments:
+                        - year                -   4 digit year
+
+  - Return Value:
+                        - 1 if year is a leap year, otherwise 0
+
+*********************************************************************************************/
+
+static inline int32_t binaryFeatureData_leap_year (int64_t year)
+{
+  /*  If the year is evenly divisible by 4 but not by 100, or it's evenly divisible by 400, this is a leap year.  */
+
+  return ((!(year % 4) && (year % 100)) || !(year % 400));
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+  - Module Name:        days_from_civil
+
+  - Date Written:       October 2026
+
+  - Purpose:            Number of days from 1970-01-01 to a (proleptic Gregorian) date using
+                        nothing but integer arithmetic.  Years are counted from March so that
+                        the leap day is the last day of the "year", which makes each 400 year
+                        era a fixed 146097 days.
+
+  - Arguments:
+                        - year                -   4 digit year
+                        - month               -   month (1 - 12)
+                        - mday                -   day of month (1 - 31)
+
+  - Return Value:
+                        - days since 1970-01-01 (negative before then)
+
+*********************************************************************************************/
+
+static inline int64_t binaryFeatureData_days_from_civil (int64_t year, int32_t month, int32_t mday)
+{
+  int64_t era, yoe, doy, doe;
+
+
+  year -= (month <= 2);
+  era = (year >= 0 ? year : year - 399) / 400;
+  yoe = year - era * 400;
+  doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + mday - 1;
+  doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+
+  return (era * 146097 + doe - 719468);
+}
+
+
+
+/********************************************************************************************/
+/*!
+
+  - Module Name:        civil_from_days
+
+  - Date Written:       October 2026
+
+  - Purpose:            The inverse of days_from_civil.
+
+  - Arguments:
+                        - days                -   days since 1970-01-01
+                        - year                -   returned 4 digit year
+                        - month               -   returned month (1 - 12)
+                        - mday                -   returned day of month (1 - 31)
+
+  - Return Value:       None
+
+*********************************************************************************************/
+
+static inline void binaryFeatureData_civil_from_days (int64_t days, int64_t *year, int32_t *month, int32_t *mday)
+{
+  int64_t era, doe, yoe, doy, mp;
+
+
+  days += 719468;
+  era = (days >= 0 ? days : days - 146096) / 146097;
+  doe = days - era * 146097;
+  yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  mp = (5 * doy + 2) / 153;
+
+  *mday = (int32_t) (doy - (153 * mp + 2) / 5 + 1);
+  *month = (int32_t) (mp < 10 ? mp + 3 : mp - 9);
+  *year = yoe + era * 400 + (*month <= 2);
+}
@@ -39,6 +39,11 @@
 #ifndef __BFDATA_INTERNALS_H__
 #define __BFDATA_INTERNALS_H__
 
+#ifndef NVWIN3X
+#include <pthread.h>
+#endif
+
+
 #ifdef  __cplusplus
 extern "C" {
 #endif
@@ -52,6 +57,113 @@ extern "C" {
 #endif
 
 
+/*!  The error state is per thread so that different handles can be used from different threads at the same time (see
+     binaryFeatureData_merge_files).  */
+
+#if defined (_MSC_VER)
+#define         BFDATA_THREAD_LOCAL             __declspec(thread)
+#else
+#define         BFDATA_THREAD_LOCAL             __thread
+#endif
+
+
+/*!  Used for the record codec kernels (see binaryFeatureData_decode_layout) so that each (version, swap) instance is
+     compiled with the layout and byte order as constants.  */
+
+#if defined (_MSC_VER)
+#define         BFDATA_FORCE_INLINE             static __forceinline
+#elif defined (__GNUC__)
+#define         BFDATA_FORCE_INLINE             static inline __attribute__ ((always_inline))
+#else
+#define         BFDATA_FORCE_INLINE             static inline
+#endif
+
+
+/*!  Journal (.bfj) file definitions.  The journal is a transient, native endian file so no swapping is done.  It
+     consists of a BFDATA_JOURNAL_HEADER_SIZE byte header (magic string, record size, header size) followed by record
+     entries (BFDATA_JOURNAL_RECORD, record number, on-disk record, checksum) and commit markers
+     (BFDATA_JOURNAL_COMMIT, number of records, checksum).  */
+
+#define         BFDATA_JOURNAL_MAGIC            "BFDJRNL1"
+#define         BFDATA_JOURNAL_HEADER_SIZE      16
+#define         BFDATA_JOURNAL_RECORD           0x52454331      /*  "REC1"  */
+#define         BFDATA_JOURNAL_COMMIT           0x434f4d31      /*  "COM1"  */
+#define         BFDATA_JOURNAL_CHECKPOINT_SIZE  67108864LL      /*  Checkpoint the journal when it gets bigger than this.  */
+
+
+/*  Read-ahead settings.  Once BFDATA_READ_AHEAD_TRIGGER records in a row have been read in order we start reading
+    BFDATA_READ_AHEAD_SIZE bytes worth of records at a time into the handle's read-ahead buffer.  */
+
+#define         BFDATA_READ_AHEAD_TRIGGER       2
+#define         BFDATA_READ_AHEAD_SIZE          2097152
+
+
+/*  Delta encoded polygon block (see binaryFeatureData_build_polygon).  */
+
+#define         BFDATA_POLY_DELTA_MAGIC         "BFDPOLYZ"
+#define         BFDATA_POLY_DELTA_HEADER_SIZE   24
+
+
+/*  Polygon trailer (see binaryFeatureData_build_trailer) and its meta data section tags.  */
+
+#define         BFDATA_POLY_TRAILER_MAGIC       "BFDPOLYT"
+#define         BFDATA_POLY_SECTION_LOD         1
+#define         BFDATA_POLY_SECTION_BOUNDS      2
+
+
+/*  Polygon bounds file (see binaryFeatureData_save_bounds).  */
+
+#define         BFDATA_BOUNDS_MAGIC             "BFDBNDS1"
+#define         BFDATA_BOUNDS_HEADER_SIZE       16
+
+
+/*!  A record written while a transaction is active (see binaryFeatureData_begin_transaction).  The polygon and image
+     addresses in the record have already been set to where the staged data will land in the .bfa file.  */
+
+typedef struct
+{
+  uint32_t      recnum;                     /*!<  Record number the record will be written to.  */
+  uint32_t      sequence;                   /*!<  Order in which the record was staged.  */
+  BFDATA_RECORD record;                     /*!<  The record as passed to binaryFeatureData_write_record.  */
+} INTERNAL_BFDATA_STAGED;
+
+
+/*!  Image dedup table entry (see binaryFeatureData_set_image_dedup).  An empty slot has a size of 0.  */
+
+typedef struct
+{
+  uint64_t      hash;                       /*!<  64 bit FNV-1a hash of the image.  */
+  int64_t       address;                    /*!<  Address of the image in the .bfa file.  */
+  uint32_t      size;                       /*!<  Image size in bytes.  */
+} INTERNAL_BFDATA_IMAGE_HASH;
+
+
+/*!  Point index (kd-tree) entry (see binaryFeatureData_build_point_index).  */
+
+typedef struct
+{
+  double        v[3];                       /*!<  Feature position as a unit vector.  */
+  uint32_t      recnum;                     /*!<  Record number.  */
+  uint8_t       dim;                        /*!<  Axis this node splits on.  */
+} INTERNAL_BFDATA_KD_POINT;
+
+
+/*!  Nearest neighbor search result.  */
+
+typedef struct
+{
+  double        dist2;                      /*!<  Squared chord distance between the unit vectors.  */
+  uint32_t      recnum;                     /*!<  Record number.  */
+} INTERNAL_BFDATA_NEIGHBOR;
+
+
+/*!  Record codec for one on-disk layout and byte order (see binaryFeatureData_select_codec).  The decoder unpacks a
+     bfdh[hnd].record_size byte on-disk record, the encoder packs one.  */
+
+typedef void (*INTERNAL_BFDATA_DECODER) (const uint8_t *buffer, BFDATA_RECORD *bfd_record);
+typedef void (*INTERNAL_BFDATA_ENCODER) (const BFDATA_RECORD *bfd_record, uint8_t *buffer);
+
+
 /*!  This is the structure we use to keep track of important formatting data for an open BFD file.  */
 
 typedef struct
@@ -71,11 +183,109 @@ typedef struct
   uint16_t      major_version;              /*!<  Major version number for backward compatibility.  */
   uint32_t      header_size;                /*!<  Header size in bytes.  */
   uint32_t      record_size;                /*!<  Record size in bytes.  */
+  int16_t       field_offset[BFDATA_FIELD_COUNT]; /*!<  Offset of each field in the on-disk record (-1 if not stored).  */
+  INTERNAL_BFDATA_DECODER decode;           /*!<  Record decoder for this version and byte order.  */
+  INTERNAL_BFDATA_ENCODER encode;           /*!<  Record encoder for this version and byte order.  */
   BFDATA_SHORT_FEATURE *short_feature;      /*!<  Allocated array of truncated records for fast memory access in applications.  */
   BFDATA_HEADER header;                     /*!<  BFD file header.  */
+  uint8_t       durability;                 /*!<  Durability mode (BFDATA_DURABILITY_NONE, etc.).  */
+  uint32_t      sync_records;               /*!<  Group sync interval in records (BFDATA_DURABILITY_GROUP, 0 = unused).  */
+  uint32_t      sync_msecs;                 /*!<  Group sync interval in milliseconds (BFDATA_DURABILITY_GROUP, 0 = unused).  */
+  uint32_t      unsynced_records;           /*!<  Number of records written since the last sync.  */
+  int64_t       last_sync;                  /*!<  Monotonic time of the last sync in milliseconds.  */
+  uint8_t       read_only;                  /*!<  Set if the file was opened BFDATA_READONLY.  */
+  FILE          *jfp;                       /*!<  Journal file pointer (NULL if journaling is off).  */
+  char          j_path[1024];               /*!<  Journal file name.  */
+  uint32_t      journal_group;              /*!<  Number of journal entries per group commit.  */
+  uint32_t      journal_pending;            /*!<  Number of journal entries written since the last commit.  */
+  uint8_t       transaction;                /*!<  Set if a transaction is active.  */
+  uint32_t      txn_records;                /*!<  Number of records in the file once the transaction commits.  */
+  int64_t       txn_base;                   /*!<  End of the .bfa file when the transaction began.  */
+  INTERNAL_BFDATA_STAGED *staged;           /*!<  Records staged by the active transaction.  */
+  uint32_t      staged_count;               /*!<  Number of staged records.  */
+  uint32_t      staged_alloc;               /*!<  Allocated size of the staged array.  */
+  uint8_t       *staged_data;               /*!<  Polygon and image bytes staged by the active transaction.  */
+  int64_t       staged_data_size;           /*!<  Bytes used in staged_data.  */
+  int64_t       staged_data_alloc;          /*!<  Bytes allocated for staged_data.  */
+  uint32_t      append_size;                /*!<  Append buffer flush threshold in bytes (0 = append mode off).  */
+  uint8_t       *append_records;            /*!<  Buffered appended records (on-disk format).  */
+  uint32_t      append_records_size;        /*!<  Bytes used in append_records.  */
+  uint32_t      append_records_alloc;       /*!<  Bytes allocated for append_records.  */
+  uint8_t       *append_data;               /*!<  Buffered polygons and images for appended records.  */
+  int64_t       append_data_size;           /*!<  Bytes used in append_data.  */
+  int64_t       append_data_alloc;          /*!<  Bytes allocated for append_data.  */
+  int64_t       append_bfa_end;             /*!<  Address in the .bfa file where append_data will be written.  */
+  uint8_t       *ra_buffer;                 /*!<  Read-ahead buffer (on-disk records).  */
+  uint32_t      ra_start;                   /*!<  Record number of the first record in ra_buffer.  */
+  uint32_t      ra_count;                   /*!<  Number of records in ra_buffer (0 = empty).  */
+  uint32_t      ra_next;                    /*!<  Record number we expect to be read next if access is sequential.  */
+  uint32_t      ra_streak;                  /*!<  Number of records read in order.  */
+  uint8_t       ra_advised;                 /*!<  Set once we've told the kernel the file is being read sequentially.  */
+  uint8_t       image_dedup;                /*!<  Set if identical images should share one copy in the .bfa file.  */
+  INTERNAL_BFDATA_IMAGE_HASH *image_hash;   /*!<  Open addressed hash table of stored images.  */
+  uint32_t      image_hash_count;           /*!<  Number of entries in image_hash.  */
+  uint32_t      image_hash_size;            /*!<  Number of slots in image_hash (power of 2).  */
+  uint8_t       poly_encoding;              /*!<  Polygon encoding for writes (BFDATA_POLYGON_RAW, etc.).  */
+  double        poly_scale;                 /*!<  Scale for BFDATA_POLYGON_DELTA.  */
+  uint8_t       *poly_buffer;               /*!<  Scratch buffer for building and reading polygon blocks.  */
+  int64_t       poly_buffer_alloc;          /*!<  Bytes allocated for poly_buffer.  */
+  uint8_t       lod_levels;                 /*!<  Number of level of detail tolerances (0 = off).  */
+  double        lod_tolerance[BFDATA_MAX_LOD_LEVELS]; /*!<  Level of detail tolerances in degrees.  */
+  uint8_t       *lod_buffer;                /*!<  Scratch buffer for building polygon trailers.  */
+  int64_t       lod_buffer_alloc;           /*!<  Bytes allocated for lod_buffer.  */
+  BFDATA_POLYGON *lod_poly;                 /*!<  Scratch polygon for building levels of detail.  */
+  uint8_t       *poly_meta;                 /*!<  Polygon trailer meta data read by binaryFeatureData_read_poly_meta.  */
+  uint32_t      poly_meta_alloc;            /*!<  Bytes allocated for poly_meta.  */
+  uint8_t       poly_bounds_valid;          /*!<  Set once binaryFeatureData_read_all_polygon_bounds has loaded poly_bounds.  */
+  BFDATA_POLYGON_BOUNDS *poly_bounds;       /*!<  Bounding box of every record (see binaryFeatureData_read_all_polygon_bounds).  */
+  uint32_t      poly_bounds_count;          /*!<  Number of records in poly_bounds.  */
+  uint32_t      poly_bounds_alloc;          /*!<  Number of records allocated for poly_bounds.  */
+  char          b_path[1024];               /*!<  Polygon bounds file name (see binaryFeatureData_save_bounds).  */
+  uint32_t      bounds_stamp;               /*!<  [BOUNDS STAMP] from the header (0 = the bounds file can't be used).  */
+  uint32_t      bounds_count;               /*!<  Number of records when the header was read.  */
+  int64_t       last_poly_address;          /*!<  Address of the last polygon written through this handle (0 = none).  */
+  BFDATA_POLYGON_BOUNDS last_poly_bounds;   /*!<  Bounding box of the last polygon written.  */
+  uint8_t       query_valid;                /*!<  Set once the polygon query index has been built.  */
+  double        *query_lat;                 /*!<  Latitudes of the indexed polygons.  */
+  double        *query_lon;                 /*!<  Longitudes of the indexed polygons.  */
+  int64_t       *query_vertex;              /*!<  Index of each record's first point in query_lat/query_lon (number of
+                                                  records + 1, records that aren't indexed have no points).  */
+  BFDATA_POLYGON_BOUNDS query_extent;       /*!<  Bounds of all of the indexed polygons.  */
+  uint32_t      grid_cols;                  /*!<  Number of query index grid columns (0 = no polygons).  */
+  uint32_t      grid_rows;                  /*!<  Number of query index grid rows.  */
+  double        grid_dlon;                  /*!<  Query index grid cell width in degrees.  */
+  double        grid_dlat;                  /*!<  Query index grid cell height in degrees.  */
+  uint32_t      *grid_start;                /*!<  Start of each grid cell's records in grid_record (cells + 1).  */
+  uint32_t      *grid_record;               /*!<  Records whose bounds overlap each grid cell.  */
+  uint32_t      *query_mark;                /*!<  Per record stamps used to skip records already checked.  */
+  uint32_t      query_stamp;                /*!<  Current query stamp.  */
+  uint32_t      *hit_index;                 /*!<  Start of each query point's hits in hit_record.  */
+  uint32_t      hit_index_alloc;            /*!<  Number of entries allocated for hit_index.  */
+  uint32_t      *hit_record;                /*!<  Query results (record numbers).  */
+  uint32_t      hit_record_alloc;           /*!<  Number of entries allocated for hit_record.  */
+  double        *hit_distance;              /*!<  Distances (meters) for nearest neighbor and radius query results.  */
+  uint32_t      hit_distance_alloc;         /*!<  Number of entries allocated for hit_distance.  */
+  uint8_t       point_index_valid;          /*!<  Set once the point index (kd-tree) has been built.  */
+  INTERNAL_BFDATA_KD_POINT *kd_point;       /*!<  The point index.  */
+  uint32_t      kd_count;                   /*!<  Number of points in kd_point.  */
+  INTERNAL_BFDATA_NEIGHBOR *neighbor;       /*!<  Scratch array for nearest neighbor and radius searches.  */
+  uint32_t      neighbor_alloc;             /*!<  Number of entries allocated for neighbor.  */
+  BFDATA_STATS  stats;                      /*!<  I/O statistics (see binaryFeatureData_get_stats).  */
 } INTERNAL_BFDATA_STRUCT;
 
 
+/*!  An instrumented public operation in progress (see binaryFeatureData_begin_operation).  */
+
+typedef struct
+{
+  int32_t       id;                         /*!<  Operation ID (BFDATA_OPERATION_*).  */
+  int32_t       hnd;                        /*!<  File handle (-1 for open and create).  */
+  int32_t       recnum;                     /*!<  Record number (-1 if not applicable).  */
+  int64_t       begin;                      /*!<  Start time in nanoseconds (0 if latency stats are off).  */
+  uint64_t      io;                         /*!<  Handle's I/O byte total at the start.  */
+} INTERNAL_BFDATA_OPERATION;
+
+
 /*!  BFD error handling variables.  */
 
 typedef struct 
@@ -88,6 +298,77 @@ typedef struct
 } BFDATA_ERROR_STRUCT;
 
 
+/*!  Merge (see binaryFeatureData_merge_files) definitions.  Each input has a reader thread that fills a queue of
+     BFDATA_MERGE_QUEUE_SIZE decoded records (and polygons) in output order.  */
+
+#define         BFDATA_MERGE_QUEUE_SIZE         256
+
+typedef struct
+{
+  double        time;                       /*!<  Event time (seconds).  */
+  uint32_t      recnum;                     /*!<  Record number in the input file.  */
+} INTERNAL_BFDATA_MERGE_KEY;
+
+typedef struct
+{
+  BFDATA_RECORD record;                     /*!<  The record.  */
+  double        *poly;                      /*!<  Polygon latitudes followed by longitudes (or NULL).  */
+} INTERNAL_BFDATA_MERGE_SLOT;
+
+typedef struct
+{
+  int32_t       hnd;                        /*!<  Input handle.  */
+  FILE          *ifp;                       /*!<  Separate stream on the input .bfa file for copying images.  */
+  uint32_t      count;                      /*!<  Number of records.  */
+  uint32_t      base;                       /*!<  Output record number of the first record (input order only).  */
+  INTERNAL_BFDATA_MERGE_KEY *key;           /*!<  Records sorted by time (time order only).  */
+  uint32_t      *map;                       /*!<  Output record number of each input record (time order only).  */
+  uint32_t      next;                       /*!<  Next entry in key during the merge.  */
+  BFDATA_POLYGON *poly;                     /*!<  Polygon read buffer.  */
+  INTERNAL_BFDATA_MERGE_SLOT slot[BFDATA_MERGE_QUEUE_SIZE];
+  uint32_t      head;                       /*!<  Number of records put in the queue.  */
+  uint32_t      tail;                       /*!<  Number of records taken out of the queue.  */
+  int32_t       status;                     /*!<  Thread status (BFDATA_SUCCESS or an error).  */
+  BFDATA_ERROR_STRUCT error;                /*!<  Thread error state if status is an error.  */
+  uint8_t       stop;                       /*!<  Set to tell the reader thread to quit.  */
+  uint8_t       running;                    /*!<  Set while there is a thread to join.  */
+#ifndef NVWIN3X
+  pthread_t     thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t ready;                     /*!<  Signalled when a record is added to the queue (or on error).  */
+  pthread_cond_t space;                     /*!<  Signalled when a record is taken out of the queue (or on stop).  */
+#endif
+} INTERNAL_BFDATA_MERGE_INPUT;
+
+
+/*!  Split (see binaryFeatureData_split_file) output tile.  The reader (the calling thread) fills each tile's queue with
+     the records that go in the tile and the tile's writer thread empties it.  */
+
+typedef struct
+{
+  int32_t       hnd;                        /*!<  Output handle.  */
+  FILE          *ifp;                       /*!<  Separate stream on the input .bfa file for copying images.  */
+  const char    *i_path;                    /*!<  Input .bfa file name (for errors).  */
+  uint32_t      count;                      /*!<  Number of records in the tile.  */
+  const uint32_t *record;                   /*!<  Input record numbers of the records in the tile (ascending).  */
+  uint32_t      next;                       /*!<  Next entry in record while reading the input.  */
+  BFDATA_POLYGON *poly;                     /*!<  Polygon write buffer.  */
+  INTERNAL_BFDATA_MERGE_SLOT slot[BFDATA_MERGE_QUEUE_SIZE];
+  uint32_t      head;                       /*!<  Number of records put in the queue.  */
+  uint32_t      tail;                       /*!<  Number of records written.  */
+  int32_t       status;                     /*!<  Thread status (BFDATA_SUCCESS or an error).  */
+  BFDATA_ERROR_STRUCT error;                /*!<  Thread error state if status is an error.  */
+  uint8_t       stop;                       /*!<  Set to tell the writer thread to quit.  */
+  uint8_t       running;                    /*!<  Set while there is a thread to join.  */
+#ifndef NVWIN3X
+  pthread_t     thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t ready;                     /*!<  Signalled when a record is added to the queue (or on stop).  */
+  pthread_cond_t space;                     /*!<  Signalled when a record is taken out of the queue (or on error).  */
+#endif
+} INTERNAL_BFDATA_SPLIT_TILE;
+
+
 #ifdef  __cplusplus
 }
 #endif
@@ -49,6 +49,8 @@ extern "C" {
 #define BFDATA_POLY_VERSION_SIZE       512       /*!<  Polygon file header size  */
 #define BFDATA_NEXT_RECORD             -1        /*!<  Next record flag  */
 #define BFDATA_POLY_ARRAY_SIZE         10000     /*!<  Serious overkill ;-)  */
+#define BFDATA_APPEND_BUFFER_SIZE      4194304   /*!<  Suggested append buffer size (see binaryFeatureData_set_append_buffer)  */
+#define BFDATA_IMAGE_CHUNK_SIZE        65536     /*!<  Default chunk size for binaryFeatureData_read_image_stream  */
 
 
   /*  File open modes.  */
@@ -57,6 +59,26 @@ extern "C" {
 #define BFDATA_READONLY                1         /*!<  Open file read only  */
 
 
+  /*  Durability modes (see binaryFeatureData_set_durability).  */
+
+#define BFDATA_DURABILITY_NONE         0         /*!<  Leave flushing to the C library and the OS (default)  */
+#define BFDATA_DURABILITY_FLUSH        1         /*!<  fflush the BFD and associated files on close  */
+#define BFDATA_DURABILITY_DATASYNC     2         /*!<  fflush and fdatasync the BFD and associated files on close  */
+#define BFDATA_DURABILITY_GROUP        3         /*!<  DATASYNC on close plus a sync every N records or M milliseconds  */
+
+
+  /*  Polygon encodings (see binaryFeatureData_set_polygon_encoding).  */
+
+#define BFDATA_POLYGON_RAW             0         /*!<  Interleaved latitude and longitude doubles (default)  */
+#define BFDATA_POLYGON_DELTA           1         /*!<  Scaled integer deltas stored as zigzag varints  */
+
+#define BFDATA_POLYGON_DEFAULT_SCALE   10000000.0  /*!<  Default delta encoding scale (1.0e-7 degrees, about 1 cm)  */
+
+#define BFDATA_MAX_LOD_LEVELS          8         /*!<  Maximum number of polygon levels of detail  */
+
+#define BFDATA_EARTH_RADIUS            6371008.8 /*!<  Mean earth radius in meters used for feature distances  */
+
+
   /*  Feature types.  */
 
 #define BFDATA_HYDROGRAPHIC            0         /*!<  Hydrographic feature  */
@@ -65,6 +87,73 @@ extern "C" {
 #define BFDATA_FEATURE_TYPES           2         /*!<  Number of feature types  */
 
 
+  /*  BFDATA_RECORD field IDs (see binaryFeatureData_scan and binaryFeatureData_read_record_fields).  */
+
+#define BFDATA_FIELD_CONTACT_ID        0
+#define BFDATA_FIELD_FEATURE_TYPE      1
+#define BFDATA_FIELD_EVENT_TV_SEC      2
+#define BFDATA_FIELD_EVENT_TV_NSEC     3
+#define BFDATA_FIELD_LATITUDE          4
+#define BFDATA_FIELD_LONGITUDE         5
+#define BFDATA_FIELD_LENGTH            6
+#define BFDATA_FIELD_WIDTH             7
+#define BFDATA_FIELD_HEIGHT            8
+#define BFDATA_FIELD_DEPTH             9         /*!<  Datum corrected, as returned by binaryFeatureData_read_record  */
+#define BFDATA_FIELD_DATUM             10
+#define BFDATA_FIELD_HORIZONTAL_ORIENTATION 11
+#define BFDATA_FIELD_VERTICAL_ORIENTATION 12
+#define BFDATA_FIELD_DESCRIPTION       13
+#define BFDATA_FIELD_REMARKS           14
+#define BFDATA_FIELD_SONAR_TYPE        15
+#define BFDATA_FIELD_EQUIP_TYPE        16
+#define BFDATA_FIELD_PLATFORM_TYPE     17
+#define BFDATA_FIELD_NAV_SYSTEM        18
+#define BFDATA_FIELD_HEADING           19
+#define BFDATA_FIELD_CONFIDENCE_LEVEL  20
+#define BFDATA_FIELD_ANALYST_ACTIVITY  21
+#define BFDATA_FIELD_POLY_ADDRESS      22
+#define BFDATA_FIELD_POLY_COUNT        23
+#define BFDATA_FIELD_POLY_TYPE         24
+#define BFDATA_FIELD_IMAGE_ADDRESS     25
+#define BFDATA_FIELD_IMAGE_SIZE        26
+#define BFDATA_FIELD_IMAGE_NAME        27
+#define BFDATA_FIELD_PARENT_RECORD     28
+#define BFDATA_FIELD_CHILD_RECORD      29
+
+#define BFDATA_FIELD_COUNT             30        /*!<  Number of field IDs  */
+
+#define BFDATA_FIELD_MASK(field)       (1U << (field))  /*!<  Field mask bit (see binaryFeatureData_read_record_fields)  */
+#define BFDATA_ALL_FIELDS              ((1U << BFDATA_FIELD_COUNT) - 1)  /*!<  Mask of all of the fields  */
+
+
+  /*  Scan predicate operators (see BFDATA_PREDICATE).  */
+
+#define BFDATA_OP_EQ                   0         /*!<  Equal  */
+#define BFDATA_OP_NE                   1         /*!<  Not equal  */
+#define BFDATA_OP_LT                   2         /*!<  Less than (numeric fields only)  */
+#define BFDATA_OP_LE                   3         /*!<  Less than or equal (numeric fields only)  */
+#define BFDATA_OP_GT                   4         /*!<  Greater than (numeric fields only)  */
+#define BFDATA_OP_GE                   5         /*!<  Greater than or equal (numeric fields only)  */
+#define BFDATA_OP_CONTAINS             6         /*!<  Contains substring (string fields only)  */
+
+
+  /*  Operation IDs (see BFDATA_STATS and BFDATA_TRACE_EVENT).  */
+
+#define BFDATA_OPERATION_OPEN          0         /*!<  binaryFeatureData_open_file, _create_file  */
+#define BFDATA_OPERATION_CLOSE         1         /*!<  binaryFeatureData_close_file  */
+#define BFDATA_OPERATION_READ_RECORD   2         /*!<  binaryFeatureData_read_record, _read_record_fields, _read_record_range  */
+#define BFDATA_OPERATION_WRITE_RECORD  3         /*!<  binaryFeatureData_write_record, _write_record_image_file  */
+#define BFDATA_OPERATION_READ_POLYGON  4         /*!<  binaryFeatureData_read_polygon, _read_polygon_lod  */
+#define BFDATA_OPERATION_READ_IMAGE    5         /*!<  binaryFeatureData_read_image, _read_image_chunk, _read_image_stream  */
+#define BFDATA_OPERATION_READ_SHORT_FEATURES 6   /*!<  binaryFeatureData_read_all_short_features  */
+#define BFDATA_OPERATION_SCAN          7         /*!<  binaryFeatureData_scan, _scan_fields  */
+#define BFDATA_OPERATION_SYNC          8         /*!<  binaryFeatureData_sync, _commit_transaction  */
+
+#define BFDATA_OPERATIONS              9         /*!<  Number of operation IDs  */
+
+#define BFDATA_LATENCY_BUCKETS         32        /*!<  Latency histogram buckets (bucket i counts times of 2^i to 2^(i+1) - 1 ns)  */
+
+
   /*  Error conditions.  */
 
 #define       BFDATA_SUCCESS                      0
@@ -100,6 +189,19 @@ extern "C" {
 #define       BFDATA_IMAGE_READ_ERROR             -30
 #define       BFDATA_IMAGE_FILE_OPEN_ERROR        -31
 #define       BFDATA_IMAGE_FILE_READ_ERROR        -32
+#define       BFDATA_SYNC_ERROR                   -33
+#define       BFDATA_INVALID_DURABILITY_MODE      -34
+#define       BFDATA_JOURNAL_OPEN_ERROR           -35
+#define       BFDATA_JOURNAL_WRITE_ERROR          -36
+#define       BFDATA_JOURNAL_REPLAY_ERROR         -37
+#define       BFDATA_TRANSACTION_ERROR            -38
+#define       BFDATA_MEMORY_ALLOCATION_ERROR      -39
+#define       BFDATA_INVALID_IMAGE_RANGE          -40
+#define       BFDATA_INVALID_POLYGON_ENCODING     -41
+#define       BFDATA_INVALID_LOD                  -42
+#define       BFDATA_INVALID_QUERY                -43
+#define       BFDATA_INVALID_PREDICATE            -44
+#define       BFDATA_INVALID_ENDIAN               -45
 
 
 
@@ -38,7 +38,7 @@
 
 #ifndef BFDATA_VERSION
 
-#define     BFDATA_VERSION "PFM Software - Binary Feature Data library V3.00 - 08/20/16"
+#define     BFDATA_VERSION "PFM Software - Binary Feature Data library V3.25 - 10/19/26"
 
 #endif
 
@@ -143,4 +143,211 @@
       just to pass on information and didn't want the underlying data points marked with any flags
       (e.g. PFM_SELECTED_FEATURE or PFM_DESIGNATED_SOUNDING).
 
+
+    Version 3.01
+    10/19/26
+
+    - Added binaryFeatureData_set_durability and binaryFeatureData_sync so that applications can choose
+      between throughput and safety.  Durability modes are none (the old behavior), flush on close,
+      fdatasync on close, and group sync every N records or M milliseconds.
+    - The header space fill is now written in blocks instead of one byte at a time.
+
+
+    Version 3.02
+    10/19/26
+
+    - Added an optional write-ahead journal (.bfj file, see binaryFeatureData_set_journal).  Records are
+      group committed to the journal and binaryFeatureData_open_file replays committed entries after an
+      unclean shutdown so appended features are no longer lost when [NUMBER OF RECORDS] is stale.
+    - Records are now packed into a buffer and written with a single fwrite.
+    - Fixed binaryFeatureData_ngets reading before the start of the string on empty lines.
+
+
+    Version 3.03
+    10/19/26
+
+    - Added binaryFeatureData_begin_transaction, binaryFeatureData_commit_transaction, and
+      binaryFeatureData_abort_transaction.  Writes made during a transaction are staged in memory and
+      applied at commit with one .bfa write, one write per run of consecutive records, and a single
+      header count update.  With journaling on, the whole transaction is committed to the journal first.
+
+
+    Version 3.04
+    10/19/26
+
+    - Added binaryFeatureData_set_append_buffer for buffered sequential appends.
+    - Fixed write_record writing the polygon poly_count times.
+
+
+    Version 3.05
+    10/19/26
+
+    - Records are now read with a single fread and decoded from memory.
+    - Added adaptive read-ahead for sequential record reads.
+    - Fixed BFDATA_NEXT_RECORD reads always failing with BFDATA_INVALID_RECORD_NUMBER.
+    - Fixed the datum shift being applied before byte swapping.
+
+
+    Version 3.06
+    10/19/26
+
+    - Added binaryFeatureData_read_image_chunk and binaryFeatureData_read_image_stream for partial and
+      progressive image reads.
+
+
+    Version 3.07
+    10/19/26
+
+    - binaryFeatureData_write_record_image_file now copies the image file straight into the .bfa file
+      (copy_file_range or sendfile on Linux, streaming otherwise) instead of reading it into memory.
+    - Memory allocation failures now return BFDATA_MEMORY_ALLOCATION_ERROR instead of exiting.
+
+
+    Version 3.08
+    10/19/26
+
+    - Added binaryFeatureData_set_image_dedup to store identical images only once in the .bfa file.
+
+
+    Version 3.09
+    10/19/26
+
+    - Added binaryFeatureData_set_polygon_encoding and the delta encoded (zigzag varint) polygon format.
+    - Polygons are now written and read with a single fwrite/fread and the caller's polygon is no longer
+      byte swapped in place when writing to a swapped file.
+
+
+    Version 3.10
+    10/19/26
+
+    - Added binaryFeatureData_set_polygon_lod and binaryFeatureData_read_polygon_lod.  Simplified
+      (Douglas-Peucker) versions of each polygon are stored in a trailer in front of the polygon in the
+      .bfa file so older readers are unaffected.
+
+
+    Version 3.11
+    10/19/26
+
+    - Added binaryFeatureData_read_all_polygon_bounds and binaryFeatureData_get_polygon_bounds.  The
+      bounding box of each polygon is stored in its trailer and kept in memory once loaded.
+
+
+    Version 3.12
+    10/19/26
+
+    - Added binaryFeatureData_points_in_polygons and binaryFeatureData_overlapping_polygons.  They use an
+      in-memory grid index of the feature polygons that is built on the first query.
+
+
+    Version 3.13
+    10/19/26
+
+    - Added binaryFeatureData_nearest_features, binaryFeatureData_features_within_radius, and their
+      batch forms.  They use an in-memory kd-tree of the feature positions (as unit vectors) and return
+      great circle distances in meters.
+
+
+    Version 3.14
+    10/19/26
+
+    - Added binaryFeatureData_find_duplicates to group probable duplicate features across open files
+      by distance, event time, and depth.
+
+
+    Version 3.15
+    10/19/26
+
+    - Added binaryFeatureData_merge_files to merge several BFD files into one, optionally ordered by
+      event time.  The inputs are read (and sorted) in parallel and images are copied without decoding.
+    - The error state is now per thread.
+
+
+    Version 3.16
+    10/19/26
+
+    - Added binaryFeatureData_split_file and binaryFeatureData_split_file_grid to split a BFD file into
+      per-tile BFD files in one pass with a writer thread per tile.
+
+
+    Version 3.17
+    10/19/26
+
+    - Added binaryFeatureData_scan to find the records that match a predicate (BFDATA_PREDICATE terms
+      on BFDATA_FIELD_* fields).  Records are tested on their on-disk bytes and only matches are fully
+      decoded.
+
+
+    Version 3.18
+    10/19/26
+
+    - Added binaryFeatureData_read_record_fields, binaryFeatureData_read_record_range, and
+      binaryFeatureData_scan_fields.  They only decode the fields in a mask of BFDATA_FIELD_MASK bits.
+
+
+    Version 3.19
+    10/19/26
+
+    - binaryFeatureData_cvtime and binaryFeatureData_inv_cvtime now use integer calendar arithmetic
+      instead of localtime/mktime with TZ=GMT.  They no longer change the process time zone and are
+      thread safe.  Added binaryFeatureData_cvtime_batch and binaryFeatureData_inv_cvtime_batch.
+
+
+    Version 3.20
+    10/19/26
+
+    - Added binaryFeatureData_set_file_endian so a new file can be written in either byte order.  The
+      [ENDIAN] header tag now reflects the file's byte order instead of the machine's (updating a file
+      from a machine with the other byte order used to mislabel it).
+    - Added bench/bfd_bench.c, a synthetic BFD file generator and microbenchmark with JSON output.
+
+
+    Version 3.21
+    10/19/26
+
+    - Added per handle I/O statistics (BFDATA_STATS: bytes read and written per file, read/write calls,
+      seeks, records decoded and encoded, polygons and images read, header rewrites, and last record and
+      read-ahead cache hits) with binaryFeatureData_get_stats and binaryFeatureData_reset_stats.
+    - Added log2 latency histograms for the public operations (BFDATA_OPERATION_*).  They're off by
+      default, see binaryFeatureData_set_latency_stats.
+
+
+    Version 3.22
+    10/19/26
+
+    - Added binaryFeatureData_set_trace_hooks to have begin/end functions called around the public
+      operations (open, create, close, record reads and writes, polygon and image reads, short
+      features, scans, and syncs) with a BFDATA_TRACE_EVENT (operation, handle, record number,
+      status, and bytes of file I/O).
+
+
+    Version 3.23
+    10/19/26
+
+    - Added binaryFeatureData.hpp, a header only C++17 wrapper (bfdata::BfdFile) that closes the file
+      on destruction, can be moved but not copied, throws bfdata::Error on failure, and has record
+      ranges for range-for and the standard algorithms.
+
+
+    Version 3.24
+    10/19/26
+
+    - Records are now decoded and encoded by a codec picked when the file is created or opened, one for
+      each on-disk layout (pre 2.00, 2.x, 3.x) and byte order, so the per record path no longer checks
+      the version or byte order.  Writing to a byte swapped file no longer swaps the caller's record
+      in place (writing the same record twice used to store it unswapped the second time).
+
+
+    Version 3.25
+    10/19/26
+
+    - binaryFeatureData_write_record and binaryFeatureData_write_record_image_file now take a const polygon
+      and image and never modify them.  Byte swapping is done in the library's own buffers and never
+      touches caller data, so the same polygon and image can be written to files of either byte order
+      without making copies first.  The record is not const.  It still gets the assigned polygon and image
+      addresses, the image name and size (image file), and the feature type fix back.
+    - Polygon bounds are saved on close in a .bfb file next to the BFD file (matched to it by a
+      [BOUNDS STAMP] header tag) so binaryFeatureData_read_all_polygon_bounds and
+      binaryFeatureData_get_polygon_bounds don't have to scan the .bfa file after the file is reopened.
+      Rewriting a record without its polygon no longer throws the in-memory bounds away.
+
 </pre>*/
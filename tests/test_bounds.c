@@ -0,0 +1,254 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of merchantability or fitness for a particular purpose, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+
+/*!
+
+    test_bounds - Test for the polygon bounds file (see
+    binaryFeatureData_read_all_polygon_bounds).
+
+    A file is written with records that have their own polygon, records that point at the
+    previous record's polygon (written with poly set to NULL), and records without one.  After
+    it's closed the bounds have to come back, on a new handle, without reading anything from
+    the .bfa file (or decoding any records).  Rewriting a record without its polygon mustn't
+    make the handle scan again, the bounds file has to be gone until the file is closed, and a
+    bounds file that doesn't go with the file has to be ignored.  Run by "make check".
+
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "binaryFeatureData.h"
+
+
+#define TEST_FILE     "test_bounds.bfd"
+#define TEST_POLY     "test_bounds.bfa"
+#define TEST_BOUNDS   "test_bounds.bfb"
+#define RECORDS       12
+#define POLY_COUNT    4
+
+
+static int32_t failures = 0;
+
+
+#define CHECK(x) do {if (!(x)) {fprintf (stderr, "%s:%d: CHECK (%s) failed\n", __FILE__, __LINE__, #x); failures++;}} while (0)
+
+
+static BFDATA_POLYGON poly;
+
+
+/*  Records 0, 3, 6, ... have their own polygon, 1, 4, 7, ... share the one before them, and the rest have none.  The
+    extra record appended later (RECORDS) has its own polygon.  */
+
+static void fill (int32_t i, BFDATA_RECORD *bfd_record)
+{
+  int32_t j, base = i - (i % 3 == 1);
+
+
+  memset (bfd_record, 0, sizeof (BFDATA_RECORD));
+  sprintf (bfd_record->contact_id, "B%05d", i);
+  bfd_record->latitude = 10.0 + i;
+  bfd_record->longitude = -70.0 - i;
+
+  if (i % 3 != 2 || i == RECORDS)
+    {
+      bfd_record->poly_count = POLY_COUNT;
+      bfd_record->poly_type = 1;
+
+      for (j = 0 ; j < POLY_COUNT ; j++)
+        {
+          poly.latitude[j] = 10.0 + base + (j & 1) * 0.5;
+          poly.longitude[j] = -70.0 - base - (j >> 1) * 0.25;
+        }
+    }
+}
+
+
+static int32_t check_bounds (int32_t i, const BFDATA_POLYGON_BOUNDS *bounds)
+{
+  int32_t base = i - (i % 3 == 1);
+
+
+  if (i % 3 == 2 && i != RECORDS)
+    return (bounds->min_latitude == 10.0 + i && bounds->max_latitude == 10.0 + i && bounds->min_longitude == -70.0 - i &&
+            bounds->max_longitude == -70.0 - i);
+
+  return (bounds->min_latitude == 10.0 + base && bounds->max_latitude == 10.5 + base && bounds->min_longitude == -70.25 - base &&
+          bounds->max_longitude == -70.0 - base);
+}
+
+
+/*  Open the file and check the bounds of the first "count" records.  Returns the number of bytes read from the .bfa
+    file.  */
+
+static uint64_t read_bounds (int32_t count, int32_t use_all)
+{
+  BFDATA_HEADER bfd_header;
+  BFDATA_POLYGON_BOUNDS *all, bounds;
+  BFDATA_STATS stats;
+  int32_t hnd, i;
+
+
+  if ((hnd = binaryFeatureData_open_file (TEST_FILE, &bfd_header, BFDATA_READONLY)) < 0)
+    {
+      binaryFeatureData_perror ();
+      exit (-1);
+    }
+
+  CHECK (bfd_header.number_of_records == (uint32_t) count);
+
+  if (use_all)
+    {
+      CHECK (binaryFeatureData_read_all_polygon_bounds (hnd, &all) == BFDATA_SUCCESS);
+      for (i = 0 ; i < count ; i++) CHECK (check_bounds (i, &all[i]));
+    }
+  else
+    {
+      for (i = 0 ; i < count ; i++)
+        {
+          CHECK (binaryFeatureData_get_polygon_bounds (hnd, i, &bounds) == BFDATA_SUCCESS);
+          CHECK (check_bounds (i, &bounds));
+        }
+    }
+
+  binaryFeatureData_get_stats (hnd, &stats);
+  binaryFeatureData_close_file (hnd);
+
+  return (stats.bfa_bytes_read);
+}
+
+
+int main ()
+{
+  BFDATA_HEADER bfd_header;
+  BFDATA_RECORD bfd_record;
+  BFDATA_POLYGON_BOUNDS *all, bounds;
+  BFDATA_STATS stats;
+  int32_t hnd, i;
+  FILE *fp;
+
+
+  memset (&bfd_header, 0, sizeof (BFDATA_HEADER));
+
+  if ((hnd = binaryFeatureData_create_file (TEST_FILE, bfd_header)) < 0)
+    {
+      binaryFeatureData_perror ();
+      exit (-1);
+    }
+
+  for (i = 0 ; i < RECORDS ; i++)
+    {
+      fill (i, &bfd_record);
+
+      if (i % 3 == 1)
+        {
+          /*  Point at the polygon we just wrote.  */
+
+          CHECK (binaryFeatureData_read_record (hnd, i - 1, &bfd_record) == BFDATA_SUCCESS);
+          bfd_record.latitude = 10.0 + i;
+          bfd_record.longitude = -70.0 - i;
+          CHECK (binaryFeatureData_write_record (hnd, BFDATA_NEXT_RECORD, &bfd_record, NULL, NULL) == BFDATA_SUCCESS);
+        }
+      else
+        {
+          CHECK (binaryFeatureData_write_record (hnd, BFDATA_NEXT_RECORD, &bfd_record, bfd_record.poly_count ? &poly : NULL, NULL) ==
+                 BFDATA_SUCCESS);
+        }
+    }
+
+  CHECK (binaryFeatureData_close_file (hnd) == BFDATA_SUCCESS);
+  CHECK (access (TEST_BOUNDS, F_OK) == 0);
+
+
+  /*  Both ways of getting the bounds have to come from the bounds file.  */
+
+  CHECK (read_bounds (RECORDS, 1) == 0);
+  CHECK (read_bounds (RECORDS, 0) == 0);
+
+
+  /*  Rewrite a record without its polygon and append one with a polygon.  */
+
+  if ((hnd = binaryFeatureData_open_file (TEST_FILE, &bfd_header, BFDATA_UPDATE)) < 0)
+    {
+      binaryFeatureData_perror ();
+      exit (-1);
+    }
+
+  CHECK (binaryFeatureData_read_record (hnd, 3, &bfd_record) == BFDATA_SUCCESS);
+  strcpy (bfd_record.description, "Rewritten");
+
+  binaryFeatureData_reset_stats (hnd);
+
+  CHECK (binaryFeatureData_write_record (hnd, 3, &bfd_record, NULL, NULL) == BFDATA_SUCCESS);
+  CHECK (access (TEST_BOUNDS, F_OK) != 0);
+
+  CHECK (binaryFeatureData_read_all_polygon_bounds (hnd, &all) == BFDATA_SUCCESS);
+  CHECK (check_bounds (3, &all[3]));
+
+  fill (RECORDS, &bfd_record);
+  CHECK (binaryFeatureData_write_record (hnd, BFDATA_NEXT_RECORD, &bfd_record, &poly, NULL) == BFDATA_SUCCESS);
+  CHECK (binaryFeatureData_get_polygon_bounds (hnd, RECORDS, &bounds) == BFDATA_SUCCESS);
+  CHECK (check_bounds (RECORDS, &bounds));
+
+  binaryFeatureData_get_stats (hnd, &stats);
+  CHECK (stats.bfa_bytes_read == 0 && stats.records_decoded == 0);
+
+  CHECK (binaryFeatureData_close_file (hnd) == BFDATA_SUCCESS);
+  CHECK (access (TEST_BOUNDS, F_OK) == 0);
+
+  CHECK (read_bounds (RECORDS + 1, 1) == 0);
+
+
+  /*  A bounds file with the wrong stamp isn't used (the bounds have to come from the .bfa file).  */
+
+  if ((fp = fopen (TEST_BOUNDS, "rb+")) == NULL)
+    {
+      perror (TEST_BOUNDS);
+      exit (-1);
+    }
+  fseek (fp, 8, SEEK_SET);
+  i = getc (fp);
+  fseek (fp, 8, SEEK_SET);
+  fputc (i ^ 0xff, fp);
+  fclose (fp);
+
+  CHECK (read_bounds (RECORDS + 1, 1) > 0);
+
+
+  remove (TEST_FILE);
+  remove (TEST_POLY);
+  remove (TEST_BOUNDS);
+
+
+  if (failures)
+    {
+      fprintf (stderr, "test_bounds: %d failures\n", failures);
+      return (1);
+    }
+
+  printf ("test_bounds: OK\n");
+  return (0);
+}
@@ -0,0 +1,168 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of merchantability or fitness for a particular purpose, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+
+/*!
+
+    test_codec - Round trip test for the record codecs (see BFDATA_RECORD_CODEC).
+
+    Every field of a record is encoded and decoded with each of the six layout/byte order pairs
+    and compared.  The codecs are static so this includes binaryFeatureData.c itself instead of
+    linking with the library.  Run by "make check".
+
+*/
+
+
+#include "binaryFeatureData.c"
+
+
+static int32_t failures = 0;
+
+
+#define CHECK(x) do {if (!(x)) {fprintf (stderr, "%s:%d: version %d swap %d: CHECK (%s) failed\n", __FILE__, __LINE__, \
+                                         codec[i].version, codec[i].swap, #x); failures++;}} while (0)
+
+
+typedef struct
+{
+  int32_t                 version;
+  int32_t                 swap;
+  INTERNAL_BFDATA_ENCODER encode;
+  INTERNAL_BFDATA_DECODER decode;
+} CODEC;
+
+
+int main ()
+{
+  static const CODEC codec[6] =
+    {{1, 0, binaryFeatureData_encode_v1_0, binaryFeatureData_decode_v1_0},
+     {1, 1, binaryFeatureData_encode_v1_1, binaryFeatureData_decode_v1_1},
+     {2, 0, binaryFeatureData_encode_v2_0, binaryFeatureData_decode_v2_0},
+     {2, 1, binaryFeatureData_encode_v2_1, binaryFeatureData_decode_v2_1},
+     {3, 0, binaryFeatureData_encode_v3_0, binaryFeatureData_decode_v3_0},
+     {3, 1, binaryFeatureData_encode_v3_1, binaryFeatureData_decode_v3_1}};
+  BFDATA_RECORD in, out;
+  uint8_t buffer[sizeof (BFDATA_RECORD)], plain[sizeof (BFDATA_RECORD)];
+  int32_t i;
+
+
+  memset (&in, 0, sizeof (BFDATA_RECORD));
+  memcpy (in.contact_id, "ABC123", 7);
+  in.feature_type = BFDATA_INFORMATIONAL;
+  in.event_tv_sec = 1700000000;
+  in.event_tv_nsec = 123456789;
+  in.latitude = 30.123456789;
+  in.longitude = -88.987654321;
+  in.length = 1.5;
+  in.width = 2.5;
+  in.height = 3.5;
+  in.depth = 20.25;
+  in.datum = 0.75;
+  in.horizontal_orientation = 45.0;
+  in.vertical_orientation = 135.0;
+  strcpy (in.description, "Wreck");
+  strcpy (in.remarks, "Remarks text");
+  in.sonar_type = 1;
+  in.equip_type = 2;
+  in.platform_type = 3;
+  in.nav_system = 4;
+  in.heading = 271.5;
+  in.confidence_level = 5;
+  strcpy (in.analyst_activity, "NAVO");
+  in.poly_address = 0x0123456789abLL;
+  in.poly_count = 17;
+  in.poly_type = 1;
+  in.image_address = 0x0fedcba98765LL;
+  in.image_size = 4096;
+  strcpy (in.image_name, "image.jpg");
+  in.parent_record = 0x01020304;
+  in.child_record = 0x05060708;
+
+
+  for (i = 0 ; i < 6 ; i++)
+    {
+      /*  Fill with junk so that anything the encoder doesn't set (or clears after packing) shows up.  */
+
+      memset (buffer, 0xa5, sizeof (buffer));
+      codec[i].encode (&in, buffer);
+
+      memset (&out, 0x5a, sizeof (BFDATA_RECORD));
+      codec[i].decode (buffer, &out);
+
+
+      CHECK (!memcmp (out.contact_id, in.contact_id, sizeof (in.contact_id)));
+      CHECK (out.feature_type == (codec[i].version >= 3 ? in.feature_type : 0));
+      CHECK (out.event_tv_sec == in.event_tv_sec);
+      CHECK (out.event_tv_nsec == in.event_tv_nsec);
+      CHECK (out.latitude == in.latitude);
+      CHECK (out.longitude == in.longitude);
+      CHECK (out.length == in.length);
+      CHECK (out.width == in.width);
+      CHECK (out.height == in.height);
+      CHECK (out.depth == in.depth - in.datum);
+      CHECK (out.datum == in.datum);
+      CHECK (out.horizontal_orientation == in.horizontal_orientation);
+      CHECK (out.vertical_orientation == in.vertical_orientation);
+      CHECK (!memcmp (out.description, in.description, sizeof (in.description)));
+      CHECK (!memcmp (out.remarks, in.remarks, sizeof (in.remarks)));
+      CHECK (out.sonar_type == in.sonar_type);
+      CHECK (out.equip_type == in.equip_type);
+      CHECK (out.platform_type == in.platform_type);
+      CHECK (out.nav_system == in.nav_system);
+      CHECK (out.heading == in.heading);
+      CHECK (out.confidence_level == in.confidence_level);
+      CHECK (!memcmp (out.analyst_activity, in.analyst_activity, sizeof (in.analyst_activity)));
+      CHECK (out.poly_address == in.poly_address);
+      CHECK (out.poly_count == in.poly_count);
+      CHECK (out.poly_type == in.poly_type);
+      CHECK (out.image_address == in.image_address);
+      CHECK (out.image_size == in.image_size);
+      CHECK (!memcmp (out.image_name, in.image_name, sizeof (in.image_name)));
+      CHECK (out.parent_record == in.parent_record);
+      CHECK (out.child_record == in.child_record);
+
+
+      /*  The swapped layout has to differ from the native one (the datum is never swapped so check the latitude).  */
+
+      if (codec[i].swap)
+        {
+          memset (plain, 0xa5, sizeof (plain));
+          codec[i - 1].encode (&in, plain);
+          CHECK (memcmp (buffer, plain, sizeof (BFDATA_RECORD)));
+        }
+
+
+      /*  Pre 2.00 records are sizeof (BFDATA_RECORD) bytes on disk so the tail has to be cleared.  */
+
+      if (codec[i].version < 2) CHECK (buffer[sizeof (BFDATA_RECORD) - 1] == 0);
+    }
+
+
+  if (failures)
+    {
+      fprintf (stderr, "test_codec: %d failures\n", failures);
+      return (1);
+    }
+
+  printf ("test_codec: OK\n");
+  return (0);
+}
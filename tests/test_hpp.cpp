@@ -0,0 +1,265 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of merchantability or fitness for a particular purpose, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+
+/*!
+
+    test_hpp - Test (and example) for the C++ wrapper in binaryFeatureData.hpp.
+
+    Writes a small file through bfdata::BfdFile, then reads it back with range-for, a standard
+    algorithm, and a hand written *it++ loop.  It also checks the move-only ownership: a
+    moved-from BfdFile is closed, moving into an open BfdFile closes it, and close () can be
+    called more than once.  Run by "make check".
+
+*/
+
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "binaryFeatureData.hpp"
+
+
+#define TEST_FILE     "test_hpp.bfd"
+#define TEST_FILE_2   "test_hpp_2.bfd"
+#define RECORDS       20
+
+
+static int32_t failures = 0;
+
+
+#define CHECK(x) do {if (!(x)) {fprintf (stderr, "%s:%d: CHECK (%s) failed\n", __FILE__, __LINE__, #x); failures++;}} while (0)
+
+
+/*  The ownership and iterator requirements can be checked at compile time.  */
+
+static_assert (!std::is_copy_constructible<bfdata::BfdFile>::value, "BfdFile must not be copyable");
+static_assert (!std::is_copy_assignable<bfdata::BfdFile>::value, "BfdFile must not be copy assignable");
+static_assert (std::is_nothrow_move_constructible<bfdata::BfdFile>::value, "BfdFile must be moveable");
+static_assert (std::is_nothrow_move_assignable<bfdata::BfdFile>::value, "BfdFile must be move assignable");
+
+static_assert (std::is_same<std::iterator_traits<bfdata::RecordIterator>::iterator_category, std::input_iterator_tag>::value,
+               "RecordIterator must be an input iterator");
+static_assert (std::is_convertible<decltype (*std::declval<bfdata::RecordIterator &> ()++), BFDATA_RECORD>::value,
+               "*it++ must give a record");
+
+
+static void remove_files (const char *path)
+{
+  char a_path[512];
+
+
+  remove (path);
+  strcpy (a_path, path);
+  a_path[strlen (a_path) - 1] = 'a';
+  remove (a_path);
+  a_path[strlen (a_path) - 1] = 'b';
+  remove (a_path);
+}
+
+
+static void write_file (const char *path)
+{
+  BFDATA_HEADER bfd_header;
+  BFDATA_RECORD bfd_record;
+  std::vector<double> latitude, longitude;
+  std::vector<uint8_t> image;
+
+
+  memset (&bfd_header, 0, sizeof (BFDATA_HEADER));
+
+  bfdata::BfdFile file = bfdata::BfdFile::create (path, bfd_header);
+
+  for (int32_t i = 0 ; i < RECORDS ; i++)
+    {
+      memset (&bfd_record, 0, sizeof (BFDATA_RECORD));
+      bfd_record.latitude = 10.0 + i;
+      bfd_record.longitude = -70.0 - i;
+
+      latitude.assign (i % 5, 10.0 + i);
+      longitude.assign (i % 5, -70.0 - i);
+      for (std::size_t j = 0 ; j < latitude.size () ; j++) latitude[j] += j * 0.001;
+
+      image.assign (i % 3 ? 0 : 100 + i, (uint8_t) i);
+
+      file.write (bfd_record, BFDATA_NEXT_RECORD, latitude, longitude, image);
+
+      CHECK (bfd_record.poly_count == latitude.size ());
+      CHECK (bfd_record.image_size == image.size ());
+      CHECK (!latitude.size () || bfd_record.poly_address > 0);
+    }
+
+  CHECK (file.size () == RECORDS);
+
+  file.close ();
+  CHECK (!file.is_open ());
+}
+
+
+int main ()
+{
+  std::vector<double> latitude, longitude;
+  std::vector<uint8_t> image;
+  uint32_t count;
+
+
+  try
+    {
+      write_file (TEST_FILE);
+      write_file (TEST_FILE_2);
+
+
+      bfdata::BfdFile file = bfdata::BfdFile::open (TEST_FILE);
+
+      CHECK (file.is_open ());
+      CHECK (file.size () == RECORDS);
+
+
+      /*  range-for, with the polygon and image of every record.  */
+
+      count = 0;
+      for (const BFDATA_RECORD &record : file.records ())
+        {
+          CHECK (record.latitude == 10.0 + count);
+          CHECK (record.poly_count == count % 5);
+
+          if (record.poly_count)
+            {
+              bfdata::Polygon poly = file.polygon (count);
+
+              CHECK (poly.size () == record.poly_count);
+              CHECK (poly.latitude[poly.size () - 1] == 10.0 + count + (poly.size () - 1) * 0.001);
+              CHECK (poly.longitude[0] == -70.0 - count);
+
+              file.polygon (count, latitude, longitude);
+              CHECK (latitude.size () == record.poly_count && longitude.size () == record.poly_count);
+            }
+
+          file.image (count, image);
+          CHECK (image.size () == record.image_size);
+          CHECK (std::all_of (image.begin (), image.end (), [count] (uint8_t byte) {return (byte == count);}));
+
+          count++;
+        }
+      CHECK (count == RECORDS);
+
+
+      /*  A standard algorithm over a sub-range.  */
+
+      bfdata::RecordRange range = file.records (5, 15);
+
+      CHECK (range.size () == 10);
+      CHECK (std::count_if (range.begin (), range.end (), [] (const BFDATA_RECORD &record) {return (record.poly_count != 0);}) == 8);
+
+
+      /*  *it++ has to give the record the iterator pointed to before the increment.  */
+
+      bfdata::RecordRange all = file.records ();
+
+      count = 0;
+      for (bfdata::RecordIterator it = all.begin () ; it != all.end () ; )
+        {
+          BFDATA_RECORD record = *it++;
+
+          CHECK (record.latitude == 10.0 + count);
+          CHECK (it == all.end () || it->latitude == 10.0 + count + 1);
+          count++;
+        }
+      CHECK (count == RECORDS);
+
+
+      /*  Moving transfers the handle and leaves the source closed.  */
+
+      int32_t hnd = file.handle ();
+
+      bfdata::BfdFile moved (std::move (file));
+
+      CHECK (!file.is_open ());
+      CHECK (moved.is_open () && moved.handle () == hnd);
+      CHECK (moved.read (3).latitude == 13.0);
+
+
+      /*  Move assigning into an open file closes it first.  */
+
+      bfdata::BfdFile other = bfdata::BfdFile::open (TEST_FILE_2);
+
+      other = std::move (moved);
+
+      CHECK (!moved.is_open ());
+      CHECK (other.handle () == hnd);
+
+
+      /*  If it didn't we'd run out of handles here.  */
+
+      bfdata::BfdFile reused;
+
+      for (int32_t i = 0 ; i < 2 * BFDATA_MAX_FILES ; i++) reused = bfdata::BfdFile::open (TEST_FILE_2);
+
+      CHECK (reused.is_open ());
+      reused.close ();
+
+
+      /*  close () reports errors, closing twice (or closing a moved-from file) does nothing.  */
+
+      other.close ();
+      CHECK (!other.is_open ());
+      other.close ();
+      file.close ();
+
+
+      /*  Errors come back as exceptions with the BFDATA_* code.  */
+
+      try
+        {
+          bfdata::BfdFile::open ("test_hpp_missing.bfd");
+          CHECK (false);
+        }
+      catch (const bfdata::Error &error)
+        {
+          CHECK (error.code () < 0);
+        }
+    }
+  catch (const bfdata::Error &error)
+    {
+      fprintf (stderr, "test_hpp: unexpected error %d: %s\n", error.code (), error.what ());
+      failures++;
+    }
+
+
+  remove_files (TEST_FILE);
+  remove_files (TEST_FILE_2);
+
+
+  if (failures)
+    {
+      fprintf (stderr, "test_hpp: %d failures\n", failures);
+      return (1);
+    }
+
+  printf ("test_hpp: OK\n");
+  return (0);
+}
@@ -0,0 +1,236 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of merchantability or fitness for a particular purpose, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+
+/*!
+
+    test_journal - Test for journal replay in binaryFeatureData_open_file.
+
+    A child process writes records to a journaled file and then "crashes" (_exit without
+    closing, so anything still sitting in the stdio buffers is lost).  Reopening the file for
+    update has to replay the committed groups: the record count, the records, and their
+    polygons have to be there, the header has to keep its creation time, and the journal has
+    to be gone.  A journal that can't be replayed has to fail the open without using up a
+    handle.  Run by "make check".
+
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "binaryFeatureData.h"
+
+
+#define TEST_FILE     "test_journal.bfd"
+#define TEST_POLY     "test_journal.bfa"
+#define TEST_JOURNAL  "test_journal.bfj"
+#define TEST_BOUNDS   "test_journal.bfb"
+#define GROUP         4
+#define RECORDS       10
+#define COMMITTED     ((RECORDS / GROUP) * GROUP)
+#define POLY_COUNT    3
+
+
+static int32_t failures = 0;
+
+
+#define CHECK(x) do {if (!(x)) {fprintf (stderr, "%s:%d: CHECK (%s) failed\n", __FILE__, __LINE__, #x); failures++;}} while (0)
+
+
+static BFDATA_POLYGON poly;
+
+
+static void fill_record (int32_t i, BFDATA_RECORD *bfd_record)
+{
+  memset (bfd_record, 0, sizeof (BFDATA_RECORD));
+  sprintf (bfd_record->contact_id, "C%05d", i);
+  sprintf (bfd_record->description, "Record %d", i);
+  bfd_record->latitude = 30.0 + i * 0.01;
+  bfd_record->longitude = -88.0 - i * 0.01;
+  bfd_record->depth = 10.0 + i;
+  bfd_record->poly_count = POLY_COUNT;
+  bfd_record->poly_type = 1;
+}
+
+
+static void fill_poly (int32_t i)
+{
+  int32_t j;
+
+
+  for (j = 0 ; j < POLY_COUNT ; j++)
+    {
+      poly.latitude[j] = 30.0 + i * 0.01 + j * 0.001;
+      poly.longitude[j] = -88.0 - i * 0.01 - j * 0.001;
+    }
+}
+
+
+/*  Reopen the (empty) file, write RECORDS records with journaling on, and exit without closing the file.  */
+
+static void crash_writer ()
+{
+  BFDATA_HEADER bfd_header;
+  BFDATA_RECORD bfd_record;
+  int32_t hnd, i;
+
+
+  if ((hnd = binaryFeatureData_open_file (TEST_FILE, &bfd_header, BFDATA_UPDATE)) < 0) _exit (2);
+  if (binaryFeatureData_set_journal (hnd, GROUP) < 0) _exit (3);
+
+  for (i = 0 ; i < RECORDS ; i++)
+    {
+      fill_record (i, &bfd_record);
+      fill_poly (i);
+
+      if (binaryFeatureData_write_record (hnd, BFDATA_NEXT_RECORD, &bfd_record, &poly, NULL) < 0) _exit (4);
+    }
+
+  _exit (0);
+}
+
+
+int main ()
+{
+  BFDATA_HEADER bfd_header;
+  BFDATA_RECORD bfd_record, expected;
+  BFDATA_POLYGON read_poly;
+  int32_t hnd, i, j, status;
+  time_t creation;
+  pid_t pid;
+  FILE *fp;
+
+
+  remove (TEST_JOURNAL);
+
+
+  /*  The header times are only set on close so create an empty file first.  */
+
+  memset (&bfd_header, 0, sizeof (BFDATA_HEADER));
+  strcpy (bfd_header.creation_software, "test_journal");
+
+  if ((hnd = binaryFeatureData_create_file (TEST_FILE, bfd_header)) < 0 || binaryFeatureData_close_file (hnd) < 0)
+    {
+      binaryFeatureData_perror ();
+      exit (-1);
+    }
+
+  if ((hnd = binaryFeatureData_open_file (TEST_FILE, &bfd_header, BFDATA_READONLY)) < 0)
+    {
+      binaryFeatureData_perror ();
+      exit (-1);
+    }
+
+  creation = bfd_header.creation_tv_sec;
+  binaryFeatureData_close_file (hnd);
+
+
+  if ((pid = fork ()) < 0)
+    {
+      perror ("fork");
+      exit (-1);
+    }
+
+  if (!pid) crash_writer ();
+
+  waitpid (pid, &status, 0);
+  CHECK (WIFEXITED (status) && WEXITSTATUS (status) == 0);
+  CHECK (access (TEST_JOURNAL, F_OK) == 0);
+
+
+  /*  Replay.  */
+
+  if ((hnd = binaryFeatureData_open_file (TEST_FILE, &bfd_header, BFDATA_UPDATE)) < 0)
+    {
+      binaryFeatureData_perror ();
+      exit (-1);
+    }
+
+  CHECK (access (TEST_JOURNAL, F_OK) != 0);
+  CHECK (bfd_header.number_of_records >= COMMITTED && bfd_header.number_of_records <= RECORDS);
+  CHECK (creation > 0 && bfd_header.creation_tv_sec == creation);
+  CHECK (!strcmp (bfd_header.creation_software, "test_journal"));
+
+  for (i = 0 ; i < COMMITTED ; i++)
+    {
+      fill_record (i, &expected);
+      fill_poly (i);
+
+      CHECK (binaryFeatureData_read_record (hnd, i, &bfd_record) == BFDATA_SUCCESS);
+      CHECK (!strcmp (bfd_record.contact_id, expected.contact_id));
+      CHECK (!strcmp (bfd_record.description, expected.description));
+      CHECK (bfd_record.latitude == expected.latitude);
+      CHECK (bfd_record.longitude == expected.longitude);
+      CHECK (bfd_record.depth == expected.depth);
+      CHECK (bfd_record.poly_count == POLY_COUNT);
+
+      CHECK (binaryFeatureData_read_polygon (hnd, i, &read_poly) == BFDATA_SUCCESS);
+      for (j = 0 ; j < POLY_COUNT ; j++)
+        {
+          CHECK (read_poly.latitude[j] == poly.latitude[j]);
+          CHECK (read_poly.longitude[j] == poly.longitude[j]);
+        }
+    }
+
+  CHECK (binaryFeatureData_close_file (hnd) == BFDATA_SUCCESS);
+
+
+  /*  A journal we can't replay fails the open.  It must not use up a handle (more failures than there are handles and
+      then a good open).  */
+
+  for (i = 0 ; i < 2 * BFDATA_MAX_FILES ; i++)
+    {
+      if ((fp = fopen (TEST_JOURNAL, "wb")) == NULL)
+        {
+          perror (TEST_JOURNAL);
+          exit (-1);
+        }
+      for (j = 0 ; j < 64 ; j++) fputc ('x', fp);
+      fclose (fp);
+
+      CHECK (binaryFeatureData_open_file (TEST_FILE, &bfd_header, BFDATA_UPDATE) == BFDATA_JOURNAL_REPLAY_ERROR);
+    }
+
+  remove (TEST_JOURNAL);
+
+  CHECK ((hnd = binaryFeatureData_open_file (TEST_FILE, &bfd_header, BFDATA_UPDATE)) >= 0);
+  if (hnd >= 0) binaryFeatureData_close_file (hnd);
+
+
+  remove (TEST_FILE);
+  remove (TEST_POLY);
+  remove (TEST_BOUNDS);
+
+
+  if (failures)
+    {
+      fprintf (stderr, "test_journal: %d failures\n", failures);
+      return (1);
+    }
+
+  printf ("test_journal: OK\n");
+  return (0);
+}
@@ -0,0 +1,214 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of merchantability or fitness for a particular purpose, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+
+/*!
+
+    test_polygon - Round trip test for delta encoded polygons (see
+    binaryFeatureData_set_polygon_encoding).
+
+    Polygons are encoded with binaryFeatureData_encode_block, decoded, and then written to a
+    file and read back.  The cases are a normal outline (delta encoded), a polygon that only
+    just scales to under the 4.0e18 limit (delta encoded), and polygons that scale past the
+    limit, where the differences could overflow 64 bits, so they have to be stored raw.  The
+    encoder is static so this includes binaryFeatureData.c itself instead of linking with the
+    library.  Run by "make check".
+
+*/
+
+
+#include "binaryFeatureData.c"
+
+
+#define TEST_FILE     "test_polygon.bfd"
+#define TEST_POLY     "test_polygon.bfa"
+#define TEST_BOUNDS   "test_polygon.bfb"
+#define POLY_COUNT    10
+#define CASES         4
+
+
+static int32_t failures = 0;
+
+
+#define CHECK(x) do {if (!(x)) {fprintf (stderr, "%s:%d: case %d: CHECK (%s) failed\n", __FILE__, __LINE__, i, #x); \
+                                failures++;}} while (0)
+
+
+static BFDATA_POLYGON poly[CASES], read_poly;
+static uint8_t block[BFDATA_POLY_DELTA_HEADER_SIZE + POLY_COUNT * 20];
+
+
+/*  Fill in the polygon for case i and return the scale to use with it.  */
+
+static double fill_poly (int32_t i, BFDATA_POLYGON *p)
+{
+  int32_t j;
+
+
+  for (j = 0 ; j < POLY_COUNT ; j++)
+    {
+      switch (i)
+        {
+          /*  A normal outline at the default scale.  */
+
+        case 0:
+          p->latitude[j] = 30.0 + j * 0.0001;
+          p->longitude[j] = -88.0 - j * 0.0001;
+          break;
+
+
+          /*  Just under the limit (3.999e18) at the maximum scale.  Only the first difference is big.  */
+
+        case 1:
+          p->latitude[j] = 3999.0;
+          p->longitude[j] = -3999.0;
+          break;
+
+
+          /*  Over the limit and swinging from one side to the other.  With the old 9.0e18 limit these were delta encoded
+              and the differences (about 1.6e19) overflowed.  */
+
+        case 2:
+          p->latitude[j] = j & 1 ? -8000.0 : 8000.0;
+          p->longitude[j] = j & 1 ? 8000.0 : -8000.0;
+          break;
+
+
+          /*  Mostly small but with one point over the limit.  */
+
+        case 3:
+          p->latitude[j] = j == POLY_COUNT / 2 ? 5000.0 : 1.0 + j * 0.001;
+          p->longitude[j] = 2.0 + j * 0.001;
+          break;
+        }
+    }
+
+  return (i ? 1.0e15 : 0.0);
+}
+
+
+static int32_t same_poly (const BFDATA_POLYGON *a, const BFDATA_POLYGON *b, double scale)
+{
+  double tolerance = scale == 0.0 ? 1.0 / BFDATA_POLYGON_DEFAULT_SCALE : 1.0 / scale;
+  int32_t j;
+
+
+  for (j = 0 ; j < POLY_COUNT ; j++)
+    {
+      if (fabs (a->latitude[j] - b->latitude[j]) > tolerance || fabs (a->longitude[j] - b->longitude[j]) > tolerance)
+        return (0);
+    }
+
+  return (1);
+}
+
+
+int main ()
+{
+  BFDATA_HEADER bfd_header;
+  BFDATA_RECORD bfd_record;
+  int64_t size, raw_size = POLY_COUNT * 2 * sizeof (double);
+  int32_t hnd, i;
+  double scale[CASES];
+
+
+  memset (&bfd_header, 0, sizeof (BFDATA_HEADER));
+
+  if ((hnd = binaryFeatureData_create_file (TEST_FILE, bfd_header)) < 0)
+    {
+      binaryFeatureData_perror ();
+      exit (-1);
+    }
+
+
+  for (i = 0 ; i < CASES ; i++)
+    {
+      scale[i] = fill_poly (i, &poly[i]);
+
+      CHECK (binaryFeatureData_set_polygon_encoding (hnd, BFDATA_POLYGON_DELTA, scale[i]) == BFDATA_SUCCESS);
+
+
+      /*  Cases 0 and 1 have to be delta encoded, 2 and 3 have to fall back to raw storage.  */
+
+      size = binaryFeatureData_encode_block (hnd, POLY_COUNT, &poly[i], block);
+
+      if (i < 2)
+        {
+          CHECK (size < raw_size);
+          CHECK (!memcmp (block, BFDATA_POLY_DELTA_MAGIC, 8));
+        }
+      else
+        {
+          CHECK (size == raw_size);
+          CHECK (memcmp (block, BFDATA_POLY_DELTA_MAGIC, 8));
+        }
+
+      memset (&read_poly, 0, sizeof (BFDATA_POLYGON));
+      CHECK (binaryFeatureData_decode_polygon (hnd, POLY_COUNT, block, size, &read_poly));
+      CHECK (same_poly (&read_poly, &poly[i], scale[i]));
+
+
+      memset (&bfd_record, 0, sizeof (BFDATA_RECORD));
+      sprintf (bfd_record.contact_id, "P%d", i);
+      bfd_record.latitude = poly[i].latitude[0];
+      bfd_record.longitude = poly[i].longitude[0];
+      bfd_record.poly_count = POLY_COUNT;
+      bfd_record.poly_type = 1;
+
+      CHECK (binaryFeatureData_write_record (hnd, BFDATA_NEXT_RECORD, &bfd_record, &poly[i], NULL) == BFDATA_SUCCESS);
+    }
+
+  CHECK (binaryFeatureData_close_file (hnd) == BFDATA_SUCCESS);
+
+
+  /*  And back from the file.  */
+
+  if ((hnd = binaryFeatureData_open_file (TEST_FILE, &bfd_header, BFDATA_READONLY)) < 0)
+    {
+      binaryFeatureData_perror ();
+      exit (-1);
+    }
+
+  for (i = 0 ; i < CASES ; i++)
+    {
+      memset (&read_poly, 0, sizeof (BFDATA_POLYGON));
+      CHECK (binaryFeatureData_read_polygon (hnd, i, &read_poly) == BFDATA_SUCCESS);
+      CHECK (same_poly (&read_poly, &poly[i], scale[i]));
+    }
+
+  binaryFeatureData_close_file (hnd);
+
+
+  remove (TEST_FILE);
+  remove (TEST_POLY);
+  remove (TEST_BOUNDS);
+
+
+  if (failures)
+    {
+      fprintf (stderr, "test_polygon: %d failures\n", failures);
+      return (1);
+    }
+
+  printf ("test_polygon: OK\n");
+  return (0);
+}
@@ -0,0 +1,216 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of merchantability or fitness for a particular purpose, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+
+/*!
+
+    test_write_record - Regression test for binaryFeatureData_write_record and
+    binaryFeatureData_write_record_image_file.
+
+    Both functions have to hand the polygon and image addresses (and the image name and size for
+    the image file version) back in bfd_record while leaving the polygon and image alone.  An
+    application that writes a record with a polygon and then writes the same structure again with
+    poly set to NULL (to change something other than the polygon) depends on that, otherwise the
+    second write stores a zero polygon address.  This is checked for normal writes, append
+    buffered writes, and transactions in both byte orders.  Run by "make check".
+
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "binaryFeatureData.h"
+
+
+#define TEST_FILE   "test_write_record.bfd"
+#define TEST_IMAGE  "test_write_record.img"
+#define IMAGE_SIZE  300
+#define POLY_COUNT  5
+
+
+static int32_t failures = 0;
+
+
+#define CHECK(x) do {if (!(x)) {fprintf (stderr, "%s:%d: mode %d: CHECK (%s) failed\n", __FILE__, __LINE__, mode, #x); failures++;}} while (0)
+
+
+static BFDATA_POLYGON poly, poly_copy, read_poly;
+
+
+int main ()
+{
+  BFDATA_HEADER bfd_header;
+  BFDATA_RECORD bfd_record, bfd_copy, read_record;
+  uint8_t image[IMAGE_SIZE], image_copy[IMAGE_SIZE], read_image[IMAGE_SIZE];
+  int32_t hnd, mode, big, kind, i, j;
+  char path[512];
+  FILE *fp;
+
+
+  for (i = 0 ; i < IMAGE_SIZE ; i++) image[i] = (uint8_t) (i * 7);
+
+  if ((fp = fopen (TEST_IMAGE, "wb")) == NULL || fwrite (image, IMAGE_SIZE, 1, fp) != 1)
+    {
+      perror (TEST_IMAGE);
+      exit (-1);
+    }
+  fclose (fp);
+
+
+  /*  Bit 0 of mode is the byte order, the rest is 0 for normal writes, 1 for the append buffer, and 2 for a
+      transaction.  */
+
+  for (mode = 0 ; mode < 6 ; mode++)
+    {
+      big = mode & 1;
+      kind = mode >> 1;
+
+      memset (&bfd_header, 0, sizeof (BFDATA_HEADER));
+
+      if ((hnd = binaryFeatureData_create_file (TEST_FILE, bfd_header)) < 0)
+        {
+          binaryFeatureData_perror ();
+          exit (-1);
+        }
+
+      CHECK (binaryFeatureData_set_file_endian (hnd, big) == BFDATA_SUCCESS);
+      if (kind == 1) CHECK (binaryFeatureData_set_append_buffer (hnd, 1 << 16) == BFDATA_SUCCESS);
+      if (kind == 2) CHECK (binaryFeatureData_begin_transaction (hnd) == BFDATA_SUCCESS);
+
+
+      memset (&bfd_record, 0, sizeof (BFDATA_RECORD));
+      strcpy (bfd_record.contact_id, "test");
+      bfd_record.latitude = 12.5;
+      bfd_record.longitude = -70.25;
+      bfd_record.depth = 10.0;
+      bfd_record.heading = 90.0;
+      bfd_record.feature_type = 77;
+      bfd_record.poly_count = POLY_COUNT;
+      bfd_record.image_size = IMAGE_SIZE;
+
+      for (i = 0 ; i < POLY_COUNT ; i++)
+        {
+          poly.latitude[i] = 12.5 + i * 0.001;
+          poly.longitude[i] = -70.25 - i * 0.001;
+        }
+
+      bfd_copy = bfd_record;
+      poly_copy = poly;
+      memcpy (image_copy, image, IMAGE_SIZE);
+
+
+      /*  Record 0 has a polygon and an image.  The addresses and the feature type fix have to come back to us but
+          nothing else may change.  */
+
+      CHECK (binaryFeatureData_write_record (hnd, BFDATA_NEXT_RECORD, &bfd_record, &poly, image) == BFDATA_SUCCESS);
+      CHECK (bfd_record.poly_address > 0);
+      CHECK (bfd_record.image_address >= 0);
+      CHECK (bfd_record.feature_type == BFDATA_HYDROGRAPHIC);
+
+      bfd_copy.poly_address = bfd_record.poly_address;
+      bfd_copy.image_address = bfd_record.image_address;
+      bfd_copy.feature_type = bfd_record.feature_type;
+      CHECK (!memcmp (&bfd_record, &bfd_copy, sizeof (BFDATA_RECORD)));
+      CHECK (!memcmp (&poly, &poly_copy, sizeof (BFDATA_POLYGON)));
+      CHECK (!memcmp (image, image_copy, IMAGE_SIZE));
+
+
+      /*  Record 1 is the same structure written again without the polygon and image.  It has to point at record 0's
+          polygon and image.  */
+
+      bfd_record.depth = 11.0;
+      CHECK (binaryFeatureData_write_record (hnd, BFDATA_NEXT_RECORD, &bfd_record, NULL, NULL) == BFDATA_SUCCESS);
+
+
+      /*  Record 2 takes its image from a file.  The image name, size, and address have to come back to us.  */
+
+      strcpy (bfd_record.image_name, "none");
+      bfd_record.image_size = 0;
+      bfd_record.image_address = -1;
+      CHECK (binaryFeatureData_write_record_image_file (hnd, BFDATA_NEXT_RECORD, &bfd_record, &poly, TEST_IMAGE) == BFDATA_SUCCESS);
+      CHECK (!strcmp (bfd_record.image_name, TEST_IMAGE));
+      CHECK (bfd_record.image_size == IMAGE_SIZE);
+      CHECK (bfd_record.image_address >= 0);
+
+
+      /*  Record 3 is that structure written again without the polygon and image.  */
+
+      CHECK (binaryFeatureData_write_record (hnd, BFDATA_NEXT_RECORD, &bfd_record, NULL, NULL) == BFDATA_SUCCESS);
+
+
+      if (kind == 2) CHECK (binaryFeatureData_commit_transaction (hnd) == BFDATA_SUCCESS);
+      CHECK (binaryFeatureData_close_file (hnd) == BFDATA_SUCCESS);
+
+
+      if ((hnd = binaryFeatureData_open_file (TEST_FILE, &bfd_header, BFDATA_READONLY)) < 0)
+        {
+          binaryFeatureData_perror ();
+          exit (-1);
+        }
+
+      CHECK (bfd_header.number_of_records == 4);
+
+      for (i = 0 ; i < 4 ; i++)
+        {
+          CHECK (binaryFeatureData_read_record (hnd, i, &read_record) == BFDATA_SUCCESS);
+          CHECK (read_record.poly_count == POLY_COUNT);
+          CHECK (read_record.image_size == IMAGE_SIZE);
+          CHECK (read_record.feature_type == BFDATA_HYDROGRAPHIC);
+          CHECK (read_record.poly_address > 0);
+
+          memset (&read_poly, 0, sizeof (BFDATA_POLYGON));
+          CHECK (binaryFeatureData_read_polygon (hnd, i, &read_poly) == BFDATA_SUCCESS);
+          for (j = 0 ; j < POLY_COUNT ; j++)
+            {
+              CHECK (read_poly.latitude[j] == poly.latitude[j]);
+              CHECK (read_poly.longitude[j] == poly.longitude[j]);
+            }
+
+          memset (read_image, 0, IMAGE_SIZE);
+          CHECK (binaryFeatureData_read_image (hnd, i, read_image) == BFDATA_SUCCESS);
+          CHECK (!memcmp (read_image, image, IMAGE_SIZE));
+        }
+
+      binaryFeatureData_close_file (hnd);
+    }
+
+
+  remove (TEST_IMAGE);
+  remove (TEST_FILE);
+  strcpy (path, TEST_FILE);
+  path[strlen (path) - 1] = 'a';
+  remove (path);
+  path[strlen (path) - 1] = 'b';
+  remove (path);
+
+
+  if (failures)
+    {
+      fprintf (stderr, "test_write_record: %d failures\n", failures);
+      return (1);
+    }
+
+  printf ("test_write_record: OK\n");
+  return (0);
+}